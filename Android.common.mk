@@ -130,4 +130,9 @@ LOCAL_CPPFLAGS += \
 	-DDISABLE_CURSOR_PLANE
 endif
 
+ifeq ($(strip $(BOARD_USES_HEADLESS_WSI)), true)
+LOCAL_CPPFLAGS += \
+	-DUSE_HEADLESS_WSI
+endif
+
 endif
@@ -81,15 +81,25 @@ LOCAL_SRC_FILES := \
 	core/mosaicdisplay.cpp \
         core/overlaylayer.cpp \
 	core/nesteddisplay.cpp \
+	core/nestedprotocol.cpp \
+	core/nestedreplythread.cpp \
         display/displayplanemanager.cpp \
 	display/displayplanestate.cpp \
         display/displayqueue.cpp \
+        display/framecapture.cpp \
+        display/framestatistics.cpp \
+        display/layerupdatetracker.cpp \
+        display/nativesurfacepool.cpp \
+        display/panelfitter.cpp \
+        display/refreshrategovernor.cpp \
         display/vblankeventhandler.cpp \
         display/virtualdisplay.cpp \
         utils/fdhandler.cpp \
         utils/hwcevent.cpp \
         utils/hwcthread.cpp \
+        utils/hwctracebuffer.cpp \
         utils/hwcutils.cpp \
+        utils/sharedfence.cpp \
         utils/disjoint_layers.cpp
 
 ifeq ($(strip $(TARGET_USES_HWC2)), false)
@@ -16,6 +16,7 @@
 
 #include "compositor.h"
 
+#include <unistd.h>
 #include <xf86drmMode.h>
 
 #include <algorithm>
@@ -68,8 +69,10 @@ bool Compositor::Draw(DisplayPlaneStateList &comp_planes,
   CTRACE();
   const DisplayPlaneState *comp = NULL;
   std::vector<size_t> dedicated_layers;
-  std::vector<DrawState> draw_state;
   std::vector<DrawState> media_state;
+  // DrawStates handed to the thread come back with the next frame, their
+  // storage is reused.
+  size_t total_draw_states = 0;
 
   for (DisplayPlaneState &plane : comp_planes) {
     if (plane.Scanout()) {
@@ -113,11 +116,12 @@ bool Compositor::Draw(DisplayPlaneStateList &comp_planes,
       if (comp_regions.empty())
         continue;
 
-      draw_state.emplace_back();
-      DrawState &state = draw_state.back();
+      if (draw_states_.size() == total_draw_states)
+        draw_states_.emplace_back();
+
+      DrawState &state = draw_states_.at(total_draw_states);
+      state.Reset();
       state.surface_ = surface;
-      size_t num_regions = comp_regions.size();
-      state.states_.reserve(num_regions);
       bool use_plane_transform = false;
       if (plane.GetRotationType() ==
           DisplayPlaneState::RotationType::kGPURotation) {
@@ -131,15 +135,16 @@ bool Compositor::Draw(DisplayPlaneStateList &comp_planes,
         return false;
       }
 
-      if (state.states_.empty()) {
-        draw_state.pop_back();
+      if (!state.states_.empty()) {
+        total_draw_states++;
       }
     }
   }
 
+  draw_states_.resize(total_draw_states);
   bool status = true;
-  if (!draw_state.empty() || !media_state.empty())
-    status = thread_->Draw(draw_state, media_state, layers);
+  if (!draw_states_.empty() || !media_state.empty())
+    status = thread_->Draw(draw_states_, media_state, layers);
 
   return status;
 }
@@ -151,29 +156,13 @@ bool Compositor::DrawOffscreen(std::vector<OverlayLayer> &layers,
                                uint32_t width, uint32_t height,
                                HWCNativeHandle output_handle,
                                int32_t acquire_fence, int32_t *retire_fence) {
-  std::vector<CompositionRegion> comp_regions;
-  SeparateLayers(std::vector<size_t>(), source_layers, display_frame,
-                 HwcRect<int>(0, 0, width, height), comp_regions);
-  if (comp_regions.empty()) {
-    ETRACE(
-        "Failed to prepare offscreen buffer. "
-        "error: %s",
-        PRINTERROR());
-    return false;
-  }
-
-  NativeSurface *surface = Create3DBuffer(width, height);
-  surface->InitializeForOffScreenRendering(output_handle, resource_manager);
   std::vector<DrawState> draw;
   std::vector<DrawState> media;
   draw.emplace_back();
   DrawState &draw_state = draw.back();
-  draw_state.destroy_surface_ = true;
-  draw_state.surface_ = surface;
-  size_t num_regions = comp_regions.size();
-  draw_state.states_.reserve(num_regions);
-  if (!CalculateRenderState(layers, comp_regions, draw_state, 1, false)) {
-    ETRACE("Failed to calculate render state.");
+  if (!PrepareOffscreenDraw(layers, display_frame, source_layers,
+                            resource_manager, width, height, output_handle,
+                            draw_state)) {
     return false;
   }
 
@@ -195,6 +184,59 @@ bool Compositor::DrawOffscreen(std::vector<OverlayLayer> &layers,
   return status;
 }
 
+bool Compositor::QueueDrawOffscreen(
+    std::vector<OverlayLayer> &layers,
+    const std::vector<HwcRect<int>> &display_frame,
+    const std::vector<size_t> &source_layers,
+    ResourceManager *resource_manager, uint32_t width, uint32_t height,
+    HWCNativeHandle output_handle, int32_t acquire_fence,
+    QueuedDrawCallback *callback, uint32_t id) {
+  DrawState draw_state;
+  if (!PrepareOffscreenDraw(layers, display_frame, source_layers,
+                            resource_manager, width, height, output_handle,
+                            draw_state)) {
+    if (acquire_fence > 0)
+      close(acquire_fence);
+
+    return false;
+  }
+
+  if (acquire_fence > 0) {
+    draw_state.acquire_fences_.emplace_back(acquire_fence);
+  }
+
+  return thread_->QueueDraw(draw_state, layers, callback, id);
+}
+
+bool Compositor::PrepareOffscreenDraw(
+    std::vector<OverlayLayer> &layers,
+    const std::vector<HwcRect<int>> &display_frame,
+    const std::vector<size_t> &source_layers,
+    ResourceManager *resource_manager, uint32_t width, uint32_t height,
+    HWCNativeHandle output_handle, DrawState &draw_state) {
+  std::vector<CompositionRegion> comp_regions;
+  SeparateLayers(std::vector<size_t>(), source_layers, display_frame,
+                 HwcRect<int>(0, 0, width, height), comp_regions);
+  if (comp_regions.empty()) {
+    ETRACE(
+        "Failed to prepare offscreen buffer. "
+        "error: %s",
+        PRINTERROR());
+    return false;
+  }
+
+  if (!CalculateRenderState(layers, comp_regions, draw_state, 1, false)) {
+    ETRACE("Failed to calculate render state.");
+    return false;
+  }
+
+  NativeSurface *surface = Create3DBuffer(width, height);
+  surface->InitializeForOffScreenRendering(output_handle, resource_manager);
+  draw_state.destroy_surface_ = true;
+  draw_state.surface_ = surface;
+  return true;
+}
+
 void Compositor::FreeResources() {
   thread_->FreeResources();
 }
@@ -205,17 +247,28 @@ bool Compositor::CalculateRenderState(
     uint32_t downscaling_factor, bool uses_display_up_scaling,
     bool use_plane_transform) {
   CTRACE();
-  size_t num_regions = comp_regions.size();
-  for (size_t region_index = 0; region_index < num_regions; region_index++) {
-    const CompositionRegion &region = comp_regions.at(region_index);
-    RenderState state;
-    state.ConstructState(layers, region, downscaling_factor,
-                         uses_display_up_scaling, use_plane_transform);
+  layer_table_.Reset(layers.size(), downscaling_factor,
+                     uses_display_up_scaling, use_plane_transform);
+  size_t total_layer_states = 0;
+  for (const CompositionRegion &region : comp_regions) {
+    layer_table_.AddLayers(layers, region);
+    total_layer_states += region.source_layers.size();
+  }
+
+  // RenderStates point into layer_states_, it must not grow after this.
+  draw_state.layer_states_.reserve(total_layer_states);
+  draw_state.states_.reserve(comp_regions.size());
+  // Regions are drawn in reverse order.
+  for (size_t region_index = comp_regions.size(); region_index-- > 0;) {
+    const CompositionRegion &region = comp_regions[region_index];
+    draw_state.states_.emplace_back();
+    RenderState &state = draw_state.states_.back();
+    state.ConstructState(region, layer_table_, draw_state.layer_states_);
     if (state.layer_state_.empty()) {
+      draw_state.states_.pop_back();
       continue;
     }
 
-    draw_state.states_.emplace(draw_state.states_.begin(), state);
     const std::vector<size_t> &source = region.source_layers;
     for (size_t texture_index : source) {
       OverlayLayer &layer = layers.at(texture_index);
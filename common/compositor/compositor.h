@@ -59,6 +59,16 @@ class Compositor {
                      ResourceManager *resource_manager, uint32_t width,
                      uint32_t height, HWCNativeHandle output_handle,
                      int32_t acquire_fence, int32_t *retire_fence);
+  // Same as DrawOffscreen, without waiting for the draw to be submitted.
+  // callback is told its fence once it is, layers must be kept until
+  // then.
+  bool QueueDrawOffscreen(std::vector<OverlayLayer> &layers,
+                          const std::vector<HwcRect<int>> &display_frame,
+                          const std::vector<size_t> &source_layers,
+                          ResourceManager *resource_manager, uint32_t width,
+                          uint32_t height, HWCNativeHandle output_handle,
+                          int32_t acquire_fence, QueuedDrawCallback *callback,
+                          uint32_t id);
   void FreeResources();
 
   void SetVideoScalingMode(uint32_t);
@@ -76,6 +86,12 @@ class Compositor {
                             DrawState &state, uint32_t downscaling_factor,
                             bool uses_display_up_scaling,
                             bool use_plane_transform = false);
+  bool PrepareOffscreenDraw(std::vector<OverlayLayer> &layers,
+                            const std::vector<HwcRect<int>> &display_frame,
+                            const std::vector<size_t> &source_layers,
+                            ResourceManager *resource_manager, uint32_t width,
+                            uint32_t height, HWCNativeHandle output_handle,
+                            DrawState &draw_state);
   void SeparateLayers(const std::vector<size_t> &dedicated_layers,
                       const std::vector<size_t> &source_layers,
                       const std::vector<HwcRect<int>> &display_frame,
@@ -87,6 +103,8 @@ class Compositor {
   HWCColorMap colors_;
   uint32_t scaling_mode_;
   HWCDeinterlaceProp deinterlace_;
+  LayerStateTable layer_table_;
+  std::vector<DrawState> draw_states_;
 };
 
 }  // namespace hwcomposer
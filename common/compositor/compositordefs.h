@@ -48,6 +48,10 @@ typedef struct gl_import {
   EGLImageKHR image_ = 0;
   GLuint texture_ = 0;
   GLuint fb_ = 0;
+  // Luma and chroma planes of NV12 and P010 buffers imported on their
+  // own, see OverlayBuffer::GetPlanarGpuResource.
+  EGLImageKHR plane_images_[2] = {0, 0};
+  GLuint plane_textures_[2] = {0, 0};
   HWCNativeHandle handle_ = 0;
   uint32_t drm_fd_ = 0;
 } ResourceHandle;
@@ -80,5 +84,25 @@ typedef struct media_import {
 
 typedef void* MediaDisplay;
 
+// How the 3D renderer samples a layer. Layers with planes imported on
+// their own are sampled per plane and converted to RGB by the shader, all
+// others through an external image.
+enum YUVSampling {
+  kSampleExternal = 0,
+  kSampleNV12 = 1,
+  kSampleP010 = 2
+};
+
+// Key of a shader converting YUV to RGB, made of the YUVSampling,
+// HWCColorSpace and HWCColorRange of a layer. kSampleExternal if there is
+// nothing to convert.
+inline uint32_t GetYUVSamplingKey(uint32_t sampling, uint32_t color_space,
+                                  uint32_t color_range) {
+  if (sampling == kSampleExternal)
+    return kSampleExternal;
+
+  return sampling | (color_space << 8) | (color_range << 16);
+}
+
 }  // namespace hwcomposer
 #endif  // COMMON_COMPOSITOR_COMPOSITORDEFS_H_
@@ -130,6 +130,29 @@ bool CompositorThread::Draw(std::vector<DrawState> &states,
   return draw_succeeded_;
 }
 
+bool CompositorThread::QueueDraw(DrawState &state,
+                                 const std::vector<OverlayLayer> &layers,
+                                 QueuedDrawCallback *callback, uint32_t id) {
+  if (!initialized_)
+    return false;
+
+  tasks_lock_.lock();
+  queued_draws_.emplace_back();
+  QueuedDraw &draw = queued_draws_.back();
+  draw.states_.emplace_back(std::move(state));
+  draw.buffers_.reserve(layers.size());
+  for (auto &layer : layers) {
+    draw.buffers_.emplace_back(layer.GetBuffer());
+  }
+
+  draw.callback_ = callback;
+  draw.id_ = id;
+  tasks_ |= kRenderQueued;
+  tasks_lock_.unlock();
+  Resume();
+  return true;
+}
+
 void CompositorThread::ExitThread() {
   HWCThread::Exit();
   std::vector<DrawState>().swap(states_);
@@ -137,6 +160,7 @@ void CompositorThread::ExitThread() {
 }
 
 void CompositorThread::HandleExit() {
+  HandleQueuedDrawRequests(true);
   HandleReleaseRequest();
   gl_renderer_.reset(nullptr);
   gpu_resource_handler_.reset(nullptr);
@@ -144,6 +168,11 @@ void CompositorThread::HandleExit() {
 
 void CompositorThread::HandleRoutine() {
   bool signal = false;
+  // Queued before any draw still to come.
+  if (tasks_ & kRenderQueued) {
+    HandleQueuedDrawRequests(false);
+  }
+
   if (tasks_ & kRender3D) {
     Handle3DDrawRequest();
     signal = true;
@@ -254,33 +283,65 @@ void CompositorThread::Handle3DDrawRequest() {
   tasks_ &= ~kRender3D;
   tasks_lock_.unlock();
 
+  if (!Draw3D(buffers_, states_))
+    draw_succeeded_ = false;
+}
+
+void CompositorThread::HandleQueuedDrawRequests(bool exiting) {
+  tasks_lock_.lock();
+  tasks_ &= ~kRenderQueued;
+  std::deque<QueuedDraw> draws;
+  draws.swap(queued_draws_);
+  tasks_lock_.unlock();
+
+  for (QueuedDraw &draw : draws) {
+    DrawState &draw_state = draw.states_.front();
+    bool drawn = !exiting && !draw_state.states_.empty() &&
+                 Draw3D(draw.buffers_, draw.states_);
+    int32_t fence = -1;
+    if (drawn) {
+      fence = draw_state.retire_fence_;
+    } else {
+      delete draw_state.surface_;
+      draw_state.surface_ = NULL;
+    }
+
+    draw.callback_->DrawQueued(draw.id_, drawn, fence);
+  }
+}
+
+bool CompositorThread::Draw3D(const std::vector<OverlayBuffer *> &buffers,
+                              std::vector<DrawState> &states) {
   Ensure3DRenderer();
   if (!gl_renderer_) {
-    draw_succeeded_ = false;
-    return;
+    return false;
   }
 
   gl_renderer_->SetExplicitSyncSupport(disable_explicit_sync_);
 
-  if (!gpu_resource_handler_->PrepareResources(buffers_)) {
+  if (!gpu_resource_handler_->PrepareResources(buffers)) {
     ETRACE(
         "Failed to prepare GPU resources for compositing the frame, "
         "error: %s",
         PRINTERROR());
-    draw_succeeded_ = false;
-    return;
+    return false;
   }
 
-  size_t size = states_.size();
+  bool succeeded = true;
+  size_t size = states.size();
   for (size_t i = 0; i < size; i++) {
-    DrawState &draw_state = states_.at(i);
+    DrawState &draw_state = states.at(i);
     for (RenderState &render_state : draw_state.states_) {
-      std::vector<RenderState::LayerState> &layer_state =
-          render_state.layer_state_;
-
+      RenderState::LayerStateList &layer_state = render_state.layer_state_;
       for (RenderState::LayerState &temp : layer_state) {
         temp.handle_ =
             gpu_resource_handler_->GetResourceHandle(temp.layer_index_);
+        if (temp.sampling_key_ != kSampleExternal &&
+            !gpu_resource_handler_->GetPlaneResourceHandles(
+                temp.layer_index_, &temp.plane_handles_[0],
+                &temp.plane_handles_[1])) {
+          temp.sampling_key_ = kSampleExternal;
+        }
       }
     }
 
@@ -296,22 +357,22 @@ void CompositorThread::Handle3DDrawRequest() {
           "Failed to Draw: "
           "error: %s",
           PRINTERROR());
-      draw_succeeded_ = false;
+      succeeded = false;
       break;
     }
 
     if (draw_state.destroy_surface_) {
-      if (draw_succeeded_) {
-        draw_state.retire_fence_ =
-            draw_state.surface_->GetLayer()->ReleaseAcquireFence();
-      }
-
+      draw_state.retire_fence_ =
+          draw_state.surface_->GetLayer()->ReleaseAcquireFence();
       delete draw_state.surface_;
+      draw_state.surface_ = NULL;
     }
   }
 
   if (disable_explicit_sync_)
     gl_renderer_->InsertFence(-1);
+
+  return succeeded;
 }
 
 void CompositorThread::HandleMediaDrawRequest() {
@@ -20,6 +20,7 @@
 #include <spinlock.h>
 #include <platformdefines.h>
 
+#include <deque>
 #include <memory>
 #include <vector>
 
@@ -37,6 +38,18 @@ class DisplayPlaneManager;
 class ResourceManager;
 class NativeBufferHandler;
 
+// Told the result of a draw queued with CompositorThread::QueueDraw, on
+// the compositor thread.
+class QueuedDrawCallback {
+ public:
+  virtual ~QueuedDrawCallback() {
+  }
+
+  // retire_fence is owned by callee, -1 if the draw failed.
+  virtual void DrawQueued(uint32_t id, bool succeeded,
+                          int32_t retire_fence) = 0;
+};
+
 class CompositorThread : public HWCThread {
  public:
   CompositorThread();
@@ -47,6 +60,10 @@ class CompositorThread : public HWCThread {
   bool Draw(std::vector<DrawState>& states,
             std::vector<DrawState>& media_states,
             const std::vector<OverlayLayer>& layers);
+  // Draws state after any earlier request without waiting for it, state
+  // is taken. Returns false if the thread isn't running.
+  bool QueueDraw(DrawState& state, const std::vector<OverlayLayer>& layers,
+                 QueuedDrawCallback* callback, uint32_t id);
 
   void SetExplicitSyncSupport(bool disable_explicit_sync);
   void UpdateLayerPixelData(std::vector<OverlayLayer>& layers);
@@ -63,10 +80,21 @@ class CompositorThread : public HWCThread {
     kRender3D = 1 << 1,  // Render content.
     kRenderMedia = 1 << 2,
     kReleaseResources = 1 << 3,  // Release surfaces from plane manager.
-    kRefreshRawPixelData = 1 << 4
+    kRefreshRawPixelData = 1 << 4,
+    kRenderQueued = 1 << 5  // Render draws queued by QueueDraw.
+  };
+
+  struct QueuedDraw {
+    std::vector<DrawState> states_;
+    std::vector<OverlayBuffer*> buffers_;
+    QueuedDrawCallback* callback_ = NULL;
+    uint32_t id_ = 0;
   };
 
   void Handle3DDrawRequest();
+  void HandleQueuedDrawRequests(bool exiting);
+  bool Draw3D(const std::vector<OverlayBuffer*>& buffers,
+              std::vector<DrawState>& states);
   void HandleMediaDrawRequest();
   void HandleReleaseRequest();
   void HandleRawPixelUpdate();
@@ -83,6 +111,7 @@ class CompositorThread : public HWCThread {
   std::vector<OverlayBuffer*> pixel_data_;
   std::vector<DrawState> states_;
   std::vector<DrawState> media_states_;
+  std::deque<QueuedDraw> queued_draws_;
   std::vector<ResourceHandle> purged_resources_;
   bool disable_explicit_sync_;
   bool draw_succeeded_ = false;
@@ -29,6 +29,8 @@
 
 #include "va/varenderer.h"
 
+#include <drm_fourcc.h>
+
 namespace hwcomposer {
 
 NativeSurface* Create3DBuffer(uint32_t width, uint32_t height) {
@@ -69,4 +71,23 @@ NativeGpuResource* CreateNativeGpuResourceHandler() {
 #endif
 }
 
+void GetRenderTargetModifiers(bool video, std::vector<uint64_t>* modifiers) {
+  modifiers->clear();
+  // VA surfaces keep their implicit layout.
+  if (video)
+    return;
+
+#ifdef USE_GL
+#if defined(EGL_DMA_BUF_PLANE0_MODIFIER_LO_EXT) && \
+    defined(I915_FORMAT_MOD_Y_TILED_CCS)
+  // Compression state lives in an aux plane, which can only be passed
+  // to EGL with EGL_EXT_image_dma_buf_import_modifiers.
+  modifiers->emplace_back(I915_FORMAT_MOD_Y_TILED_CCS);
+#endif
+  modifiers->emplace_back(I915_FORMAT_MOD_Y_TILED);
+  modifiers->emplace_back(I915_FORMAT_MOD_X_TILED);
+  modifiers->emplace_back(DRM_FORMAT_MOD_LINEAR);
+#endif
+}
+
 }  // namespace hwcomposer
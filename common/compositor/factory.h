@@ -19,6 +19,8 @@
 
 #include <stdint.h>
 
+#include <vector>
+
 namespace hwcomposer {
 
 class NativeGpuResource;
@@ -40,5 +42,10 @@ Renderer* CreateMediaRenderer();
 
 NativeGpuResource* CreateNativeGpuResourceHandler();
 
+// Fills modifiers with the layouts the renderer used for 3D or Media
+// offscreen targets can render to, most preferred first. Empty if only
+// implicit layouts are supported.
+void GetRenderTargetModifiers(bool video, std::vector<uint64_t>* modifiers);
+
 }  // namespace hwcomposer
 #endif  // COMMON_COMPOSITOR_FACTORY_H_
@@ -16,9 +16,13 @@
 
 #include "glprogram.h"
 
+#include <map>
+#include <mutex>
 #include <string>
 #include <sstream>
 
+#include <hwcdefs.h>
+
 #include "hwctrace.h"
 #include "renderstate.h"
 
@@ -83,15 +87,118 @@ static std::string GenerateVertexShader(int layer_count) {
   return vertex_shader_stream.str();
 }
 
-static std::string GenerateFragmentShader(int layer_count) {
+// Generates a function converting a layer with sampling_key from YUV to
+// RGB, see GetYUVSamplingKey.
+static std::string GenerateYUVFunction(uint32_t sampling_key) {
+  uint32_t sampling = sampling_key & 0xff;
+  HWCColorSpace color_space =
+      static_cast<HWCColorSpace>((sampling_key >> 8) & 0xff);
+  bool full_range = static_cast<HWCColorRange>(sampling_key >> 16) ==
+                    HWCColorRange::kFull;
+  double kr, kb;
+  switch (color_space) {
+    case HWCColorSpace::kBT709:
+      kr = 0.2126;
+      kb = 0.0722;
+      break;
+    case HWCColorSpace::kBT2020:
+      kr = 0.2627;
+      kb = 0.0593;
+      break;
+    default:
+      kr = 0.299;
+      kb = 0.114;
+      break;
+  }
+
+  // Samples are normalized to code / max_code first. P010 keeps 10 bits
+  // in the top of 16.
+  bool ten_bit = sampling == kSampleP010;
+  double max_code = ten_bit ? 1023.0 : 255.0;
+  double sample_scale = ten_bit ? 65535.0 / 64.0 / 1023.0 : 1.0;
+  double bit_scale = (max_code + 1.0) / 256.0;
+  double luma_offset = full_range ? 0.0 : 16.0 * bit_scale / max_code;
+  double luma_scale = full_range ? 1.0 : max_code / (219.0 * bit_scale);
+  double chroma_offset = 128.0 * bit_scale / max_code;
+  double chroma_scale = full_range ? 1.0 : max_code / (224.0 * bit_scale);
+
+  // rgb = matrix * (yuv - offset), with the ranges folded in and then
+  // rearranged to rgb = matrix * yuv + bias.
+  double kg = 1.0 - kr - kb;
+  double matrix[3][3] = {
+      {1.0, 1.0, 1.0},
+      {0.0, -2.0 * kb * (1.0 - kb) / kg, 2.0 * (1.0 - kb)},
+      {2.0 * (1.0 - kr), -2.0 * kr * (1.0 - kr) / kg, 0.0}};
+  double scales[3] = {luma_scale, chroma_scale, chroma_scale};
+  double offsets[3] = {luma_offset, chroma_offset, chroma_offset};
+  double bias[3] = {0.0, 0.0, 0.0};
+  for (int column = 0; column < 3; column++) {
+    for (int row = 0; row < 3; row++) {
+      matrix[column][row] *= scales[column];
+      bias[row] -= matrix[column][row] * offsets[column];
+      matrix[column][row] *= sample_scale;
+    }
+  }
+
+  std::ostringstream stream;
+  stream.precision(9);
+  stream << "vec4 SampleYUV" << sampling_key
+         << "(highp sampler2D luma, highp sampler2D chroma, vec2 coords) {\n"
+         << "  const highp mat3 csc = mat3(";
+  for (int column = 0; column < 3; column++) {
+    for (int row = 0; row < 3; row++) {
+      stream << std::fixed << matrix[column][row]
+             << (column == 2 && row == 2 ? "" : ", ");
+    }
+  }
+  stream << ");\n"
+         << "  const highp vec3 bias = vec3(" << bias[0] << ", " << bias[1]
+         << ", " << bias[2] << ");\n"
+         << "  highp vec3 yuv = vec3(texture(luma, coords).r,\n"
+         << "                        texture(chroma, coords).rg);\n"
+         << "  return vec4(clamp(csc * yuv + bias, 0.0, 1.0), 1.0);\n"
+         << "}\n";
+  return stream.str();
+}
+
+// Conversion functions only depend on the key, they are shared by all
+// programs.
+static const std::string &GetYUVFunction(uint32_t sampling_key) {
+  static std::mutex lock;
+  static std::map<uint32_t, std::string> functions;
+  std::lock_guard<std::mutex> guard(lock);
+  std::string &function = functions[sampling_key];
+  if (function.empty())
+    function = GenerateYUVFunction(sampling_key);
+
+  return function;
+}
+
+static std::string GenerateFragmentShader(
+    int layer_count, const std::vector<uint32_t> &sampling_keys) {
   std::ostringstream fragment_shader_stream;
   fragment_shader_stream << "#version 300 es\n"
                          << "#define LAYER_COUNT " << layer_count << "\n"
                          << "#extension GL_OES_EGL_image_external : require\n"
                          << "precision mediump float;\n";
+  std::map<uint32_t, bool> functions;
   for (int i = 0; i < layer_count; ++i) {
-    fragment_shader_stream << "uniform samplerExternalOES uLayerTexture" << i
+    uint32_t sampling_key =
+        sampling_keys.empty() ? 0 : sampling_keys[i];
+    if (sampling_key == kSampleExternal) {
+      fragment_shader_stream << "uniform samplerExternalOES uLayerTexture"
+                             << i << ";\n";
+      continue;
+    }
+
+    fragment_shader_stream << "uniform highp sampler2D uLayerTexture" << i
+                           << ";\n"
+                           << "uniform highp sampler2D uLayerChroma" << i
                            << ";\n";
+    if (!functions[sampling_key]) {
+      fragment_shader_stream << GetYUVFunction(sampling_key);
+      functions[sampling_key] = true;
+    }
   }
   fragment_shader_stream << "uniform float uLayerAlpha[LAYER_COUNT];\n"
                          << "uniform float uLayerPremult[LAYER_COUNT];\n"
@@ -105,12 +212,21 @@ static std::string GenerateFragmentShader(int layer_count) {
   for (int i = 0; i < layer_count; ++i) {
     if (i > 0)
       fragment_shader_stream << "  if (alphaCover > 0.5/255.0) {\n";
+    uint32_t sampling_key =
+        sampling_keys.empty() ? 0 : sampling_keys[i];
     // clang-format off
-    fragment_shader_stream << "  texSample = texture2D(uLayerTexture" << i
-                           << ",\n"
-                           << "                        fTexCoords[" << i
-                           << "]);\n"
-                           << "  multRgb = texSample.rgb *\n"
+    if (sampling_key == kSampleExternal) {
+      fragment_shader_stream << "  texSample = texture2D(uLayerTexture" << i
+                             << ",\n"
+                             << "                        fTexCoords[" << i
+                             << "]);\n";
+    } else {
+      fragment_shader_stream << "  texSample = SampleYUV" << sampling_key
+                             << "(uLayerTexture" << i << ",\n"
+                             << "                        uLayerChroma" << i
+                             << ", fTexCoords[" << i << "]);\n";
+    }
+    fragment_shader_stream << "  multRgb = texSample.rgb *\n"
                            << "            max(texSample.a, uLayerPremult[" << i
                            << "]);\n"
                            << "  color += multRgb * uLayerAlpha[" << i
@@ -127,6 +243,7 @@ static std::string GenerateFragmentShader(int layer_count) {
 }
 
 static GLint GenerateProgram(unsigned num_textures,
+                             const std::vector<uint32_t> &sampling_keys,
                              std::ostringstream *shader_log) {
   std::string vertex_shader_string = GenerateVertexShader(num_textures);
   const GLchar *vertex_shader_source = vertex_shader_string.c_str();
@@ -135,7 +252,8 @@ static GLint GenerateProgram(unsigned num_textures,
   if (!vertex_shader)
     return 0;
 
-  std::string fragment_shader_string = GenerateFragmentShader(num_textures);
+  std::string fragment_shader_string =
+      GenerateFragmentShader(num_textures, sampling_keys);
   const GLchar *fragment_shader_source = fragment_shader_string.c_str();
   GLint fragment_shader = CompileAndCheckShader(
       GL_FRAGMENT_SHADER, 1, &fragment_shader_source, shader_log);
@@ -194,9 +312,11 @@ GLProgram::~GLProgram() {
     glDeleteProgram(program_);
 }
 
-bool GLProgram::Init(unsigned texture_count) {
+bool GLProgram::Init(unsigned texture_count,
+                     const std::vector<uint32_t> &sampling_keys) {
   std::ostringstream shader_log;
-  program_ = GenerateProgram(texture_count, &shader_log);
+  sampling_keys_ = sampling_keys;
+  program_ = GenerateProgram(texture_count, sampling_keys, &shader_log);
   if (!program_) {
     ETRACE("%s", shader_log.str().c_str());
     return false;
@@ -221,6 +341,13 @@ void GLProgram::UseProgram(const RenderState &state, GLuint viewport_width,
       GLuint tex_loc =
           glGetUniformLocation(program_, texture_name_formatter.str().c_str());
       glUniform1i(tex_loc, src_index);
+      if (SamplesPlanes(src_index)) {
+        std::ostringstream chroma_name_formatter;
+        chroma_name_formatter << "uLayerChroma" << src_index;
+        GLuint chroma_loc = glGetUniformLocation(
+            program_, chroma_name_formatter.str().c_str());
+        glUniform1i(chroma_loc, size + src_index);
+      }
     }
 
     initialized_ = true;
@@ -241,7 +368,29 @@ void GLProgram::UseProgram(const RenderState &state, GLuint viewport_width,
     glUniformMatrix2fv(tex_matrix_loc_ + src_index, 1, GL_FALSE,
                        src.texture_matrix_);
     glActiveTexture(GL_TEXTURE0 + src_index);
-    glBindTexture(GL_TEXTURE_EXTERNAL_OES, src.handle_);
+    if (!SamplesPlanes(src_index)) {
+      glBindTexture(GL_TEXTURE_EXTERNAL_OES, src.handle_);
+      continue;
+    }
+
+    // Chroma planes use the units after those of all layers.
+    glBindTexture(GL_TEXTURE_2D, src.plane_handles_[0]);
+    glActiveTexture(GL_TEXTURE0 + size + src_index);
+    glBindTexture(GL_TEXTURE_2D, src.plane_handles_[1]);
+  }
+}
+
+void GLProgram::UnbindTextures(unsigned texture_count) {
+  for (unsigned src_index = 0; src_index < texture_count; src_index++) {
+    glActiveTexture(GL_TEXTURE0 + src_index);
+    if (!SamplesPlanes(src_index)) {
+      glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
+      continue;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0 + texture_count + src_index);
+    glBindTexture(GL_TEXTURE_2D, 0);
   }
 }
 
@@ -19,6 +19,7 @@
 
 #include <vector>
 
+#include "compositordefs.h"
 #include "shim.h"
 
 namespace hwcomposer {
@@ -33,9 +34,20 @@ class GLProgram {
 
   ~GLProgram();
 
-  bool Init(unsigned texture_count);
+  // sampling_keys has the key of every layer, see GetYUVSamplingKey.
+  // Empty if all layers are sampled through external images.
+  bool Init(unsigned texture_count,
+            const std::vector<uint32_t>& sampling_keys =
+                std::vector<uint32_t>());
   void UseProgram(const RenderState& cmd, GLuint viewport_width,
                   GLuint viewport_height);
+  void UnbindTextures(unsigned texture_count);
+
+  // True if the layer is sampled from its planes, which then take two
+  // texture units.
+  bool SamplesPlanes(unsigned layer) const {
+    return !sampling_keys_.empty() && sampling_keys_[layer] != kSampleExternal;
+  }
 
  private:
   GLint program_;
@@ -44,6 +56,7 @@ class GLProgram {
   GLint alpha_loc_;
   GLint premult_loc_;
   GLint tex_matrix_loc_;
+  std::vector<uint32_t> sampling_keys_;
   bool initialized_;
 };
 
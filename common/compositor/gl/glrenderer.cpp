@@ -53,6 +53,7 @@ bool GLRenderer::Init() {
   }
 
   InitializeShims();
+  glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &max_texture_units_);
 
   // generate the VAO & bind
   GLuint vertex_array;
@@ -132,7 +133,7 @@ bool GLRenderer::Draw(const std::vector<RenderState> &render_states,
 
   for (const RenderState &state : render_states) {
     unsigned size = state.layer_state_.size();
-    GLProgram *program = GetProgram(size);
+    GLProgram *program = GetProgram(state);
     if (!program)
       continue;
 
@@ -157,10 +158,7 @@ bool GLRenderer::Draw(const std::vector<RenderState> &render_states,
 
     glDrawArrays(GL_TRIANGLES, 0, 3);
 
-    for (unsigned src_index = 0; src_index < size; src_index++) {
-      glActiveTexture(GL_TEXTURE0 + src_index);
-      glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
-    }
+    program->UnbindTextures(size);
   }
 
   glDisable(GL_SCISSOR_TEST);
@@ -194,6 +192,39 @@ void GLRenderer::SetExplicitSyncSupport(bool disable_explicit_sync) {
   disable_explicit_sync_ = disable_explicit_sync;
 }
 
+GLProgram *GLRenderer::GetProgram(const RenderState &state) {
+  unsigned size = state.layer_state_.size();
+  bool has_yuv = false;
+  sampling_keys_.resize(size);
+  for (unsigned src_index = 0; src_index < size; src_index++) {
+    sampling_keys_[src_index] = state.layer_state_[src_index].sampling_key_;
+    has_yuv |= sampling_keys_[src_index] != kSampleExternal;
+  }
+
+  // Planes of a layer take two texture units, if there are not enough
+  // the driver converts all layers.
+  if (!has_yuv || static_cast<GLint>(size * 2) > max_texture_units_)
+    return GetProgram(size);
+
+  // Programs which failed to build are kept as NULL, so that they are
+  // only tried once.
+  auto it = yuv_programs_.find(sampling_keys_);
+  if (it == yuv_programs_.end()) {
+    std::unique_ptr<GLProgram> program(new GLProgram());
+    if (!program->Init(size, sampling_keys_)) {
+      ETRACE("Failed to create program converting YUV layers.");
+      program.reset();
+    }
+
+    it = yuv_programs_.emplace(sampling_keys_, std::move(program)).first;
+  }
+
+  if (!it->second)
+    return GetProgram(size);
+
+  return it->second.get();
+}
+
 GLProgram *GLRenderer::GetProgram(unsigned texture_count) {
   if (programs_.size() >= texture_count) {
     GLProgram *program = programs_[texture_count - 1].get();
@@ -17,6 +17,7 @@
 #ifndef COMMON_COMPOSITOR_GL_GLRENDERER_H_
 #define COMMON_COMPOSITOR_GL_GLRENDERER_H_
 
+#include <map>
 #include <memory>
 #include <vector>
 
@@ -42,10 +43,16 @@ class GLRenderer : public Renderer {
 
  private:
   GLProgram *GetProgram(unsigned texture_count);
+  GLProgram *GetProgram(const RenderState &state);
 
   EGLOffScreenContext context_;
 
   std::vector<std::unique_ptr<GLProgram>> programs_;
+  // Programs for regions with YUV layers sampled from their planes, by
+  // the sampling keys of the layers.
+  std::map<std::vector<uint32_t>, std::unique_ptr<GLProgram>> yuv_programs_;
+  std::vector<uint32_t> sampling_keys_;
+  GLint max_texture_units_ = 0;
   GLuint vertex_array_ = 0;
   bool disable_explicit_sync_ = false;
 };
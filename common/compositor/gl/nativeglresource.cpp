@@ -16,16 +16,29 @@
 
 #include "nativeglresource.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "hwctrace.h"
 #include "overlaylayer.h"
 #include "shim.h"
 
 namespace hwcomposer {
 
+NativeGLResource::NativeGLResource() {
+  // Setting HWC_GL_PLANAR_YUV to 0 leaves the YUV to RGB conversion to
+  // the driver.
+  const char* planar_yuv = getenv("HWC_GL_PLANAR_YUV");
+  if (planar_yuv && !strcmp(planar_yuv, "0"))
+    planar_yuv_ = false;
+}
+
 bool NativeGLResource::PrepareResources(
     const std::vector<OverlayBuffer*>& buffers) {
   std::vector<GLuint>().swap(layer_textures_);
   layer_textures_.reserve(buffers.size());
+  layer_plane_textures_.clear();
+  layer_plane_textures_.resize(buffers.size(), PlaneTextures{0, 0});
   EGLDisplay egl_display = eglGetCurrentDisplay();
   for (auto& buffer : buffers) {
     // Create EGLImage.
@@ -37,6 +50,13 @@ bool NativeGLResource::PrepareResources(
       return false;
     }
 
+    if (planar_yuv_) {
+      const ResourceHandle& planes = buffer->GetPlanarGpuResource(egl_display);
+      PlaneTextures& textures = layer_plane_textures_[layer_textures_.size()];
+      textures.luma = planes.plane_textures_[0];
+      textures.chroma = planes.plane_textures_[1];
+    }
+
     layer_textures_.emplace_back(import_image.texture_);
   }
 
@@ -75,6 +95,14 @@ void NativeGLResource::ReleaseGPUResources(
       eglDestroyImageKHR(egl_display, handle.image_);
     }
 
+    for (uint32_t plane = 0; plane < 2; plane++) {
+      if (handle.plane_images_[plane])
+        eglDestroyImageKHR(egl_display, handle.plane_images_[plane]);
+
+      if (handle.plane_textures_[plane])
+        textures.emplace_back(handle.plane_textures_[plane]);
+    }
+
     if (handle.texture_) {
       textures.emplace_back(handle.texture_);
     }
@@ -104,4 +132,19 @@ GpuResourceHandle NativeGLResource::GetResourceHandle(
   return layer_textures_.at(layer_index);
 }
 
+bool NativeGLResource::GetPlaneResourceHandles(uint32_t layer_index,
+                                               GpuResourceHandle* luma,
+                                               GpuResourceHandle* chroma) const {
+  if (layer_plane_textures_.size() <= layer_index)
+    return false;
+
+  const PlaneTextures& textures = layer_plane_textures_[layer_index];
+  if (!textures.luma || !textures.chroma)
+    return false;
+
+  *luma = textures.luma;
+  *chroma = textures.chroma;
+  return true;
+}
+
 }  // namespace hwcomposer
@@ -28,11 +28,13 @@ struct OverlayLayer;
 
 class NativeGLResource : public NativeGpuResource {
  public:
-  NativeGLResource() = default;
+  NativeGLResource();
   ~NativeGLResource() override;
 
   bool PrepareResources(const std::vector<OverlayBuffer*>& buffers) override;
   GpuResourceHandle GetResourceHandle(uint32_t layer_index) const override;
+  bool GetPlaneResourceHandles(uint32_t layer_index, GpuResourceHandle* luma,
+                               GpuResourceHandle* chroma) const override;
 
   void ReleaseGPUResources(const std::vector<ResourceHandle>& handles) override;
 
@@ -40,7 +42,16 @@ class NativeGLResource : public NativeGpuResource {
       const std::vector<OverlayBuffer*>& buffers) override;
 
  private:
+  struct PlaneTextures {
+    GLuint luma;
+    GLuint chroma;
+  };
+
   std::vector<GLuint> layer_textures_;
+  std::vector<PlaneTextures> layer_plane_textures_;
+  // YUV layers are sampled through external images if false, see
+  // HWC_GL_PLANAR_YUV.
+  bool planar_yuv_ = true;
 };
 
 }  // namespace hwcomposer
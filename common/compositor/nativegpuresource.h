@@ -43,6 +43,14 @@ class NativeGpuResource {
   virtual void HandleTextureUploads(
       const std::vector<OverlayBuffer*>& buffers) = 0;
   virtual GpuResourceHandle GetResourceHandle(uint32_t layer_index) const = 0;
+  // Gets the luma and chroma planes of a YUV layer, imported on their
+  // own. Returns false if they aren't available, the layer is then
+  // sampled through GetResourceHandle.
+  virtual bool GetPlaneResourceHandles(uint32_t /*layer_index*/,
+                                       GpuResourceHandle* /*luma*/,
+                                       GpuResourceHandle* /*chroma*/) const {
+    return false;
+  }
   virtual void ReleaseGPUResources(
       const std::vector<ResourceHandle>& handles) = 0;
 };
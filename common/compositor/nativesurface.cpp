@@ -42,9 +42,10 @@ NativeSurface::~NativeSurface() {
 }
 
 bool NativeSurface::Init(ResourceManager *resource_manager, uint32_t format,
-                         uint32_t usage) {
-  resource_manager->GetNativeBufferHandler()->CreateBuffer(
-      width_, height_, format, &native_handle_, usage);
+                         uint32_t usage,
+                         const std::vector<uint64_t> &modifiers) {
+  resource_manager->GetNativeBufferHandler()->CreateBufferWithModifiers(
+      width_, height_, format, modifiers, &native_handle_, usage);
   if (!native_handle_) {
     ETRACE("NativeSurface: Failed to create buffer.");
     return false;
@@ -18,6 +18,7 @@
 #define COMMON_COMPOSITOR_NATIVESURFACE_H_
 
 #include <memory>
+#include <vector>
 
 #include "overlaylayer.h"
 #include "platformdefines.h"
@@ -42,7 +43,10 @@ class NativeSurface {
 
   virtual ~NativeSurface();
 
-  bool Init(ResourceManager* resource_manager, uint32_t format, uint32_t usage);
+  // modifiers are the layouts the surface may be allocated with, most
+  // preferred first. An empty list leaves the layout to the allocator.
+  bool Init(ResourceManager* resource_manager, uint32_t format, uint32_t usage,
+            const std::vector<uint64_t>& modifiers = std::vector<uint64_t>());
 
   bool InitializeForOffScreenRendering(HWCNativeHandle native_handle,
                                        ResourceManager* resource_manager);
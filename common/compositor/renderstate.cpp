@@ -16,6 +16,8 @@
 
 #include "renderstate.h"
 
+#include <drm_fourcc.h>
+
 #include <hwcutils.h>
 
 #include "compositionregion.h"
@@ -25,11 +27,33 @@
 
 namespace hwcomposer {
 
-void RenderState::ConstructState(std::vector<OverlayLayer> &layers,
-                                 const CompositionRegion &region,
-                                 uint32_t downscaling_factor,
-                                 bool uses_display_up_scaling,
-                                 bool use_plane_transform) {
+static uint32_t GetSamplingKey(const OverlayLayer &layer) {
+  const OverlayBuffer *buffer = layer.GetBuffer();
+  uint32_t sampling;
+  switch (buffer->GetFormat()) {
+    case DRM_FORMAT_NV12:
+      sampling = kSampleNV12;
+      break;
+    case DRM_FORMAT_P010:
+      sampling = kSampleP010;
+      break;
+    default:
+      return kSampleExternal;
+  }
+
+  HWCColorSpace color_space = layer.GetColorSpace();
+  if (color_space == HWCColorSpace::kDefault) {
+    color_space = buffer->GetHeight() > 576 ? HWCColorSpace::kBT709
+                                            : HWCColorSpace::kBT601;
+  }
+
+  return GetYUVSamplingKey(sampling, static_cast<uint32_t>(color_space),
+                           static_cast<uint32_t>(layer.GetColorRange()));
+}
+
+void RenderState::ConstructState(const CompositionRegion &region,
+                                 const LayerStateTable &table,
+                                 std::vector<LayerState> &arena) {
   float bounds[4];
   std::copy_n(region.frame.bounds, 4, bounds);
   x_ = bounds[0];
@@ -40,118 +64,174 @@ void RenderState::ConstructState(std::vector<OverlayLayer> &layers,
   scissor_y_ = y_;
   scissor_width_ = width_;
   scissor_height_ = height_;
+  float swapped[4] = {bounds[1], bounds[0], bounds[3], bounds[2]};
+  size_t first = arena.size();
   const std::vector<size_t> &source = region.source_layers;
   for (size_t texture_index : source) {
-    OverlayLayer &layer = layers.at(texture_index);
-    layer_state_.emplace_back();
-    RenderState::LayerState &src = layer_state_.back();
-    src.layer_index_ = texture_index;
-    bool swap_xy = false;
-    bool flip_xy[2] = {false, false};
-    uint32_t transform = layer.GetTransform();
-    if (use_plane_transform) {
-      transform = layer.GetPlaneTransform();
+    arena.emplace_back();
+    if (table.FillState(texture_index, bounds, swapped, arena.back()))
+      break;
+  }
+
+  layer_state_.data_ = arena.data() + first;
+  layer_state_.size_ = arena.size() - first;
+}
+
+void LayerStateTable::Reset(size_t total_layers, uint32_t downscaling_factor,
+                            bool uses_display_up_scaling,
+                            bool use_plane_transform) {
+  downscaling_factor_ = downscaling_factor;
+  uses_display_up_scaling_ = uses_display_up_scaling;
+  use_plane_transform_ = use_plane_transform;
+  known_.assign(total_layers, 0);
+  swap_xy_.resize(total_layers);
+  opaque_.resize(total_layers);
+  alpha_.resize(total_layers);
+  premult_.resize(total_layers);
+  sampling_key_.resize(total_layers);
+  origin_.resize(total_layers);
+  extent_.resize(total_layers);
+  offset_.resize(total_layers);
+  size_.resize(total_layers);
+}
+
+void LayerStateTable::AddLayers(const std::vector<OverlayLayer> &layers,
+                                const CompositionRegion &region) {
+  for (size_t texture_index : region.source_layers) {
+    if (!known_.at(texture_index)) {
+      AddLayer(layers.at(texture_index), texture_index);
+      known_[texture_index] = 1;
     }
+  }
+}
 
-    switch (transform) {
-      case HWCTransform::kTransform180: {
-        swap_xy = false;
+void LayerStateTable::AddLayer(const OverlayLayer &layer, size_t index) {
+  bool swap_xy = false;
+  bool flip_xy[2] = {false, false};
+  uint32_t transform = layer.GetTransform();
+  if (use_plane_transform_) {
+    transform = layer.GetPlaneTransform();
+  }
+
+  switch (transform) {
+    case HWCTransform::kTransform180: {
+      swap_xy = false;
+      flip_xy[0] = true;
+      flip_xy[1] = true;
+      break;
+    }
+    case HWCTransform::kTransform270: {
+      swap_xy = true;
+      flip_xy[0] = true;
+      flip_xy[1] = false;
+      break;
+    }
+    case HWCTransform::kTransform90: {
+      swap_xy = true;
+      if (transform & HWCTransform::kReflectX) {
         flip_xy[0] = true;
         flip_xy[1] = true;
-        break;
-      }
-      case HWCTransform::kTransform270: {
-        swap_xy = true;
-        flip_xy[0] = true;
+      } else if (transform & HWCTransform::kReflectY) {
+        flip_xy[0] = false;
         flip_xy[1] = false;
-        break;
-      }
-      case HWCTransform::kTransform90: {
-        swap_xy = true;
-        if (transform & HWCTransform::kReflectX) {
-          flip_xy[0] = true;
-          flip_xy[1] = true;
-        } else if (transform & HWCTransform::kReflectY) {
-          flip_xy[0] = false;
-          flip_xy[1] = false;
-        } else {
-          flip_xy[0] = false;
-          flip_xy[1] = true;
-        }
-        break;
-      }
-      default: {
-        if (layer.GetTransform() & HWCTransform::kReflectX)
-          flip_xy[0] = true;
-        if (layer.GetTransform() & HWCTransform::kReflectY)
-          flip_xy[1] = true;
-      }
-    }
-
-    if (swap_xy)
-      std::copy_n(&TransformMatrices[4], 4, src.texture_matrix_);
-    else
-      std::copy_n(&TransformMatrices[0], 4, src.texture_matrix_);
-
-    HwcRect<float> display_rect;
-    float display_size[2];
-
-    if (uses_display_up_scaling) {
-      display_rect = layer.GetSourceCrop();
-      display_size[0] = static_cast<float>(layer.GetSourceCropWidth());
-      display_size[1] = static_cast<float>(layer.GetSourceCropHeight());
-    } else {
-      const HwcRect<int> &display_Rect = layer.GetDisplayFrame();
-      display_rect.left = static_cast<float>(display_Rect.left);
-      display_rect.right = static_cast<float>(display_Rect.right);
-      display_rect.top = static_cast<float>(display_Rect.top);
-      display_rect.bottom = static_cast<float>(display_Rect.bottom);
-      if (downscaling_factor > 1) {
-        display_rect.right =
-            display_rect.right -
-            ((display_rect.right - display_rect.left) / downscaling_factor);
-
-        display_size[0] = display_rect.right - display_rect.left;
-        display_size[1] = display_rect.bottom - display_rect.top;
       } else {
-        display_size[0] = static_cast<float>(layer.GetDisplayFrameWidth());
-        display_size[1] = static_cast<float>(layer.GetDisplayFrameHeight());
+        flip_xy[0] = false;
+        flip_xy[1] = true;
       }
+      break;
     }
+    default: {
+      if (layer.GetTransform() & HWCTransform::kReflectX)
+        flip_xy[0] = true;
+      if (layer.GetTransform() & HWCTransform::kReflectY)
+        flip_xy[1] = true;
+    }
+  }
 
-    float tex_width = static_cast<float>(layer.GetBuffer()->GetWidth());
-    float tex_height = static_cast<float>(layer.GetBuffer()->GetHeight());
-    const HwcRect<float> &source_crop = layer.GetSourceCrop();
-
-    HwcRect<float> crop_rect(
-        source_crop.left / tex_width, source_crop.top / tex_height,
-        source_crop.right / tex_width, source_crop.bottom / tex_height);
-
-    float crop_size[2] = {crop_rect.bounds[2] - crop_rect.bounds[0],
-                          crop_rect.bounds[3] - crop_rect.bounds[1]};
-
-    for (int j = 0; j < 4; j++) {
-      int b = j ^ (swap_xy ? 1 : 0);
-      float bound_percent =
-          (bounds[b] - display_rect.bounds[b % 2]) / display_size[b % 2];
-      if (flip_xy[j % 2]) {
-        src.crop_bounds_[j] =
-            crop_rect.bounds[j % 2 + 2] - bound_percent * crop_size[j % 2];
-      } else {
-        src.crop_bounds_[j] =
-            crop_rect.bounds[j % 2] + bound_percent * crop_size[j % 2];
-      }
+  HwcRect<float> display_rect;
+  float display_size[2];
+
+  if (uses_display_up_scaling_) {
+    display_rect = layer.GetSourceCrop();
+    display_size[0] = static_cast<float>(layer.GetSourceCropWidth());
+    display_size[1] = static_cast<float>(layer.GetSourceCropHeight());
+  } else {
+    const HwcRect<int> &display_Rect = layer.GetDisplayFrame();
+    display_rect.left = static_cast<float>(display_Rect.left);
+    display_rect.right = static_cast<float>(display_Rect.right);
+    display_rect.top = static_cast<float>(display_Rect.top);
+    display_rect.bottom = static_cast<float>(display_Rect.bottom);
+    if (downscaling_factor_ > 1) {
+      display_rect.right =
+          display_rect.right -
+          ((display_rect.right - display_rect.left) / downscaling_factor_);
+
+      display_size[0] = display_rect.right - display_rect.left;
+      display_size[1] = display_rect.bottom - display_rect.top;
+    } else {
+      display_size[0] = static_cast<float>(layer.GetDisplayFrameWidth());
+      display_size[1] = static_cast<float>(layer.GetDisplayFrameHeight());
     }
+  }
 
-    if (layer.GetBlending() == HWCBlending::kBlendingNone) {
-      src.alpha_ = src.premult_ = 1.0f;
-      break;
+  float tex_width = static_cast<float>(layer.GetBuffer()->GetWidth());
+  float tex_height = static_cast<float>(layer.GetBuffer()->GetHeight());
+  const HwcRect<float> &source_crop = layer.GetSourceCrop();
+
+  HwcRect<float> crop_rect(
+      source_crop.left / tex_width, source_crop.top / tex_height,
+      source_crop.right / tex_width, source_crop.bottom / tex_height);
+
+  float crop_size[2] = {crop_rect.bounds[2] - crop_rect.bounds[0],
+                        crop_rect.bounds[3] - crop_rect.bounds[1]};
+
+  // A flipped bound counts down from the opposite edge of the crop.
+  for (int j = 0; j < 4; j++) {
+    int b = j ^ (swap_xy ? 1 : 0);
+    offset_[index].value[j] = display_rect.bounds[b % 2];
+    size_[index].value[j] = display_size[b % 2];
+    if (flip_xy[j % 2]) {
+      origin_[index].value[j] = crop_rect.bounds[j % 2 + 2];
+      extent_[index].value[j] = -crop_size[j % 2];
+    } else {
+      origin_[index].value[j] = crop_rect.bounds[j % 2];
+      extent_[index].value[j] = crop_size[j % 2];
     }
+  }
 
-    src.alpha_ = layer.GetAlpha() / 255.0f;
-    src.premult_ =
+  swap_xy_[index] = swap_xy;
+  sampling_key_[index] = GetSamplingKey(layer);
+  if (layer.GetBlending() == HWCBlending::kBlendingNone) {
+    opaque_[index] = 1;
+    alpha_[index] = premult_[index] = 1.0f;
+  } else {
+    opaque_[index] = 0;
+    alpha_[index] = layer.GetAlpha() / 255.0f;
+    premult_[index] =
         (layer.GetBlending() == HWCBlending::kBlendingPremult) ? 1.0f : 0.0f;
   }
 }
 
+bool LayerStateTable::FillState(size_t index, const float *bounds,
+                                const float *swapped,
+                                RenderState::LayerState &state) const {
+  const float *region = swap_xy_[index] ? swapped : bounds;
+  const float *origin = origin_[index].value;
+  const float *extent = extent_[index].value;
+  const float *offset = offset_[index].value;
+  const float *size = size_[index].value;
+  for (int j = 0; j < 4; j++) {
+    state.crop_bounds_[j] =
+        origin[j] + (region[j] - offset[j]) / size[j] * extent[j];
+  }
+
+  std::copy_n(&TransformMatrices[swap_xy_[index] ? 4 : 0], 4,
+              state.texture_matrix_);
+  state.alpha_ = alpha_[index];
+  state.premult_ = premult_[index];
+  state.layer_index_ = index;
+  state.sampling_key_ = sampling_key_[index];
+  return opaque_[index];
+}
+
 }  // namespace hwcomposer
@@ -33,6 +33,8 @@ class NativeGpuResource;
 class NativeSurface;
 class OverlayBuffer;
 
+class LayerStateTable;
+
 struct RenderState {
   struct LayerState {
     float crop_bounds_[4];
@@ -40,13 +42,49 @@ struct RenderState {
     float premult_;
     float texture_matrix_[4];
     uint32_t layer_index_;
+    // See GetYUVSamplingKey. If not kSampleExternal, plane_handles_ are
+    // the luma and chroma planes of the layer.
+    uint32_t sampling_key_;
     GpuResourceHandle handle_;
+    GpuResourceHandle plane_handles_[2];
+  };
+
+  // LayerStates of one region. They live in the layer_states_ arena of
+  // the DrawState the RenderState belongs to.
+  class LayerStateList {
+   public:
+    LayerState *begin() const {
+      return data_;
+    }
+
+    LayerState *end() const {
+      return data_ + size_;
+    }
+
+    size_t size() const {
+      return size_;
+    }
+
+    bool empty() const {
+      return size_ == 0;
+    }
+
+    LayerState &operator[](size_t index) const {
+      return data_[index];
+    }
+
+   private:
+    friend struct RenderState;
+    LayerState *data_ = NULL;
+    size_t size_ = 0;
   };
 
-  void ConstructState(std::vector<OverlayLayer> &layers,
-                      const CompositionRegion &region,
-                      uint32_t downscaling_factor, bool uses_display_up_scaling,
-                      bool use_plane_transform);
+  // Appends the LayerStates of region to arena. The arena must have
+  // capacity for all source layers of region, so that the LayerStates of
+  // earlier regions stay where they are.
+  void ConstructState(const CompositionRegion &region,
+                      const LayerStateTable &table,
+                      std::vector<LayerState> &arena);
 
   uint32_t x_;
   uint32_t y_;
@@ -56,7 +94,52 @@ struct RenderState {
   uint32_t scissor_y_;
   uint32_t scissor_width_;
   uint32_t scissor_height_;
-  std::vector<LayerState> layer_state_;
+  LayerStateList layer_state_;
+};
+
+// Part of the LayerState which doesn't depend on the region, computed
+// once per layer for all regions of a plane and kept as one array per
+// field. Crop bound j of a layer in a region is:
+//   origin[j] + (bounds[j ^ swap_xy] - offset[j]) / size[j] * extent[j]
+// where bounds are those of the region, which is done for all four
+// bounds at once.
+class LayerStateTable {
+ public:
+  // Forgets all layers. Called for every plane, as the parameters are
+  // those of the plane.
+  void Reset(size_t total_layers, uint32_t downscaling_factor,
+             bool uses_display_up_scaling, bool use_plane_transform);
+
+  // Computes the state of the source layers of region which aren't
+  // known yet.
+  void AddLayers(const std::vector<OverlayLayer> &layers,
+                 const CompositionRegion &region);
+
+  // Fills state for the layer at index in the region with bounds. Returns
+  // true if the layer is opaque, hiding the layers after it.
+  bool FillState(size_t index, const float *bounds, const float *swapped,
+                 RenderState::LayerState &state) const;
+
+ private:
+  struct Bounds {
+    float value[4];
+  };
+
+  void AddLayer(const OverlayLayer &layer, size_t index);
+
+  uint32_t downscaling_factor_ = 1;
+  bool uses_display_up_scaling_ = false;
+  bool use_plane_transform_ = false;
+  std::vector<uint8_t> known_;
+  std::vector<uint8_t> swap_xy_;
+  std::vector<uint8_t> opaque_;
+  std::vector<float> alpha_;
+  std::vector<float> premult_;
+  std::vector<uint32_t> sampling_key_;
+  std::vector<Bounds> origin_;
+  std::vector<Bounds> extent_;
+  std::vector<Bounds> offset_;
+  std::vector<Bounds> size_;
 };
 
 struct MediaState {
@@ -73,7 +156,26 @@ struct DrawState {
     }
   }
 
+  DrawState() = default;
+  DrawState(DrawState &&) = default;
+
+  // Clears the DrawState for reuse, keeping its storage.
+  void Reset() {
+    for (int32_t fence : acquire_fences_) {
+      close(fence);
+    }
+
+    acquire_fences_.clear();
+    states_.clear();
+    layer_states_.clear();
+    surface_ = NULL;
+    destroy_surface_ = false;
+    retire_fence_ = -1;
+  }
+
   std::vector<RenderState> states_;
+  // Storage for the LayerStates of all states_.
+  std::vector<RenderState::LayerState> layer_states_;
   MediaState media_state_;
   NativeSurface *surface_;
   bool destroy_surface_ = false;
@@ -18,6 +18,8 @@
 
 #include <sys/file.h>
 
+#include <chrono>
+
 #include "mosaicdisplay.h"
 
 #include "hwctrace.h"
@@ -28,6 +30,9 @@ GpuDevice::GpuDevice() : HWCThread(-8, "GpuDevice") {
 }
 
 GpuDevice::~GpuDevice() {
+  if (settings_thread_.joinable())
+    settings_thread_.join();
+
   display_manager_.reset(nullptr);
 }
 
@@ -41,18 +46,52 @@ bool GpuDevice::Initialize() {
     use_thread = false;
   }
 
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  // Parsing hwc_display.ini doesn't depend on any display state,
+  // read it while we are waiting for the kernel.
+  settings_thread_ =
+      std::thread(&GpuDevice::ParseHWCSettings, &hwc_settings_);
+
   thread_stage_lock_.lock();
   display_manager_.reset(DisplayManager::CreateDisplayManager(this));
 
   bool success = display_manager_->Initialize();
   if (!success) {
     thread_stage_lock_.unlock();
+    settings_thread_.join();
     return false;
   }
 
   thread_stage_lock_.unlock();
+  std::chrono::steady_clock::time_point manager_done =
+      std::chrono::steady_clock::now();
   HandleHWCSettings();
+  std::chrono::steady_clock::time_point settings_done =
+      std::chrono::steady_clock::now();
   InitializeHotPlugEvents(false);
+  std::chrono::steady_clock::time_point displays_done =
+      std::chrono::steady_clock::now();
+
+  ISTARTUPTRACE(
+      "GpuDevice startup(usec): DisplayManager: %lld HWCSettings: %lld "
+      "Displays: %lld Total: %lld",
+      static_cast<long long>(
+          std::chrono::duration_cast<std::chrono::microseconds>(manager_done -
+                                                                start)
+              .count()),
+      static_cast<long long>(
+          std::chrono::duration_cast<std::chrono::microseconds>(settings_done -
+                                                                manager_done)
+              .count()),
+      static_cast<long long>(
+          std::chrono::duration_cast<std::chrono::microseconds>(displays_done -
+                                                                settings_done)
+              .count()),
+      static_cast<long long>(
+          std::chrono::duration_cast<std::chrono::microseconds>(displays_done -
+                                                                start)
+              .count()));
 
   // Take the lock to ensure everything is initilized in
   // Handle Routine.
@@ -105,16 +144,7 @@ void GpuDevice::RegisterHotPlugEventCallback(
   display_manager_->RegisterHotPlugEventCallback(callback);
 }
 
-void GpuDevice::HandleHWCSettings() {
-  initialization_state_lock_.lock();
-  if ((initialization_state_ & kHWCSettingsInProgress) ||
-      (initialization_state_ & kHWCSettingsDone)) {
-    initialization_state_lock_.unlock();
-    return;
-  }
-
-  initialization_state_ |= kHWCSettingsInProgress;
-  initialization_state_lock_.unlock();
+void GpuDevice::ParseHWCSettings(HWCSettings *settings) {
   // Handle config file reading
   const char *hwc_dp_cfg_path = std::getenv("HWC_DISPLAY_CONFIG");
   if (!hwc_dp_cfg_path) {
@@ -329,6 +359,50 @@ void GpuDevice::HandleHWCSettings() {
     }
   };
 
+  settings->use_logical = use_logical;
+  settings->use_mosaic = use_mosaic;
+  settings->use_cloned = use_cloned;
+  settings->rotate_display = rotate_display;
+  settings->logical_displays.swap(logical_displays);
+  settings->physical_displays.swap(physical_displays);
+  settings->display_rotation.swap(display_rotation);
+  settings->rotation_display_index.swap(rotation_display_index);
+  settings->cloned_displays.swap(cloned_displays);
+  settings->mosaic_displays.swap(mosaic_displays);
+}
+
+void GpuDevice::HandleHWCSettings() {
+  initialization_state_lock_.lock();
+  if ((initialization_state_ & kHWCSettingsInProgress) ||
+      (initialization_state_ & kHWCSettingsDone)) {
+    initialization_state_lock_.unlock();
+    return;
+  }
+
+  initialization_state_ |= kHWCSettingsInProgress;
+  initialization_state_lock_.unlock();
+  // Config file is parsed in parallel with display manager
+  // initialization, wait for it to finish.
+  if (settings_thread_.joinable()) {
+    settings_thread_.join();
+  } else {
+    ParseHWCSettings(&hwc_settings_);
+  }
+
+  bool use_logical = hwc_settings_.use_logical;
+  bool use_mosaic = hwc_settings_.use_mosaic;
+  bool use_cloned = hwc_settings_.use_cloned;
+  bool rotate_display = hwc_settings_.rotate_display;
+  std::vector<uint32_t> &logical_displays = hwc_settings_.logical_displays;
+  std::vector<uint32_t> &physical_displays = hwc_settings_.physical_displays;
+  std::vector<uint32_t> &display_rotation = hwc_settings_.display_rotation;
+  std::vector<uint32_t> &rotation_display_index =
+      hwc_settings_.rotation_display_index;
+  std::vector<std::vector<uint32_t>> &cloned_displays =
+      hwc_settings_.cloned_displays;
+  std::vector<std::vector<uint32_t>> &mosaic_displays =
+      hwc_settings_.mosaic_displays;
+
   InitializeHotPlugEvents();
   std::vector<NativeDisplay *> displays;
   std::vector<NativeDisplay *> unordered_displays =
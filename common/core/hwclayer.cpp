@@ -20,6 +20,8 @@
 
 #include <hwcutils.h>
 
+#include "sharedfence.h"
+
 namespace hwcomposer {
 
 // Minimum threshold before we take advantage of
@@ -65,6 +67,15 @@ void HwcLayer::SetBlending(HWCBlending blending) {
   }
 }
 
+void HwcLayer::SetColorSpace(HWCColorSpace color_space,
+                             HWCColorRange color_range) {
+  if (color_space != color_space_ || color_range != color_range_) {
+    color_space_ = color_space;
+    color_range_ = color_range;
+    UpdateRenderingDamage(display_frame_, display_frame_, true);
+  }
+}
+
 void HwcLayer::SetSourceCrop(const HwcRect<float>& source_crop) {
   if ((source_crop.left != source_crop_.left) ||
       (source_crop.right != source_crop_.right) ||
@@ -179,12 +190,32 @@ void HwcLayer::SetReleaseFence(int32_t fd) {
     release_fd_ = -1;
   }
 
+  shared_release_fences_.clear();
   release_fd_ = fd;
 }
 
+void HwcLayer::AddReleaseFence(const std::shared_ptr<SharedFence>& fence) {
+  shared_release_fences_.emplace_back(fence);
+}
+
 int32_t HwcLayer::GetReleaseFence() {
   int32_t old_fd = release_fd_;
   release_fd_ = -1;
+  for (const std::shared_ptr<SharedFence>& fence : shared_release_fences_) {
+    if (old_fd <= 0) {
+      old_fd = fence->Duplicate();
+      continue;
+    }
+
+    // Fences are added in order, if merging fails the newer one is kept.
+    int32_t merged = fence->Merge(old_fd);
+    if (merged > 0) {
+      close(old_fd);
+      old_fd = merged;
+    }
+  }
+
+  shared_release_fences_.clear();
   return old_fd;
 }
 
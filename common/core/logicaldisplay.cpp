@@ -176,6 +176,71 @@ void LogicalDisplay::RestoreVideoDefaultDeinterlace() {
   physical_display_->RestoreVideoDefaultDeinterlace();
 }
 
+void LogicalDisplay::UpdateVideoState(int64_t session_id, bool is_prepared) {
+  physical_display_->UpdateVideoState(session_id, is_prepared);
+}
+
+void LogicalDisplay::UpdateVideoFPS(int64_t session_id, int32_t fps) {
+  physical_display_->UpdateVideoFPS(session_id, fps);
+}
+
+void LogicalDisplay::SetOptimizationMode(HWCOptimizationMode mode) {
+  physical_display_->SetOptimizationMode(mode);
+}
+
+bool LogicalDisplay::SetOverscan(int32_t x_overscan, int32_t y_overscan) {
+  return physical_display_->SetOverscan(x_overscan, y_overscan);
+}
+
+bool LogicalDisplay::GetOverscan(int32_t *x_overscan, int32_t *y_overscan) {
+  return physical_display_->GetOverscan(x_overscan, y_overscan);
+}
+
+bool LogicalDisplay::SetDisplayScaling(HWCDisplayScaling mode) {
+  return physical_display_->SetDisplayScaling(mode);
+}
+
+bool LogicalDisplay::GetDisplayScaling(HWCDisplayScaling *mode) {
+  return physical_display_->GetDisplayScaling(mode);
+}
+
+bool LogicalDisplay::SetBlank(bool blank) {
+  return physical_display_->SetBlank(blank);
+}
+
+bool LogicalDisplay::GetFrameStatistics(
+    uint64_t since_frame, std::vector<HwcFrameStatistics> *frames) {
+  return physical_display_->GetFrameStatistics(since_frame, frames);
+}
+
+bool LogicalDisplay::GetSurfacePoolStatistics(
+    HwcSurfacePoolStatistics *stats) {
+  return physical_display_->GetSurfacePoolStatistics(stats);
+}
+
+bool LogicalDisplay::GetLayerStatistics(
+    std::vector<HwcLayerStatistics> *layers) {
+  return physical_display_->GetLayerStatistics(layers);
+}
+
+bool LogicalDisplay::StartFrameCapture(uint32_t frames,
+                                       const char *directory) {
+  return physical_display_->StartFrameCapture(frames, directory);
+}
+
+bool LogicalDisplay::GetFrameCaptureStatistics(
+    HwcFrameCaptureStatistics *stats) {
+  return physical_display_->GetFrameCaptureStatistics(stats);
+}
+
+void LogicalDisplay::TakeCapturedFrames(std::vector<HwcCapturedFrame> *frames) {
+  physical_display_->TakeCapturedFrames(frames);
+}
+
+void LogicalDisplay::SetWarmSuspend(bool enable, uint64_t surface_budget) {
+  physical_display_->SetWarmSuspend(enable, surface_budget);
+}
+
 void LogicalDisplay::UpdateScalingRatio(uint32_t /*primary_width*/,
                                         uint32_t /*primary_height*/,
                                         uint32_t /*display_width*/,
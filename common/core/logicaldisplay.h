@@ -83,6 +83,30 @@ class LogicalDisplay : public NativeDisplay {
   void SetVideoDeinterlace(HWCDeinterlaceFlag flag,
                            HWCDeinterlaceControl mode) override;
   void RestoreVideoDefaultDeinterlace() override;
+  void UpdateVideoState(int64_t session_id, bool is_prepared) override;
+  void UpdateVideoFPS(int64_t session_id, int32_t fps) override;
+  void SetOptimizationMode(HWCOptimizationMode mode) override;
+
+  bool SetOverscan(int32_t x_overscan, int32_t y_overscan) override;
+  bool GetOverscan(int32_t *x_overscan, int32_t *y_overscan) override;
+  bool SetDisplayScaling(HWCDisplayScaling mode) override;
+  bool GetDisplayScaling(HWCDisplayScaling *mode) override;
+  bool SetBlank(bool blank) override;
+
+  bool GetFrameStatistics(uint64_t since_frame,
+                          std::vector<HwcFrameStatistics> *frames) override;
+
+  bool GetSurfacePoolStatistics(HwcSurfacePoolStatistics *stats) override;
+
+  bool GetLayerStatistics(std::vector<HwcLayerStatistics> *layers) override;
+
+  bool StartFrameCapture(uint32_t frames, const char *directory) override;
+
+  bool GetFrameCaptureStatistics(HwcFrameCaptureStatistics *stats) override;
+
+  void TakeCapturedFrames(std::vector<HwcCapturedFrame> *frames) override;
+
+  void SetWarmSuspend(bool enable, uint64_t surface_budget) override;
 
   bool IsConnected() const override;
 
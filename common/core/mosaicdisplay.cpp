@@ -168,6 +168,13 @@ bool MosaicDisplay::SetPowerMode(uint32_t power_mode) {
   return true;
 }
 
+void MosaicDisplay::SetWarmSuspend(bool enable, uint64_t surface_budget) {
+  uint32_t size = physical_displays_.size();
+  for (uint32_t i = 0; i < size; i++) {
+    physical_displays_.at(i)->SetWarmSuspend(enable, surface_budget);
+  }
+}
+
 bool MosaicDisplay::Present(std::vector<HwcLayer *> &source_layers,
                             int32_t *retire_fence,
                             bool /*handle_constraints*/) {
@@ -443,6 +450,74 @@ void MosaicDisplay::RestoreVideoDefaultDeinterlace() {
   }
 }
 
+void MosaicDisplay::UpdateVideoState(int64_t session_id, bool is_prepared) {
+  uint32_t size = physical_displays_.size();
+  for (uint32_t i = 0; i < size; i++) {
+    physical_displays_.at(i)->UpdateVideoState(session_id, is_prepared);
+  }
+}
+
+void MosaicDisplay::UpdateVideoFPS(int64_t session_id, int32_t fps) {
+  uint32_t size = physical_displays_.size();
+  for (uint32_t i = 0; i < size; i++) {
+    physical_displays_.at(i)->UpdateVideoFPS(session_id, fps);
+  }
+}
+
+void MosaicDisplay::SetOptimizationMode(HWCOptimizationMode mode) {
+  uint32_t size = physical_displays_.size();
+  for (uint32_t i = 0; i < size; i++) {
+    physical_displays_.at(i)->SetOptimizationMode(mode);
+  }
+}
+
+bool MosaicDisplay::SetOverscan(int32_t x_overscan, int32_t y_overscan) {
+  bool supported = !physical_displays_.empty();
+  uint32_t size = physical_displays_.size();
+  for (uint32_t i = 0; i < size; i++) {
+    if (!physical_displays_.at(i)->SetOverscan(x_overscan, y_overscan))
+      supported = false;
+  }
+
+  return supported;
+}
+
+bool MosaicDisplay::GetOverscan(int32_t *x_overscan, int32_t *y_overscan) {
+  if (physical_displays_.empty())
+    return false;
+
+  return physical_displays_.at(0)->GetOverscan(x_overscan, y_overscan);
+}
+
+bool MosaicDisplay::SetDisplayScaling(HWCDisplayScaling mode) {
+  bool supported = !physical_displays_.empty();
+  uint32_t size = physical_displays_.size();
+  for (uint32_t i = 0; i < size; i++) {
+    if (!physical_displays_.at(i)->SetDisplayScaling(mode))
+      supported = false;
+  }
+
+  return supported;
+}
+
+bool MosaicDisplay::GetDisplayScaling(HWCDisplayScaling *mode) {
+  if (physical_displays_.empty())
+    return false;
+
+  return physical_displays_.at(0)->GetDisplayScaling(mode);
+}
+
+bool MosaicDisplay::SetBlank(bool blank) {
+  bool blanked = !physical_displays_.empty();
+  uint32_t size = physical_displays_.size();
+  for (uint32_t i = 0; i < size; i++) {
+    if (!physical_displays_.at(i)->SetBlank(blank))
+      blanked = false;
+  }
+
+  return blanked;
+}
+
 void MosaicDisplay::UpdateScalingRatio(uint32_t /*primary_width*/,
                                        uint32_t /*primary_height*/,
                                        uint32_t /*display_width*/,
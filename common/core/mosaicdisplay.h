@@ -50,6 +50,8 @@ class MosaicDisplay : public NativeDisplay {
 
   bool SetPowerMode(uint32_t power_mode) override;
 
+  void SetWarmSuspend(bool enable, uint64_t surface_budget) override;
+
   bool Present(std::vector<HwcLayer *> &source_layers, int32_t *retire_fence,
                bool handle_constraints = false) override;
 
@@ -76,6 +78,15 @@ class MosaicDisplay : public NativeDisplay {
   void SetVideoDeinterlace(HWCDeinterlaceFlag flag,
                            HWCDeinterlaceControl mode) override;
   void RestoreVideoDefaultDeinterlace() override;
+  void UpdateVideoState(int64_t session_id, bool is_prepared) override;
+  void UpdateVideoFPS(int64_t session_id, int32_t fps) override;
+  void SetOptimizationMode(HWCOptimizationMode mode) override;
+
+  bool SetOverscan(int32_t x_overscan, int32_t y_overscan) override;
+  bool GetOverscan(int32_t *x_overscan, int32_t *y_overscan) override;
+  bool SetDisplayScaling(HWCDisplayScaling mode) override;
+  bool GetDisplayScaling(HWCDisplayScaling *mode) override;
+  bool SetBlank(bool blank) override;
 
   bool IsConnected() const override;
 
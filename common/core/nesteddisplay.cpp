@@ -17,27 +17,204 @@
 #include "nesteddisplay.h"
 
 #include <nativebufferhandler.h>
+#include <hwclayer.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 #include <string>
 #include <sstream>
 
 #include <hwctrace.h>
+#include <hwcutils.h>
+
+#include "nestedprotocol.h"
+#include "sharedfence.h"
 
 namespace hwcomposer {
 
+// Frames between attempts to connect to the host.
+#define NESTED_RECONNECT_FRAMES 60
+// Buffers not presented for this many frames are dropped by the host.
+#define NESTED_BUFFER_IDLE_FRAMES 120
+
+static void CloseFds(const std::vector<int> &fds) {
+  for (int fd : fds) {
+    if (fd >= 0)
+      close(fd);
+  }
+}
+
 NestedDisplay::NestedDisplay() {
 }
 
 NestedDisplay::~NestedDisplay() {
+  DisconnectFromHost();
 }
 
 void NestedDisplay::InitNestedDisplay() {
+  if (socket_ < 0)
+    ConnectToHost();
 }
 
-bool NestedDisplay::Initialize(NativeBufferHandler * /*buffer_handler*/) {
+bool NestedDisplay::Initialize(NativeBufferHandler *buffer_handler) {
+  buffer_handler_ = buffer_handler;
   return true;
 }
 
+bool NestedDisplay::ConnectToHost() {
+  last_connect_frame_ = frame_;
+  const char *path = getenv(NESTED_SOCKET_ENV);
+  if (!path)
+    path = NESTED_DEFAULT_SOCKET;
+
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    ETRACE("NestedDisplay: Socket path %s is too long.", path);
+    return false;
+  }
+
+  strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+  int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    ETRACE("NestedDisplay: Failed to create socket %s", PRINTERROR());
+    return false;
+  }
+
+  if (connect(fd, reinterpret_cast<struct sockaddr *>(&address),
+              sizeof(address)) < 0) {
+    // No host listening, not an error.
+    close(fd);
+    return false;
+  }
+
+  NestedHello hello;
+  hello.version = NESTED_PROTOCOL_VERSION;
+  NestedMessageHeader header;
+  std::vector<uint8_t> payload;
+  std::vector<int> fds;
+  if (SendNestedMessage(fd, kNestedHello, &hello, sizeof(hello), NULL, 0) <
+          0 ||
+      !ReceiveNestedMessage(fd, NESTED_REPLY_TIMEOUT, &header, &payload,
+                            &fds) ||
+      header.type != kNestedConfig || payload.size() < sizeof(NestedConfig)) {
+    ETRACE("NestedDisplay: Host at %s didn't send its configuration.", path);
+    CloseFds(fds);
+    close(fd);
+    return false;
+  }
+
+  CloseFds(fds);
+  NestedConfig config;
+  memcpy(&config, payload.data(), sizeof(config));
+  if (config.width && config.height) {
+    width_ = config.width;
+    height_ = config.height;
+  }
+
+  if (config.refresh_rate)
+    refresh_rate_ = config.refresh_rate;
+
+  if (!reply_thread_.Start(fd)) {
+    close(fd);
+    return false;
+  }
+
+  socket_ = fd;
+  IHOTPLUGEVENTTRACE("NestedDisplay: Connected to %s, %dx%d@%d", path, width_,
+                     height_, refresh_rate_);
+  return true;
+}
+
+void NestedDisplay::DisconnectFromHost() {
+  reply_thread_.Stop();
+  if (socket_ >= 0) {
+    close(socket_);
+    socket_ = -1;
+  }
+
+  // The host drops buffers of a guest which went away.
+  buffers_.clear();
+}
+
+uint32_t NestedDisplay::GetBufferId(HWCNativeHandle handle,
+                                    uint64_t *bytes_sent) {
+  const HWCNativeBuffer &native_buffer = GETNATIVEBUFFER(handle);
+  auto it = buffers_.find(native_buffer);
+  if (it != buffers_.end()) {
+    it->second.last_used_ = frame_;
+    return it->second.id_;
+  }
+
+  if (!buffer_handler_)
+    return 0;
+
+  // Import a copy of the handle for the buffer's layout, the host gets
+  // its own reference to the dma-buf.
+  HWCNativeHandle copy = 0;
+  buffer_handler_->CopyHandle(handle, &copy);
+  if (!buffer_handler_->ImportBuffer(copy)) {
+    ETRACE("NestedDisplay: Failed to import buffer.");
+    buffer_handler_->DestroyHandle(copy);
+    return 0;
+  }
+
+  const HwcBuffer &meta_data = copy->meta_data_;
+  NestedBuffer buffer;
+  memset(&buffer, 0, sizeof(buffer));
+  buffer.id = next_buffer_id_++;
+  if (!next_buffer_id_)
+    next_buffer_id_ = 1;
+  buffer.width = meta_data.width_;
+  buffer.height = meta_data.height_;
+  buffer.format = meta_data.format_;
+  buffer.total_planes = buffer_handler_->GetTotalPlanes(copy);
+  for (uint32_t i = 0; i < 4; i++) {
+    buffer.pitches[i] = meta_data.pitches_[i];
+    buffer.offsets[i] = meta_data.offsets_[i];
+  }
+  buffer.modifier = meta_data.modifier_;
+
+  int fd = meta_data.prime_fd_;
+  ssize_t sent = SendNestedMessage(socket_, kNestedAddBuffer, &buffer,
+                                   sizeof(buffer), &fd, 1);
+  buffer_handler_->ReleaseBuffer(copy);
+  buffer_handler_->DestroyHandle(copy);
+  if (sent < 0) {
+    ETRACE("NestedDisplay: Failed to send buffer %s", PRINTERROR());
+    return 0;
+  }
+
+  *bytes_sent += sent;
+  BufferEntry &entry = buffers_[native_buffer];
+  entry.id_ = buffer.id;
+  entry.last_used_ = frame_;
+  return buffer.id;
+}
+
+void NestedDisplay::RemoveIdleBuffers(uint64_t *bytes_sent) {
+  for (auto it = buffers_.begin(); it != buffers_.end();) {
+    if (frame_ - it->second.last_used_ < NESTED_BUFFER_IDLE_FRAMES) {
+      ++it;
+      continue;
+    }
+
+    NestedBufferId id;
+    id.id = it->second.id_;
+    ssize_t sent = SendNestedMessage(socket_, kNestedRemoveBuffer, &id,
+                                     sizeof(id), NULL, 0);
+    if (sent > 0)
+      *bytes_sent += sent;
+
+    it = buffers_.erase(it);
+  }
+}
+
 bool NestedDisplay::IsConnected() const {
   return true;
 }
@@ -63,14 +240,157 @@ bool NestedDisplay::GetActiveConfig(uint32_t *config) {
   return true;
 }
 
-bool NestedDisplay::SetPowerMode(uint32_t /*power_mode*/) {
+bool NestedDisplay::SetPowerMode(uint32_t power_mode) {
+  power_mode_ = power_mode;
   return true;
 }
 
-bool NestedDisplay::Present(std::vector<HwcLayer *> & /*source_layers*/,
-                            int32_t * /*retire_fence*/,
+bool NestedDisplay::Present(std::vector<HwcLayer *> &source_layers,
+                            int32_t *retire_fence,
                             bool /*handle_constraints*/) {
-  // TODO implement Present
+  CTRACE();
+  *retire_fence = -1;
+  HwcFrameStatistics stats;
+  stats.present_time = GetMonotonicTime();
+  frame_++;
+
+  if (socket_ < 0 && frame_ - last_connect_frame_ >= NESTED_RECONNECT_FRAMES)
+    ConnectToHost();
+
+  // Layers which can't be forwarded are dropped, as are all layers while
+  // no host is listening.
+  uint64_t bytes_sent = 0;
+  std::vector<HwcLayer *> forwarded_layers;
+  std::vector<int> acquire_fences;
+  alignas(8) uint8_t message[NESTED_MAX_MESSAGE];
+  NestedLayer *nested_layers =
+      reinterpret_cast<NestedLayer *>(message + sizeof(NestedFrame));
+  for (HwcLayer *layer : source_layers) {
+    layer->SetReleaseFence(-1);
+    int32_t acquire_fence = layer->GetAcquireFence();
+    HWCNativeHandle handle = layer->GetNativeHandle();
+    uint32_t id = 0;
+    if (socket_ >= 0 && layer->IsVisible() && handle &&
+        !handle->is_raw_pixel_ &&
+        forwarded_layers.size() < NESTED_MAX_LAYERS)
+      id = GetBufferId(handle, &bytes_sent);
+
+    if (!id) {
+      if (acquire_fence > 0)
+        close(acquire_fence);
+      continue;
+    }
+
+    NestedLayer &nested = nested_layers[forwarded_layers.size()];
+    memset(&nested, 0, sizeof(nested));
+    nested.buffer_id = id;
+    nested.transform = layer->GetTransform();
+    nested.blending = static_cast<uint32_t>(layer->GetBlending());
+    nested.alpha = layer->GetAlpha();
+    const HwcRect<float> &crop = layer->GetSourceCrop();
+    nested.source_crop[0] = crop.left;
+    nested.source_crop[1] = crop.top;
+    nested.source_crop[2] = crop.right;
+    nested.source_crop[3] = crop.bottom;
+    const HwcRect<int> &frame = layer->GetDisplayFrame();
+    nested.display_frame[0] = frame.left;
+    nested.display_frame[1] = frame.top;
+    nested.display_frame[2] = frame.right;
+    nested.display_frame[3] = frame.bottom;
+    // The host hasn't seen anything of a new layer yet.
+    HwcRect<int> damage = layer->GetSurfaceDamage();
+    if (!layer->IsValidated()) {
+      damage = frame;
+    } else if (!layer->HasLayerContentChanged()) {
+      damage.reset();
+    }
+    nested.damage[0] = damage.left;
+    nested.damage[1] = damage.top;
+    nested.damage[2] = damage.right;
+    nested.damage[3] = damage.bottom;
+    if (acquire_fence > 0) {
+      nested.has_acquire_fence = 1;
+      acquire_fences.emplace_back(acquire_fence);
+    }
+
+    forwarded_layers.emplace_back(layer);
+  }
+
+  if (socket_ < 0) {
+    for (HwcLayer *layer : source_layers) {
+      if (layer->IsVisible())
+        layer->Validate();
+    }
+
+    return true;
+  }
+
+  NestedFrame nested_frame;
+  memset(&nested_frame, 0, sizeof(nested_frame));
+  nested_frame.frame = frame_;
+  nested_frame.total_layers = forwarded_layers.size();
+  memcpy(message, &nested_frame, sizeof(nested_frame));
+  size_t size =
+      sizeof(NestedFrame) + forwarded_layers.size() * sizeof(NestedLayer);
+  ssize_t sent =
+      SendNestedMessage(socket_, kNestedFrame, message, size,
+                        acquire_fences.data(), acquire_fences.size());
+  CloseFds(acquire_fences);
+  stats.commit_time = GetMonotonicTime();
+  if (sent < 0) {
+    ETRACE("NestedDisplay: Lost connection to host %s", PRINTERROR());
+    DisconnectFromHost();
+    return false;
+  }
+
+  bytes_sent += sent;
+
+  // Frames don't wait more than a frame period for the host, fences of
+  // a frame the host didn't complete by then signal once it did.
+  int64_t deadline = stats.commit_time + 1000000000LL / refresh_rate_;
+  int32_t release_fence = -1;
+  bool late = false;
+  if (!reply_thread_.TakeFrameFences(frame_, deadline, &release_fence,
+                                     retire_fence, &late)) {
+    ETRACE("NestedDisplay: Host didn't complete frame %llu.",
+           static_cast<unsigned long long>(frame_));
+    DisconnectFromHost();
+    return false;
+  }
+
+  if (late) {
+    ITRACE("NestedDisplay: Host didn't complete frame %llu in time.",
+           static_cast<unsigned long long>(frame_));
+  } else {
+    stats.flip_time = GetMonotonicTime();
+  }
+
+  // One fence for all layers, fds are only created for the layers whose
+  // release fence is queried.
+  if (release_fence > 0) {
+    std::shared_ptr<SharedFence> fence =
+        std::make_shared<SharedFence>(release_fence);
+    for (HwcLayer *layer : forwarded_layers)
+      layer->AddReleaseFence(fence);
+  }
+
+  for (HwcLayer *layer : source_layers) {
+    if (layer->IsVisible())
+      layer->Validate();
+  }
+
+  RemoveIdleBuffers(&bytes_sent);
+
+  stats.frame_number = frame_;
+  stats.total_layers = forwarded_layers.size();
+  stats.forwarded_bytes = bytes_sent;
+  frame_statistics_.Record(stats);
+  return true;
+}
+
+bool NestedDisplay::GetFrameStatistics(
+    uint64_t since_frame, std::vector<HwcFrameStatistics> *frames) {
+  frame_statistics_.Read(since_frame, frames);
   return true;
 }
 
@@ -158,14 +478,14 @@ bool NestedDisplay::GetDisplayAttribute(uint32_t /*config*/,
   // We always get the values from preferred mode config.
   switch (attribute) {
     case HWCDisplayAttribute::kWidth:
-      *value = 1920;
+      *value = width_;
       break;
     case HWCDisplayAttribute::kHeight:
-      *value = 1080;
+      *value = height_;
       break;
     case HWCDisplayAttribute::kRefreshRate:
       // in nanoseconds
-      *value = 60;
+      *value = refresh_rate_;
       break;
     case HWCDisplayAttribute::kDpiX:
       // Dots per 1000 inches
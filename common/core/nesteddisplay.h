@@ -21,13 +21,27 @@
 #include <stdint.h>
 
 #include <memory>
+#include <unordered_map>
 
 #include <nativedisplay.h>
+#include <platformdefines.h>
+
+#include "framestatistics.h"
+#include "nestedreplythread.h"
 
 namespace hwcomposer {
 
 class NestedDisplayManager;
+class NativeBufferHandler;
 
+// NestedDisplay forwards layers to a compositor running on the host,
+// without compositing them, see nestedprotocol.h. Buffers are shared as
+// dma-bufs once and referred to by id after that, so a frame only takes
+// the layer list and acquire fences. Release and retire fences come back
+// from the host.
+//
+// Frames presented while no host is listening are dropped, connecting
+// is retried every NESTED_RECONNECT_FRAMES frames.
 class NestedDisplay : public NativeDisplay {
  public:
   NestedDisplay();
@@ -93,6 +107,9 @@ class NestedDisplay : public NativeDisplay {
   bool GetDisplayConfigs(uint32_t *num_configs, uint32_t *configs) override;
   bool GetDisplayName(uint32_t *size, char *name) override;
 
+  bool GetFrameStatistics(uint64_t since_frame,
+                          std::vector<HwcFrameStatistics> *frames) override;
+
   bool EnableVSync() const {
     return enable_vsync_;
   }
@@ -104,13 +121,36 @@ class NestedDisplay : public NativeDisplay {
   void HotPlugUpdate(bool connected);
 
  private:
+  struct BufferEntry {
+    uint32_t id_ = 0;
+    uint64_t last_used_ = 0;
+  };
+
+  bool ConnectToHost();
+  void DisconnectFromHost();
+  // Returns the id of the buffer of handle, sending it to the host first
+  // if it wasn't yet. Returns 0 on failure.
+  uint32_t GetBufferId(HWCNativeHandle handle, uint64_t *bytes_sent);
+  // Tells the host to drop buffers which weren't used for a while.
+  void RemoveIdleBuffers(uint64_t *bytes_sent);
+
+  NativeBufferHandler *buffer_handler_ = NULL;
+  int socket_ = -1;
+  uint64_t frame_ = 0;
+  uint64_t last_connect_frame_ = 0;
+  NestedReplyThread reply_thread_;
+  uint32_t next_buffer_id_ = 1;
+  std::unordered_map<HWCNativeBuffer, BufferEntry, BufferHash, BufferEqual>
+      buffers_;
+  FrameStatisticsRing frame_statistics_;
+  uint32_t refresh_rate_ = 60;
   std::shared_ptr<RefreshCallback> refresh_callback_ = NULL;
   std::shared_ptr<VsyncCallback> vsync_callback_ = NULL;
   std::shared_ptr<HotPlugCallback> hotplug_callback_ = NULL;
   uint32_t power_mode_ = kOff;
   uint32_t display_id_;
-  uint32_t width_ = 0;
-  uint32_t height_ = 0;
+  uint32_t width_ = 1920;
+  uint32_t height_ = 1080;
   bool enable_vsync_ = false;
   uint32_t config_ = 1;
 };
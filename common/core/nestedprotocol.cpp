@@ -0,0 +1,131 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "nestedprotocol.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace hwcomposer {
+
+ssize_t SendNestedMessage(int socket, uint32_t type, const void* payload,
+                          size_t size, const int* fds, size_t total_fds) {
+  if (total_fds > NESTED_MAX_FDS ||
+      size + sizeof(NestedMessageHeader) > NESTED_MAX_MESSAGE)
+    return -1;
+
+  NestedMessageHeader header;
+  header.type = type;
+  header.size = size;
+
+  struct iovec iov[2];
+  iov[0].iov_base = &header;
+  iov[0].iov_len = sizeof(header);
+  iov[1].iov_base = const_cast<void*>(payload);
+  iov[1].iov_len = size;
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = size ? 2 : 1;
+
+  char control[CMSG_SPACE(sizeof(int) * NESTED_MAX_FDS)];
+  if (total_fds) {
+    memset(control, 0, sizeof(control));
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * total_fds);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * total_fds);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * total_fds);
+  }
+
+  ssize_t ret;
+  do {
+    ret = sendmsg(socket, &msg, MSG_NOSIGNAL);
+  } while (ret < 0 && errno == EINTR);
+
+  return ret;
+}
+
+bool ReceiveNestedMessage(int socket, int timeout, NestedMessageHeader* header,
+                          std::vector<uint8_t>* payload,
+                          std::vector<int>* fds) {
+  struct pollfd pfd;
+  pfd.fd = socket;
+  pfd.events = POLLIN;
+  int ret;
+  do {
+    ret = poll(&pfd, 1, timeout);
+  } while (ret < 0 && errno == EINTR);
+
+  if (ret <= 0 || !(pfd.revents & POLLIN))
+    return false;
+
+  uint8_t buffer[NESTED_MAX_MESSAGE];
+  struct iovec iov;
+  iov.iov_base = buffer;
+  iov.iov_len = sizeof(buffer);
+
+  char control[CMSG_SPACE(sizeof(int) * NESTED_MAX_FDS)];
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  ssize_t size;
+  do {
+    size = recvmsg(socket, &msg, MSG_CMSG_CLOEXEC);
+  } while (size < 0 && errno == EINTR);
+
+  if (size <= 0)
+    return false;
+
+  // Take ownership of all fds first, even if the message turns out to be
+  // bad, so that none of them leaks.
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+      continue;
+
+    size_t total_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    const uint8_t* data = CMSG_DATA(cmsg);
+    for (size_t i = 0; i < total_fds; i++) {
+      int fd;
+      memcpy(&fd, data + i * sizeof(int), sizeof(int));
+      fds->emplace_back(fd);
+    }
+  }
+
+  if ((msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) ||
+      static_cast<size_t>(size) < sizeof(NestedMessageHeader))
+    return false;
+
+  memcpy(header, buffer, sizeof(NestedMessageHeader));
+  if (header->size != size - sizeof(NestedMessageHeader))
+    return false;
+
+  payload->assign(buffer + sizeof(NestedMessageHeader), buffer + size);
+  return true;
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,137 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_CORE_NESTEDPROTOCOL_H_
+#define COMMON_CORE_NESTEDPROTOCOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <vector>
+
+namespace hwcomposer {
+
+// Protocol spoken by NestedDisplay (the guest) with a compositor on the
+// host, over a UNIX SOCK_SEQPACKET socket. Each message is one packet,
+// a NestedMessageHeader followed by the payload of its type, with file
+// descriptors attached as SCM_RIGHTS ancillary data.
+//
+// The guest sends kNestedHello once connected and the host answers with
+// kNestedConfig. Buffers are sent once with kNestedAddBuffer, which
+// carries their dma-buf, and are referred to by id afterwards until
+// kNestedRemoveBuffer. Every kNestedFrame is answered by kNestedFrameDone.
+#define NESTED_PROTOCOL_VERSION 1
+// Environment variable naming the socket of the host, the default is
+// used if it isn't set.
+#define NESTED_SOCKET_ENV "HWC_NESTED_SOCKET"
+#define NESTED_DEFAULT_SOCKET "/tmp/hwc-nested"
+#define NESTED_MAX_LAYERS 32
+// Largest message, a frame with NESTED_MAX_LAYERS layers.
+#define NESTED_MAX_MESSAGE 4096
+#define NESTED_MAX_FDS NESTED_MAX_LAYERS
+// How long the guest waits for the host to answer, in ms. Frames only
+// wait a frame period for their fences, the host is given up on once it
+// didn't send anything for this long.
+#define NESTED_REPLY_TIMEOUT 1000
+
+enum NestedMessageType {
+  kNestedHello = 1,        // Guest to host, NestedHello.
+  kNestedConfig = 2,       // Host to guest, NestedConfig.
+  kNestedAddBuffer = 3,    // Guest to host, NestedBuffer and its dma-buf.
+  kNestedRemoveBuffer = 4, // Guest to host, NestedBufferId.
+  // Guest to host, NestedFrame followed by total_layers NestedLayer,
+  // bottom most first, and the acquire fences of the layers which have
+  // one, in the same order.
+  kNestedFrame = 5,
+  // Host to guest, NestedFrameDone followed by the release fence and the
+  // retire fence, if the host has them.
+  kNestedFrameDone = 6
+};
+
+struct NestedMessageHeader {
+  uint32_t type;
+  uint32_t size;  // Of the payload.
+};
+
+struct NestedHello {
+  uint32_t version;
+};
+
+struct NestedConfig {
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  uint32_t refresh_rate;  // In Hz.
+};
+
+struct NestedBuffer {
+  uint32_t id;
+  uint32_t width;
+  uint32_t height;
+  uint32_t format;  // DRM_FORMAT_*.
+  uint32_t total_planes;
+  uint32_t pitches[4];
+  uint32_t offsets[4];
+  uint64_t modifier;
+};
+
+struct NestedBufferId {
+  uint32_t id;
+};
+
+struct NestedLayer {
+  uint32_t buffer_id;
+  uint32_t transform;  // HWCTransform.
+  uint32_t blending;   // HWCBlending.
+  uint32_t alpha;
+  float source_crop[4];  // Left, top, right, bottom.
+  int32_t display_frame[4];
+  // Part of the layer which changed since the last frame, as given to
+  // HwcLayer::SetSurfaceDamage. Empty if nothing did.
+  int32_t damage[4];
+  uint32_t has_acquire_fence;
+};
+
+struct NestedFrame {
+  uint64_t frame;
+  uint32_t total_layers;
+  uint32_t reserved;
+};
+
+struct NestedFrameDone {
+  uint64_t frame;
+  // Signalled once the host doesn't read the buffers of the frame any
+  // more and when the frame was shown. If the host doesn't send a fence,
+  // that already happened by the time kNestedFrameDone was sent.
+  uint32_t has_release_fence;
+  uint32_t has_retire_fence;
+};
+
+// Sends a message of type with size bytes of payload, and total_fds of
+// fds attached. Returns the number of bytes sent, -1 on error.
+ssize_t SendNestedMessage(int socket, uint32_t type, const void* payload,
+                          size_t size, const int* fds, size_t total_fds);
+
+// Receives the next message, waiting for at most timeout ms (-1 waits
+// forever). The payload is copied to payload and file descriptors
+// received, which are owned by the caller, are appended to fds. Returns
+// false on error, time out or if the peer hung up.
+bool ReceiveNestedMessage(int socket, int timeout, NestedMessageHeader* header,
+                          std::vector<uint8_t>* payload, std::vector<int>* fds);
+
+}  // namespace hwcomposer
+#endif  // COMMON_CORE_NESTEDPROTOCOL_H_
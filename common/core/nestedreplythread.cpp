@@ -0,0 +1,292 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "nestedreplythread.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <chrono>
+
+#include "hwctrace.h"
+#include "hwcutils.h"
+#include "nestedprotocol.h"
+
+namespace hwcomposer {
+
+// sw_sync interface of the kernel, which isn't part of its uapi headers.
+struct NestedSwSyncFence {
+  uint32_t value;
+  char name[32];
+  int32_t fence;
+};
+
+#define NESTED_SW_SYNC_IOC_CREATE_FENCE \
+  _IOWR('W', 0, struct NestedSwSyncFence)
+#define NESTED_SW_SYNC_IOC_INC _IOW('W', 1, uint32_t)
+
+static const char *kTimelinePaths[] = {"/sys/kernel/debug/sync/sw_sync",
+                                       "/dev/sw_sync"};
+
+NestedReplyThread::NestedReplyThread() : HWCThread(-8, "NestedReplyThread") {
+}
+
+NestedReplyThread::~NestedReplyThread() {
+  Stop();
+  if (timeline_ >= 0)
+    close(timeline_);
+}
+
+bool NestedReplyThread::Start(int socket) {
+  Stop();
+  if (timeline_ < 0) {
+    for (const char *path : kTimelinePaths) {
+      timeline_ = open(path, O_RDWR | O_CLOEXEC);
+      if (timeline_ >= 0)
+        break;
+    }
+
+    if (timeline_ < 0)
+      ITRACE("NestedReplyThread: No sw_sync timeline, late frames block.");
+  }
+
+  std::lock_guard<std::mutex> lock(lock_);
+  socket_ = socket;
+  hung_up_ = false;
+  last_reply_time_ = GetMonotonicTime();
+  fd_handler_.AddFd(socket_);
+  if (!InitWorker()) {
+    ETRACE("NestedReplyThread: Failed to start.");
+    fd_handler_.RemoveFd(socket_);
+    socket_ = -1;
+    hung_up_ = true;
+    return false;
+  }
+
+  return true;
+}
+
+void NestedReplyThread::Stop() {
+  Exit();
+  std::lock_guard<std::mutex> lock(lock_);
+  if (socket_ >= 0 && !hung_up_)
+    fd_handler_.RemoveFd(socket_);
+
+  socket_ = -1;
+  hung_up_ = true;
+  DropFrameDone();
+  for (LateFrame &late : late_frames_) {
+    for (int fence : late.fences_) {
+      fd_handler_.RemoveFd(fence);
+      close(fence);
+    }
+  }
+
+  late_frames_.clear();
+  SignalTimeline(timeline_point_);
+  frame_done_received_.notify_all();
+}
+
+bool NestedReplyThread::TakeFrameFences(uint64_t frame, int64_t deadline,
+                                        int32_t *release_fence,
+                                        int32_t *retire_fence, bool *late) {
+  *release_fence = -1;
+  *retire_fence = -1;
+  *late = false;
+  const int64_t reply_timeout = NESTED_REPLY_TIMEOUT * 1000000LL;
+  std::unique_lock<std::mutex> lock(lock_);
+  int64_t now = GetMonotonicTime();
+  while (!hung_up_ && !(has_frame_done_ && done_frame_ == frame)) {
+    if (now >= deadline) {
+      *late = true;
+      if (now - last_reply_time_ >= reply_timeout)
+        return false;
+
+      if (timeline_ >= 0)
+        break;
+
+      // Without a timeline, buffers of the frame can only be released
+      // once the host completed it.
+      deadline = last_reply_time_ + reply_timeout;
+      continue;
+    }
+
+    frame_done_received_.wait_for(lock,
+                                  std::chrono::nanoseconds(deadline - now));
+    now = GetMonotonicTime();
+  }
+
+  if (hung_up_)
+    return false;
+
+  if (has_frame_done_ && done_frame_ == frame) {
+    *release_fence = done_release_fence_;
+    *retire_fence = done_retire_fence_;
+    done_release_fence_ = -1;
+    done_retire_fence_ = -1;
+    has_frame_done_ = false;
+    return true;
+  }
+
+  struct NestedSwSyncFence data;
+  memset(&data, 0, sizeof(data));
+  data.value = timeline_point_ + 1;
+  strncpy(data.name, "hwc nested", sizeof(data.name) - 1);
+  if (ioctl(timeline_, NESTED_SW_SYNC_IOC_CREATE_FENCE, &data) < 0) {
+    ETRACE("NestedReplyThread: Failed to create fence %s", PRINTERROR());
+    return false;
+  }
+
+  timeline_point_++;
+  LateFrame late_frame;
+  late_frame.frame_ = frame;
+  late_frame.point_ = timeline_point_;
+  late_frames_.emplace_back(late_frame);
+  *release_fence = data.fence;
+  *retire_fence = dup(data.fence);
+  return true;
+}
+
+void NestedReplyThread::HandleRoutine() {
+  std::lock_guard<std::mutex> lock(lock_);
+  if (socket_ >= 0 && !hung_up_)
+    ReceiveMessages();
+
+  SignalLateFrames();
+}
+
+void NestedReplyThread::ReceiveMessages() {
+  NestedMessageHeader header;
+  std::vector<uint8_t> payload;
+  std::vector<int> fds;
+  struct pollfd pfd;
+  pfd.fd = socket_;
+  pfd.events = POLLIN;
+  while (poll(&pfd, 1, 0) > 0) {
+    fds.clear();
+    if (!(pfd.revents & POLLIN) ||
+        !ReceiveNestedMessage(socket_, 0, &header, &payload, &fds)) {
+      for (int fd : fds)
+        close(fd);
+
+      // The host drops the buffers of frames it didn't complete.
+      hung_up_ = true;
+      fd_handler_.RemoveFd(socket_);
+      for (LateFrame &late : late_frames_)
+        late.completed_ = true;
+
+      frame_done_received_.notify_all();
+      return;
+    }
+
+    last_reply_time_ = GetMonotonicTime();
+    if (header.type != kNestedFrameDone ||
+        payload.size() < sizeof(NestedFrameDone)) {
+      for (int fd : fds)
+        close(fd);
+
+      continue;
+    }
+
+    NestedFrameDone done;
+    memcpy(&done, payload.data(), sizeof(done));
+    size_t fd_index = 0;
+    int32_t release_fence = -1;
+    int32_t retire_fence = -1;
+    if (done.has_release_fence && fd_index < fds.size())
+      release_fence = fds[fd_index++];
+    if (done.has_retire_fence && fd_index < fds.size())
+      retire_fence = fds[fd_index++];
+    for (size_t i = fd_index; i < fds.size(); i++)
+      close(fds[i]);
+
+    LateFrame *late_frame = NULL;
+    for (LateFrame &late : late_frames_) {
+      if (late.frame_ == done.frame)
+        late_frame = &late;
+    }
+
+    if (late_frame) {
+      late_frame->completed_ = true;
+      for (int32_t fence : {release_fence, retire_fence}) {
+        if (fence < 0)
+          continue;
+
+        late_frame->fences_.emplace_back(fence);
+        fd_handler_.AddFd(fence);
+      }
+
+      continue;
+    }
+
+    DropFrameDone();
+    has_frame_done_ = true;
+    done_frame_ = done.frame;
+    done_release_fence_ = release_fence;
+    done_retire_fence_ = retire_fence;
+    frame_done_received_.notify_all();
+  }
+}
+
+void NestedReplyThread::SignalLateFrames() {
+  for (LateFrame &late : late_frames_) {
+    for (auto it = late.fences_.begin(); it != late.fences_.end();) {
+      if (!fd_handler_.IsReady(*it)) {
+        ++it;
+        continue;
+      }
+
+      fd_handler_.RemoveFd(*it);
+      close(*it);
+      it = late.fences_.erase(it);
+    }
+  }
+
+  // Points of the timeline signal in order.
+  while (!late_frames_.empty() && late_frames_.front().completed_ &&
+         late_frames_.front().fences_.empty()) {
+    SignalTimeline(late_frames_.front().point_);
+    late_frames_.pop_front();
+  }
+}
+
+void NestedReplyThread::SignalTimeline(uint32_t point) {
+  if (timeline_ < 0 || point == signalled_point_)
+    return;
+
+  uint32_t count = point - signalled_point_;
+  if (ioctl(timeline_, NESTED_SW_SYNC_IOC_INC, &count) < 0)
+    ETRACE("NestedReplyThread: Failed to signal fences %s", PRINTERROR());
+
+  signalled_point_ = point;
+}
+
+void NestedReplyThread::DropFrameDone() {
+  if (done_release_fence_ >= 0)
+    close(done_release_fence_);
+
+  if (done_retire_fence_ >= 0)
+    close(done_retire_fence_);
+
+  done_release_fence_ = -1;
+  done_retire_fence_ = -1;
+  has_frame_done_ = false;
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,96 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_CORE_NESTEDREPLYTHREAD_H_
+#define COMMON_CORE_NESTEDREPLYTHREAD_H_
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "hwcthread.h"
+
+namespace hwcomposer {
+
+// Receives the messages the host sends a NestedDisplay, so that frames
+// don't have to wait for the host to answer.
+//
+// Frames the host doesn't complete in time get their fences from a
+// sw_sync timeline instead. A point of the timeline signals once the host
+// completed the frame and the fences it sent for it signalled, until then
+// the host may still read the buffers of the frame.
+class NestedReplyThread : public HWCThread {
+ public:
+  NestedReplyThread();
+  ~NestedReplyThread() override;
+
+  // Starts receiving from socket, which stays owned by caller.
+  bool Start(int socket);
+  // Stops receiving. Fences of frames which weren't completed signal, as
+  // the host drops the buffers of a guest which went away.
+  void Stop();
+
+  // Takes the release and retire fence of frame, -1 for those the host
+  // didn't send, waiting until deadline (CLOCK_MONOTONIC in ns) at most
+  // for the host to complete it. Fences of the timeline are taken after
+  // that, without a timeline this waits until the host didn't send
+  // anything for NESTED_REPLY_TIMEOUT. Sets late if the frame wasn't
+  // completed in time. Returns false if the host hung up or stopped
+  // answering.
+  bool TakeFrameFences(uint64_t frame, int64_t deadline,
+                       int32_t* release_fence, int32_t* retire_fence,
+                       bool* late);
+
+ protected:
+  void HandleRoutine() override;
+
+ private:
+  struct LateFrame {
+    uint64_t frame_ = 0;
+    uint32_t point_ = 0;
+    bool completed_ = false;
+    // Fences sent by the host which didn't signal yet.
+    std::vector<int> fences_;
+  };
+
+  void ReceiveMessages();
+  // Signals the points of late frames which are done, in order.
+  void SignalLateFrames();
+  void SignalTimeline(uint32_t point);
+  void DropFrameDone();
+
+  std::mutex lock_;
+  std::condition_variable frame_done_received_;
+  int socket_ = -1;
+  bool hung_up_ = false;
+  // When the host last sent a message, CLOCK_MONOTONIC in ns.
+  int64_t last_reply_time_ = 0;
+  // Last kNestedFrameDone received, until taken by TakeFrameFences.
+  bool has_frame_done_ = false;
+  uint64_t done_frame_ = 0;
+  int32_t done_release_fence_ = -1;
+  int32_t done_retire_fence_ = -1;
+  int timeline_ = -1;
+  uint32_t timeline_point_ = 0;
+  uint32_t signalled_point_ = 0;
+  std::deque<LateFrame> late_frames_;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_CORE_NESTEDREPLYTHREAD_H_
@@ -22,6 +22,7 @@
 #include <hwctrace.h>
 
 #include "hwcutils.h"
+#include "panelfitter.h"
 
 #include "resourcemanager.h"
 
@@ -86,7 +87,8 @@ void OverlayLayer::SetBuffer(HWCNativeHandle handle, int32_t acquire_fence,
     }
   }
 
-  if (register_buffer && handle->is_raw_pixel_ && !surface_damage_.empty()) {
+  if (register_buffer && handle->is_raw_pixel_ && !surface_damage_.empty() &&
+      !(state_ & kPreview)) {
     buffer->UpdateRawPixelBackingStore(handle->pixel_memory_);
     state_ |= kRawPixelDataChanged;
   }
@@ -201,7 +203,8 @@ void OverlayLayer::InitializeState(HwcLayer* layer,
                                    OverlayLayer* previous_layer,
                                    uint32_t z_order, uint32_t layer_index,
                                    uint32_t max_height, uint32_t rotation,
-                                   bool handle_constraints) {
+                                   bool handle_constraints,
+                                   const PanelFitter* panel_fitter) {
   transform_ = layer->GetTransform();
   if (rotation != kRotateNone) {
     ValidateTransform(layer->GetTransform(), rotation);
@@ -216,6 +219,8 @@ void OverlayLayer::InitializeState(HwcLayer* layer,
   source_crop_height_ = layer->GetSourceCropHeight();
   source_crop_ = layer->GetSourceCrop();
   blending_ = layer->GetBlending();
+  color_space_ = layer->GetColorSpace();
+  color_range_ = layer->GetColorRange();
   surface_damage_ = layer->GetLayerDamage();
   SetBuffer(layer->GetNativeHandle(), layer->GetAcquireFence(),
             resource_manager, true);
@@ -225,7 +230,10 @@ void OverlayLayer::InitializeState(HwcLayer* layer,
   }
 
   if (!handle_constraints) {
-    if (previous_layer) {
+    if (panel_fitter)
+      FitToDisplay(*panel_fitter);
+
+    if (previous_layer && IsVisible()) {
       ValidatePreviousFrameState(previous_layer, layer);
     }
     return;
@@ -312,11 +320,28 @@ void OverlayLayer::InitializeState(HwcLayer* layer,
                                            static_cast<int>(source_crop_.top));
   }
 
-  if (previous_layer) {
+  if (panel_fitter)
+    FitToDisplay(*panel_fitter);
+
+  if (previous_layer && IsVisible()) {
     ValidatePreviousFrameState(previous_layer, layer);
   }
 }
 
+void OverlayLayer::FitToDisplay(const PanelFitter& panel_fitter) {
+  HwcRect<float> source_crop = source_crop_;
+  if (!panel_fitter.MapLayer(transform_, &display_frame_, &source_crop)) {
+    state_ |= kInvisible;
+    return;
+  }
+
+  display_frame_width_ = display_frame_.right - display_frame_.left;
+  display_frame_height_ = display_frame_.bottom - display_frame_.top;
+  SetSourceCrop(source_crop);
+  if (!surface_damage_.empty())
+    surface_damage_ = panel_fitter.MapRect(surface_damage_);
+}
+
 void OverlayLayer::InitializeFromHwcLayer(
     HwcLayer* layer, ResourceManager* resource_manager,
     OverlayLayer* previous_layer, uint32_t z_order, uint32_t layer_index,
@@ -325,17 +350,44 @@ void OverlayLayer::InitializeFromHwcLayer(
   display_frame_height_ = layer->GetDisplayFrameHeight();
   display_frame_ = layer->GetDisplayFrame();
   InitializeState(layer, resource_manager, previous_layer, z_order, layer_index,
-                  max_height, rotation, handle_constraints);
+                  max_height, rotation, handle_constraints, NULL);
 }
 
-void OverlayLayer::InitializeFromScaledHwcLayer(
+void OverlayLayer::InitializeFromFittedHwcLayer(
     HwcLayer* layer, ResourceManager* resource_manager,
     OverlayLayer* previous_layer, uint32_t z_order, uint32_t layer_index,
-    const HwcRect<int>& display_frame, uint32_t max_height, uint32_t rotation,
+    const PanelFitter& panel_fitter, uint32_t max_height, uint32_t rotation,
     bool handle_constraints) {
-  SetDisplayFrame(display_frame);
+  display_frame_width_ = layer->GetDisplayFrameWidth();
+  display_frame_height_ = layer->GetDisplayFrameHeight();
+  display_frame_ = layer->GetDisplayFrame();
   InitializeState(layer, resource_manager, previous_layer, z_order, layer_index,
-                  max_height, rotation, handle_constraints);
+                  max_height, rotation, handle_constraints, &panel_fitter);
+}
+
+void OverlayLayer::InitializeFromOverlayLayer(const OverlayLayer& rhs,
+                                              uint32_t z_order) {
+  transform_ = rhs.transform_;
+  plane_transform_ = rhs.plane_transform_;
+  z_order_ = z_order;
+  layer_index_ = z_order;
+  source_crop_width_ = rhs.source_crop_width_;
+  source_crop_height_ = rhs.source_crop_height_;
+  display_frame_width_ = rhs.display_frame_width_;
+  display_frame_height_ = rhs.display_frame_height_;
+  alpha_ = rhs.alpha_;
+  source_crop_ = rhs.source_crop_;
+  display_frame_ = rhs.display_frame_;
+  surface_damage_ = rhs.display_frame_;
+  blending_ = rhs.blending_;
+  color_space_ = rhs.color_space_;
+  color_range_ = rhs.color_range_;
+  state_ = kLayerContentChanged | kDimensionsChanged;
+  supported_composition_ = rhs.supported_composition_;
+  actual_composition_ = rhs.actual_composition_;
+  type_ = rhs.type_;
+  std::shared_ptr<OverlayBuffer> buffer = rhs.imported_buffer_->buffer_;
+  imported_buffer_.reset(new ImportedBuffer(buffer, -1));
 }
 
 void OverlayLayer::ValidatePreviousFrameState(OverlayLayer* rhs,
@@ -363,7 +415,9 @@ void OverlayLayer::ValidatePreviousFrameState(OverlayLayer* rhs,
         if ((buffer->GetFormat() !=
              rhs->imported_buffer_->buffer_->GetFormat()) ||
             (alpha_ != rhs->alpha_) || (blending_ != rhs->blending_) ||
-            (transform_ != rhs->transform_)) {
+            (transform_ != rhs->transform_) ||
+            (color_space_ != rhs->color_space_) ||
+            (color_range_ != rhs->color_range_)) {
           content_changed = true;
         }
       }
@@ -29,6 +29,7 @@ namespace hwcomposer {
 
 struct HwcLayer;
 class OverlayBuffer;
+class PanelFitter;
 class ResourceManager;
 
 struct OverlayLayer {
@@ -51,13 +52,20 @@ struct OverlayLayer {
                               uint32_t layer_index, uint32_t max_height,
                               uint32_t rotation, bool handle_constraints);
 
-  void InitializeFromScaledHwcLayer(HwcLayer* layer,
+  // Initialize OverlayLayer from layer laid out on the display by
+  // panel_fitter.
+  void InitializeFromFittedHwcLayer(HwcLayer* layer,
                                     ResourceManager* buffer_manager,
                                     OverlayLayer* previous_layer,
                                     uint32_t z_order, uint32_t layer_index,
-                                    const HwcRect<int>& display_frame,
+                                    const PanelFitter& panel_fitter,
                                     uint32_t max_height, uint32_t rotation,
                                     bool handle_constraints);
+
+  // Initialize OverlayLayer as a copy of rhs at z_order, sharing its
+  // buffer but not its acquire fence.
+  void InitializeFromOverlayLayer(const OverlayLayer& rhs, uint32_t z_order);
+
   // Get z order of this layer.
   uint32_t GetZorder() const {
     return z_order_;
@@ -79,6 +87,14 @@ struct OverlayLayer {
     return blending_;
   }
 
+  HWCColorSpace GetColorSpace() const {
+    return color_space_;
+  }
+
+  HWCColorRange GetColorRange() const {
+    return color_range_;
+  }
+
   // This represents the transform to
   // be applied to this layer without taking
   // into account any Display transform i.e.
@@ -215,6 +231,29 @@ struct OverlayLayer {
     return state_ & kForceFullDraw;
   }
 
+  // Marks the content of this layer as not having
+  // changed for a while. Static layers may be
+  // composited together into a plane which is
+  // reused as long as none of them changes.
+  void SetStaticContent(bool value) {
+    if (value) {
+      state_ |= kStaticContent;
+    } else {
+      state_ &= ~kStaticContent;
+    }
+  }
+
+  bool HasStaticContent() const {
+    return state_ & kStaticContent;
+  }
+
+  // Marks this layer as only used to preview composition,
+  // raw pixel content of its buffer isn't uploaded then.
+  // Needs to be called before initializing the layer.
+  void SetPreview() {
+    state_ |= kPreview;
+  }
+
   void Dump();
 
  private:
@@ -225,7 +264,9 @@ struct OverlayLayer {
     kSourceRectChanged = 1 << 3,
     kNeedsReValidation = 1 << 4,
     kRawPixelDataChanged = 1 << 5,
-    kForceFullDraw = 1 << 6
+    kForceFullDraw = 1 << 6,
+    kStaticContent = 1 << 7,
+    kPreview = 1 << 8
   };
 
   struct ImportedBuffer {
@@ -251,7 +292,12 @@ struct OverlayLayer {
   void InitializeState(HwcLayer* layer, ResourceManager* buffer_manager,
                        OverlayLayer* previous_layer, uint32_t z_order,
                        uint32_t layer_index, uint32_t max_height,
-                       uint32_t rotation, bool handle_constraints);
+                       uint32_t rotation, bool handle_constraints,
+                       const PanelFitter* panel_fitter);
+
+  // Maps display frame, source crop and damage to the display. Marks
+  // the layer invisible if it ends up outside of the display.
+  void FitToDisplay(const PanelFitter& panel_fitter);
 
   uint32_t transform_ = 0;
   uint32_t plane_transform_ = 0;
@@ -266,6 +312,8 @@ struct OverlayLayer {
   HwcRect<int> display_frame_;
   HwcRect<int> surface_damage_;
   HWCBlending blending_ = HWCBlending::kBlendingNone;
+  HWCColorSpace color_space_ = HWCColorSpace::kDefault;
+  HWCColorRange color_range_ = HWCColorRange::kLimited;
   uint32_t state_ = kLayerContentChanged | kDimensionsChanged;
   std::unique_ptr<ImportedBuffer> imported_buffer_;
   LayerComposition supported_composition_;
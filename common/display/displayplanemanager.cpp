@@ -16,8 +16,12 @@
 
 #include "displayplanemanager.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "displayplane.h"
 #include "factory.h"
+#include "hwcutils.h"
 #include "hwctrace.h"
 #include "nativesurface.h"
 #include "overlaylayer.h"
@@ -40,6 +44,8 @@ DisplayPlaneManager::~DisplayPlaneManager() {
 bool DisplayPlaneManager::Initialize(uint32_t width, uint32_t height) {
   width_ = width;
   height_ = height;
+  surface_pool_.Initialize(resource_manager_, width, height);
+  std::vector<PreviewCacheEntry>().swap(preview_cache_);
   bool status = plane_handler_->PopulatePlanes(overlay_planes_);
   if (!overlay_planes_.empty()) {
     if (overlay_planes_.size() > 1) {
@@ -141,6 +147,21 @@ bool DisplayPlaneManager::ValidateLayers(
     }
 #endif
 
+    // Static layers next to each other are composited into one plane,
+    // which is only redrawn when one of them changes, if that leaves
+    // more planes to layers which do change.
+    bool freeze_static_layers =
+        ShouldFreezeStaticLayers(layer_begin, layer_end,
+                                 std::distance(overlay_begin, overlay_end));
+    bool last_plane_static = false;
+
+    uint32_t video_zorder = 0;
+    size_t planes_below_video =
+        GetPlanesBelowVideo(layer_begin, layer_end,
+                            std::distance(overlay_begin, overlay_end),
+                            &video_zorder);
+    size_t composition_begin = composition.size();
+
     // Handle layers for overlays.
     for (auto j = overlay_begin; j != overlay_end; ++j) {
       DisplayPlane *plane = j->get();
@@ -166,6 +187,35 @@ bool DisplayPlaneManager::ValidateLayers(
           continue;
         }
 
+        bool is_static = layer->HasStaticContent();
+        if (freeze_static_layers && is_static && last_plane_static &&
+            previous_layer && !composition.empty()) {
+          DisplayPlaneState &last_plane = composition.back();
+#ifdef SURFACE_TRACING
+          ISURFACETRACE("Added Static Layer: %d \n", layer->GetZorder());
+#endif
+          previous_layer = layer;
+          last_plane.AddLayer(layer);
+          ResetPlaneTarget(last_plane, commit_planes.back());
+          validate_final_layers = true;
+          continue;
+        }
+
+        // Leave the planes kept for video to it and the layers above it.
+        if (layer->GetZorder() < video_zorder &&
+            composition.size() - composition_begin >= planes_below_video) {
+          DisplayPlaneState &last_plane = composition.back();
+#ifdef SURFACE_TRACING
+          ISURFACETRACE("Added Layer below Video: %d \n", layer->GetZorder());
+#endif
+          previous_layer = layer;
+          last_plane.AddLayer(layer);
+          ResetPlaneTarget(last_plane, commit_planes.back());
+          validate_final_layers = true;
+          last_plane_static = last_plane_static && is_static;
+          continue;
+        }
+
         bool prefer_seperate_plane = layer->PreferSeparatePlane();
         if (!prefer_seperate_plane && previous_layer) {
           prefer_seperate_plane = previous_layer->PreferSeparatePlane();
@@ -194,6 +244,8 @@ bool DisplayPlaneManager::ValidateLayers(
             last_plane.SetVideoPlane();
           }
 
+          last_plane_static = is_static;
+
           if (fall_back) {
             ResetPlaneTarget(last_plane, commit_planes.back());
             validate_final_layers = true;
@@ -246,6 +298,7 @@ bool DisplayPlaneManager::ValidateLayers(
             last_plane.AddLayer(layer);
             ResetPlaneTarget(last_plane, commit_planes.back());
             validate_final_layers = true;
+            last_plane_static = last_plane_static && is_static;
           }
         }
       }
@@ -324,6 +377,54 @@ bool DisplayPlaneManager::ValidateLayers(
   return render_layers;
 }
 
+bool DisplayPlaneManager::ShouldFreezeStaticLayers(
+    std::vector<OverlayLayer>::iterator layer_begin,
+    std::vector<OverlayLayer>::iterator layer_end, size_t free_planes) {
+  size_t total_layers = 0;
+  size_t static_layers = 0;
+  for (auto i = layer_begin; i != layer_end; ++i) {
+    if (i->IsCursorLayer())
+      continue;
+
+    total_layers++;
+    if (i->HasStaticContent())
+      static_layers++;
+  }
+
+  // Nothing to gain if all layers get a plane anyway or none of them
+  // changes.
+  return total_layers > free_planes && static_layers > 1 &&
+         static_layers < total_layers;
+}
+
+size_t DisplayPlaneManager::GetPlanesBelowVideo(
+    std::vector<OverlayLayer>::iterator layer_begin,
+    std::vector<OverlayLayer>::iterator layer_end, size_t free_planes,
+    uint32_t *video_zorder) const {
+  if (!video_playback_)
+    return free_planes;
+
+  size_t layers_below = 0;
+  auto video = layer_begin;
+  for (; video != layer_end; ++video) {
+    if (video->IsVideoLayer())
+      break;
+
+    if (!video->IsCursorLayer())
+      layers_below++;
+  }
+
+  // The plane above video is kept even if nothing is shown over it
+  // yet, video would have to move down once something is.
+  size_t kept_planes = free_planes > 2 ? 2 : 1;
+  if (video == layer_end || free_planes <= kept_planes ||
+      layers_below <= free_planes - kept_planes)
+    return free_planes;
+
+  *video_zorder = video->GetZorder();
+  return free_planes - kept_planes;
+}
+
 DisplayPlaneState *DisplayPlaneManager::GetLastUsedOverlay(
     DisplayPlaneStateList &composition) {
   CTRACE();
@@ -651,63 +752,126 @@ void DisplayPlaneManager::SetOffScreenPlaneTarget(DisplayPlaneState &plane) {
 
 void DisplayPlaneManager::ReleaseAllOffScreenTargets() {
   CTRACE();
-  std::vector<std::unique_ptr<NativeSurface>>().swap(surfaces_);
+  surface_pool_.Clear();
 }
 
 void DisplayPlaneManager::ReleaseFreeOffScreenTargets() {
-  std::vector<std::unique_ptr<NativeSurface>> surfaces;
-  for (auto &fb : surfaces_) {
-    if (fb->GetSurfaceAge() >= 0) {
-      surfaces.emplace_back(fb.release());
+  surface_pool_.Trim();
+}
+
+bool DisplayPlaneManager::TrimOffScreenTargets(size_t total_bytes) {
+  return surface_pool_.TrimTo(total_bytes);
+}
+
+bool DisplayPlaneManager::EnsureOffScreenTargetsFit(
+    DisplayPlaneStateList &composition,
+    std::vector<NativeSurface *> &mark_later) {
+  bool reallocated = false;
+  for (DisplayPlaneState &plane : composition) {
+    if (!plane.NeedsOffScreenComposition())
+      continue;
+
+    const std::vector<NativeSurface *> &surfaces = plane.GetSurfaces();
+    if (surfaces.empty())
+      continue;
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    GetOffScreenTargetSize(plane, &width, &height);
+    bool fits = true;
+    for (NativeSurface *surface : surfaces) {
+      if (static_cast<uint32_t>(surface->GetWidth()) < width ||
+          static_cast<uint32_t>(surface->GetHeight()) < height) {
+        fits = false;
+        break;
+      }
     }
+
+    if (fits)
+      continue;
+
+#ifdef SURFACE_TRACING
+    ISURFACETRACE("Plane grew to %dx%d, replacing off-screen targets. \n",
+                  width, height);
+#endif
+    MarkSurfacesForRecycling(&plane, mark_later, false);
+    EnsureOffScreenTarget(plane);
+    reallocated = true;
   }
 
-  surfaces.swap(surfaces_);
+  return reallocated;
+}
+
+void DisplayPlaneManager::SetVideoPlayback(bool video_playback) {
+  if (video_playback_ == video_playback)
+    return;
+
+  video_playback_ = video_playback;
+  std::vector<PreviewCacheEntry>().swap(preview_cache_);
 }
 
 void DisplayPlaneManager::SetDisplayTransform(uint32_t transform) {
   display_transform_ = transform;
+  std::vector<PreviewCacheEntry>().swap(preview_cache_);
 }
 
 void DisplayPlaneManager::EnsureOffScreenTarget(DisplayPlaneState &plane) {
-  NativeSurface *surface = NULL;
   bool video_separate = plane.IsVideoPlane();
   uint32_t preferred_format = 0;
-  uint32_t usage = hwcomposer::kLayerNormal;
   if (video_separate) {
     preferred_format = plane.GetDisplayPlane()->GetPreferredVideoFormat();
   } else {
     preferred_format = plane.GetDisplayPlane()->GetPreferredFormat();
   }
 
-  for (auto &fb : surfaces_) {
-    if (fb->GetSurfaceAge() == -1) {
-      uint32_t surface_format = fb->GetLayer()->GetBuffer()->GetFormat();
-      if (preferred_format == surface_format) {
-        surface = fb.get();
-        break;
-      }
-    }
-  }
-
+  // Pick a tiled or compressed layout both the plane and the renderer
+  // can handle.
+  std::vector<uint64_t> plane_modifiers;
+  std::vector<uint64_t> renderer_modifiers;
+  std::vector<uint64_t> modifiers;
+  plane.GetDisplayPlane()->GetSupportedModifiers(preferred_format,
+                                                 &plane_modifiers);
+  GetRenderTargetModifiers(video_separate, &renderer_modifiers);
+  NegotiateModifiers(plane_modifiers, renderer_modifiers, &modifiers);
+
+  uint32_t width = 0;
+  uint32_t height = 0;
+  GetOffScreenTargetSize(plane, &width, &height);
+  NativeSurface *surface = surface_pool_.Acquire(
+      width, height, preferred_format, modifiers, video_separate);
   if (!surface) {
-    NativeSurface *new_surface = NULL;
-    if (video_separate) {
-      new_surface = CreateVideoBuffer(width_, height_);
-      usage = hwcomposer::kLayerVideo;
-    } else {
-      new_surface = Create3DBuffer(width_, height_);
-    }
-
-    new_surface->Init(resource_manager_, preferred_format, usage);
-    surfaces_.emplace_back(std::move(new_surface));
-    surface = surfaces_.back().get();
+    ETRACE("Failed to get an off-screen target for plane.");
+    return;
   }
 
   surface->SetPlaneTarget(plane, gpu_fd_);
   plane.SetOffScreenTarget(surface);
 }
 
+void DisplayPlaneManager::GetOffScreenTargetSize(
+    const DisplayPlaneState &plane, uint32_t *width, uint32_t *height) const {
+  *width = width_;
+  *height = height_;
+  // Media targets are written by VA at the layer's position and rotated
+  // composition can cover any part of the display, keep them full size.
+  if (plane.IsVideoPlane() || display_transform_ != kIdentity ||
+      plane.GetRotationType() ==
+          DisplayPlaneState::RotationType::kGPURotation)
+    return;
+
+  const HwcRect<int> &frame = plane.GetDisplayFrame();
+  int right = frame.right;
+  int bottom = frame.bottom;
+  if (plane.IsUsingPlaneScalar()) {
+    const HwcRect<float> &crop = plane.GetSourceCrop();
+    right = std::max(right, static_cast<int>(std::ceil(crop.right)));
+    bottom = std::max(bottom, static_cast<int>(std::ceil(crop.bottom)));
+  }
+
+  *width = std::min(width_, static_cast<uint32_t>(std::max(right, 1)));
+  *height = std::min(height_, static_cast<uint32_t>(std::max(bottom, 1)));
+}
+
 void DisplayPlaneManager::ValidateFinalLayers(
     std::vector<OverlayPlane> &commit_planes,
     DisplayPlaneStateList &composition, std::vector<OverlayLayer> &layers,
@@ -754,6 +918,140 @@ bool DisplayPlaneManager::FallbacktoGPU(
   return false;
 }
 
+void DisplayPlaneManager::PreviewComposition(
+    std::vector<OverlayLayer> &layers, bool disable_overlay,
+    std::vector<HWCLayerComposition> *composition) {
+  CTRACE();
+  size_t total_layers = layers.size();
+  composition->assign(total_layers, HWCLayerComposition::kGpu);
+  if (disable_overlay || total_layers == 0 || overlay_planes_.empty())
+    return;
+
+  bool cache_valid = preview_cache_.size() == total_layers;
+  for (size_t i = 0; i < total_layers; ++i) {
+    PreviewCacheEntry entry;
+    FillPreviewCacheEntry(layers.at(i), &entry);
+    if (cache_valid && IsSamePreviewCacheEntry(preview_cache_.at(i), entry))
+      continue;
+
+    if (cache_valid) {
+      cache_valid = false;
+      preview_cache_.resize(i);
+    }
+
+    preview_cache_.emplace_back(entry);
+  }
+
+  if (cache_valid) {
+    *composition = preview_results_;
+    return;
+  }
+
+  auto overlay_end = overlay_planes_.end();
+#ifdef DISABLE_CURSOR_PLANE
+  overlay_end = overlay_planes_.end() - 1;
+#else
+  if (cursor_plane_ && !cursor_plane_->IsUniversal()) {
+    overlay_end = overlay_planes_.end() - 1;
+  }
+#endif
+
+  // Mirror the plane assignment done by ValidateLayers. A layer which
+  // can't be scanned out is composited together with the layers on the
+  // last used plane, making all of them GPU composited.
+  std::vector<OverlayPlane> commit_planes;
+  std::vector<size_t> plane_owners;
+  std::vector<size_t> cursor_layers;
+  auto plane = overlay_planes_.begin();
+  bool force_gpu = false;
+  uint32_t video_zorder = 0;
+  size_t planes_below_video =
+      GetPlanesBelowVideo(layers.begin(), layers.end(),
+                          std::distance(plane, overlay_end), &video_zorder);
+  for (size_t i = 0; i < total_layers; ++i) {
+    OverlayLayer *layer = &(layers.at(i));
+    if (layer->IsCursorLayer()) {
+      cursor_layers.emplace_back(i);
+      continue;
+    }
+
+    bool below_video = layer->GetZorder() < video_zorder &&
+                       plane_owners.size() >= planes_below_video;
+    if (plane != overlay_end && !below_video) {
+      commit_planes.emplace_back(OverlayPlane(plane->get(), layer));
+      bool fall_back = FallbacktoGPU(plane->get(), layer, commit_planes);
+      if (!fall_back || layer->PreferSeparatePlane()) {
+        if (!fall_back)
+          composition->at(i) = HWCLayerComposition::kDisplay;
+
+        plane_owners.emplace_back(i);
+        ++plane;
+        continue;
+      }
+
+      commit_planes.pop_back();
+    }
+
+    if (plane_owners.empty()) {
+      force_gpu = true;
+      break;
+    }
+
+    composition->at(plane_owners.back()) = HWCLayerComposition::kGpu;
+  }
+
+  if (force_gpu) {
+    composition->assign(total_layers, HWCLayerComposition::kGpu);
+  } else {
+#ifdef DISABLE_CURSOR_PLANE
+    overlay_end = overlay_planes_.end() - 1;
+#else
+    overlay_end = overlay_planes_.end();
+#endif
+    for (size_t index : cursor_layers) {
+      OverlayLayer *layer = &(layers.at(index));
+      if (plane != overlay_end) {
+        commit_planes.emplace_back(OverlayPlane(plane->get(), layer));
+        if (!FallbacktoGPU(plane->get(), layer, commit_planes)) {
+          composition->at(index) = HWCLayerComposition::kDisplay;
+          ++plane;
+          continue;
+        }
+
+        commit_planes.pop_back();
+      }
+
+      if (!plane_owners.empty())
+        composition->at(plane_owners.back()) = HWCLayerComposition::kGpu;
+    }
+  }
+
+  preview_results_ = *composition;
+}
+
+void DisplayPlaneManager::FillPreviewCacheEntry(const OverlayLayer &layer,
+                                                PreviewCacheEntry *entry) {
+  entry->display_frame_ = layer.GetDisplayFrame();
+  entry->source_crop_width_ = layer.GetSourceCropWidth();
+  entry->source_crop_height_ = layer.GetSourceCropHeight();
+  entry->format_ = layer.GetBuffer()->GetFormat();
+  entry->transform_ = layer.GetPlaneTransform();
+  entry->alpha_ = layer.GetAlpha();
+  entry->blending_ = layer.GetBlending();
+  entry->cursor_ = layer.IsCursorLayer();
+  entry->video_ = layer.IsVideoLayer();
+}
+
+bool DisplayPlaneManager::IsSamePreviewCacheEntry(
+    const PreviewCacheEntry &lhs, const PreviewCacheEntry &rhs) {
+  return lhs.display_frame_ == rhs.display_frame_ &&
+         lhs.source_crop_width_ == rhs.source_crop_width_ &&
+         lhs.source_crop_height_ == rhs.source_crop_height_ &&
+         lhs.format_ == rhs.format_ && lhs.transform_ == rhs.transform_ &&
+         lhs.alpha_ == rhs.alpha_ && lhs.blending_ == rhs.blending_ &&
+         lhs.cursor_ == rhs.cursor_ && lhs.video_ == rhs.video_;
+}
+
 bool DisplayPlaneManager::CheckPlaneFormat(uint32_t format) {
   return overlay_planes_.at(0)->IsSupportedFormat(format);
 }
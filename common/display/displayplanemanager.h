@@ -24,6 +24,7 @@
 
 #include "displayplanestate.h"
 #include "displayplanehandler.h"
+#include "nativesurfacepool.h"
 
 namespace hwcomposer {
 
@@ -62,6 +63,14 @@ class DisplayPlaneManager {
                         bool needs_revalidation_checks,
                         bool re_validate_commit);
 
+  // Checks which of the given layers could be scanned out directly,
+  // without touching any plane or off-screen surface state. composition
+  // is populated with one entry per layer in layers. Results for a layer
+  // stack with the same geometry and formats as the last call are reused.
+  void PreviewComposition(std::vector<OverlayLayer> &layers,
+                          bool disable_overlay,
+                          std::vector<HWCLayerComposition> *composition);
+
   bool CheckPlaneFormat(uint32_t format);
 
   void SetOffScreenPlaneTarget(DisplayPlaneState &plane);
@@ -70,8 +79,24 @@ class DisplayPlaneManager {
 
   void ReleaseAllOffScreenTargets();
 
+  // Frees off-screen targets not in use until all of them take at most
+  // total_bytes. Returns false if the ones in use take more.
+  bool TrimOffScreenTargets(size_t total_bytes);
+
+  // Off-screen targets are sized to the area of the display a plane
+  // covers. Replaces the surfaces of planes which have grown past their
+  // targets since they were allocated, old surfaces are added to
+  // mark_later. Returns true if any plane got a new target.
+  bool EnsureOffScreenTargetsFit(DisplayPlaneStateList &composition,
+                                 std::vector<NativeSurface *> &mark_later);
+
   bool HasSurfaces() const {
-    return !surfaces_.empty();
+    return !surface_pool_.IsEmpty();
+  }
+
+  // Can be called from any thread.
+  void GetSurfacePoolStatistics(HwcSurfacePoolStatistics *stats) const {
+    surface_pool_.GetStatistics(stats);
   }
 
   uint32_t GetGpuFd() const {
@@ -86,6 +111,13 @@ class DisplayPlaneManager {
   // with pipe of this displayplanemanager.
   void SetDisplayTransform(uint32_t transform);
 
+  // While video is being played, a plane is kept for the bottom most
+  // video layer and one for the layers above it. Layers below the video
+  // share the remaining planes, so that video is neither composited
+  // with other layers nor moved to another plane when UI shows up over
+  // it.
+  void SetVideoPlayback(bool video_playback);
+
  private:
   struct LayerResultCache {
     uint32_t last_transform_ = 0;
@@ -93,6 +125,36 @@ class DisplayPlaneManager {
     DisplayPlane *plane_;
   };
 
+  // Layer properties which decide the result of a TestCommit.
+  struct PreviewCacheEntry {
+    HwcRect<int> display_frame_;
+    uint32_t source_crop_width_ = 0;
+    uint32_t source_crop_height_ = 0;
+    uint32_t format_ = 0;
+    uint32_t transform_ = 0;
+    uint8_t alpha_ = 0xff;
+    HWCBlending blending_ = HWCBlending::kBlendingNone;
+    bool cursor_ = false;
+    bool video_ = false;
+  };
+
+  static void FillPreviewCacheEntry(const OverlayLayer &layer,
+                                    PreviewCacheEntry *entry);
+  static bool IsSamePreviewCacheEntry(const PreviewCacheEntry &lhs,
+                                      const PreviewCacheEntry &rhs);
+
+  // Returns true if layers which are static should share planes, i.e.
+  // there are more layers than free_planes and some of them change.
+  static bool ShouldFreezeStaticLayers(
+      std::vector<OverlayLayer>::iterator layer_begin,
+      std::vector<OverlayLayer>::iterator layer_end, size_t free_planes);
+  // Returns how many of free_planes the layers below the first video
+  // layer in [layer_begin, layer_end) may take while video is being
+  // played, and sets video_zorder to the z order of that layer. Returns
+  // free_planes if no planes need to be kept for video.
+  size_t GetPlanesBelowVideo(std::vector<OverlayLayer>::iterator layer_begin,
+                             std::vector<OverlayLayer>::iterator layer_end,
+                             size_t free_planes, uint32_t *video_zorder) const;
   DisplayPlaneState *GetLastUsedOverlay(DisplayPlaneStateList &composition);
   bool FallbacktoGPU(DisplayPlane *target_plane, OverlayLayer *layer,
                      const std::vector<OverlayPlane> &commit_planes) const;
@@ -107,6 +169,12 @@ class DisplayPlaneManager {
 
   void EnsureOffScreenTarget(DisplayPlaneState &plane);
 
+  // Size an off-screen target of plane needs to have. Composition
+  // happens in display coordinates, so this reaches from the origin to
+  // the bottom right corner of the area the plane covers.
+  void GetOffScreenTargetSize(const DisplayPlaneState &plane, uint32_t *width,
+                              uint32_t *height) const;
+
   void PreparePlaneForCursor(DisplayPlaneState *plane,
                              std::vector<NativeSurface *> &mark_later,
                              bool *validate_final_layers, bool reset_buffer,
@@ -150,14 +218,17 @@ class DisplayPlaneManager {
   DisplayPlaneHandler *plane_handler_;
   ResourceManager *resource_manager_;
   DisplayPlane *cursor_plane_;
-  std::vector<std::unique_ptr<NativeSurface>> surfaces_;
+  NativeSurfacePool surface_pool_;
   std::vector<std::unique_ptr<DisplayPlane>> overlay_planes_;
   std::vector<LayerResultCache> results_cache_;
+  std::vector<PreviewCacheEntry> preview_cache_;
+  std::vector<HWCLayerComposition> preview_results_;
 
   uint32_t width_;
   uint32_t height_;
   uint32_t gpu_fd_;
   uint32_t display_transform_ = kIdentity;
+  bool video_playback_ = false;
 };
 
 }  // namespace hwcomposer
@@ -31,6 +31,7 @@
 
 #include "physicaldisplay.h"
 #include "renderer.h"
+#include "sharedfence.h"
 
 namespace hwcomposer {
 
@@ -78,6 +79,7 @@ bool DisplayQueue::Initialize(uint32_t pipe, uint32_t width, uint32_t height,
   }
 
   display_plane_manager_->SetDisplayTransform(plane_transform_);
+  panel_fitter_.SetDisplaySize(width, height);
   ResetQueue();
   vblank_handler_->SetPowerMode(kOff);
   vblank_handler_->Init(gpu_fd_, pipe);
@@ -87,23 +89,27 @@ bool DisplayQueue::Initialize(uint32_t pipe, uint32_t width, uint32_t height,
 bool DisplayQueue::SetPowerMode(uint32_t power_mode) {
   switch (power_mode) {
     case kOff:
-      HandleExit();
+      if (!HandleWarmSuspend())
+        HandleExit();
       break;
     case kDoze:
-      HandleExit();
+      if (!HandleWarmSuspend())
+        HandleExit();
       break;
     case kDozeSuspend:
       vblank_handler_->SetPowerMode(kDozeSuspend);
       state_ |= kPoweredOn;
       break;
     case kOn:
-      state_ |= kPoweredOn | kConfigurationChanged | kNeedsColorCorrection;
+      state_ |= kPoweredOn | kNeedsColorCorrection;
       vblank_handler_->SetPowerMode(kOn);
       power_mode_lock_.lock();
       state_ &= ~kIgnoreIdleRefresh;
       compositor_.Init(resource_manager_.get(),
                        display_plane_manager_->GetGpuFd());
       power_mode_lock_.unlock();
+      if (!(state_ & kWarmSuspended) || !ResumeLastFrame())
+        state_ |= kConfigurationChanged;
       break;
     default:
       break;
@@ -112,6 +118,126 @@ bool DisplayQueue::SetPowerMode(uint32_t power_mode) {
   return true;
 }
 
+void DisplayQueue::SetWarmSuspend(bool enable, uint64_t surface_budget) {
+  warm_suspend_ = enable;
+  warm_suspend_budget_ = surface_budget;
+  if (!enable)
+    DropSuspendedState();
+}
+
+bool DisplayQueue::StartFrameCapture(uint32_t width, uint32_t height,
+                                     uint32_t frames, const char* directory) {
+  return frame_capture_.Start(resource_manager_.get(), width, height, frames,
+                              directory);
+}
+
+void DisplayQueue::GetFrameCaptureStatistics(
+    HwcFrameCaptureStatistics* stats) {
+  frame_capture_.GetStatistics(stats);
+}
+
+void DisplayQueue::TakeCapturedFrames(std::vector<HwcCapturedFrame>* frames) {
+  frame_capture_.TakeFrames(frames);
+}
+
+void DisplayQueue::DropSuspendedState() {
+  std::lock_guard<std::mutex> update_lock(update_lock_);
+  if (!(state_ & kWarmSuspended))
+    return;
+
+  state_ &= ~kWarmSuspended;
+  state_ |= kConfigurationChanged;
+  ResetQueue();
+}
+
+bool DisplayQueue::HandleWarmSuspend() {
+  std::lock_guard<std::mutex> update_lock(update_lock_);
+  if (state_ & kWarmSuspended)
+    return true;
+
+  if (!warm_suspend_ || (state_ & kClonedMode) ||
+      previous_plane_state_.empty())
+    return false;
+
+  // Nothing stays on screen, surfaces waiting for a flip to be recycled
+  // are free now.
+  for (NativeSurface* surface : mark_not_inuse_)
+    surface->SetSurfaceAge(-1);
+
+  for (NativeSurface* surface : surfaces_not_inuse_)
+    surface->SetSurfaceAge(-1);
+
+  std::vector<NativeSurface*>().swap(mark_not_inuse_);
+  std::vector<NativeSurface*>().swap(surfaces_not_inuse_);
+  if (!display_plane_manager_->TrimOffScreenTargets(warm_suspend_budget_)) {
+    IHOTPLUGEVENTTRACE(
+        "Surfaces of last frame exceed warm suspend budget, suspending "
+        "cold: %p \n",
+        this);
+    return false;
+  }
+
+  power_mode_lock_.lock();
+  state_ |= kIgnoreIdleRefresh;
+  power_mode_lock_.unlock();
+  vblank_handler_->SetPowerMode(kOff);
+  display_->Disable(previous_plane_state_);
+  if (kms_fence_ > 0) {
+    close(kms_fence_);
+    kms_fence_ = 0;
+  }
+
+  if (has_pending_stats_)
+    RecordPendingStatistics(0, 0);
+
+  state_ &= ~(kPoweredOn | kLastFrameIdleUpdate);
+  state_ |= kWarmSuspended;
+  return true;
+}
+
+bool DisplayQueue::ResumeLastFrame() {
+  std::lock_guard<std::mutex> update_lock(update_lock_);
+  state_ &= ~kWarmSuspended;
+  // Mode or scaling changed while suspended, the last frame was laid out
+  // for the previous one.
+  if (state_ & kConfigurationChanged) {
+    ResetQueue();
+    return false;
+  }
+
+  int64_t resume_time = GetMonotonicTime();
+  // Disable released the planes.
+  for (const DisplayPlaneState& plane : previous_plane_state_)
+    plane.GetDisplayPlane()->SetInUse(true);
+
+  int32_t fence = -1;
+  bool disable_ovelays = state_ & kDisableOverlayUsage;
+  if (!display_->Commit(previous_plane_state_, previous_plane_state_,
+                        disable_ovelays, &fence)) {
+    ETRACE("Failed to show last frame after resume, resuming cold.");
+    for (const DisplayPlaneState& plane : previous_plane_state_)
+      plane.GetDisplayPlane()->SetInUse(false);
+
+    ResetQueue();
+    return false;
+  }
+
+  pending_stats_ = HwcFrameStatistics();
+  pending_stats_.present_time = resume_time;
+  pending_stats_.commit_time = GetMonotonicTime();
+  pending_stats_.total_layers = in_flight_layers_.size();
+  pending_stats_.total_planes = previous_plane_state_.size();
+  pending_stats_.composition_flags = kFrameResumed;
+  has_pending_stats_ = true;
+  if (fence > 0) {
+    kms_fence_ = fence;
+  } else {
+    RecordPendingStatistics(0, 0);
+  }
+
+  return true;
+}
+
 void DisplayQueue::RotateDisplay(HWCRotation rotation) {
   switch (rotation) {
     case kRotate90:
@@ -392,35 +518,185 @@ void DisplayQueue::GetCachedLayers(const std::vector<OverlayLayer>& layers,
   }
 }
 
+void DisplayQueue::WaitForPreviousFlip() {
+  int64_t wait_start = GetMonotonicTime();
+  HWCPoll(kms_fence_, -1);
+  int64_t now = GetMonotonicTime();
+  // Fence may have signalled long before, e.g. after an idle period.
+  int64_t signal_time = 0;
+  bool signalled = has_pending_stats_ &&
+                   GetFenceSignalTime(kms_fence_, &signal_time) &&
+                   signal_time <= now;
+  close(kms_fence_);
+  kms_fence_ = 0;
+  if (!has_pending_stats_)
+    return;
+
+  int64_t last_vblank = 0;
+  int64_t vblank_period = 0;
+  vblank_handler_->GetVblankTiming(&last_vblank, &vblank_period);
+  // Vblank handler tracks every vblank, the latest one after commit is
+  // when the frame got on screen. Fall back to the time fence signalled
+  // in case vblank thread hasn't caught up yet or is off, and to now only
+  // if the kernel doesn't report that.
+  int64_t flip_time = signalled ? signal_time : now;
+  if (last_vblank >= pending_stats_.commit_time && last_vblank <= flip_time)
+    flip_time = last_vblank;
+
+  RecordPendingStatistics(flip_time, now - wait_start);
+}
+
+void DisplayQueue::RecordPendingStatistics(int64_t flip_time,
+                                           int64_t fence_wait_time) {
+  pending_stats_.frame_number = ++total_frames_;
+  pending_stats_.flip_time = flip_time;
+  pending_stats_.fence_wait_time = fence_wait_time;
+  if (flip_time > 0) {
+    int64_t last_vblank = 0;
+    int64_t vblank_period = 0;
+    vblank_handler_->GetVblankTiming(&last_vblank, &vblank_period);
+    if (vblank_period > 0 && flip_time > pending_stats_.commit_time) {
+      pending_stats_.missed_vblanks = static_cast<uint32_t>(
+          (flip_time - pending_stats_.commit_time) / vblank_period);
+    }
+  }
+
+  for (const std::shared_ptr<SharedFence>& fence : pending_release_fences_)
+    pending_stats_.release_fence_fds += fence->GetFdsCreated();
+
+  pending_release_fences_.clear();
+  frame_statistics_.Record(pending_stats_);
+  has_pending_stats_ = false;
+}
+
+void DisplayQueue::GetFrameStatistics(
+    uint64_t since_frame, std::vector<HwcFrameStatistics>* frames) {
+  frame_statistics_.Read(since_frame, frames);
+}
+
+void DisplayQueue::GetSurfacePoolStatistics(HwcSurfacePoolStatistics* stats) {
+  display_plane_manager_->GetSurfacePoolStatistics(stats);
+}
+
+void DisplayQueue::GetLayerStatistics(std::vector<HwcLayerStatistics>* layers) {
+  layer_tracker_.GetStatistics(layers);
+}
+
+void DisplayQueue::InitializeOverlayLayer(HwcLayer* layer,
+                                          OverlayLayer* previous_layer,
+                                          uint32_t z_order,
+                                          uint32_t layer_index,
+                                          bool handle_constraints,
+                                          OverlayLayer* overlay_layer) {
+  if (!panel_fitter_.IsIdentity()) {
+    overlay_layer->InitializeFromFittedHwcLayer(
+        layer, resource_manager_.get(), previous_layer, z_order, layer_index,
+        panel_fitter_, display_plane_manager_->GetHeight(), plane_transform_,
+        handle_constraints);
+  } else {
+    overlay_layer->InitializeFromHwcLayer(
+        layer, resource_manager_.get(), previous_layer, z_order, layer_index,
+        display_plane_manager_->GetHeight(), plane_transform_,
+        handle_constraints);
+  }
+}
+
+bool DisplayQueue::ValidateLayers(
+    std::vector<HwcLayer*>& source_layers,
+    std::vector<HWCLayerComposition>* composition) {
+  CTRACE();
+  // Plane manager and resource manager are shared with QueueUpdate.
+  std::lock_guard<std::mutex> update_lock(update_lock_);
+  size_t size = source_layers.size();
+  // Layers which are not visible are dropped and don't need any
+  // composition.
+  composition->assign(size, HWCLayerComposition::kDisplay);
+  if (!(state_ & kPoweredOn))
+    return false;
+
+  std::vector<OverlayLayer>& layers = preview_layers_;
+  layers.reserve(size);
+  uint32_t z_order = 0;
+  for (size_t layer_index = 0; layer_index < size; layer_index++) {
+    HwcLayer* layer = source_layers.at(layer_index);
+    if (!layer->IsVisible())
+      continue;
+
+    layers.emplace_back();
+    OverlayLayer* overlay_layer = &(layers.back());
+    overlay_layer->SetPreview();
+    InitializeOverlayLayer(layer, NULL, z_order, layer_index, false,
+                           overlay_layer);
+    // This is only a dry run, acquire fence still belongs to the layer
+    // and will be consumed by the following Present call.
+    layer->SetAcquireFence(overlay_layer->ReleaseAcquireFence());
+    if (!overlay_layer->IsVisible()) {
+      layers.pop_back();
+      continue;
+    }
+
+    z_order++;
+  }
+
+  std::vector<HWCLayerComposition>& layers_composition = preview_composition_;
+  display_plane_manager_->PreviewComposition(
+      layers, state_ & kDisableOverlayUsage, &layers_composition);
+  size = layers.size();
+  for (size_t i = 0; i < size; i++) {
+    composition->at(layers.at(i).GetLayerIndex()) = layers_composition.at(i);
+  }
+
+  // Keep the storage only, buffers are released.
+  layers.clear();
+  return true;
+}
+
 bool DisplayQueue::QueueUpdate(std::vector<HwcLayer*>& source_layers,
                                int32_t* retire_fence, bool idle_update,
                                bool handle_constraints) {
   CTRACE();
+  std::lock_guard<std::mutex> update_lock(update_lock_);
   ScopedIdleStateTracker tracker(idle_tracker_, compositor_,
                                  resource_manager_.get(), this);
   if (tracker.IgnoreUpdate()) {
     return true;
   }
 
+  // Frames are dropped while blanked, unblank asks for a new one.
+  if (state_ & kBlanked) {
+    *retire_fence = -1;
+    return true;
+  }
+
+  int64_t present_time = GetMonotonicTime();
   size_t size = source_layers.size();
   size_t previous_size = in_flight_layers_.size();
+  // Layers are laid out anew when scaling changed, treat them as new
+  // ones so that all of them are redrawn.
+  bool layout_changed = UpdatePanelFitter();
+  if (layout_changed)
+    previous_size = 0;
   std::vector<OverlayLayer> layers;
   int remove_index = -1;
   int add_index = -1;
   // If last commit failed, lets force full validation as
   // state might be all wrong in our side.
   bool idle_frame = tracker.RenderIdleMode() || idle_update;
-  bool validate_layers =
-      last_commit_failed_update_ || previous_plane_state_.empty();
+  bool validate_layers = last_commit_failed_update_ ||
+                         previous_plane_state_.empty() || layout_changed;
   *retire_fence = -1;
   uint32_t z_order = 0;
   bool has_video_layer = false;
   bool re_validate_commit = false;
   bool handle_raw_pixel_update = false;
 
+  layer_tracker_.BeginFrame();
   for (size_t layer_index = 0; layer_index < size; layer_index++) {
     HwcLayer* layer = source_layers.at(layer_index);
-    layer->SetReleaseFence(-1);
+    // Layers presented by a cloned display also get release fences from
+    // the display they are cloned from, keep them so both get merged.
+    if (!(state_ & kClonedMode))
+      layer->SetReleaseFence(-1);
     if (!layer->IsVisible())
       continue;
 
@@ -433,36 +709,20 @@ bool DisplayQueue::QueueUpdate(std::vector<HwcLayer*>& source_layers,
       add_index = z_order;
     }
 
-    if (scaling_tracker_.scaling_state_ == ScalingTracker::kNeedsScaling) {
-      HwcRect<int> display_frame = layer->GetDisplayFrame();
-      display_frame.left =
-          display_frame.left +
-          (display_frame.left * scaling_tracker_.scaling_width);
-      display_frame.top = display_frame.top +
-                          (display_frame.top * scaling_tracker_.scaling_height);
-      display_frame.right =
-          display_frame.right +
-          (display_frame.right * scaling_tracker_.scaling_width);
-      display_frame.bottom =
-          display_frame.bottom +
-          (display_frame.bottom * scaling_tracker_.scaling_height);
-
-      overlay_layer->InitializeFromScaledHwcLayer(
-          layer, resource_manager_.get(), previous_layer, z_order, layer_index,
-          display_frame, display_plane_manager_->GetHeight(), plane_transform_,
-          handle_constraints);
-    } else {
-      overlay_layer->InitializeFromHwcLayer(
-          layer, resource_manager_.get(), previous_layer, z_order, layer_index,
-          display_plane_manager_->GetHeight(), plane_transform_,
-          handle_constraints);
-    }
+    InitializeOverlayLayer(layer, previous_layer, z_order, layer_index,
+                           handle_constraints, overlay_layer);
 
     if (!overlay_layer->IsVisible()) {
       layers.pop_back();
       continue;
     }
 
+    // Layers which became static may now share a plane, see
+    // LayerUpdateTracker.
+    if (layer_tracker_.TrackLayer(layer, overlay_layer)) {
+      validate_layers = true;
+    }
+
     if (overlay_layer->RawPixelDataChanged()) {
       handle_raw_pixel_update = true;
     }
@@ -587,6 +847,28 @@ bool DisplayQueue::QueueUpdate(std::vector<HwcLayer*>& source_layers,
     video_lock_.unlock();
   }
 
+  // While video playback is announced, planes are set aside for the
+  // video layer. Layers are assigned to planes again when that changes.
+  bool video_playback = false;
+  if (has_video_layer) {
+    video_lock_.lock();
+    video_playback =
+        optimization_mode_ == HWCOptimizationMode::kOptimizeVideo;
+    video_lock_.unlock();
+    if (!video_playback)
+      video_playback = refresh_governor_.HasVideoSessions();
+  }
+
+  if (video_playback != video_playback_) {
+    video_playback_ = video_playback;
+    display_plane_manager_->SetVideoPlayback(video_playback);
+    idle_frame = false;
+    validate_layers = true;
+  }
+
+  if (video_playback)
+    tracker.FrameHasVideoPlayback();
+
   bool composition_passed = true;
   bool disable_ovelays = state_ & kDisableOverlayUsage;
   if (!validate_layers && tracker.RevalidateLayers()) {
@@ -635,7 +917,9 @@ bool DisplayQueue::QueueUpdate(std::vector<HwcLayer*>& source_layers,
       }
 
       if (can_ignore_commit) {
+        layer_tracker_.EndFrame(layers, current_composition_planes, NULL);
         in_flight_layers_.swap(layers);
+        UpdateCursorState(source_layers, handle_constraints);
         return true;
       }
     }
@@ -666,6 +950,12 @@ bool DisplayQueue::QueueUpdate(std::vector<HwcLayer*>& source_layers,
     state_ &= ~kConfigurationChanged;
   }
 
+  // Planes may have grown past their off-screen targets while being
+  // updated incrementally.
+  if (display_plane_manager_->EnsureOffScreenTargetsFit(
+          current_composition_planes, surfaces_not_inuse_))
+    render_layers = true;
+
   DUMP_CURRENT_COMPOSITION_PLANES();
   DUMP_CURRENT_LAYER_PLANE_COMBINATIONS();
   DUMP_CURRENT_DUPLICATE_LAYER_COMBINATIONS();
@@ -699,13 +989,12 @@ bool DisplayQueue::QueueUpdate(std::vector<HwcLayer*>& source_layers,
   }
 
   int32_t fence = 0;
-#ifndef ENABLE_DOUBLE_BUFFERING
+  // Kernel rejects a non-blocking commit while the previous one is still
+  // pending. With double buffering that can only be a cursor update.
   if (kms_fence_ > 0) {
-    HWCPoll(kms_fence_, -1);
-    close(kms_fence_);
-    kms_fence_ = 0;
+    WaitForPreviousFlip();
   }
-#endif
+
   if (state_ & kNeedsColorCorrection) {
     display_->SetColorCorrection(gamma_, contrast_, brightness_);
     display_->SetColorTransformMatrix(color_transform_matrix_,
@@ -713,11 +1002,40 @@ bool DisplayQueue::QueueUpdate(std::vector<HwcLayer*>& source_layers,
     state_ &= ~kNeedsColorCorrection;
   }
 
+  // Idle refreshes don't tell us anything about content cadence.
+  if (!idle_update) {
+    refresh_governor_.FramePresented(has_video_layer);
+    float content_rate = 0;
+    if (refresh_governor_.ContentRateChanged(&content_rate))
+      display_->UpdateContentRate(content_rate);
+  }
+
   composition_passed =
       display_->Commit(current_composition_planes, previous_plane_state_,
                        disable_ovelays, &fence);
 
+  if (has_pending_stats_)
+    RecordPendingStatistics(0, 0);
+
+  pending_stats_ = HwcFrameStatistics();
+  pending_stats_.present_time = present_time;
+  pending_stats_.commit_time = GetMonotonicTime();
+  pending_stats_.total_layers = layers.size();
+  pending_stats_.total_planes = current_composition_planes.size();
+  if (render_layers)
+    pending_stats_.composition_flags |= kFrameGpuComposition;
+  if (validate_layers)
+    pending_stats_.composition_flags |= kFrameFullValidation;
+  if (idle_frame)
+    pending_stats_.composition_flags |= kFrameIdleUpdate;
+  if (disable_ovelays)
+    pending_stats_.composition_flags |= kFrameOverlaysDisabled;
+  layer_tracker_.EndFrame(layers, current_composition_planes, &pending_stats_);
+  has_pending_stats_ = true;
+
   if (!composition_passed) {
+    pending_stats_.composition_flags |= kFrameCommitFailed;
+    RecordPendingStatistics(0, 0);
     last_commit_failed_update_ = true;
     return false;
   }
@@ -740,6 +1058,7 @@ bool DisplayQueue::QueueUpdate(std::vector<HwcLayer*>& source_layers,
 
   // Swap current and previous composition results.
   previous_plane_state_.swap(current_composition_planes);
+  UpdateCursorState(source_layers, handle_constraints);
 
   // Set Age for all offscreen surfaces.
   UpdateOnScreenSurfaces();
@@ -774,6 +1093,17 @@ bool DisplayQueue::QueueUpdate(std::vector<HwcLayer*>& source_layers,
     ReleaseSurfacesAsNeeded(validate_layers);
   }
 
+  // Before statistics of the frame may be recorded below.
+  if (frame_capture_.IsActive()) {
+    std::vector<const OverlayLayer*> capture_layers;
+    capture_layers.reserve(previous_plane_state_.size());
+    for (const DisplayPlaneState& plane : previous_plane_state_)
+      capture_layers.emplace_back(plane.GetOverlayLayer());
+
+    pending_stats_.capture_time = frame_capture_.CaptureFrame(
+        &compositor_, capture_layers, fence > 0 ? dup(fence) : -1);
+  }
+
   if (fence > 0) {
     if (!(state_ & kClonedMode)) {
       *retire_fence = dup(fence);
@@ -782,13 +1112,13 @@ bool DisplayQueue::QueueUpdate(std::vector<HwcLayer*>& source_layers,
     kms_fence_ = fence;
 
     SetReleaseFenceToLayers(fence, source_layers);
+  } else {
+    RecordPendingStatistics(0, 0);
   }
 
 #ifdef ENABLE_DOUBLE_BUFFERING
   if (kms_fence_ > 0) {
-    HWCPoll(kms_fence_, -1);
-    close(kms_fence_);
-    kms_fence_ = 0;
+    WaitForPreviousFlip();
   }
 #endif
 
@@ -801,6 +1131,107 @@ bool DisplayQueue::QueueUpdate(std::vector<HwcLayer*>& source_layers,
   return true;
 }
 
+bool DisplayQueue::UpdateCursor(HwcLayer* layer, int32_t* retire_fence) {
+  CTRACE();
+  *retire_fence = -1;
+  // A frame is being prepared, it will pick up the new cursor state.
+  if (!update_lock_.try_lock())
+    return false;
+
+  bool updated = CommitCursorUpdate(layer, retire_fence);
+  update_lock_.unlock();
+  return updated;
+}
+
+bool DisplayQueue::CommitCursorUpdate(HwcLayer* layer, int32_t* retire_fence) {
+  if (cursor_plane_index_ < 0 || layer != cursor_source_layer_ ||
+      !layer->IsVisible() || last_commit_failed_update_ ||
+      !(state_ & kPoweredOn) ||
+      (state_ & (kConfigurationChanged | kClonedMode | kBlanked)))
+    return false;
+
+  const DisplayPlaneState& plane_state =
+      previous_plane_state_.at(cursor_plane_index_);
+  OverlayLayer& previous_layer =
+      in_flight_layers_.at(plane_state.GetSourceLayers().front());
+
+  OverlayLayer cursor_layer;
+  InitializeOverlayLayer(layer, &previous_layer, previous_layer.GetZorder(),
+                         previous_layer.GetLayerIndex(),
+                         cursor_handle_constraints_, &cursor_layer);
+
+  DisplayPlane* plane = plane_state.GetDisplayPlane();
+  OverlayBuffer* buffer = cursor_layer.GetBuffer();
+  bool supported = cursor_layer.IsVisible() && cursor_layer.IsCursorLayer() &&
+                   !cursor_layer.NeedsRevalidation() &&
+                   plane->ValidateLayer(&cursor_layer);
+  if (supported && !buffer->GetFb())
+    supported = buffer->CreateFrameBuffer(gpu_fd_);
+
+  if (!supported) {
+    // Acquire fence still belongs to the layer and will be consumed by
+    // the next QueueUpdate.
+    layer->SetAcquireFence(cursor_layer.ReleaseAcquireFence());
+    return false;
+  }
+
+  // A plain move keeps the buffer and the size on screen.
+  bool position_only =
+      buffer == previous_layer.GetBuffer() &&
+      cursor_layer.GetDisplayFrameWidth() ==
+          previous_layer.GetDisplayFrameWidth() &&
+      cursor_layer.GetDisplayFrameHeight() ==
+          previous_layer.GetDisplayFrameHeight() &&
+      cursor_layer.GetSourceCrop() == previous_layer.GetSourceCrop();
+
+  // Commits are serialized, the kernel would reject this one while the
+  // last frame or cursor update is pending.
+  if (kms_fence_ > 0)
+    WaitForPreviousFlip();
+
+  if (!display_->CommitCursor(plane, &cursor_layer, cursor_plane_index_,
+                              position_only, retire_fence)) {
+    layer->SetAcquireFence(cursor_layer.ReleaseAcquireFence());
+    return false;
+  }
+
+  // Previous cursor buffer can be released once the update is on screen.
+  if (!position_only && *retire_fence > 0)
+    layer->SetReleaseFence(dup(*retire_fence));
+
+  // Next frame or cursor update waits for this one to be done.
+  if (*retire_fence > 0)
+    kms_fence_ = dup(*retire_fence);
+
+  cursor_layer.SetLayerComposition(OverlayLayer::kDisplay);
+  // Plane state points to this entry, keep it in place.
+  previous_layer = std::move(cursor_layer);
+  return true;
+}
+
+void DisplayQueue::UpdateCursorState(std::vector<HwcLayer*>& source_layers,
+                                     bool handle_constraints) {
+  cursor_plane_index_ = -1;
+  cursor_source_layer_ = NULL;
+  cursor_handle_constraints_ = handle_constraints;
+  size_t size = previous_plane_state_.size();
+  for (size_t i = 0; i < size; i++) {
+    const DisplayPlaneState& plane = previous_plane_state_.at(i);
+    if (!plane.IsCursorPlane() || !plane.Scanout() ||
+        plane.SurfaceRecycled() || plane.GetSourceLayers().size() != 1)
+      continue;
+
+    const OverlayLayer& layer =
+        in_flight_layers_.at(plane.GetSourceLayers().front());
+    if (!layer.IsCursorLayer() || plane.GetOverlayLayer() != &layer)
+      continue;
+
+    cursor_plane_index_ = i;
+    cursor_source_layer_ = source_layers.at(layer.GetLayerIndex());
+    break;
+  }
+}
+
 void DisplayQueue::SetCloneMode(bool cloned) {
   if (cloned) {
     if (!(state_ & kClonedMode)) {
@@ -918,45 +1349,58 @@ void DisplayQueue::UpdateOnScreenSurfaces() {
 
 void DisplayQueue::SetReleaseFenceToLayers(
     int32_t fence, std::vector<HwcLayer*>& source_layers) {
+  std::shared_ptr<SharedFence> flip_fence;
   for (const DisplayPlaneState& plane : previous_plane_state_) {
     const std::vector<size_t>& layers = plane.GetSourceLayers();
     size_t size = layers.size();
-    int32_t release_fence = -1;
     if (plane.Scanout() && !plane.SurfaceRecycled()) {
+      if (!flip_fence && fence > 0) {
+        flip_fence = std::make_shared<SharedFence>(dup(fence));
+        pending_release_fences_.emplace_back(flip_fence);
+        pending_stats_.release_fence_fds++;
+      }
+
       for (size_t layer_index = 0; layer_index < size; layer_index++) {
         OverlayLayer& overlay_layer =
             in_flight_layers_.at(layers.at(layer_index));
-        HwcLayer* layer = source_layers.at(overlay_layer.GetLayerIndex());
-        layer->SetReleaseFence(dup(fence));
         overlay_layer.SetLayerComposition(OverlayLayer::kDisplay);
+        if (flip_fence) {
+          HwcLayer* layer = source_layers.at(overlay_layer.GetLayerIndex());
+          layer->AddReleaseFence(flip_fence);
+          pending_stats_.release_fences++;
+        }
       }
     } else {
-      release_fence = plane.GetOverlayLayer()->ReleaseAcquireFence();
+      std::shared_ptr<SharedFence> composition_fence;
+      int32_t release_fence = plane.GetOverlayLayer()->ReleaseAcquireFence();
+      if (release_fence > 0) {
+        composition_fence = std::make_shared<SharedFence>(release_fence);
+        pending_release_fences_.emplace_back(composition_fence);
+      }
 
       for (size_t layer_index = 0; layer_index < size; layer_index++) {
         OverlayLayer& overlay_layer =
             in_flight_layers_.at(layers.at(layer_index));
         overlay_layer.SetLayerComposition(OverlayLayer::kGpu);
         HwcLayer* layer = source_layers.at(overlay_layer.GetLayerIndex());
-        if (release_fence > 0) {
-          layer->SetReleaseFence(dup(release_fence));
+        if (composition_fence) {
+          layer->AddReleaseFence(composition_fence);
+          pending_stats_.release_fences++;
         } else {
           int32_t temp = overlay_layer.ReleaseAcquireFence();
-          if (temp > 0)
-            layer->SetReleaseFence(temp);
+          if (temp > 0) {
+            layer->AddReleaseFence(std::make_shared<SharedFence>(temp));
+            pending_stats_.release_fences++;
+          }
         }
       }
-
-      if (release_fence > 0) {
-        close(release_fence);
-        release_fence = -1;
-      }
     }
   }
 }
 
 void DisplayQueue::HandleExit() {
   IHOTPLUGEVENTTRACE("HandleExit Called: %p \n", this);
+  std::lock_guard<std::mutex> update_lock(update_lock_);
   power_mode_lock_.lock();
   state_ |= kIgnoreIdleRefresh;
   power_mode_lock_.unlock();
@@ -970,6 +1414,9 @@ void DisplayQueue::HandleExit() {
     kms_fence_ = 0;
   }
 
+  if (has_pending_stats_)
+    RecordPendingStatistics(0, 0);
+
   bool disable_overlay = false;
   if (state_ & kDisableOverlayUsage) {
     disable_overlay = true;
@@ -1078,6 +1525,20 @@ void DisplayQueue::RestoreVideoDefaultDeinterlace() {
   video_lock_.unlock();
 }
 
+void DisplayQueue::UpdateVideoState(int64_t session_id, bool is_prepared) {
+  refresh_governor_.UpdateVideoState(session_id, is_prepared);
+}
+
+void DisplayQueue::UpdateVideoFPS(int64_t session_id, int32_t fps) {
+  refresh_governor_.UpdateVideoFPS(session_id, fps);
+}
+
+void DisplayQueue::SetOptimizationMode(HWCOptimizationMode mode) {
+  video_lock_.lock();
+  optimization_mode_ = mode;
+  video_lock_.unlock();
+}
+
 int DisplayQueue::RegisterVsyncCallback(std::shared_ptr<VsyncCallback> callback,
                                         uint32_t display_id) {
   return vblank_handler_->RegisterCallback(callback, display_id);
@@ -1095,6 +1556,14 @@ void DisplayQueue::VSyncControl(bool enabled) {
   vblank_handler_->VSyncControl(enabled);
 }
 
+void DisplayQueue::SetSimulatedVblankPeriod(int64_t period) {
+  vblank_handler_->SetSimulatedPeriod(period);
+}
+
+void DisplayQueue::VsyncPeriodChanged(int64_t period) {
+  vblank_handler_->PeriodChanged(period);
+}
+
 void DisplayQueue::HandleIdleCase() {
   idle_tracker_.idle_lock_.lock();
   if (idle_tracker_.state_ & FrameStateTracker::kPrepareComposition) {
@@ -1105,7 +1574,7 @@ void DisplayQueue::HandleIdleCase() {
   if (idle_tracker_.total_planes_ <= 1 ||
       (idle_tracker_.state_ & FrameStateTracker::kTrackingFrames) ||
       (idle_tracker_.state_ & FrameStateTracker::kRevalidateLayers) ||
-      idle_tracker_.has_cursor_layer_) {
+      idle_tracker_.has_cursor_layer_ || idle_tracker_.has_video_playback_) {
     idle_tracker_.idle_lock_.unlock();
     return;
   }
@@ -1147,31 +1616,132 @@ void DisplayQueue::ForceRefresh() {
 void DisplayQueue::DisplayConfigurationChanged() {
   // Mark it as needs modeset, so that in next queue update we do a modeset
   state_ |= kConfigurationChanged;
+  // Content rate needs to be applied again for the new configuration.
+  refresh_governor_.Reset();
 }
 
 void DisplayQueue::UpdateScalingRatio(uint32_t primary_width,
                                       uint32_t primary_height,
                                       uint32_t display_width,
                                       uint32_t display_height) {
-  scaling_tracker_.scaling_state_ = ScalingTracker::kNeeedsNoSclaing;
-  uint32_t primary_area = primary_width * primary_height;
-  uint32_t display_area = display_width * display_height;
-  if (primary_area != display_area) {
-    scaling_tracker_.scaling_state_ = ScalingTracker::kNeedsScaling;
-    scaling_tracker_.scaling_width =
-        float(display_width - primary_width) / float(primary_width);
-    scaling_tracker_.scaling_height =
-        float(display_height - primary_height) / float(primary_height);
+  scaling_lock_.lock();
+  content_width_ = 0;
+  content_height_ = 0;
+  if (primary_width != display_width || primary_height != display_height) {
+    content_width_ = primary_width;
+    content_height_ = primary_height;
   }
+  scaling_lock_.unlock();
 
   state_ |= kConfigurationChanged;
 }
 
+void DisplayQueue::SetOverscan(int32_t x_overscan, int32_t y_overscan) {
+  scaling_lock_.lock();
+  x_overscan_ = x_overscan;
+  y_overscan_ = y_overscan;
+  scaling_lock_.unlock();
+}
+
+void DisplayQueue::GetOverscan(int32_t* x_overscan, int32_t* y_overscan) {
+  scaling_lock_.lock();
+  *x_overscan = x_overscan_;
+  *y_overscan = y_overscan_;
+  scaling_lock_.unlock();
+}
+
+void DisplayQueue::SetDisplayScaling(HWCDisplayScaling mode) {
+  scaling_lock_.lock();
+  scaling_mode_ = mode;
+  scaling_lock_.unlock();
+}
+
+HWCDisplayScaling DisplayQueue::GetDisplayScaling() {
+  scaling_lock_.lock();
+  HWCDisplayScaling mode = scaling_mode_;
+  scaling_lock_.unlock();
+  return mode;
+}
+
+bool DisplayQueue::UpdatePanelFitter() {
+  bool changed = false;
+  // Mode may have changed, display size is known once it's applied.
+  if ((state_ & kConfigurationChanged) &&
+      panel_fitter_.SetDisplaySize(display_->Width(), display_->Height()))
+    changed = true;
+
+  scaling_lock_.lock();
+  if (panel_fitter_.SetContentSize(content_width_, content_height_))
+    changed = true;
+  if (panel_fitter_.SetScalingMode(scaling_mode_))
+    changed = true;
+  if (panel_fitter_.SetOverscan(x_overscan_, y_overscan_))
+    changed = true;
+  scaling_lock_.unlock();
+  return changed;
+}
+
+bool DisplayQueue::SetBlank(bool blank) {
+  std::unique_lock<std::mutex> update_lock(update_lock_);
+  if (blank == static_cast<bool>(state_ & kBlanked))
+    return true;
+
+  if (!blank) {
+    // Buffers of the last frame may have been freed while blanked, the
+    // next one is validated from scratch rather than shown again.
+    state_ &= ~kBlanked;
+    if (!previous_plane_state_.empty())
+      ResetQueue();
+
+    update_lock.unlock();
+    ForceRefresh();
+    return true;
+  }
+
+  state_ |= kBlanked;
+  // Nothing is shown, or the next frame does a modeset anyway.
+  if (!(state_ & kPoweredOn) || (state_ & kConfigurationChanged) ||
+      previous_plane_state_.empty())
+    return true;
+
+  if (kms_fence_ > 0) {
+    WaitForPreviousFlip();
+  } else if (has_pending_stats_) {
+    RecordPendingStatistics(0, 0);
+  }
+
+  // Planes are disabled rather than the pipe, so that unblank doesn't
+  // need a modeset.
+  DisplayPlaneStateList no_planes;
+  for (const DisplayPlaneState& plane : previous_plane_state_)
+    plane.GetDisplayPlane()->SetInUse(false);
+
+  int32_t fence = -1;
+  bool disable_ovelays = state_ & kDisableOverlayUsage;
+  if (!display_->Commit(no_planes, previous_plane_state_, disable_ovelays,
+                        &fence)) {
+    ETRACE("Failed to blank display.");
+    // Last frame is still on screen.
+    for (const DisplayPlaneState& plane : previous_plane_state_)
+      plane.GetDisplayPlane()->SetInUse(true);
+
+    state_ &= ~kBlanked;
+    return false;
+  }
+
+  if (fence > 0)
+    kms_fence_ = fence;
+
+  return true;
+}
+
 void DisplayQueue::ResetQueue() {
   applied_video_effect_ = false;
   last_commit_failed_update_ = false;
   std::vector<OverlayLayer>().swap(in_flight_layers_);
   DisplayPlaneStateList().swap(previous_plane_state_);
+  cursor_plane_index_ = -1;
+  cursor_source_layer_ = NULL;
   std::vector<NativeSurface*>().swap(mark_not_inuse_);
   std::vector<NativeSurface*>().swap(surfaces_not_inuse_);
   if (display_plane_manager_->HasSurfaces())
@@ -1188,6 +1758,7 @@ void DisplayQueue::ResetQueue() {
   if (ignore_updates) {
     idle_tracker_.state_ |= FrameStateTracker::kIgnoreUpdates;
   }
+  refresh_governor_.Reset();
   compositor_.Reset();
 }
 
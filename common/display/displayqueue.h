@@ -24,12 +24,18 @@
 
 #include <queue>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include "compositor.h"
 #include "displayplanemanager.h"
+#include "framecapture.h"
+#include "framestatistics.h"
 #include "hwcthread.h"
+#include "layerupdatetracker.h"
+#include "panelfitter.h"
 #include "platformdefines.h"
+#include "refreshrategovernor.h"
 #include "resourcemanager.h"
 #include "vblankeventhandler.h"
 
@@ -44,6 +50,7 @@ class PhysicalDisplay;
 class DisplayPlaneHandler;
 struct HwcLayer;
 class NativeBufferHandler;
+class SharedFence;
 
 static uint32_t kidleframes = 250;
 class DisplayQueue {
@@ -57,7 +64,33 @@ class DisplayQueue {
 
   bool QueueUpdate(std::vector<HwcLayer*>& source_layers, int32_t* retire_fence,
                    bool idle_update, bool handle_constraints);
+  // Commits only the cursor plane, if layer is the cursor layer of the
+  // last frame and it is scanned out directly. Returns false if the
+  // update needs to wait for the next QueueUpdate, i.e. a frame is being
+  // prepared, the layer changed in a way that needs validation or the
+  // display couldn't take the update.
+  bool UpdateCursor(HwcLayer* layer, int32_t* retire_fence);
+  bool ValidateLayers(std::vector<HwcLayer*>& source_layers,
+                      std::vector<HWCLayerComposition>* composition);
+  // Can be called from any thread.
+  void GetFrameStatistics(uint64_t since_frame,
+                          std::vector<HwcFrameStatistics>* frames);
+  // Can be called from any thread.
+  void GetSurfacePoolStatistics(HwcSurfacePoolStatistics* stats);
+  // Can be called from any thread.
+  void GetLayerStatistics(std::vector<HwcLayerStatistics>* layers);
   bool SetPowerMode(uint32_t power_mode);
+  // See NativeDisplay::SetWarmSuspend.
+  void SetWarmSuspend(bool enable, uint64_t surface_budget);
+  // Drops what was kept by a warm suspend, the display powers on cold.
+  void DropSuspendedState();
+  // See NativeDisplay::StartFrameCapture, frames are width x height.
+  bool StartFrameCapture(uint32_t width, uint32_t height, uint32_t frames,
+                         const char* directory);
+  // Can be called from any thread.
+  void GetFrameCaptureStatistics(HwcFrameCaptureStatistics* stats);
+  // Can be called from any thread.
+  void TakeCapturedFrames(std::vector<HwcCapturedFrame>* frames);
   bool CheckPlaneFormat(uint32_t format);
   void SetGamma(float red, float green, float blue);
   void SetColorTransform(const float *matrix, HWCColorTransform hint);
@@ -71,6 +104,19 @@ class DisplayQueue {
   void RestoreVideoDefaultColor(HWCColorControl color);
   void SetVideoDeinterlace(HWCDeinterlaceFlag flag, HWCDeinterlaceControl mode);
   void RestoreVideoDefaultDeinterlace();
+  void UpdateVideoState(int64_t session_id, bool is_prepared);
+  void UpdateVideoFPS(int64_t session_id, int32_t fps);
+  void SetOptimizationMode(HWCOptimizationMode mode);
+  // Scaling and overscan apply from the next frame, see PanelFitter.
+  // Can be called from any thread.
+  void SetOverscan(int32_t x_overscan, int32_t y_overscan);
+  void GetOverscan(int32_t* x_overscan, int32_t* y_overscan);
+  void SetDisplayScaling(HWCDisplayScaling mode);
+  HWCDisplayScaling GetDisplayScaling();
+  // Disables all planes keeping the mode set. Frames are dropped while
+  // blanked, unblank forces a refresh which validates the next frame
+  // from scratch.
+  bool SetBlank(bool blank);
   int RegisterVsyncCallback(std::shared_ptr<VsyncCallback> callback,
                             uint32_t display_id);
 
@@ -79,6 +125,14 @@ class DisplayQueue {
 
   void VSyncControl(bool enabled);
 
+  // Used by displays without a CRTC to drive vblank events, see
+  // VblankEventHandler::SetSimulatedPeriod.
+  void SetSimulatedVblankPeriod(int64_t period);
+
+  // Display switched to a mode with a different refresh rate on its own,
+  // see VblankEventHandler::PeriodChanged.
+  void VsyncPeriodChanged(int64_t period);
+
   void HandleIdleCase();
 
   void DisplayConfigurationChanged();
@@ -98,6 +152,30 @@ class DisplayQueue {
 
   void IgnoreUpdates();
  private:
+  void InitializeOverlayLayer(HwcLayer* layer, OverlayLayer* previous_layer,
+                              uint32_t z_order, uint32_t layer_index,
+                              bool handle_constraints,
+                              OverlayLayer* overlay_layer);
+
+  // Applies scaling requested since the last frame to panel_fitter_.
+  // Returns true if layout of content changed.
+  bool UpdatePanelFitter();
+
+  // Waits for the last committed frame, or cursor update, to be on
+  // screen and closes kms_fence_.
+  void WaitForPreviousFlip();
+  // Pushes pending_stats_ to frame_statistics_, flip_time is the time
+  // when frame was shown or zero if unknown.
+  void RecordPendingStatistics(int64_t flip_time, int64_t fence_wait_time);
+
+  // Turns the display off keeping layers, plane assignments, buffers and
+  // off-screen surfaces of the last frame. Returns false if warm suspend
+  // is disabled or the surfaces don't fit in its budget.
+  bool HandleWarmSuspend();
+  // Shows the frame kept by HandleWarmSuspend again. Returns false if it
+  // couldn't be, the queue is reset then.
+  bool ResumeLastFrame();
+
   enum QueueState {
     kNeedsColorCorrection = 1 << 0,  // Needs Color correction.
     kConfigurationChanged = 1 << 1,  // Layers need to be re-validated.
@@ -108,17 +186,10 @@ class DisplayQueue {
     kIgnoreIdleRefresh =
         1 << 6,            // Ignore refresh request during idle callback.
     kClonedMode = 1 << 7,  // We are in cloned mode.
-    kLastFrameIdleUpdate = 1 << 8  // Last frame was a refresh for Idle state.
-  };
-
-  struct ScalingTracker {
-    enum ScalingState {
-      kNeeedsNoSclaing = 0,  // Needs no scaling.
-      kNeedsScaling = 1,     // Needs scaling.
-    };
-    float scaling_height = 1.0;
-    float scaling_width = 1.0;
-    uint32_t scaling_state_ = ScalingTracker::kNeeedsNoSclaing;
+    kLastFrameIdleUpdate =
+        1 << 8,              // Last frame was a refresh for Idle state.
+    kWarmSuspended = 1 << 9,  // Powered off keeping the last frame.
+    kBlanked = 1 << 10        // All planes disabled, see SetBlank.
   };
 
   struct FrameStateTracker {
@@ -140,6 +211,9 @@ class DisplayQueue {
 
     uint32_t idle_frames_ = 0;
     bool has_cursor_layer_ = false;
+    // Video playback was announced and the last frame had video, a
+    // paused video isn't moved to the GPU as idle content.
+    bool has_video_playback_ = false;
     SpinLock idle_lock_;
     int state_ = kPrepareComposition;
     uint32_t revalidate_frames_counter_ = 0;
@@ -158,6 +232,7 @@ class DisplayQueue {
       tracker_.idle_lock_.lock();
       tracker_.state_ |= FrameStateTracker::kPrepareComposition;
       tracker_.has_cursor_layer_ = false;
+      tracker_.has_video_playback_ = false;
       if (tracker_.state_ & FrameStateTracker::kPrepareIdleComposition) {
         tracker_.state_ |= FrameStateTracker::kRenderIdleDisplay;
         tracker_.state_ &= ~FrameStateTracker::kPrepareIdleComposition;
@@ -197,6 +272,10 @@ class DisplayQueue {
       tracker_.has_cursor_layer_ = true;
     }
 
+    void FrameHasVideoPlayback() {
+      tracker_.has_video_playback_ = true;
+    }
+
     ~ScopedIdleStateTracker() {
       tracker_.idle_lock_.lock();
       // Reset idle frame count. We want that idle frames
@@ -241,9 +320,17 @@ class DisplayQueue {
                        bool* render_layers, bool* can_ignore_commit,
                        bool* needs_plane_validation,
                        bool* force_full_validation);
+  // Hands the layers of the frame which was just committed one shared
+  // fence per release event instead of an fd each, see SharedFence.
   void SetReleaseFenceToLayers(int32_t fence,
                                std::vector<HwcLayer*>& source_layers);
 
+  // Remembers the plane scanning out the cursor layer of the frame which
+  // was just committed, for UpdateCursor.
+  void UpdateCursorState(std::vector<HwcLayer*>& source_layers,
+                         bool handle_constraints);
+  bool CommitCursorUpdate(HwcLayer* layer, int32_t* retire_fence);
+
   void SetMediaEffectsState(bool apply_effects,
                             const std::vector<OverlayLayer>& layers,
                             DisplayPlaneStateList& current_composition_planes);
@@ -264,14 +351,38 @@ class DisplayQueue {
   HWCColorTransform color_transform_hint_;
   uint32_t contrast_;
   int32_t kms_fence_ = 0;
+  bool warm_suspend_ = false;
+  uint64_t warm_suspend_budget_ = 0;
   struct gamma_colors gamma_;
   std::unique_ptr<VblankEventHandler> vblank_handler_;
   std::unique_ptr<DisplayPlaneManager> display_plane_manager_;
   std::unique_ptr<ResourceManager> resource_manager_;
   std::vector<OverlayLayer> in_flight_layers_;
+  // Storage reused by every composition preview, see ValidateLayers.
+  std::vector<OverlayLayer> preview_layers_;
+  std::vector<HWCLayerComposition> preview_composition_;
   DisplayPlaneStateList previous_plane_state_;
   FrameStateTracker idle_tracker_;
-  ScalingTracker scaling_tracker_;
+  // Lays out content with the scaling requested below, updated at the
+  // start of every frame.
+  PanelFitter panel_fitter_;
+  SpinLock scaling_lock_;
+  HWCDisplayScaling scaling_mode_ = HWCDisplayScaling::kScaleStretch;
+  int32_t x_overscan_ = 0;
+  int32_t y_overscan_ = 0;
+  // Size of content shown in cloned mode, 0 when it's the display size.
+  uint32_t content_width_ = 0;
+  uint32_t content_height_ = 0;
+  FrameStatisticsRing frame_statistics_;
+  // Statistics of the last committed frame, waiting for its flip.
+  HwcFrameStatistics pending_stats_;
+  bool has_pending_stats_ = false;
+  // Release fences of the pending frame, their fd counts are added to
+  // pending_stats_ once it is recorded.
+  std::vector<std::shared_ptr<SharedFence>> pending_release_fences_;
+  uint64_t total_frames_ = 0;
+  RefreshRateGovernor refresh_governor_;
+  LayerUpdateTracker layer_tracker_;
   // shared_ptr since we need to use this outside of the thread lock (to
   // actually call the hook) and we don't want the memory freed until we're
   // done
@@ -285,6 +396,11 @@ class DisplayQueue {
   SpinLock video_lock_;
   bool requested_video_effect_ = false;
   bool applied_video_effect_ = false;
+  HWCOptimizationMode optimization_mode_ =
+      HWCOptimizationMode::kOptimizeNormal;
+  // Planes are set aside for video, see
+  // DisplayPlaneManager::SetVideoPlayback.
+  bool video_playback_ = false;
   // Set to true when layers are validated and commit fails.
   bool last_commit_failed_update_ = false;
   // Surfaces to be marked as not in use. These
@@ -295,6 +411,21 @@ class DisplayQueue {
   // need to be marked as not in use during next
   // frame.
   std::vector<NativeSurface*> surfaces_not_inuse_;
+  // Held while a frame is prepared and committed, fence waits and
+  // composition included, so a mutex rather than a spin lock. UpdateCursor
+  // only try locks it, cursor updates racing with a frame go with that
+  // frame.
+  std::mutex update_lock_;
+  // Index in previous_plane_state_ of the plane scanning out the cursor
+  // layer directly, -1 if there is none.
+  int cursor_plane_index_ = -1;
+  // Layer the cursor plane was last updated from. Only compared
+  // against, never dereferenced.
+  const HwcLayer* cursor_source_layer_ = NULL;
+  bool cursor_handle_constraints_ = false;
+  // Last, so that its worker is done reading back before the buffer
+  // handler of resource_manager_ goes away.
+  FrameCapture frame_capture_;
 };
 
 }  // namespace hwcomposer
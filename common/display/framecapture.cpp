@@ -0,0 +1,349 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "framecapture.h"
+
+#include <drm_fourcc.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <nativebufferhandler.h>
+
+#include "compositor.h"
+#include "hwctrace.h"
+#include "hwcutils.h"
+#include "overlaylayer.h"
+#include "resourcemanager.h"
+
+namespace hwcomposer {
+
+// Lowest priority, readback must not compete with composition.
+FrameCapture::FrameCapture() : HWCThread(19, "FrameCapture") {
+}
+
+FrameCapture::~FrameCapture() {
+  Stop();
+}
+
+bool FrameCapture::Start(ResourceManager* resource_manager, uint32_t width,
+                         uint32_t height, uint32_t frames,
+                         const char* directory) {
+  Stop();
+  if (!frames)
+    return true;
+
+  ScopedSpinLock capture_lock(capture_lock_);
+  resource_manager_ = resource_manager;
+  width_ = width;
+  height_ = height;
+  directory_ = directory ? directory : "";
+  sequence_ = 0;
+
+  // Linear, so that mapping them doesn't need a detiling copy.
+  const NativeBufferHandler* handler =
+      resource_manager_->GetNativeBufferHandler();
+  std::vector<uint64_t> modifiers(1, DRM_FORMAT_MOD_LINEAR);
+  for (StagingSlot& slot : slots_) {
+    if (!handler->CreateBufferWithModifiers(width, height,
+                                            DRM_FORMAT_ABGR8888, modifiers,
+                                            &slot.handle_)) {
+      ETRACE("FrameCapture: Failed to allocate %dx%d staging buffer.", width,
+             height);
+      ReleaseStagingBuffers();
+      return false;
+    }
+  }
+
+  if (!InitWorker()) {
+    ETRACE("FrameCapture: Failed to initialize worker. %s", PRINTERROR());
+    ReleaseStagingBuffers();
+    return false;
+  }
+
+  pending_frames_ = frames;
+  return true;
+}
+
+void FrameCapture::Stop() {
+  ScopedSpinLock capture_lock(capture_lock_);
+  pending_frames_ = 0;
+  WaitForQueuedCopies();
+  // Worker reads back copies in flight before exiting.
+  Exit();
+  ReleaseStagingBuffers();
+}
+
+void FrameCapture::WaitForQueuedCopies() {
+  while (true) {
+    bool queued = false;
+    lock_.lock();
+    for (StagingSlot& slot : slots_) {
+      if (slot.state_ == kCopying)
+        queued = true;
+    }
+    lock_.unlock();
+
+    if (!queued)
+      return;
+
+    usleep(1000);
+  }
+}
+
+void FrameCapture::ReleaseStagingBuffers() {
+  if (!resource_manager_)
+    return;
+
+  const NativeBufferHandler* handler =
+      resource_manager_->GetNativeBufferHandler();
+  for (StagingSlot& slot : slots_) {
+    if (slot.fence_ > 0)
+      close(slot.fence_);
+
+    if (slot.handle_) {
+      handler->ReleaseBuffer(slot.handle_);
+      handler->DestroyHandle(slot.handle_);
+    }
+
+    slot = StagingSlot();
+  }
+}
+
+int64_t FrameCapture::CaptureFrame(
+    Compositor* compositor, const std::vector<const OverlayLayer*>& layers,
+    int32_t acquire_fence) {
+  int64_t start = GetMonotonicTime();
+  if (!capture_lock_.try_lock()) {
+    if (acquire_fence > 0)
+      close(acquire_fence);
+
+    dropped_++;
+    return GetMonotonicTime() - start;
+  }
+
+  if (!pending_frames_) {
+    if (acquire_fence > 0)
+      close(acquire_fence);
+
+    capture_lock_.unlock();
+    return 0;
+  }
+
+  pending_frames_--;
+  uint64_t sequence = sequence_++;
+  StagingSlot* slot = NULL;
+  lock_.lock();
+  for (StagingSlot& staging : slots_) {
+    if (staging.state_ == kFree) {
+      staging.state_ = kCopying;
+      staging.sequence_ = sequence;
+      slot = &staging;
+      break;
+    }
+  }
+  lock_.unlock();
+
+  bool queued = false;
+  if (slot && !layers.empty()) {
+    // Buffers of the last copy to this slot aren't needed any more.
+    slot->layers_.clear();
+    std::vector<HwcRect<int>> display_frames;
+    std::vector<size_t> index;
+    display_frames.reserve(layers.size());
+    index.reserve(layers.size());
+    for (size_t i = 0; i < layers.size(); i++) {
+      slot->layers_.emplace_back();
+      slot->layers_.back().InitializeFromOverlayLayer(*layers.at(i), i);
+      display_frames.emplace_back(layers.at(i)->GetDisplayFrame());
+      index.emplace_back(i);
+    }
+
+    queued = compositor->QueueDrawOffscreen(
+        slot->layers_, display_frames, index, resource_manager_, width_,
+        height_, slot->handle_, acquire_fence, this, slot - slots_);
+  } else if (acquire_fence > 0) {
+    close(acquire_fence);
+  }
+
+  if (slot && !queued) {
+    lock_.lock();
+    slot->state_ = kFree;
+    lock_.unlock();
+  }
+
+  if (!queued)
+    dropped_++;
+
+  capture_lock_.unlock();
+  int64_t elapsed = GetMonotonicTime() - start;
+  submit_time_ += elapsed;
+  return elapsed;
+}
+
+void FrameCapture::DrawQueued(uint32_t id, bool succeeded,
+                              int32_t retire_fence) {
+  StagingSlot& slot = slots_[id];
+  lock_.lock();
+  if (succeeded) {
+    slot.fence_ = retire_fence;
+    slot.state_ = kReadback;
+  } else {
+    slot.state_ = kFree;
+  }
+  lock_.unlock();
+
+  if (succeeded) {
+    Resume();
+  } else {
+    dropped_++;
+  }
+}
+
+void FrameCapture::HandleRoutine() {
+  while (true) {
+    // Oldest frame first.
+    StagingSlot* slot = NULL;
+    lock_.lock();
+    for (StagingSlot& staging : slots_) {
+      if (staging.state_ == kReadback &&
+          (!slot || staging.sequence_ < slot->sequence_))
+        slot = &staging;
+    }
+    lock_.unlock();
+
+    if (!slot)
+      return;
+
+    int64_t start = GetMonotonicTime();
+    uint64_t sequence = slot->sequence_;
+    std::vector<uint8_t> image;
+    bool read = Readback(*slot, &image);
+    lock_.lock();
+    slot->state_ = kFree;
+    lock_.unlock();
+
+    if (read) {
+      Store(sequence, image);
+    } else {
+      dropped_++;
+    }
+
+    readback_time_ += GetMonotonicTime() - start;
+  }
+}
+
+void FrameCapture::HandleExit() {
+  HandleRoutine();
+}
+
+bool FrameCapture::Readback(StagingSlot& slot, std::vector<uint8_t>* image) {
+  if (slot.fence_ > 0) {
+    HWCPoll(slot.fence_, -1);
+    close(slot.fence_);
+    slot.fence_ = -1;
+  }
+
+  const NativeBufferHandler* handler =
+      resource_manager_->GetNativeBufferHandler();
+  uint32_t stride = 0;
+  void* map_data = NULL;
+  const uint8_t* pixels = static_cast<const uint8_t*>(handler->Map(
+      slot.handle_, 0, 0, width_, height_, &stride, &map_data, 0));
+  if (!pixels) {
+    ETRACE("FrameCapture: Failed to map staging buffer.");
+    return false;
+  }
+
+  // ABGR8888 is R, G, B, A in memory, which is what PAM expects.
+  char header[128];
+  int header_size = snprintf(header, sizeof(header),
+                             "P7\nWIDTH %u\nHEIGHT %u\nDEPTH 4\nMAXVAL 255\n"
+                             "TUPLTYPE RGB_ALPHA\nENDHDR\n",
+                             width_, height_);
+  size_t row_size = static_cast<size_t>(width_) * 4;
+  image->reserve(header_size + row_size * height_);
+  image->insert(image->end(), header, header + header_size);
+  for (uint32_t y = 0; y < height_; y++) {
+    const uint8_t* row = pixels + static_cast<size_t>(y) * stride;
+    image->insert(image->end(), row, row + row_size);
+  }
+
+  handler->UnMap(slot.handle_, map_data);
+  return true;
+}
+
+void FrameCapture::Store(uint64_t sequence, std::vector<uint8_t>& image) {
+  // Image is handed over to the queue of frames kept in memory.
+  size_t size = image.size();
+  if (!directory_.empty()) {
+    std::string path =
+        directory_ + "/frame-" + std::to_string(sequence) + ".pam";
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) {
+      ETRACE("FrameCapture: Failed to open %s. %s", path.c_str(),
+             PRINTERROR());
+      dropped_++;
+      return;
+    }
+
+    size_t written = fwrite(image.data(), 1, image.size(), file);
+    fclose(file);
+    if (written != image.size()) {
+      ETRACE("FrameCapture: Failed to write %s.", path.c_str());
+      dropped_++;
+      return;
+    }
+  } else {
+    lock_.lock();
+    if (frames_.size() >= FRAME_CAPTURE_MAX_QUEUED_FRAMES ||
+        queued_bytes_ + size > FRAME_CAPTURE_MAX_QUEUED_BYTES) {
+      lock_.unlock();
+      dropped_++;
+      return;
+    }
+
+    frames_.emplace_back();
+    HwcCapturedFrame& frame = frames_.back();
+    frame.sequence = sequence;
+    frame.image.swap(image);
+    queued_bytes_ += size;
+    lock_.unlock();
+  }
+
+  captured_++;
+  bytes_ += size;
+}
+
+void FrameCapture::GetStatistics(HwcFrameCaptureStatistics* stats) const {
+  stats->captured = captured_;
+  stats->dropped = dropped_;
+  stats->bytes = bytes_;
+  stats->submit_time = submit_time_;
+  stats->readback_time = readback_time_;
+  stats->pending = pending_frames_;
+}
+
+void FrameCapture::TakeFrames(std::vector<HwcCapturedFrame>* frames) {
+  lock_.lock();
+  for (HwcCapturedFrame& frame : frames_)
+    frames->emplace_back(std::move(frame));
+
+  frames_.clear();
+  queued_bytes_ = 0;
+  lock_.unlock();
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,138 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_DISPLAY_FRAMECAPTURE_H_
+#define COMMON_DISPLAY_FRAMECAPTURE_H_
+
+#include <stdint.h>
+
+#include <hwcdefs.h>
+#include <platformdefines.h>
+#include <spinlock.h>
+
+#include <atomic>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "compositorthread.h"
+#include "hwcthread.h"
+#include "overlaylayer.h"
+
+namespace hwcomposer {
+
+class Compositor;
+class ResourceManager;
+
+// Staging buffers frames are copied to, a frame is dropped if none is free.
+#define FRAME_CAPTURE_STAGING_BUFFERS 3
+// Frames kept in memory until taken, later ones are dropped.
+#define FRAME_CAPTURE_MAX_QUEUED_FRAMES 8
+#define FRAME_CAPTURE_MAX_QUEUED_BYTES (128u << 20)
+
+// Captures frames of a display for diagnostics without stalling its
+// composition. The buffers a frame was scanned out from, off-screen
+// targets already composited included, are blitted into one of a ring of
+// linear staging buffers. The blit is queued on the compositor thread,
+// only its fence is kept. A low priority worker waits for the copy, reads
+// it back as a PAM image and writes it to a directory or queues it in
+// memory. Frames are dropped whenever all staging buffers are in use or
+// the queue is full.
+class FrameCapture : public HWCThread, public QueuedDrawCallback {
+ public:
+  FrameCapture();
+  ~FrameCapture() override;
+
+  FrameCapture(const FrameCapture& rhs) = delete;
+  FrameCapture& operator=(const FrameCapture& rhs) = delete;
+
+  // Captures the next frames frames of a width x height display, see
+  // NativeDisplay::StartFrameCapture. Stops any capture in progress.
+  bool Start(ResourceManager* resource_manager, uint32_t width,
+             uint32_t height, uint32_t frames, const char* directory);
+  // Frames already copied are still read back.
+  void Stop();
+
+  bool IsActive() const {
+    return pending_frames_.load(std::memory_order_relaxed) > 0;
+  }
+
+  // Queues the copy of the frame which was just committed, made of
+  // layers bottom most first, e.g. those of its planes. Their buffers are
+  // kept until the copy was submitted, which waits for acquire_fence
+  // unless it's -1. Takes ownership of acquire_fence. Returns the time
+  // this took in ns.
+  int64_t CaptureFrame(Compositor* compositor,
+                       const std::vector<const OverlayLayer*>& layers,
+                       int32_t acquire_fence);
+
+  // Safe to call from any thread.
+  void GetStatistics(HwcFrameCaptureStatistics* stats) const;
+  // Safe to call from any thread.
+  void TakeFrames(std::vector<HwcCapturedFrame>* frames);
+
+  void HandleRoutine() override;
+  void HandleExit() override;
+
+  void DrawQueued(uint32_t id, bool succeeded, int32_t retire_fence) override;
+
+ private:
+  enum SlotState {
+    kFree,      // Can be copied to.
+    kCopying,   // Copy is queued on the compositor thread.
+    kReadback   // Copy submitted, waiting for the worker.
+  };
+
+  struct StagingSlot {
+    HWCNativeHandle handle_ = 0;
+    int32_t fence_ = -1;
+    uint64_t sequence_ = 0;
+    SlotState state_ = kFree;
+    // Copies of the layers of the frame, sharing their buffers.
+    std::vector<OverlayLayer> layers_;
+  };
+
+  // Waits for copies queued on the compositor thread to be submitted.
+  void WaitForQueuedCopies();
+  void ReleaseStagingBuffers();
+  // Waits for the copy to slot and reads it back into image.
+  bool Readback(StagingSlot& slot, std::vector<uint8_t>* image);
+  void Store(uint64_t sequence, std::vector<uint8_t>& image);
+
+  // Held by Start and Stop, CaptureFrame drops the frame if it can't
+  // take it right away.
+  SpinLock capture_lock_;
+  // Protects slot states, frames_ and queued_bytes_.
+  SpinLock lock_;
+  StagingSlot slots_[FRAME_CAPTURE_STAGING_BUFFERS];
+  std::deque<HwcCapturedFrame> frames_;
+  size_t queued_bytes_ = 0;
+  ResourceManager* resource_manager_ = NULL;
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
+  std::string directory_;
+  uint64_t sequence_ = 0;
+
+  std::atomic<uint32_t> pending_frames_{0};
+  std::atomic<uint64_t> captured_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<uint64_t> bytes_{0};
+  std::atomic<int64_t> submit_time_{0};
+  std::atomic<int64_t> readback_time_{0};
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_DISPLAY_FRAMECAPTURE_H_
@@ -0,0 +1,70 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "framestatistics.h"
+
+namespace hwcomposer {
+
+FrameStatisticsRing::FrameStatisticsRing() : total_frames_(0) {
+  for (Slot& slot : slots_) {
+    slot.sequence_.store(0, std::memory_order_relaxed);
+  }
+}
+
+void FrameStatisticsRing::Record(const HwcFrameStatistics& stats) {
+  uint64_t index = total_frames_.load(std::memory_order_relaxed);
+  Slot& slot = slots_[index & (FRAME_STATISTICS_RING_SIZE - 1)];
+  uint32_t sequence = slot.sequence_.load(std::memory_order_relaxed);
+  slot.sequence_.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.stats_ = stats;
+  slot.sequence_.store(sequence + 2, std::memory_order_release);
+  total_frames_.store(index + 1, std::memory_order_release);
+}
+
+void FrameStatisticsRing::Read(uint64_t since_frame,
+                               std::vector<HwcFrameStatistics>* frames) {
+  frames->clear();
+  uint64_t end = total_frames_.load(std::memory_order_acquire);
+  uint64_t begin = 0;
+  if (end > FRAME_STATISTICS_RING_SIZE)
+    begin = end - FRAME_STATISTICS_RING_SIZE;
+
+  frames->reserve(end - begin);
+  for (uint64_t i = begin; i < end; ++i) {
+    const Slot& slot = slots_[i & (FRAME_STATISTICS_RING_SIZE - 1)];
+    HwcFrameStatistics stats;
+    uint32_t sequence;
+    do {
+      sequence = slot.sequence_.load(std::memory_order_acquire);
+      stats = slot.stats_;
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence & 1) ||
+             sequence != slot.sequence_.load(std::memory_order_relaxed));
+
+    // Slot might have been overwritten by a newer frame while we were
+    // reading older ones, ordering is still preserved by frame_number.
+    if (stats.frame_number <= since_frame)
+      continue;
+
+    if (!frames->empty() && frames->back().frame_number >= stats.frame_number)
+      continue;
+
+    frames->emplace_back(stats);
+  }
+}
+
+}  // namespace hwcomposer
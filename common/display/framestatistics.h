@@ -0,0 +1,62 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_DISPLAY_FRAMESTATISTICS_H_
+#define COMMON_DISPLAY_FRAMESTATISTICS_H_
+
+#include <stdint.h>
+
+#include <hwcdefs.h>
+
+#include <atomic>
+#include <vector>
+
+namespace hwcomposer {
+
+// Number of frames kept per display. Needs to be a power of two.
+#define FRAME_STATISTICS_RING_SIZE 256
+
+// Fixed size ring of HwcFrameStatistics. There is a single writer (the
+// thread presenting frames for the display) which never blocks, readers
+// can run concurrently from any thread and retry slots which are being
+// overwritten while they are copied.
+class FrameStatisticsRing {
+ public:
+  FrameStatisticsRing();
+  FrameStatisticsRing(const FrameStatisticsRing& rhs) = delete;
+  FrameStatisticsRing& operator=(const FrameStatisticsRing& rhs) = delete;
+
+  // Writer side.
+  void Record(const HwcFrameStatistics& stats);
+
+  // Copies all frames still in the ring with frame_number greater than
+  // since_frame to frames, oldest first.
+  void Read(uint64_t since_frame, std::vector<HwcFrameStatistics>* frames);
+
+ private:
+  struct Slot {
+    // Odd while the slot is being written.
+    std::atomic<uint32_t> sequence_;
+    HwcFrameStatistics stats_;
+  };
+
+  Slot slots_[FRAME_STATISTICS_RING_SIZE];
+  // Total number of frames recorded so far.
+  std::atomic<uint64_t> total_frames_;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_DISPLAY_FRAMESTATISTICS_H_
@@ -0,0 +1,159 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "layerupdatetracker.h"
+
+#include "overlaylayer.h"
+
+namespace hwcomposer {
+
+// Update rate is averaged over roughly this many frames.
+#define LAYER_UPDATE_RATE_SHIFT 4
+// Update rate, out of 256, above which a layer is considered dynamic.
+#define LAYER_DYNAMIC_UPDATE_RATE 128
+
+void LayerUpdateTracker::BeginFrame() {
+  current_.clear();
+}
+
+bool LayerUpdateTracker::TrackLayer(const HwcLayer* source,
+                                    OverlayLayer* layer) {
+  // Layers mostly keep their z order between frames, check the entry at
+  // the same position first.
+  size_t index = current_.size();
+  const Entry* previous = NULL;
+  if (index < entries_.size() && entries_[index].source_ == source) {
+    previous = &entries_[index];
+  } else {
+    for (const Entry& entry : entries_) {
+      if (entry.source_ == source) {
+        previous = &entry;
+        break;
+      }
+    }
+  }
+
+  current_.emplace_back();
+  Entry& entry = current_.back();
+  if (previous)
+    entry = *previous;
+
+  entry.source_ = source;
+  // New layers count as changed.
+  bool changed = !previous || layer->HasLayerContentChanged() ||
+                 layer->NeedsRevalidation();
+  entry.update_rate_ -= entry.update_rate_ >> LAYER_UPDATE_RATE_SHIFT;
+  if (changed) {
+    entry.update_rate_ += 256 >> LAYER_UPDATE_RATE_SHIFT;
+    entry.frames_unchanged_ = 0;
+  } else {
+    entry.frames_unchanged_++;
+  }
+
+  HwcLayerUpdateClass update_class = kLayerUpdateOccasional;
+  if (entry.frames_unchanged_ >= LAYER_STATIC_FRAMES) {
+    update_class = kLayerUpdateStatic;
+  } else if (entry.update_rate_ >= LAYER_DYNAMIC_UPDATE_RATE) {
+    update_class = kLayerUpdateDynamic;
+  }
+
+  // Cursor and video layers always get planes of their own.
+  bool can_freeze = !layer->IsCursorLayer() && !layer->IsVideoLayer();
+  layer->SetStaticContent(can_freeze && update_class == kLayerUpdateStatic);
+
+  bool revalidate = false;
+  if (can_freeze && update_class != entry.update_class_) {
+    revalidate = update_class == kLayerUpdateStatic ||
+                 (entry.frozen_ && update_class == kLayerUpdateDynamic);
+  }
+
+  entry.update_class_ = update_class;
+  return revalidate;
+}
+
+void LayerUpdateTracker::EndFrame(const std::vector<OverlayLayer>& layers,
+                                  const DisplayPlaneStateList& composition,
+                                  HwcFrameStatistics* stats) {
+  uint32_t static_layers = 0;
+  for (Entry& entry : current_) {
+    entry.frozen_ = false;
+    if (entry.update_class_ == kLayerUpdateStatic)
+      static_layers++;
+  }
+
+  // Off-screen planes of static layers only, which weren't redrawn.
+  uint32_t frozen_planes = 0;
+  uint64_t frozen_pixels = 0;
+  for (const DisplayPlaneState& plane : composition) {
+    if (!plane.NeedsOffScreenComposition() || !plane.SurfaceRecycled())
+      continue;
+
+    const std::vector<size_t>& source_layers = plane.GetSourceLayers();
+    bool frozen = !source_layers.empty();
+    for (size_t index : source_layers) {
+      if (index >= layers.size() || !layers[index].HasStaticContent()) {
+        frozen = false;
+        break;
+      }
+    }
+
+    if (!frozen)
+      continue;
+
+    for (size_t index : source_layers) {
+      if (index < current_.size())
+        current_[index].frozen_ = true;
+    }
+
+    const HwcRect<int>& frame = plane.GetDisplayFrame();
+    frozen_planes++;
+    frozen_pixels += static_cast<uint64_t>(frame.right - frame.left) *
+                     (frame.bottom - frame.top);
+  }
+
+  if (stats) {
+    stats->static_layers = static_layers;
+    stats->frozen_planes = frozen_planes;
+    stats->frozen_pixels = frozen_pixels;
+  }
+
+  entries_.swap(current_);
+  current_.clear();
+
+  std::vector<HwcLayerStatistics> statistics;
+  statistics.reserve(entries_.size());
+  for (size_t i = 0; i < entries_.size(); i++) {
+    const Entry& entry = entries_[i];
+    statistics.emplace_back();
+    HwcLayerStatistics& layer = statistics.back();
+    layer.z_order = i;
+    layer.update_class = entry.update_class_;
+    layer.frames_unchanged = entry.frames_unchanged_;
+    layer.update_rate = (entry.update_rate_ * 100) >> 8;
+    layer.frozen = entry.frozen_;
+  }
+
+  ScopedSpinLock lock(lock_);
+  statistics_.swap(statistics);
+}
+
+void LayerUpdateTracker::GetStatistics(
+    std::vector<HwcLayerStatistics>* layers) {
+  ScopedSpinLock lock(lock_);
+  *layers = statistics_;
+}
+
+}  // namespace hwcomposer
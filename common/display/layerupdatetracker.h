@@ -0,0 +1,91 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_DISPLAY_LAYERUPDATETRACKER_H_
+#define COMMON_DISPLAY_LAYERUPDATETRACKER_H_
+
+#include <stdint.h>
+
+#include <hwcdefs.h>
+#include <spinlock.h>
+
+#include <vector>
+
+#include "displayplanestate.h"
+
+namespace hwcomposer {
+
+struct HwcLayer;
+struct OverlayLayer;
+
+// Frames a layer needs to stay unchanged before it is considered static.
+#define LAYER_STATIC_FRAMES 60
+
+// LayerUpdateTracker follows how often the content of each layer changes,
+// i.e. it gets a new buffer, damage or needs to be re-validated. Layers
+// are told apart by the HwcLayer backing them.
+//
+// Layers which haven't changed for LAYER_STATIC_FRAMES are marked static,
+// DisplayPlaneManager composites neighbouring static layers into one
+// plane when there aren't enough planes for all layers. That plane only
+// gets redrawn when one of its layers changes, see
+// DisplayQueue::GetCachedLayers, which leaves the other planes to layers
+// which do change.
+class LayerUpdateTracker {
+ public:
+  LayerUpdateTracker() = default;
+  LayerUpdateTracker(const LayerUpdateTracker& rhs) = delete;
+  LayerUpdateTracker& operator=(const LayerUpdateTracker& rhs) = delete;
+
+  // Should be called before the layers of a frame are tracked.
+  void BeginFrame();
+
+  // Tracks layer of the frame being prepared, in z order, and marks it
+  // static if it hasn't changed for a while. Returns true if planes
+  // should be validated again as a result, i.e. the layer just became
+  // static or a layer which was frozen started to change frequently.
+  bool TrackLayer(const HwcLayer* source, OverlayLayer* layer);
+
+  // Should be called once composition of the frame is final. Forgets
+  // layers which weren't part of it and, if stats isn't NULL, adds
+  // counters of static layers and frozen planes to stats.
+  void EndFrame(const std::vector<OverlayLayer>& layers,
+                const DisplayPlaneStateList& composition,
+                HwcFrameStatistics* stats);
+
+  // Can be called from any thread.
+  void GetStatistics(std::vector<HwcLayerStatistics>* layers);
+
+ private:
+  struct Entry {
+    const HwcLayer* source_ = NULL;
+    uint32_t frames_unchanged_ = 0;
+    // Exponential average of frames the layer changed in, out of 256.
+    uint32_t update_rate_ = 0;
+    HwcLayerUpdateClass update_class_ = kLayerUpdateOccasional;
+    bool frozen_ = false;
+  };
+
+  // Layers of the last frame and of the one being prepared, in z order.
+  std::vector<Entry> entries_;
+  std::vector<Entry> current_;
+
+  SpinLock lock_;
+  std::vector<HwcLayerStatistics> statistics_;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_DISPLAY_LAYERUPDATETRACKER_H_
@@ -0,0 +1,222 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "nativesurfacepool.h"
+
+#include <algorithm>
+
+#include "factory.h"
+#include "hwctrace.h"
+#include "nativesurface.h"
+#include "overlaybuffer.h"
+
+namespace hwcomposer {
+
+// Size classes are multiples of this in both directions, capped to the
+// display size.
+#define SURFACE_SIZE_CLASS_ALIGNMENT 256
+// Default limits, in full screen 32bpp surfaces. Three planes triple
+// buffered plus a cursor plane fit in the total limit.
+#define SURFACE_POOL_TOTAL_SURFACES 12
+#define SURFACE_POOL_IDLE_SURFACES 2
+
+NativeSurfacePool::~NativeSurfacePool() {
+  Clear();
+}
+
+void NativeSurfacePool::Initialize(ResourceManager *resource_manager,
+                                   uint32_t max_width, uint32_t max_height) {
+  resource_manager_ = resource_manager;
+  max_width_ = max_width;
+  max_height_ = max_height;
+  size_t full_screen = static_cast<size_t>(max_width) * max_height * 4;
+  SetMemoryLimits(full_screen * SURFACE_POOL_TOTAL_SURFACES,
+                  full_screen * SURFACE_POOL_IDLE_SURFACES);
+}
+
+void NativeSurfacePool::SetMemoryLimits(size_t total_bytes,
+                                        size_t idle_bytes) {
+  total_limit_ = total_bytes;
+  idle_limit_ = std::min(idle_bytes, total_bytes);
+}
+
+void NativeSurfacePool::GetSizeClass(uint32_t width, uint32_t height,
+                                     uint32_t *class_width,
+                                     uint32_t *class_height) const {
+  uint32_t align = SURFACE_SIZE_CLASS_ALIGNMENT;
+  *class_width = std::min(max_width_, ((width + align - 1) / align) * align);
+  *class_height =
+      std::min(max_height_, ((height + align - 1) / align) * align);
+}
+
+NativeSurface *NativeSurfacePool::Acquire(
+    uint32_t width, uint32_t height, uint32_t format,
+    const std::vector<uint64_t> &modifiers, bool video) {
+  uint32_t class_width = 0;
+  uint32_t class_height = 0;
+  GetSizeClass(width, height, &class_width, &class_height);
+
+  Entry *match = NULL;
+  for (Entry &entry : entries_) {
+    NativeSurface *surface = entry.surface_.get();
+    if (surface->GetSurfaceAge() != -1 || entry.video_ != video ||
+        entry.format_ != format ||
+        static_cast<uint32_t>(surface->GetWidth()) != class_width ||
+        static_cast<uint32_t>(surface->GetHeight()) != class_height)
+      continue;
+
+    // Surfaces may have been allocated for another plane, make sure
+    // this one can scan out their layout.
+    if (entry.modifier_ && !modifiers.empty() &&
+        std::find(modifiers.begin(), modifiers.end(), entry.modifier_) ==
+            modifiers.end())
+      continue;
+
+    // Prefer the most recently used surface, its memory is more likely
+    // to still be resident in caches and page tables.
+    if (!match || entry.last_used_ > match->last_used_)
+      match = &entry;
+  }
+
+  if (match) {
+    hits_++;
+    match->last_used_ = ++use_counter_;
+    UpdateResidentStatistics();
+    return match->surface_.get();
+  }
+
+  misses_++;
+  NativeSurface *surface = NULL;
+  uint32_t usage = hwcomposer::kLayerNormal;
+  if (video) {
+    surface = CreateVideoBuffer(class_width, class_height);
+    usage = hwcomposer::kLayerVideo;
+  } else {
+    surface = Create3DBuffer(class_width, class_height);
+  }
+
+  if (!surface)
+    return NULL;
+
+  if (!surface->Init(resource_manager_, format, usage, modifiers)) {
+    ETRACE("NativeSurfacePool: Failed to allocate %dx%d surface.",
+           class_width, class_height);
+    delete surface;
+    return NULL;
+  }
+
+  // Estimate of the memory backing the surface, chroma and aux planes
+  // are at most half the height of the main plane.
+  OverlayBuffer *buffer = surface->GetLayer()->GetBuffer();
+  const uint32_t *pitches = buffer->GetPitches();
+  size_t bytes = static_cast<size_t>(pitches[0]) * class_height;
+  for (uint32_t i = 1; i < buffer->GetTotalPlanes(); i++)
+    bytes += static_cast<size_t>(pitches[i]) * ((class_height + 1) / 2);
+
+  entries_.emplace_back();
+  Entry &entry = entries_.back();
+  entry.surface_.reset(surface);
+  entry.format_ = format;
+  entry.modifier_ = buffer->GetModifier();
+  entry.bytes_ = bytes;
+  entry.last_used_ = ++use_counter_;
+  entry.video_ = video;
+  total_bytes_ += bytes;
+
+  if (total_bytes_ > total_limit_)
+    Evict(total_limit_, total_limit_);
+
+  UpdateResidentStatistics();
+  return surface;
+}
+
+void NativeSurfacePool::Trim() {
+  Evict(idle_limit_, total_limit_);
+  UpdateResidentStatistics();
+}
+
+bool NativeSurfacePool::TrimTo(size_t total_bytes) {
+  Evict(total_bytes, total_bytes);
+  UpdateResidentStatistics();
+  return total_bytes_ <= total_bytes;
+}
+
+void NativeSurfacePool::Clear() {
+  std::vector<Entry>().swap(entries_);
+  total_bytes_ = 0;
+  UpdateResidentStatistics();
+}
+
+void NativeSurfacePool::Evict(size_t free_limit, size_t total_limit) {
+  size_t free_bytes = 0;
+  std::vector<size_t> free_entries;
+  for (size_t i = 0; i < entries_.size(); i++) {
+    if (entries_[i].surface_->GetSurfaceAge() == -1) {
+      free_bytes += entries_[i].bytes_;
+      free_entries.emplace_back(i);
+    }
+  }
+
+  if (free_bytes <= free_limit && total_bytes_ <= total_limit)
+    return;
+
+  std::sort(free_entries.begin(), free_entries.end(),
+            [this](size_t lhs, size_t rhs) {
+              return entries_[lhs].last_used_ < entries_[rhs].last_used_;
+            });
+
+  std::vector<bool> evict(entries_.size(), false);
+  for (size_t index : free_entries) {
+    if (free_bytes <= free_limit && total_bytes_ <= total_limit)
+      break;
+
+    evict[index] = true;
+    free_bytes -= entries_[index].bytes_;
+    total_bytes_ -= entries_[index].bytes_;
+    evictions_++;
+  }
+
+  std::vector<Entry> entries;
+  entries.reserve(entries_.size());
+  for (size_t i = 0; i < entries_.size(); i++) {
+    if (!evict[i])
+      entries.emplace_back(std::move(entries_[i]));
+  }
+
+  entries_.swap(entries);
+#ifdef SURFACE_TRACING
+  if (total_bytes_ > total_limit) {
+    ISURFACETRACE(
+        "NativeSurfacePool: %zu bytes in use exceed limit of %zu bytes. \n",
+        total_bytes_, total_limit);
+  }
+#endif
+}
+
+void NativeSurfacePool::UpdateResidentStatistics() {
+  bytes_resident_ = total_bytes_;
+  surfaces_ = entries_.size();
+}
+
+void NativeSurfacePool::GetStatistics(HwcSurfacePoolStatistics *stats) const {
+  stats->hits = hits_;
+  stats->misses = misses_;
+  stats->evictions = evictions_;
+  stats->bytes_resident = bytes_resident_;
+  stats->surfaces = surfaces_;
+}
+
+}  // namespace hwcomposer
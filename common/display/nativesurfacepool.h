@@ -0,0 +1,124 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_DISPLAY_NATIVESURFACEPOOL_H_
+#define COMMON_DISPLAY_NATIVESURFACEPOOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <hwcdefs.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace hwcomposer {
+
+class NativeSurface;
+class ResourceManager;
+
+// Off-screen surfaces used as composition targets by all planes of a
+// display. Surfaces are bucketed by size class, format, modifier and
+// whether they are media targets, so a plane whose composition only
+// covers part of the screen can borrow a smaller surface and surfaces
+// freed by one plane can be picked up by another one.
+//
+// A surface is free once its age (see NativeSurface::SetSurfaceAge) is
+// -1. Free surfaces are kept around for reuse and evicted least recently
+// used first, whenever the pool grows past its memory limit or when
+// Trim is called.
+class NativeSurfacePool {
+ public:
+  NativeSurfacePool() = default;
+  NativeSurfacePool(const NativeSurfacePool& rhs) = delete;
+  NativeSurfacePool& operator=(const NativeSurfacePool& rhs) = delete;
+
+  ~NativeSurfacePool();
+
+  // max_width, max_height is the display size, which is also the largest
+  // size class. Resets memory limits to their defaults for that size.
+  void Initialize(ResourceManager* resource_manager, uint32_t max_width,
+                  uint32_t max_height);
+
+  // total_bytes caps the memory held by the pool, free surfaces are
+  // evicted to stay below it but surfaces in use never are. idle_bytes
+  // is how much memory free surfaces may keep after Trim.
+  void SetMemoryLimits(size_t total_bytes, size_t idle_bytes);
+
+  // Returns a surface of at least width x height, rounded up to the size
+  // class, with format and one of modifiers as layout. An empty
+  // modifiers list accepts any layout. Returns NULL if no surface could
+  // be allocated.
+  NativeSurface* Acquire(uint32_t width, uint32_t height, uint32_t format,
+                         const std::vector<uint64_t>& modifiers, bool video);
+
+  // Evicts free surfaces, least recently used first, until free surfaces
+  // take at most idle_bytes.
+  void Trim();
+
+  // Evicts free surfaces, least recently used first, until the pool holds
+  // at most total_bytes. Returns false if surfaces in use take more.
+  bool TrimTo(size_t total_bytes);
+
+  // Deletes all surfaces, in use or not.
+  void Clear();
+
+  bool IsEmpty() const {
+    return entries_.empty();
+  }
+
+  // Rounds width, height up to the size class they fall in.
+  void GetSizeClass(uint32_t width, uint32_t height, uint32_t* class_width,
+                    uint32_t* class_height) const;
+
+  // Safe to call from any thread.
+  void GetStatistics(HwcSurfacePoolStatistics* stats) const;
+
+ private:
+  struct Entry {
+    std::unique_ptr<NativeSurface> surface_;
+    uint32_t format_ = 0;
+    uint64_t modifier_ = 0;
+    size_t bytes_ = 0;
+    uint64_t last_used_ = 0;
+    bool video_ = false;
+  };
+
+  // Evicts free surfaces, least recently used first, until at most
+  // free_limit bytes are held by free surfaces and total bytes are at
+  // most total_limit.
+  void Evict(size_t free_limit, size_t total_limit);
+  void UpdateResidentStatistics();
+
+  std::vector<Entry> entries_;
+  ResourceManager* resource_manager_ = NULL;
+  uint32_t max_width_ = 0;
+  uint32_t max_height_ = 0;
+  size_t total_limit_ = 0;
+  size_t idle_limit_ = 0;
+  size_t total_bytes_ = 0;
+  uint64_t use_counter_ = 0;
+
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> evictions_{0};
+  std::atomic<uint64_t> bytes_resident_{0};
+  std::atomic<uint32_t> surfaces_{0};
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_DISPLAY_NATIVESURFACEPOOL_H_
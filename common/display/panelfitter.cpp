@@ -0,0 +1,231 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "panelfitter.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace hwcomposer {
+
+namespace {
+
+// Turns the parts of a display frame clipped on each side, left, top,
+// right and bottom as fractions of the frame, into the parts of the
+// source crop they show. Buffers are flipped before being rotated.
+void ClippedSource(uint32_t transform, const float display[4],
+                   float source[4]) {
+  float left = display[0];
+  float top = display[1];
+  float right = display[2];
+  float bottom = display[3];
+  if (transform & kTransform90) {
+    // Source left edge ends up at the top, its top edge at the right.
+    source[0] = top;
+    source[1] = right;
+    source[2] = bottom;
+    source[3] = left;
+  } else if (transform & kTransform180) {
+    source[0] = right;
+    source[1] = bottom;
+    source[2] = left;
+    source[3] = top;
+  } else if (transform & kTransform270) {
+    source[0] = bottom;
+    source[1] = left;
+    source[2] = top;
+    source[3] = right;
+  } else {
+    source[0] = left;
+    source[1] = top;
+    source[2] = right;
+    source[3] = bottom;
+  }
+
+  if (transform & kReflectX)
+    std::swap(source[0], source[2]);
+
+  if (transform & kReflectY)
+    std::swap(source[1], source[3]);
+}
+
+}  // namespace
+
+bool PanelFitter::SetDisplaySize(uint32_t width, uint32_t height) {
+  if (display_width_ == width && display_height_ == height)
+    return false;
+
+  display_width_ = width;
+  display_height_ = height;
+  Update();
+  return true;
+}
+
+bool PanelFitter::SetContentSize(uint32_t width, uint32_t height) {
+  if (content_width_ == width && content_height_ == height)
+    return false;
+
+  content_width_ = width;
+  content_height_ = height;
+  Update();
+  return true;
+}
+
+bool PanelFitter::SetScalingMode(HWCDisplayScaling mode) {
+  if (scaling_mode_ == mode)
+    return false;
+
+  scaling_mode_ = mode;
+  Update();
+  return true;
+}
+
+bool PanelFitter::SetOverscan(int32_t x_overscan, int32_t y_overscan) {
+  x_overscan = std::max(std::min(x_overscan, PANEL_FITTER_MAX_OVERSCAN),
+                        -PANEL_FITTER_MAX_OVERSCAN);
+  y_overscan = std::max(std::min(y_overscan, PANEL_FITTER_MAX_OVERSCAN),
+                        -PANEL_FITTER_MAX_OVERSCAN);
+  if (x_overscan_ == x_overscan && y_overscan_ == y_overscan)
+    return false;
+
+  x_overscan_ = x_overscan;
+  y_overscan_ = y_overscan;
+  Update();
+  return true;
+}
+
+void PanelFitter::Update() {
+  uint32_t content_width = content_width_ ? content_width_ : display_width_;
+  uint32_t content_height =
+      content_height_ ? content_height_ : display_height_;
+  scale_x_ = 1.0;
+  scale_y_ = 1.0;
+  offset_x_ = 0;
+  offset_y_ = 0;
+  destination_ = HwcRect<int>(0, 0, display_width_, display_height_);
+  identity_ = true;
+  if (!display_width_ || !display_height_ || !content_width ||
+      !content_height)
+    return;
+
+  float display_width = display_width_;
+  float display_height = display_height_;
+  float width = display_width;
+  float height = display_height;
+  switch (scaling_mode_) {
+    case HWCDisplayScaling::kScaleCentre:
+      width = content_width;
+      height = content_height;
+      break;
+    case HWCDisplayScaling::kScaleFit: {
+      float scale = std::min(display_width / content_width,
+                             display_height / content_height);
+      width = content_width * scale;
+      height = content_height * scale;
+      break;
+    }
+    case HWCDisplayScaling::kScaleFill: {
+      float scale = std::max(display_width / content_width,
+                             display_height / content_height);
+      width = content_width * scale;
+      height = content_height * scale;
+      break;
+    }
+    case HWCDisplayScaling::kScaleStretch:
+    default:
+      break;
+  }
+
+  float range =
+      PANEL_FITTER_OVERSCAN_RANGE / (100.0f * PANEL_FITTER_MAX_OVERSCAN);
+  width -= display_width * x_overscan_ * range;
+  height -= display_height * y_overscan_ * range;
+  scale_x_ = width / content_width;
+  scale_y_ = height / content_height;
+  offset_x_ = (display_width - width) / 2;
+  offset_y_ = (display_height - height) / 2;
+  destination_ = HwcRect<int>(MapX(0), MapY(0), MapX(content_width),
+                              MapY(content_height));
+  identity_ = content_width == display_width_ &&
+              content_height == display_height_ &&
+              destination_ ==
+                  HwcRect<int>(0, 0, display_width_, display_height_);
+}
+
+int32_t PanelFitter::MapX(float x) const {
+  return static_cast<int32_t>(floorf(offset_x_ + x * scale_x_ + 0.5f));
+}
+
+int32_t PanelFitter::MapY(float y) const {
+  return static_cast<int32_t>(floorf(offset_y_ + y * scale_y_ + 0.5f));
+}
+
+bool PanelFitter::MapLayer(uint32_t transform, HwcRect<int>* display_frame,
+                           HwcRect<float>* source_crop) const {
+  if (identity_)
+    return true;
+
+  // Edges are rounded on their own, so that layers next to each other
+  // stay so.
+  HwcRect<int> frame(MapX(display_frame->left), MapY(display_frame->top),
+                     MapX(display_frame->right), MapY(display_frame->bottom));
+  int32_t width = frame.right - frame.left;
+  int32_t height = frame.bottom - frame.top;
+  HwcRect<int> clipped(
+      std::max(frame.left, 0), std::max(frame.top, 0),
+      std::min(frame.right, static_cast<int32_t>(display_width_)),
+      std::min(frame.bottom, static_cast<int32_t>(display_height_)));
+  if (width <= 0 || height <= 0 || clipped.right <= clipped.left ||
+      clipped.bottom <= clipped.top)
+    return false;
+
+  *display_frame = clipped;
+  if (clipped == frame)
+    return true;
+
+  float display[4] = {
+      static_cast<float>(clipped.left - frame.left) / width,
+      static_cast<float>(clipped.top - frame.top) / height,
+      static_cast<float>(frame.right - clipped.right) / width,
+      static_cast<float>(frame.bottom - clipped.bottom) / height};
+  float source[4];
+  ClippedSource(transform, display, source);
+  float source_width = source_crop->right - source_crop->left;
+  float source_height = source_crop->bottom - source_crop->top;
+  source_crop->left += source[0] * source_width;
+  source_crop->top += source[1] * source_height;
+  source_crop->right -= source[2] * source_width;
+  source_crop->bottom -= source[3] * source_height;
+  return true;
+}
+
+HwcRect<int> PanelFitter::MapRect(const HwcRect<int>& rect) const {
+  if (identity_)
+    return rect;
+
+  HwcRect<int> mapped(
+      std::max(MapX(rect.left), 0), std::max(MapY(rect.top), 0),
+      std::min(MapX(rect.right), static_cast<int32_t>(display_width_)),
+      std::min(MapY(rect.bottom), static_cast<int32_t>(display_height_)));
+  if (mapped.right <= mapped.left || mapped.bottom <= mapped.top)
+    mapped.reset();
+
+  return mapped;
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,92 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_DISPLAY_PANEL_FITTER_H_
+#define COMMON_DISPLAY_PANEL_FITTER_H_
+
+#include <stdint.h>
+
+#include <hwcdefs.h>
+
+namespace hwcomposer {
+
+// Overscan is set in the range +/-PANEL_FITTER_MAX_OVERSCAN. The limit
+// shrinks or zooms content by PANEL_FITTER_OVERSCAN_RANGE percent of the
+// display size.
+#define PANEL_FITTER_MAX_OVERSCAN 100
+#define PANEL_FITTER_OVERSCAN_RANGE 15
+
+// PanelFitter lays out content on a display of a different size, or
+// with overscan compensation. Layers are mapped one by one to the area
+// of the display content is scaled to and clipped to the display, so
+// that the display planes scale them while scanning out and layers keep
+// their planes.
+class PanelFitter {
+ public:
+  PanelFitter() = default;
+
+  // Setters return true if the layout of content changed. Content of
+  // size 0 is as large as the display.
+  bool SetDisplaySize(uint32_t width, uint32_t height);
+  bool SetContentSize(uint32_t width, uint32_t height);
+  bool SetScalingMode(HWCDisplayScaling mode);
+  // Values are clamped to +/-PANEL_FITTER_MAX_OVERSCAN. Positive ones
+  // shrink content, negative ones zoom into it.
+  bool SetOverscan(int32_t x_overscan, int32_t y_overscan);
+
+  // Returns true if content is shown as is.
+  bool IsIdentity() const {
+    return identity_;
+  }
+
+  // Area of the display content is scaled to, it's larger than the
+  // display when content is cropped.
+  const HwcRect<int>& GetDestination() const {
+    return destination_;
+  }
+
+  // Maps display_frame of a layer shown with transform to the display
+  // and clips it to the display. source_crop is cropped by the part of
+  // the layer clipped. Returns false if no part of the layer is left on
+  // the display.
+  bool MapLayer(uint32_t transform, HwcRect<int>* display_frame,
+                HwcRect<float>* source_crop) const;
+
+  // Maps rect to the display and clips it to the display.
+  HwcRect<int> MapRect(const HwcRect<int>& rect) const;
+
+ private:
+  void Update();
+  int32_t MapX(float x) const;
+  int32_t MapY(float y) const;
+
+  uint32_t display_width_ = 0;
+  uint32_t display_height_ = 0;
+  uint32_t content_width_ = 0;
+  uint32_t content_height_ = 0;
+  HWCDisplayScaling scaling_mode_ = HWCDisplayScaling::kScaleStretch;
+  int32_t x_overscan_ = 0;
+  int32_t y_overscan_ = 0;
+  float scale_x_ = 1.0;
+  float scale_y_ = 1.0;
+  float offset_x_ = 0;
+  float offset_y_ = 0;
+  HwcRect<int> destination_;
+  bool identity_ = true;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_DISPLAY_PANEL_FITTER_H_
@@ -0,0 +1,141 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "refreshrategovernor.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "hwctrace.h"
+
+namespace hwcomposer {
+
+// Common content frame rates. Estimated cadence is snapped to one of
+// these, anything else is treated as unknown.
+static const float kContentRates[] = {23.976f, 24.0f, 25.0f,  29.97f, 30.0f,
+                                      48.0f,   50.0f, 59.94f, 60.0f};
+// Maximum difference allowed when matching cadence to a content rate.
+static const float kCadenceTolerance = 0.02f;
+// Gap between two video frames after which we restart estimation,
+// i.e. playback was paused or seeked.
+static const int64_t kMaxFrameIntervalUs = 100000;
+
+void RefreshRateGovernor::UpdateVideoState(int64_t session_id,
+                                           bool is_prepared) {
+  ScopedSpinLock lock(lock_);
+  if (is_prepared) {
+    video_sessions_.emplace(session_id, 0);
+  } else {
+    video_sessions_.erase(session_id);
+  }
+}
+
+void RefreshRateGovernor::UpdateVideoFPS(int64_t session_id, int32_t fps) {
+  ScopedSpinLock lock(lock_);
+  video_sessions_[session_id] = std::max(fps, 0);
+}
+
+bool RefreshRateGovernor::HasVideoSessions() {
+  ScopedSpinLock lock(lock_);
+  return !video_sessions_.empty();
+}
+
+void RefreshRateGovernor::FramePresented(bool has_video_layer) {
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (!has_video_layer) {
+    total_intervals_ = 0;
+    interval_index_ = 0;
+    last_present_ = std::chrono::steady_clock::time_point();
+    return;
+  }
+
+  if (last_present_ != std::chrono::steady_clock::time_point()) {
+    int64_t interval = std::chrono::duration_cast<std::chrono::microseconds>(
+                           now - last_present_)
+                           .count();
+    if (interval > kMaxFrameIntervalUs) {
+      total_intervals_ = 0;
+      interval_index_ = 0;
+    } else {
+      intervals_[interval_index_] = interval;
+      interval_index_ = (interval_index_ + 1) % REFRESH_GOVERNOR_CADENCE_SAMPLES;
+      if (total_intervals_ < REFRESH_GOVERNOR_CADENCE_SAMPLES)
+        total_intervals_++;
+    }
+  }
+
+  last_present_ = now;
+}
+
+float RefreshRateGovernor::EstimateCadence() const {
+  if (total_intervals_ < REFRESH_GOVERNOR_CADENCE_SAMPLES)
+    return 0;
+
+  // Frames are presented on vsync, so single intervals alternate between
+  // multiples of the refresh period, e.g. 33ms and 50ms for 24fps at
+  // 60Hz. Their mean over the whole window matches the content rate.
+  int64_t span = 0;
+  for (int64_t interval : intervals_)
+    span += interval;
+
+  if (span <= 0)
+    return 0;
+
+  float cadence =
+      1000000.0f * REFRESH_GOVERNOR_CADENCE_SAMPLES / static_cast<float>(span);
+  // Rates like 23.976 and 24 are within tolerance of each other, take
+  // the closest one.
+  float best_rate = 0;
+  for (float rate : kContentRates) {
+    if (std::fabs(cadence - rate) <= rate * kCadenceTolerance &&
+        (best_rate == 0 ||
+         std::fabs(cadence - rate) < std::fabs(cadence - best_rate)))
+      best_rate = rate;
+  }
+
+  return best_rate;
+}
+
+bool RefreshRateGovernor::ContentRateChanged(float *rate) {
+  float content_rate = 0;
+  lock_.lock();
+  for (const std::pair<const int64_t, int32_t> &session : video_sessions_) {
+    content_rate = std::max(content_rate, static_cast<float>(session.second));
+  }
+  lock_.unlock();
+
+  // No hints from media framework, rely on what we observe.
+  if (content_rate == 0)
+    content_rate = EstimateCadence();
+
+  if (content_rate == current_rate_)
+    return false;
+
+  IDISPLAYMANAGERTRACE("Content rate changed from %f to %f", current_rate_,
+                       content_rate);
+  current_rate_ = content_rate;
+  *rate = content_rate;
+  return true;
+}
+
+void RefreshRateGovernor::Reset() {
+  total_intervals_ = 0;
+  interval_index_ = 0;
+  last_present_ = std::chrono::steady_clock::time_point();
+  current_rate_ = 0;
+}
+
+}  // namespace hwcomposer
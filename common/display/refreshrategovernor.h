@@ -0,0 +1,70 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_DISPLAY_REFRESH_RATE_GOVERNOR_H_
+#define COMMON_DISPLAY_REFRESH_RATE_GOVERNOR_H_
+
+#include <stdint.h>
+
+#include <spinlock.h>
+
+#include <chrono>
+#include <map>
+
+namespace hwcomposer {
+
+// Number of video frames used to estimate present cadence.
+#define REFRESH_GOVERNOR_CADENCE_SAMPLES 32
+
+// RefreshRateGovernor tracks the rate at which content is updated
+// while video is being played. Frame rate hints provided by media
+// framework take precedence, otherwise the rate is estimated from
+// the cadence at which frames with video layers are presented.
+class RefreshRateGovernor {
+ public:
+  RefreshRateGovernor() = default;
+
+  void UpdateVideoState(int64_t session_id, bool is_prepared);
+  void UpdateVideoFPS(int64_t session_id, int32_t fps);
+
+  // Returns true while media framework reports video being played.
+  bool HasVideoSessions();
+
+  // Should be called for every frame being presented.
+  void FramePresented(bool has_video_layer);
+
+  // Returns true if content rate has changed since last call. rate
+  // is set to the content rate in frames per second, 0 in case we
+  // don't have any video content to track.
+  bool ContentRateChanged(float *rate);
+
+  void Reset();
+
+ private:
+  float EstimateCadence() const;
+
+  SpinLock lock_;
+  // Frame rate hint for active video sessions, 0 if not known yet.
+  std::map<int64_t, int32_t> video_sessions_;
+  std::chrono::steady_clock::time_point last_present_;
+  int64_t intervals_[REFRESH_GOVERNOR_CADENCE_SAMPLES];
+  uint32_t total_intervals_ = 0;
+  uint32_t interval_index_ = 0;
+  float current_rate_ = 0;
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_DISPLAY_REFRESH_RATE_GOVERNOR_H_
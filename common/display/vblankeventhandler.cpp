@@ -16,6 +16,7 @@
 
 #include "vblankeventhandler.h"
 
+#include <errno.h>
 #include <stdlib.h>
 #include <time.h>
 
@@ -92,18 +93,77 @@ void VblankEventHandler::HandlePageFlipEvent(unsigned int sec,
   IPAGEFLIPEVENTTRACE("Callback called from HandlePageFlipEvent. %lu",
                       timestamp);
   spin_lock_.lock();
+  if (last_vblank_ > 0 && timestamp > last_vblank_) {
+    // We might have missed vblanks while this thread wasn't scheduled,
+    // only let the estimate grow when longer intervals keep repeating
+    // (i.e. refresh rate was lowered).
+    int64_t interval = timestamp - last_vblank_;
+    if (vblank_period_ == 0 || interval < vblank_period_ * 3 / 2 ||
+        ++long_vblank_intervals_ > 3) {
+      vblank_period_ = interval;
+      long_vblank_intervals_ = 0;
+    }
+  }
+
+  last_vblank_ = timestamp;
   if (enabled_ && callback_) {
     callback_->Callback(display_, timestamp);
   }
   spin_lock_.unlock();
 }
 
+void VblankEventHandler::GetVblankTiming(int64_t* last_vblank,
+                                         int64_t* period) {
+  spin_lock_.lock();
+  *last_vblank = last_vblank_;
+  *period = vblank_period_;
+  spin_lock_.unlock();
+}
+
+void VblankEventHandler::PeriodChanged(int64_t period) {
+  spin_lock_.lock();
+  vblank_period_ = period;
+  long_vblank_intervals_ = 0;
+  std::shared_ptr<VsyncCallback> callback = callback_;
+  uint32_t display = display_;
+  spin_lock_.unlock();
+
+  // Outside the lock, callback may ask for the vblank timing.
+  if (callback)
+    callback->PeriodChanged(display, period);
+}
+
+void VblankEventHandler::SetSimulatedPeriod(int64_t period) {
+  spin_lock_.lock();
+  simulated_period_ = period;
+  spin_lock_.unlock();
+}
+
 void VblankEventHandler::HandleWait() {
 }
 
 void VblankEventHandler::HandleRoutine() {
   queue_->HandleIdleCase();
 
+  spin_lock_.lock();
+  int64_t period = simulated_period_;
+  spin_lock_.unlock();
+  if (period > 0) {
+    // Simulated vblanks happen on multiples of period, so that anyone
+    // else simulating scanout with the same period stays in phase.
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t now = (int64_t)ts.tv_sec * kOneSecondNs + ts.tv_nsec;
+    int64_t next = (now / period + 1) * period;
+    ts.tv_sec = next / kOneSecondNs;
+    ts.tv_nsec = next % kOneSecondNs;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+      ;
+
+    HandlePageFlipEvent(ts.tv_sec, ts.tv_nsec / 1000);
+    return;
+  }
+
   drmVBlank vblank;
   memset(&vblank, 0, sizeof(vblank));
   vblank.request.sequence = 1;
@@ -47,6 +47,19 @@ class VblankEventHandler : public HWCThread {
 
   int VSyncControl(bool enabled);
 
+  // Timestamp of the last vblank seen and the estimated vblank period,
+  // both in ns. Values are zero if not known yet.
+  void GetVblankTiming(int64_t* last_vblank, int64_t* period);
+
+  // Generate vblanks every period ns instead of waiting for them on the
+  // DRM device, for displays which are not backed by a CRTC. Pass 0 to
+  // go back to DRM vblanks.
+  void SetSimulatedPeriod(int64_t period);
+
+  // Tells the callback about a new vblank period in ns, which also
+  // replaces the current estimate.
+  void PeriodChanged(int64_t period);
+
  protected:
   void HandleRoutine() override;
   void HandleWait() override;
@@ -62,6 +75,10 @@ class VblankEventHandler : public HWCThread {
 
   int fd_;
   int64_t last_timestamp_;
+  int64_t last_vblank_ = 0;
+  int64_t vblank_period_ = 0;
+  uint32_t long_vblank_intervals_ = 0;
+  int64_t simulated_period_ = 0;
   drmVBlankSeqType type_;
   DisplayQueue* queue_;
 };
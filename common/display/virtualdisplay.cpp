@@ -26,6 +26,7 @@
 
 #include "hwctrace.h"
 #include "overlaylayer.h"
+#include "sharedfence.h"
 
 #include "hwcutils.h"
 
@@ -144,14 +145,28 @@ bool VirtualDisplay::Present(std::vector<HwcLayer *> &source_layers,
     acquire_fence_ = 0;
 
     in_flight_layers_.swap(layers);
+    if (frame_capture_.IsActive()) {
+      OverlayLayer output_layer;
+      output_layer.SetBuffer(output_handle_, -1, resource_manager_.get(),
+                             true);
+      output_layer.SetSourceCrop(HwcRect<float>(0, 0, width_, height_));
+      output_layer.SetDisplayFrame(HwcRect<int>(0, 0, width_, height_));
+      std::vector<const OverlayLayer *> capture_layers(1, &output_layer);
+      frame_capture_.CaptureFrame(
+          &compositor_, capture_layers,
+          *retire_fence > 0 ? dup(*retire_fence) : -1);
+    }
   }
 
   int32_t fence = *retire_fence;
 
   if (fence > 0) {
+    std::shared_ptr<SharedFence> release_fence =
+        std::make_shared<SharedFence>(dup(fence));
     for (size_t layer_index = 0; layer_index < size; layer_index++) {
       HwcLayer* layer = source_layers.at(layer_index);
-      layer->SetReleaseFence(dup(fence));
+      layer->SetReleaseFence(-1);
+      layer->AddReleaseFence(release_fence);
     }
   } else {
     for (size_t layer_index = 0; layer_index < size; layer_index++) {
@@ -278,4 +293,20 @@ bool VirtualDisplay::CheckPlaneFormat(uint32_t /*format*/) {
   return true;
 }
 
+bool VirtualDisplay::StartFrameCapture(uint32_t frames,
+                                       const char *directory) {
+  return frame_capture_.Start(resource_manager_.get(), width_, height_, frames,
+                              directory);
+}
+
+bool VirtualDisplay::GetFrameCaptureStatistics(
+    HwcFrameCaptureStatistics *stats) {
+  frame_capture_.GetStatistics(stats);
+  return true;
+}
+
+void VirtualDisplay::TakeCapturedFrames(std::vector<HwcCapturedFrame> *frames) {
+  frame_capture_.TakeFrames(frames);
+}
+
 }  // namespace hwcomposer
@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "compositor.h"
+#include "framecapture.h"
 #include "resourcemanager.h"
 
 namespace hwcomposer {
@@ -78,6 +79,9 @@ class VirtualDisplay : public NativeDisplay {
 
   void VSyncControl(bool enabled) override;
   bool CheckPlaneFormat(uint32_t format) override;
+  bool StartFrameCapture(uint32_t frames, const char *directory) override;
+  bool GetFrameCaptureStatistics(HwcFrameCaptureStatistics *stats) override;
+  void TakeCapturedFrames(std::vector<HwcCapturedFrame> *frames) override;
 
  private:
   HWCNativeHandle output_handle_;
@@ -88,6 +92,8 @@ class VirtualDisplay : public NativeDisplay {
   std::vector<OverlayLayer> in_flight_layers_;
   HWCNativeHandle handle_ = 0;
   std::unique_ptr<ResourceManager> resource_manager_;
+  // Last, see DisplayQueue::frame_capture_.
+  FrameCapture frame_capture_;
 };
 
 }  // namespace hwcomposer
@@ -26,6 +26,7 @@
 #include <time.h>
 
 #include "displayplane.h"
+#include "hwctracebuffer.h"
 #include "platformdefines.h"
 
 #ifdef _cplusplus
@@ -43,6 +44,17 @@ extern "C" {
 // #define SURFACE_DUPLICATE_LAYER_TRACING 1
 // #define SURFACE_BASIC_TRACING 1
 // #define COMPOSITOR_TRACING 1
+// #define ENABLE_STARTUP_TIMING_TRACING 1
+
+// Tracing macros which are not enabled above still go to the runtime
+// binary trace backend (see hwctracebuffer.h). Only the format string and
+// first two integer arguments are recorded and nothing is evaluated unless
+// the category has been enabled.
+#define HWC_TRACE_EVENT(category, fmt, ...)                         \
+  do {                                                              \
+    if (hwcomposer::HwcTracer::IsEnabled(category))                 \
+      hwcomposer::TraceFormatEvent(category, fmt, ##__VA_ARGS__);   \
+  } while (0)
 
 // Function call tracing
 #ifdef FUNCTION_CALL_TRACING
@@ -68,7 +80,9 @@ class TraceFunc {
 };
 #define CTRACE() TraceFunc hwctrace(__func__);
 #else
-#define CTRACE()  STRACE()
+#define CTRACE() \
+  STRACE();      \
+  hwcomposer::HwcTraceScope hwctrace(hwcomposer::kTraceFunction, __func__)
 #endif
 
 // Arguments tracing
@@ -89,31 +103,43 @@ class TraceFunc {
 #ifdef ENABLE_PAGE_FLIP_EVENT_TRACING
 #define IPAGEFLIPEVENTTRACE ITRACE
 #else
-#define IPAGEFLIPEVENTTRACE(fmt, ...) ((void)0)
+#define IPAGEFLIPEVENTTRACE(fmt, ...) \
+  HWC_TRACE_EVENT(hwcomposer::kTracePageFlip, fmt, ##__VA_ARGS__)
 #endif
 
 #ifdef ENABLE_DISPLAY_MANAGER_TRACING
 #define IDISPLAYMANAGERTRACE ITRACE
 #else
-#define IDISPLAYMANAGERTRACE(fmt, ...) ((void)0)
+#define IDISPLAYMANAGERTRACE(fmt, ...) \
+  HWC_TRACE_EVENT(hwcomposer::kTraceDisplayManager, fmt, ##__VA_ARGS__)
 #endif
 
 #ifdef ENABLE_HOT_PLUG_EVENT_TRACING
 #define IHOTPLUGEVENTTRACE ITRACE
 #else
-#define IHOTPLUGEVENTTRACE(fmt, ...) ((void)0)
+#define IHOTPLUGEVENTTRACE(fmt, ...) \
+  HWC_TRACE_EVENT(hwcomposer::kTraceHotPlug, fmt, ##__VA_ARGS__)
 #endif
 
 #ifdef ENABLE_MOSAIC_DISPLAY_TRACING
 #define IMOSAICDISPLAYTRACE ITRACE
 #else
-#define IMOSAICDISPLAYTRACE(fmt, ...) ((void)0)
+#define IMOSAICDISPLAYTRACE(fmt, ...) \
+  HWC_TRACE_EVENT(hwcomposer::kTraceMosaic, fmt, ##__VA_ARGS__)
+#endif
+
+#ifdef ENABLE_STARTUP_TIMING_TRACING
+#define ISTARTUPTRACE ITRACE
+#else
+#define ISTARTUPTRACE(fmt, ...) \
+  HWC_TRACE_EVENT(hwcomposer::kTraceStartup, fmt, ##__VA_ARGS__)
 #endif
 
 #ifdef COMPOSITOR_TRACING
 #define ICOMPOSITORTRACE ITRACE
 #else
-#define ICOMPOSITORTRACE(fmt, ...) ((void)0)
+#define ICOMPOSITORTRACE(fmt, ...) \
+  HWC_TRACE_EVENT(hwcomposer::kTraceCompositor, fmt, ##__VA_ARGS__)
 #endif
 
 #ifdef RESOURCE_CACHE_TRACING
@@ -0,0 +1,328 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "hwctracebuffer.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <spinlock.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "hwctrace.h"
+
+namespace hwcomposer {
+
+// Number of events kept per thread. Needs to be a power of two.
+#define HWC_TRACE_BUFFER_SIZE 4096
+
+namespace {
+
+struct TraceEvent {
+  int64_t timestamp_;
+  const char* name_;
+  int64_t args_[2];
+  uint32_t category_;
+  char phase_;
+};
+
+// Ring of events written only by the owning thread. Readers copy events
+// and use write_index_ to find out which ones might have been overwritten
+// while copying.
+struct TraceBuffer {
+  TraceEvent events_[HWC_TRACE_BUFFER_SIZE];
+  std::atomic<uint64_t> write_index_;
+  std::atomic<bool> in_use_;
+  int32_t tid_;
+};
+
+struct TraceCategoryName {
+  const char* name_;
+  uint32_t category_;
+};
+
+const TraceCategoryName kCategoryNames[] = {
+    {"function", kTraceFunction},  {"displaymanager", kTraceDisplayManager},
+    {"pageflip", kTracePageFlip},  {"hotplug", kTraceHotPlug},
+    {"mosaic", kTraceMosaic},      {"startup", kTraceStartup},
+    {"compositor", kTraceCompositor}, {"all", kTraceAll}};
+
+// Buffers are never freed, as exporting can happen at any time. Buffers
+// of threads which exited are handed to new threads.
+SpinLock buffers_lock;
+std::vector<TraceBuffer*> buffers;
+// trace_marker is opened once and never closed, Record may be writing to
+// it at any time. Disabling markers only stops new writes.
+std::atomic<int> trace_marker_fd(-1);
+std::atomic<bool> trace_marker_enabled(false);
+
+int64_t GetTraceTime() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+class ThreadBuffer {
+ public:
+  ~ThreadBuffer() {
+    if (buffer_)
+      buffer_->in_use_.store(false, std::memory_order_release);
+  }
+
+  TraceBuffer* Get() {
+    if (buffer_)
+      return buffer_;
+
+    ScopedSpinLock lock(buffers_lock);
+    for (TraceBuffer* buffer : buffers) {
+      if (!buffer->in_use_.load(std::memory_order_acquire)) {
+        buffer_ = buffer;
+        break;
+      }
+    }
+
+    if (!buffer_) {
+      buffer_ = new TraceBuffer();
+      buffer_->write_index_.store(0, std::memory_order_relaxed);
+      buffers.emplace_back(buffer_);
+    }
+
+    buffer_->tid_ = syscall(SYS_gettid);
+    buffer_->in_use_.store(true, std::memory_order_release);
+    return buffer_;
+  }
+
+ private:
+  TraceBuffer* buffer_ = NULL;
+};
+
+thread_local ThreadBuffer thread_buffer;
+
+// Uses the systrace marker format, instant events are written as empty
+// slices.
+void WriteTraceMarker(int fd, char phase, const char* name) {
+  char marker[256];
+  int length = 0;
+  if (phase == 'E') {
+    length = snprintf(marker, sizeof(marker), "E|%d", getpid());
+  } else {
+    length = snprintf(marker, sizeof(marker), "B|%d|%s", getpid(), name);
+  }
+
+  if (length <= 0)
+    return;
+
+  if (length >= static_cast<int>(sizeof(marker)))
+    length = sizeof(marker) - 1;
+
+  // Tracing is best effort, ignore any failures.
+  if (write(fd, marker, length) < 0)
+    return;
+
+  if (phase == 'i')
+    WriteTraceMarker(fd, 'E', name);
+}
+
+void WriteJSONString(FILE* file, const char* string) {
+  fputc('"', file);
+  for (const char* c = string; c && *c; ++c) {
+    switch (*c) {
+      case '"':
+        fputs("\\\"", file);
+        break;
+      case '\\':
+        fputs("\\\\", file);
+        break;
+      case '\n':
+        fputs("\\n", file);
+        break;
+      default:
+        if (static_cast<unsigned char>(*c) < 0x20) {
+          fputc(' ', file);
+        } else {
+          fputc(*c, file);
+        }
+        break;
+    }
+  }
+  fputc('"', file);
+}
+
+const char* GetCategoryName(uint32_t category) {
+  for (const TraceCategoryName& entry : kCategoryNames) {
+    if (entry.category_ == category)
+      return entry.name_;
+  }
+
+  return "hwc";
+}
+
+uint32_t GetInitialCategories() {
+  const char* categories = getenv("HWC_TRACE");
+  if (!categories)
+    return 0;
+
+  return HwcTracer::ParseCategories(categories);
+}
+
+}  // namespace
+
+std::atomic<uint32_t> HwcTracer::enabled_categories_(GetInitialCategories());
+
+void HwcTracer::SetCategories(uint32_t categories) {
+  enabled_categories_.store(categories & kTraceAll, std::memory_order_relaxed);
+}
+
+uint32_t HwcTracer::GetCategories() {
+  return enabled_categories_.load(std::memory_order_relaxed);
+}
+
+uint32_t HwcTracer::ParseCategories(const char* categories) {
+  char* end = NULL;
+  unsigned long mask = strtoul(categories, &end, 0);
+  if (end != categories && *end == '\0')
+    return static_cast<uint32_t>(mask) & kTraceAll;
+
+  uint32_t result = 0;
+  const char* name = categories;
+  while (*name) {
+    size_t length = strcspn(name, ",");
+    for (const TraceCategoryName& entry : kCategoryNames) {
+      if (strlen(entry.name_) == length && !strncmp(entry.name_, name, length))
+        result |= entry.category_;
+    }
+
+    name += length;
+    if (*name == ',')
+      ++name;
+  }
+
+  return result;
+}
+
+bool HwcTracer::EnableTraceMarker(bool enable) {
+  if (enable && trace_marker_fd.load() < 0) {
+    int fd = open("/sys/kernel/tracing/trace_marker", O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+      fd = open("/sys/kernel/debug/tracing/trace_marker",
+                O_WRONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+      ETRACE("Failed to open trace_marker. %s", PRINTERROR());
+      return false;
+    }
+
+    // Another caller may have published one meanwhile, this one was
+    // never visible to Record.
+    int expected = -1;
+    if (!trace_marker_fd.compare_exchange_strong(expected, fd))
+      close(fd);
+  }
+
+  trace_marker_enabled.store(enable);
+  return true;
+}
+
+void HwcTracer::Record(uint32_t category, char phase, const char* name,
+                       int64_t arg0, int64_t arg1) {
+  TraceBuffer* buffer = thread_buffer.Get();
+  uint64_t index = buffer->write_index_.load(std::memory_order_relaxed);
+  TraceEvent& event = buffer->events_[index & (HWC_TRACE_BUFFER_SIZE - 1)];
+  event.timestamp_ = GetTraceTime();
+  event.name_ = name;
+  event.args_[0] = arg0;
+  event.args_[1] = arg1;
+  event.category_ = category;
+  event.phase_ = phase;
+  buffer->write_index_.store(index + 1, std::memory_order_release);
+
+  if (!trace_marker_enabled.load(std::memory_order_relaxed))
+    return;
+
+  int fd = trace_marker_fd.load(std::memory_order_relaxed);
+  if (fd >= 0)
+    WriteTraceMarker(fd, phase, name);
+}
+
+bool HwcTracer::ExportChromeTrace(const char* path) {
+  FILE* file = fopen(path, "w");
+  if (!file) {
+    ETRACE("Failed to open %s for trace export. %s", path, PRINTERROR());
+    return false;
+  }
+
+  std::vector<TraceBuffer*> current_buffers;
+  buffers_lock.lock();
+  current_buffers = buffers;
+  buffers_lock.unlock();
+
+  int pid = getpid();
+  bool first = true;
+  std::vector<TraceEvent> events;
+  fputs("{\"traceEvents\":[", file);
+  for (TraceBuffer* buffer : current_buffers) {
+    uint64_t end = buffer->write_index_.load(std::memory_order_acquire);
+    uint64_t begin = 0;
+    if (end > HWC_TRACE_BUFFER_SIZE)
+      begin = end - HWC_TRACE_BUFFER_SIZE;
+
+    events.clear();
+    for (uint64_t i = begin; i < end; ++i) {
+      events.emplace_back(buffer->events_[i & (HWC_TRACE_BUFFER_SIZE - 1)]);
+    }
+
+    // Drop events which the owning thread overwrote while we copied.
+    uint64_t latest = buffer->write_index_.load(std::memory_order_acquire);
+    uint64_t first_valid = begin;
+    if (latest > HWC_TRACE_BUFFER_SIZE)
+      first_valid = std::max(begin, latest - HWC_TRACE_BUFFER_SIZE);
+
+    for (uint64_t i = first_valid; i < end; ++i) {
+      const TraceEvent& event = events.at(i - begin);
+      if (!first)
+        fputc(',', file);
+
+      first = false;
+      fputs("\n{\"name\":", file);
+      WriteJSONString(file, event.name_);
+      fprintf(file,
+              ",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,"
+              "\"tid\":%d",
+              GetCategoryName(event.category_), event.phase_,
+              event.timestamp_ / 1000.0, pid, buffer->tid_);
+      if (event.phase_ == 'i') {
+        fprintf(file, ",\"s\":\"t\",\"args\":{\"arg0\":%lld,\"arg1\":%lld}",
+                static_cast<long long>(event.args_[0]),
+                static_cast<long long>(event.args_[1]));
+      }
+
+      fputc('}', file);
+    }
+  }
+
+  fputs("\n]}\n", file);
+  fclose(file);
+  return true;
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,140 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_UTILS_HWCTRACEBUFFER_H_
+#define COMMON_UTILS_HWCTRACEBUFFER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <type_traits>
+
+namespace hwcomposer {
+
+// Categories of the runtime trace backend. These can be enabled with the
+// HWC_TRACE environment variable as a comma separated list of names (see
+// HwcTracer::ParseCategories) or at runtime through HwcTracer.
+enum HWCTraceCategory {
+  kTraceFunction = 1 << 0,        // CTRACE
+  kTraceDisplayManager = 1 << 1,  // IDISPLAYMANAGERTRACE
+  kTracePageFlip = 1 << 2,        // IPAGEFLIPEVENTTRACE
+  kTraceHotPlug = 1 << 3,         // IHOTPLUGEVENTTRACE
+  kTraceMosaic = 1 << 4,          // IMOSAICDISPLAYTRACE
+  kTraceStartup = 1 << 5,         // ISTARTUPTRACE
+  kTraceCompositor = 1 << 6,      // ICOMPOSITORTRACE
+  kTraceAll = (1 << 7) - 1
+};
+
+// Binary event tracer. Events are stored in per thread ring buffers
+// without taking any locks, text formatting only happens when traces
+// are exported.
+class HwcTracer {
+ public:
+  static bool IsEnabled(uint32_t category) {
+    return enabled_categories_.load(std::memory_order_relaxed) & category;
+  }
+
+  static void SetCategories(uint32_t categories);
+  static uint32_t GetCategories();
+
+  // Parses a comma separated list of category names (function,
+  // displaymanager, pageflip, hotplug, mosaic, startup, compositor, all)
+  // or a numeric mask.
+  static uint32_t ParseCategories(const char* categories);
+
+  // Also write events to ftrace trace_marker as they are recorded, so they
+  // show up in systrace/perfetto captures.
+  static bool EnableTraceMarker(bool enable);
+
+  // phase is one of the Chrome trace event phases: 'B', 'E' or 'i'.
+  static void Record(uint32_t category, char phase, const char* name,
+                     int64_t arg0, int64_t arg1);
+
+  // Writes all buffered events in Chrome trace event JSON format, which
+  // can be loaded in chrome://tracing and Perfetto UI.
+  static bool ExportChromeTrace(const char* path);
+
+ private:
+  static std::atomic<uint32_t> enabled_categories_;
+};
+
+class HwcTraceScope {
+ public:
+  HwcTraceScope(uint32_t category, const char* name)
+      : category_(category), name_(name) {
+    enabled_ = HwcTracer::IsEnabled(category);
+    if (enabled_)
+      HwcTracer::Record(category_, 'B', name_, 0, 0);
+  }
+
+  ~HwcTraceScope() {
+    if (enabled_)
+      HwcTracer::Record(category_, 'E', name_, 0, 0);
+  }
+
+ private:
+  uint32_t category_;
+  const char* name_;
+  bool enabled_;
+};
+
+// Helpers to keep the first two integer arguments of printf style trace
+// calls. Anything which isn't a number or pointer is recorded as zero.
+template <typename T>
+inline typename std::enable_if<
+    std::is_arithmetic<T>::value || std::is_enum<T>::value, int64_t>::type
+TraceArgValue(const T& value) {
+  return static_cast<int64_t>(value);
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_pointer<T>::value, int64_t>::type
+TraceArgValue(const T& value) {
+  return static_cast<int64_t>(reinterpret_cast<intptr_t>(value));
+}
+
+template <typename T>
+inline typename std::enable_if<!std::is_arithmetic<T>::value &&
+                                   !std::is_enum<T>::value &&
+                                   !std::is_pointer<T>::value,
+                               int64_t>::type
+TraceArgValue(const T& /*value*/) {
+  return 0;
+}
+
+inline void FillTraceArgs(int64_t* /*args*/, uint32_t /*remaining*/) {
+}
+
+template <typename T, typename... Rest>
+inline void FillTraceArgs(int64_t* args, uint32_t remaining, const T& value,
+                          const Rest&... rest) {
+  if (!remaining)
+    return;
+
+  *args = TraceArgValue(value);
+  FillTraceArgs(args + 1, remaining - 1, rest...);
+}
+
+template <typename... Args>
+inline void TraceFormatEvent(uint32_t category, const char* format,
+                             const Args&... args) {
+  int64_t values[2] = {0, 0};
+  FillTraceArgs(values, 2, args...);
+  HwcTracer::Record(category, 'i', format, values[0], values[1]);
+}
+
+}  // namespace hwcomposer
+#endif  // COMMON_UTILS_HWCTRACEBUFFER_H_
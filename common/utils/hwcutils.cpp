@@ -16,12 +16,18 @@
 
 #include "hwcutils.h"
 
+#include <linux/sync_file.h>
 #include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
 
 #include "hwctrace.h"
 
 #include <drm_fourcc.h>
 
+#include <algorithm>
+
 namespace hwcomposer {
 
 int HWCPoll(int fd, int timeout) {
@@ -37,6 +43,32 @@ int HWCPoll(int fd, int timeout) {
   return ret;
 }
 
+bool GetFenceSignalTime(int fd, int64_t* time) {
+  struct sync_file_info info;
+  memset(&info, 0, sizeof(info));
+  if (ioctl(fd, SYNC_IOC_FILE_INFO, &info) < 0 || !info.num_fences ||
+      info.status != 1)
+    return false;
+
+  std::vector<struct sync_fence_info> fences(info.num_fences);
+  info.sync_fence_info = reinterpret_cast<uintptr_t>(fences.data());
+  if (ioctl(fd, SYNC_IOC_FILE_INFO, &info) < 0)
+    return false;
+
+  *time = 0;
+  for (const struct sync_fence_info& fence : fences) {
+    *time = std::max(*time, static_cast<int64_t>(fence.timestamp_ns));
+  }
+
+  return *time > 0;
+}
+
+int64_t GetMonotonicTime() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
 void ResetRectToRegion(const HwcRegion& hwc_region, HwcRect<int>& rect) {
   size_t total_rects = hwc_region.size();
   if (total_rects == 0) {
@@ -144,4 +176,37 @@ uint32_t GetTotalPlanesForFormat(uint32_t format) {
   return 1;
 }
 
+void NegotiateModifiers(const std::vector<uint64_t>& plane_modifiers,
+                        const std::vector<uint64_t>& renderer_modifiers,
+                        std::vector<uint64_t>* modifiers) {
+  modifiers->clear();
+  for (uint64_t modifier : renderer_modifiers) {
+    if (std::find(plane_modifiers.begin(), plane_modifiers.end(), modifier) !=
+        plane_modifiers.end())
+      modifiers->emplace_back(modifier);
+  }
+}
+
+size_t ExtendClientComposition(std::vector<bool>* client_composition) {
+  std::vector<bool>& client = *client_composition;
+  size_t size = client.size();
+  size_t bottom = 0;
+  while (bottom < size && !client[bottom])
+    bottom++;
+
+  size_t top = size;
+  while (top > bottom && !client[top - 1])
+    top--;
+
+  size_t marked = 0;
+  for (size_t i = bottom; i < top; i++) {
+    if (!client[i]) {
+      client[i] = true;
+      marked++;
+    }
+  }
+
+  return marked;
+}
+
 }  // namespace hwcomposer
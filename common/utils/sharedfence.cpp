@@ -0,0 +1,75 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "sharedfence.h"
+
+#include <errno.h>
+#include <linux/sync_file.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "hwctrace.h"
+
+namespace hwcomposer {
+
+SharedFence::SharedFence(int32_t fd) : fd_(fd) {
+}
+
+SharedFence::~SharedFence() {
+  if (fd_ > 0)
+    close(fd_);
+}
+
+int32_t SharedFence::Duplicate() const {
+  if (fd_ <= 0)
+    return -1;
+
+  int32_t fd = dup(fd_);
+  if (fd < 0) {
+    ETRACE("SharedFence: Failed to duplicate fence %s", PRINTERROR());
+    return -1;
+  }
+
+  fds_created_.fetch_add(1, std::memory_order_relaxed);
+  return fd;
+}
+
+int32_t SharedFence::Merge(int32_t fd) const {
+  if (fd_ <= 0)
+    return -1;
+
+  // Merge directly through the sync_file ioctl, libsync's sync_merge
+  // doesn't have the same signature on all platforms.
+  struct sync_merge_data data;
+  memset(&data, 0, sizeof(data));
+  strncpy(data.name, "hwc release", sizeof(data.name) - 1);
+  data.fd2 = fd_;
+  int ret;
+  do {
+    ret = ioctl(fd, SYNC_IOC_MERGE, &data);
+  } while (ret == -1 && (errno == EINTR || errno == EAGAIN));
+
+  if (ret < 0) {
+    ETRACE("SharedFence: Failed to merge fences %s", PRINTERROR());
+    return Duplicate();
+  }
+
+  fds_created_.fetch_add(1, std::memory_order_relaxed);
+  return data.fence;
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,59 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COMMON_UTILS_SHAREDFENCE_H_
+#define COMMON_UTILS_SHAREDFENCE_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace hwcomposer {
+
+// Fence fd shared by all layers released by the same event, i.e. the
+// page flip or GPU composition of a frame. Layers keep a reference
+// instead of an fd of their own, fds are only created for layers whose
+// release fence is queried.
+class SharedFence {
+ public:
+  // Takes ownership of fd.
+  explicit SharedFence(int32_t fd);
+  SharedFence(const SharedFence& rhs) = delete;
+  SharedFence& operator=(const SharedFence& rhs) = delete;
+
+  ~SharedFence();
+
+  // Returns a new fd for this fence, owned by caller.
+  int32_t Duplicate() const;
+
+  // Returns a new fd, owned by caller, which signals once both fd and
+  // this fence have signalled. fd is left untouched. If the fences can't
+  // be merged, returns a duplicate of this fence, the newer of the two.
+  int32_t Merge(int32_t fd) const;
+
+  // Number of fds created by Duplicate and Merge so far, the fd of the
+  // fence itself excluded. Safe to call from any thread.
+  uint32_t GetFdsCreated() const {
+    return fds_created_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  int32_t fd_;
+  mutable std::atomic<uint32_t> fds_created_{0};
+};
+
+}  // namespace hwcomposer
+#endif  // COMMON_UTILS_SHAREDFENCE_H_
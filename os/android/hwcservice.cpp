@@ -15,17 +15,31 @@
 */
 
 #include "hwcservice.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <binder/IInterface.h>
 #include <binder/IServiceManager.h>
 #include <binder/Parcel.h>
 #include <binder/ProcessState.h>
 #include "iahwc2.h"
 #include "hwcdefs.h"
+#include "hwctracebuffer.h"
 
 #define HWC_VERSION_STRING                                             \
   "VERSION:HWC 2.0 GIT Branch & Latest Commit:" HWC_VERSION_GIT_BRANCH \
   " " HWC_VERSION_GIT_SHA " " __DATE__ " " __TIME__
 
+// Frames dumped by IDiagnostic::DumpFrames are written there.
+#define HWC_FRAME_DUMP_DIRECTORY "/data/local/tmp/hwc-frames"
+// How long a synchronous dump may wait for each frame.
+#define HWC_FRAME_DUMP_FRAME_TIMEOUT_US 100000
+#define HWC_FRAME_DUMP_POLL_US 5000
+// Traces exported with the trace.export option are written there, the
+// option only names the file.
+#define HWC_TRACE_EXPORT_DIRECTORY "/data/local/tmp/hwc-traces"
+
 namespace android {
 using namespace hwcomposer;
 
@@ -89,6 +103,29 @@ String8 HwcService::GetHwcVersion() {
 }
 
 status_t HwcService::SetOption(String8 option, String8 value) {
+  if (option == "trace.categories") {
+    HwcTracer::SetCategories(HwcTracer::ParseCategories(value.string()));
+  } else if (option == "trace.marker") {
+    if (!HwcTracer::EnableTraceMarker(value == "1"))
+      return UNKNOWN_ERROR;
+  } else if (option == "trace.export") {
+    const char *name = value.string();
+    if (!*name || strchr(name, '/') || !strcmp(name, ".") ||
+        !strcmp(name, ".."))
+      return BAD_VALUE;
+
+    if (mkdir(HWC_TRACE_EXPORT_DIRECTORY, 0770) && errno != EEXIST) {
+      ALOGE("Failed to create %s: %s", HWC_TRACE_EXPORT_DIRECTORY,
+            strerror(errno));
+      return UNKNOWN_ERROR;
+    }
+
+    String8 path(HWC_TRACE_EXPORT_DIRECTORY "/");
+    path.append(value);
+    if (!HwcTracer::ExportChromeTrace(path.string()))
+      return UNKNOWN_ERROR;
+  }
+
   return OK;
 }
 
@@ -132,7 +169,76 @@ void HwcService::Diagnostic::DisableDisplay(uint32_t, bool) { /* nothing */
 }
 void HwcService::Diagnostic::MaskLayer(uint32_t, uint32_t, bool) { /* nothing */
 }
-void HwcService::Diagnostic::DumpFrames(uint32_t, int32_t, bool) { /* nothing */
+void HwcService::Diagnostic::DumpFrames(uint32_t d, int32_t frames,
+                                        bool bSync) {
+  hwcomposer::NativeDisplay *display;
+  if (!d) {
+    display = mHwc.GetPrimaryDisplay();
+  } else {
+    display = mHwc.GetExtendedDisplay(d - 1);
+  }
+
+  if (!display)
+    return;
+
+  uint32_t count = frames > 0 ? frames : 0;
+  if (count && mkdir(HWC_FRAME_DUMP_DIRECTORY, 0770) && errno != EEXIST) {
+    ALOGE("Failed to create %s: %s", HWC_FRAME_DUMP_DIRECTORY,
+          strerror(errno));
+    return;
+  }
+
+  hwcomposer::HwcFrameCaptureStatistics start;
+  display->GetFrameCaptureStatistics(&start);
+  if (!display->StartFrameCapture(count, HWC_FRAME_DUMP_DIRECTORY)) {
+    ALOGE("Frame capture is not supported by display %u", d);
+    return;
+  }
+
+  if (!bSync || !count)
+    return;
+
+  // Frames are only captured when presented, give up if the display
+  // stays idle.
+  uint64_t timeout = static_cast<uint64_t>(count) *
+                     HWC_FRAME_DUMP_FRAME_TIMEOUT_US;
+  for (uint64_t waited = 0; waited < timeout;
+       waited += HWC_FRAME_DUMP_POLL_US) {
+    hwcomposer::HwcFrameCaptureStatistics stats;
+    display->GetFrameCaptureStatistics(&stats);
+    if (stats.captured + stats.dropped - start.captured - start.dropped >=
+        count)
+      return;
+
+    usleep(HWC_FRAME_DUMP_POLL_US);
+  }
+
+  ALOGW("Timed out dumping %u frames of display %u", count, d);
+}
+
+status_t HwcService::Diagnostic::GetFrameStatistics(uint32_t d,
+                                                    uint64_t sinceFrame,
+                                                    Parcel *reply) {
+  hwcomposer::NativeDisplay *display;
+  if (!d) {
+    display = mHwc.GetPrimaryDisplay();
+  } else {
+    display = mHwc.GetExtendedDisplay(d - 1);
+  }
+
+  std::vector<hwcomposer::HwcFrameStatistics> frames;
+  if (!display || !display->GetFrameStatistics(sinceFrame, &frames))
+    return BAD_VALUE;
+
+  reply->writeInt32(eFrameStatisticsVersion);
+  reply->writeInt32(sizeof(hwcomposer::HwcFrameStatistics));
+  reply->writeInt32(frames.size());
+  if (!frames.empty()) {
+    reply->write(frames.data(),
+                 frames.size() * sizeof(hwcomposer::HwcFrameStatistics));
+  }
+
+  return OK;
 }
 
 HwcService::Controls::Controls(IAHWC2 &hwc, HwcService &hwcService)
@@ -195,32 +301,116 @@ HwcService::Controls::~Controls() {
 status_t HwcService::Controls::DisplaySetOverscan(uint32_t display,
                                                   int32_t xoverscan,
                                                   int32_t yoverscan) {
-  // TO DO
+  if (xoverscan < -HWCS_MAX_OVERSCAN || xoverscan > HWCS_MAX_OVERSCAN ||
+      yoverscan < -HWCS_MAX_OVERSCAN || yoverscan > HWCS_MAX_OVERSCAN)
+    return BAD_VALUE;
+
+  hwcomposer::NativeDisplay *phyDisplay;
+  if (!display) {
+    phyDisplay = mHwc.GetPrimaryDisplay();
+  } else {
+    phyDisplay = mHwc.GetExtendedDisplay(display - 1);
+  }
+
+  if (!phyDisplay || !phyDisplay->SetOverscan(xoverscan, yoverscan))
+    return INVALID_OPERATION;
+
   return OK;
 }
 
 status_t HwcService::Controls::DisplayGetOverscan(uint32_t display,
                                                   int32_t *xoverscan,
                                                   int32_t *yoverscan) {
-  // TO DO
+  hwcomposer::NativeDisplay *phyDisplay;
+  if (!display) {
+    phyDisplay = mHwc.GetPrimaryDisplay();
+  } else {
+    phyDisplay = mHwc.GetExtendedDisplay(display - 1);
+  }
+
+  if (!phyDisplay || !phyDisplay->GetOverscan(xoverscan, yoverscan))
+    return INVALID_OPERATION;
+
   return OK;
 }
 
 status_t HwcService::Controls::DisplaySetScaling(
     uint32_t display, EHwcsScalingMode eScalingMode) {
-  // TO DO
+  HWCDisplayScaling mode;
+  switch (eScalingMode) {
+    case HWCS_SCALE_CENTRE:
+      mode = HWCDisplayScaling::kScaleCentre;
+      break;
+    case HWCS_SCALE_STRETCH:
+      mode = HWCDisplayScaling::kScaleStretch;
+      break;
+    case HWCS_SCALE_FIT:
+      mode = HWCDisplayScaling::kScaleFit;
+      break;
+    case HWCS_SCALE_FILL:
+      mode = HWCDisplayScaling::kScaleFill;
+      break;
+    default:
+      return BAD_VALUE;
+  }
+
+  hwcomposer::NativeDisplay *phyDisplay;
+  if (!display) {
+    phyDisplay = mHwc.GetPrimaryDisplay();
+  } else {
+    phyDisplay = mHwc.GetExtendedDisplay(display - 1);
+  }
+
+  if (!phyDisplay || !phyDisplay->SetDisplayScaling(mode))
+    return INVALID_OPERATION;
+
   return OK;
 }
 
 status_t HwcService::Controls::DisplayGetScaling(
     uint32_t display, EHwcsScalingMode *peScalingMode) {
-  // TO DO
+  hwcomposer::NativeDisplay *phyDisplay;
+  if (!display) {
+    phyDisplay = mHwc.GetPrimaryDisplay();
+  } else {
+    phyDisplay = mHwc.GetExtendedDisplay(display - 1);
+  }
+
+  HWCDisplayScaling mode;
+  if (!phyDisplay || !phyDisplay->GetDisplayScaling(&mode))
+    return INVALID_OPERATION;
+
+  switch (mode) {
+    case HWCDisplayScaling::kScaleCentre:
+      *peScalingMode = HWCS_SCALE_CENTRE;
+      break;
+    case HWCDisplayScaling::kScaleFit:
+      *peScalingMode = HWCS_SCALE_FIT;
+      break;
+    case HWCDisplayScaling::kScaleFill:
+      *peScalingMode = HWCS_SCALE_FILL;
+      break;
+    case HWCDisplayScaling::kScaleStretch:
+    default:
+      *peScalingMode = HWCS_SCALE_STRETCH;
+      break;
+  }
+
   return OK;
 }
 
 status_t HwcService::Controls::DisplayEnableBlank(uint32_t display,
                                                   bool blank) {
-  // TO DO
+  hwcomposer::NativeDisplay *phyDisplay;
+  if (!display) {
+    phyDisplay = mHwc.GetPrimaryDisplay();
+  } else {
+    phyDisplay = mHwc.GetExtendedDisplay(display - 1);
+  }
+
+  if (!phyDisplay || !phyDisplay->SetBlank(blank))
+    return INVALID_OPERATION;
+
   return OK;
 }
 
@@ -394,19 +584,35 @@ bool HwcService::Controls::needSetKeyFrameHint() {
 
 status_t HwcService::Controls::VideoSetOptimizationMode(
     EHwcsOptimizationMode mode) {
-  // TO DO
+  HWCOptimizationMode hwc_mode;
+  switch (mode) {
+    case HWCS_OPTIMIZE_NORMAL:
+      hwc_mode = HWCOptimizationMode::kOptimizeNormal;
+      break;
+    case HWCS_OPTIMIZE_VIDEO:
+      hwc_mode = HWCOptimizationMode::kOptimizeVideo;
+      break;
+    case HWCS_OPTIMIZE_CAMERA:
+      hwc_mode = HWCOptimizationMode::kOptimizeCamera;
+      break;
+    default:
+      return BAD_VALUE;
+  }
+
+  mCurrentOptimizationMode = mode;
+  mHwc.GetPrimaryDisplay()->SetOptimizationMode(hwc_mode);
   return OK;
 }
 
 status_t HwcService::Controls::MdsUpdateVideoState(int64_t videoSessionID,
                                                    bool isPrepared) {
-  // TO DO
+  mHwc.GetPrimaryDisplay()->UpdateVideoState(videoSessionID, isPrepared);
   return OK;
 }
 
 status_t HwcService::Controls::MdsUpdateVideoFPS(int64_t videoSessionID,
                                                  int32_t fps) {
-  // TO DO
+  mHwc.GetPrimaryDisplay()->UpdateVideoFPS(videoSessionID, fps);
   return OK;
 }
 
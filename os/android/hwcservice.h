@@ -35,7 +35,6 @@ class HwcService : public BnService {
   class Diagnostic : public BnDiagnostic {
    public:
     Diagnostic(IAHWC2& IAHWC2) : mHwc(IAHWC2) {
-      HWC_UNUSED(mHwc);
     }
 
     status_t ReadLogParcel(Parcel* parcel) override;
@@ -43,6 +42,8 @@ class HwcService : public BnService {
     void DisableDisplay(uint32_t d, bool bBlank) override;
     void MaskLayer(uint32_t d, uint32_t layer, bool bHide) override;
     void DumpFrames(uint32_t d, int32_t frames, bool bSync) override;
+    status_t GetFrameStatistics(uint32_t d, uint64_t sinceFrame,
+                                Parcel* reply) override;
 
    private:
     IAHWC2& mHwc;
@@ -20,6 +20,7 @@
 #include "utils_android.h"
 
 #include <inttypes.h>
+#include <unistd.h>
 
 #include <cutils/log.h>
 #include <cutils/properties.h>
@@ -154,12 +155,22 @@ HWC2::Error IAHWC2::Init() {
       break;
   }
 
+  property_get("board.hwc.warm.suspend.mb", value, "0");
+  uint64_t warm_suspend_budget = strtoull(value, NULL, 10) << 20;
+  if (warm_suspend_budget)
+    ALOGI("HWC warm suspend budget %s MB", value);
+
   if (!device_.Initialize()) {
     ALOGE("Can't initialize drm object.");
     return HWC2::Error::NoResources;
   }
 
   std::vector<NativeDisplay *> displays = device_.GetAllDisplays();
+  if (warm_suspend_budget) {
+    for (NativeDisplay *display : displays)
+      display->SetWarmSuspend(true, warm_suspend_budget);
+  }
+
   NativeDisplay *primary_display = displays.at(0);
   uint32_t external_display_id = 1;
   primary_display_.Init(primary_display, 0, disable_explicit_sync_,
@@ -387,8 +398,8 @@ HWC2::Error IAHWC2::HwcDisplay::AcceptDisplayChanges() {
     return HWC2::Error::NotValidated;
   }
 
-  for (std::pair<const hwc2_layer_t, IAHWC2::Hwc2Layer> &l : layers_)
-    l.second.accept_type_change();
+  for (IAHWC2::Hwc2Layer *layer : z_sorted_layers_)
+    layer->accept_type_change();
 
   // reset the value to false
   checkValidateDisplay = false;
@@ -399,7 +410,11 @@ HWC2::Error IAHWC2::HwcDisplay::CreateLayer(hwc2_layer_t *layer) {
   supported(__func__);
   uint64_t id = display_->AcquireId();
   layers_.emplace(static_cast<hwc2_layer_t>(id), IAHWC2::Hwc2Layer());
-  layers_.at(id).XTranslateCoordinates(display_->GetXTranslation());
+  IAHWC2::Hwc2Layer &new_layer = layers_.at(id);
+  new_layer.XTranslateCoordinates(display_->GetXTranslation());
+  new_layer.set_z_order_dirty_flag(&z_order_dirty_);
+  z_sorted_layers_.emplace_back(&new_layer);
+  z_order_dirty_ = true;
   *layer = static_cast<hwc2_layer_t>(id);
   return HWC2::Error::None;
 }
@@ -409,8 +424,16 @@ HWC2::Error IAHWC2::HwcDisplay::DestroyLayer(hwc2_layer_t layer) {
   if (layers_.empty())
     return HWC2::Error::None;
 
-  if (layers_.erase(layer))
-    display_->ReleaseId(layer);
+  std::map<hwc2_layer_t, Hwc2Layer>::iterator it = layers_.find(layer);
+  if (it == layers_.end())
+    return HWC2::Error::None;
+
+  // Removing an element keeps the remaining layers sorted.
+  z_sorted_layers_.erase(std::remove(z_sorted_layers_.begin(),
+                                     z_sorted_layers_.end(), &it->second),
+                         z_sorted_layers_.end());
+  layers_.erase(it);
+  display_->ReleaseId(layer);
 
   return HWC2::Error::None;
 }
@@ -420,7 +443,33 @@ void IAHWC2::HwcDisplay::FreeAllLayers() {
     return;
 
   display_->ResetLayerHashGenerator();
+  std::vector<Hwc2Layer *>().swap(z_sorted_layers_);
+  std::vector<hwcomposer::HwcLayer *>().swap(present_layers_);
+  std::vector<Hwc2Layer *>().swap(present_sources_);
   std::map<hwc2_layer_t, Hwc2Layer>().swap(layers_);
+  z_order_dirty_ = false;
+}
+
+void IAHWC2::HwcDisplay::SortLayersByZOrder() {
+  if (!z_order_dirty_)
+    return;
+
+  // Usually only a few layers moved since the last frame, insertion sort
+  // is cheap for nearly sorted input and doesn't need any extra storage.
+  size_t total_layers = z_sorted_layers_.size();
+  for (size_t i = 1; i < total_layers; ++i) {
+    IAHWC2::Hwc2Layer *layer = z_sorted_layers_[i];
+    uint32_t z_order = layer->z_order();
+    size_t j = i;
+    while (j > 0 && z_sorted_layers_[j - 1]->z_order() > z_order) {
+      z_sorted_layers_[j] = z_sorted_layers_[j - 1];
+      --j;
+    }
+
+    z_sorted_layers_[j] = layer;
+  }
+
+  z_order_dirty_ = false;
 }
 
 HWC2::Error IAHWC2::HwcDisplay::GetActiveConfig(hwc2_config_t *config) {
@@ -597,73 +646,78 @@ HWC2::Error IAHWC2::HwcDisplay::GetReleaseFences(uint32_t *num_elements,
   return HWC2::Error::None;
 }
 
-HWC2::Error IAHWC2::HwcDisplay::PresentDisplay(int32_t *retire_fence) {
-  supported(__func__);
-  // order the layers by z-order
+void IAHWC2::HwcDisplay::AddToLayerStack(IAHWC2::Hwc2Layer *layer) {
+  present_layers_.emplace_back(layer->GetLayer());
+  present_sources_.emplace_back(layer);
+}
+
+void IAHWC2::HwcDisplay::BuildLayerStack() {
   bool use_client_layer = false;
   uint32_t client_z_order = 0;
-  bool use_cursor_layer = false;
-  uint32_t cursor_z_order = 0;
-  IAHWC2::Hwc2Layer *cursor_layer;
-  *retire_fence = -1;
-  std::map<uint32_t, IAHWC2::Hwc2Layer *> z_map;
-
-  // if the power mode is doze suspend then its the hint that the drawing
-  // into the display has suspended and remain in the low power state and
-  // continue displaying the current state and stop applying display
-  // update from the client
-  if (display_->PowerMode() == HWC2_POWER_MODE_DOZE_SUSPEND)
-    return HWC2::Error::None;
-  for (std::pair<const hwc2_layer_t, IAHWC2::Hwc2Layer> &l : layers_) {
-    if (l.second.IsCursorLayer()) {
-      use_cursor_layer = true;
-      cursor_layer = &l.second;
-      cursor_z_order = l.second.z_order();
+  IAHWC2::Hwc2Layer *cursor_layer = NULL;
+  SortLayersByZOrder();
+  for (IAHWC2::Hwc2Layer *layer : z_sorted_layers_) {
+    if (layer->IsCursorLayer()) {
+      cursor_layer = layer;
       continue;
     }
 
-    switch (l.second.validated_type()) {
-      case HWC2::Composition::Device:
-        z_map.emplace(std::make_pair(l.second.z_order(), &l.second));
-        break;
-      case HWC2::Composition::Client:
-        // Place it at the z_order of the highest client layer
-        use_client_layer = true;
-        client_z_order = std::max(client_z_order, l.second.z_order());
-        break;
-      default:
-        continue;
+    if (layer->validated_type() == HWC2::Composition::Client) {
+      // Place it at the z_order of the highest client layer
+      use_client_layer = true;
+      client_z_order = layer->z_order();
     }
   }
-  if (use_client_layer && client_layer_.GetLayer() &&
-      client_layer_.GetLayer()->GetNativeHandle() &&
-      client_layer_.GetLayer()->GetNativeHandle()->handle_) {
-    z_map.emplace(std::make_pair(client_z_order, &client_layer_));
-  }
 
-  // Place the cursor at the highest z-order
-  if (use_cursor_layer) {
-    if (z_map.size()) {
-      if (z_map.rbegin()->second->z_order() > cursor_z_order)
-        cursor_z_order = z_map.rbegin()->second->z_order() + 1;
-      else if (client_z_order > cursor_z_order)
-        cursor_z_order = client_z_order + 1;
-    }
-    z_map.emplace(std::make_pair(cursor_z_order, cursor_layer));
+  if (use_client_layer &&
+      !(client_layer_.GetLayer() &&
+        client_layer_.GetLayer()->GetNativeHandle() &&
+        client_layer_.GetLayer()->GetNativeHandle()->handle_)) {
+    use_client_layer = false;
   }
 
-  std::vector<hwcomposer::HwcLayer *> layers;
   // now that they're ordered by z, add them to the composition
-  for (std::pair<const uint32_t, IAHWC2::Hwc2Layer *> &l : z_map) {
-    layers.emplace_back(l.second->GetLayer());
+  present_layers_.clear();
+  present_sources_.clear();
+  for (IAHWC2::Hwc2Layer *layer : z_sorted_layers_) {
+    if (layer->IsCursorLayer() ||
+        layer->validated_type() != HWC2::Composition::Device)
+      continue;
+
+    if (use_client_layer && layer->z_order() > client_z_order) {
+      AddToLayerStack(&client_layer_);
+      use_client_layer = false;
+    }
+
+    AddToLayerStack(layer);
   }
 
-  if (layers.empty())
+  if (use_client_layer)
+    AddToLayerStack(&client_layer_);
+
+  // Place the cursor at the highest z-order
+  if (cursor_layer)
+    AddToLayerStack(cursor_layer);
+}
+
+HWC2::Error IAHWC2::HwcDisplay::PresentDisplay(int32_t *retire_fence) {
+  supported(__func__);
+  *retire_fence = -1;
+
+  // if the power mode is doze suspend then its the hint that the drawing
+  // into the display has suspended and remain in the low power state and
+  // continue displaying the current state and stop applying display
+  // update from the client
+  if (display_->PowerMode() == HWC2_POWER_MODE_DOZE_SUSPEND)
+    return HWC2::Error::None;
+
+  BuildLayerStack();
+  if (present_layers_.empty())
     return HWC2::Error::None;
 
   IHOTPLUGEVENTTRACE("PhysicalDisplay called for Display: %p \n", display_);
 
-  bool success = display_->Present(layers, retire_fence);
+  bool success = display_->Present(present_layers_, retire_fence);
   if (!success) {
     ALOGE("Failed to set layers in the composition");
     return HWC2::Error::BadLayer;
@@ -709,6 +763,27 @@ HWC2::Error IAHWC2::HwcDisplay::SetClientTarget(buffer_handle_t target,
   return HWC2::Error::None;
 }
 
+HWC2::Error IAHWC2::HwcDisplay::SetCursorPosition(hwc2_layer_t layer,
+                                                  int32_t x, int32_t y) {
+  supported(__func__);
+  if (layers_.find(layer) == layers_.end())
+    return HWC2::Error::BadLayer;
+
+  Hwc2Layer &cursor = layers_.at(layer);
+  if (cursor.sf_type() != HWC2::Composition::Cursor)
+    return HWC2::Error::BadLayer;
+
+  cursor.SetCursorPosition(x, y);
+  // Try to show the new position right away, it is otherwise picked up by
+  // the next present.
+  int32_t retire_fence = -1;
+  if (display_->UpdateCursor(cursor.GetLayer(), &retire_fence) &&
+      retire_fence > 0)
+    close(retire_fence);
+
+  return HWC2::Error::None;
+}
+
 HWC2::Error IAHWC2::HwcDisplay::SetColorMode(int32_t mode) {
   supported(__func__);
   color_mode_ = mode;
@@ -792,8 +867,9 @@ HWC2::Error IAHWC2::HwcDisplay::ValidateDisplay(uint32_t *num_types,
   supported(__func__);
   *num_types = 0;
   *num_requests = 0;
-  for (std::pair<const hwc2_layer_t, IAHWC2::Hwc2Layer> &l : layers_) {
-    IAHWC2::Hwc2Layer &layer = l.second;
+  SortLayersByZOrder();
+  for (IAHWC2::Hwc2Layer *current_layer : z_sorted_layers_) {
+    IAHWC2::Hwc2Layer &layer = *current_layer;
     switch (layer.sf_type()) {
       case HWC2::Composition::Sideband:
         layer.set_validated_type(HWC2::Composition::Client);
@@ -814,12 +890,57 @@ HWC2::Error IAHWC2::HwcDisplay::ValidateDisplay(uint32_t *num_types,
     }
   }
 
+  // Ask the display which of the device layers it would end up composing
+  // itself and let SurfaceFlinger handle those as part of client target.
+  BuildLayerStack();
+  if (!present_layers_.empty() &&
+      display_->ValidateLayers(present_layers_, &layers_composition_)) {
+    size_t total_layers = present_sources_.size();
+    for (size_t i = 0; i < total_layers; ++i) {
+      IAHWC2::Hwc2Layer *layer = present_sources_.at(i);
+      if (layer == &client_layer_ || layer->IsCursorLayer() ||
+          layer->validated_type() != HWC2::Composition::Device)
+        continue;
+
+      if (layers_composition_.at(i) == hwcomposer::HWCLayerComposition::kGpu) {
+        layer->set_validated_type(HWC2::Composition::Client);
+        ++*num_types;
+      }
+    }
+  }
+
+  // Client target is a single layer, anything in between client layers
+  // has to be part of it.
+  size_t total_layers = z_sorted_layers_.size();
+  std::vector<bool> client_composition(total_layers);
+  for (size_t i = 0; i < total_layers; ++i) {
+    client_composition[i] = z_sorted_layers_.at(i)->validated_type() ==
+                            HWC2::Composition::Client;
+  }
+
+  if (hwcomposer::ExtendClientComposition(&client_composition)) {
+    for (size_t i = 0; i < total_layers; ++i) {
+      IAHWC2::Hwc2Layer *layer = z_sorted_layers_.at(i);
+      if (!client_composition[i] ||
+          layer->validated_type() == HWC2::Composition::Client)
+        continue;
+
+      layer->set_validated_type(HWC2::Composition::Client);
+      ++*num_types;
+    }
+  }
+
   checkValidateDisplay = true;
   return HWC2::Error::None;
 }
 
-HWC2::Error IAHWC2::Hwc2Layer::SetCursorPosition(int32_t /*x*/, int32_t /*y*/) {
+HWC2::Error IAHWC2::Hwc2Layer::SetCursorPosition(int32_t x, int32_t y) {
   supported(__func__);
+  // Cursor keeps its size, frame is moved to x, y.
+  int32_t width = hwc_layer_.GetDisplayFrameWidth();
+  int32_t height = hwc_layer_.GetDisplayFrameHeight();
+  hwc_layer_.SetDisplayFrame(
+      hwcomposer::HwcRect<int>(x, y, x + width, y + height), x_translation_);
   return HWC2::Error::None;
 }
 
@@ -882,6 +1003,45 @@ HWC2::Error IAHWC2::Hwc2Layer::SetLayerCompositionType(int32_t type) {
 HWC2::Error IAHWC2::Hwc2Layer::SetLayerDataspace(int32_t dataspace) {
   supported(__func__);
   dataspace_ = static_cast<android_dataspace_t>(dataspace);
+  hwcomposer::HWCColorSpace color_space = hwcomposer::HWCColorSpace::kDefault;
+  hwcomposer::HWCColorRange color_range = hwcomposer::HWCColorRange::kLimited;
+  // Legacy dataspaces don't have the standard and range fields.
+  switch (dataspace_) {
+    case HAL_DATASPACE_JFIF:
+      color_space = hwcomposer::HWCColorSpace::kBT601;
+      color_range = hwcomposer::HWCColorRange::kFull;
+      break;
+    case HAL_DATASPACE_BT601_625:
+    case HAL_DATASPACE_BT601_525:
+      color_space = hwcomposer::HWCColorSpace::kBT601;
+      break;
+    case HAL_DATASPACE_BT709:
+      color_space = hwcomposer::HWCColorSpace::kBT709;
+      break;
+    default:
+      switch (dataspace & HAL_DATASPACE_STANDARD_MASK) {
+        case HAL_DATASPACE_STANDARD_BT601_625:
+        case HAL_DATASPACE_STANDARD_BT601_625_UNADJUSTED:
+        case HAL_DATASPACE_STANDARD_BT601_525:
+        case HAL_DATASPACE_STANDARD_BT601_525_UNADJUSTED:
+          color_space = hwcomposer::HWCColorSpace::kBT601;
+          break;
+        case HAL_DATASPACE_STANDARD_BT709:
+          color_space = hwcomposer::HWCColorSpace::kBT709;
+          break;
+        case HAL_DATASPACE_STANDARD_BT2020:
+        case HAL_DATASPACE_STANDARD_BT2020_CONSTANT_LUMINANCE:
+          color_space = hwcomposer::HWCColorSpace::kBT2020;
+          break;
+        default:
+          break;
+      }
+
+      if ((dataspace & HAL_DATASPACE_RANGE_MASK) == HAL_DATASPACE_RANGE_FULL)
+        color_range = hwcomposer::HWCColorRange::kFull;
+  }
+
+  hwc_layer_.SetColorSpace(color_space, color_range);
   return HWC2::Error::None;
 }
 
@@ -969,6 +1129,9 @@ HWC2::Error IAHWC2::Hwc2Layer::SetLayerVisibleRegion(hwc_region_t visible) {
 HWC2::Error IAHWC2::Hwc2Layer::SetLayerZOrder(uint32_t order) {
   supported(__func__);
 
+  if (z_order_dirty_ && hwc_layer_.GetZorder() != order)
+    *z_order_dirty_ = true;
+
   hwc_layer_.SetLayerZOrder(order);
   return HWC2::Error::None;
 }
@@ -1122,8 +1285,9 @@ hwc2_function_pointer_t IAHWC2::HookDevGetFunction(struct hwc2_device * /*dev*/,
     // Layer functions
     case HWC2::FunctionDescriptor::SetCursorPosition:
       return ToHook<HWC2_PFN_SET_CURSOR_POSITION>(
-          LayerHook<decltype(&Hwc2Layer::SetCursorPosition),
-                    &Hwc2Layer::SetCursorPosition, int32_t, int32_t>);
+          DisplayHook<decltype(&HwcDisplay::SetCursorPosition),
+                      &HwcDisplay::SetCursorPosition, hwc2_layer_t, int32_t,
+                      int32_t>);
     case HWC2::FunctionDescriptor::SetLayerBlendMode:
       return ToHook<HWC2_PFN_SET_LAYER_BLEND_MODE>(
           LayerHook<decltype(&Hwc2Layer::SetLayerBlendMode),
@@ -25,6 +25,7 @@
 
 #include <map>
 #include <utility>
+#include <vector>
 
 #include "hwcservice.h"
 
@@ -91,6 +92,12 @@ class IAHWC2 : public hwc2_device_t {
       return hwc_layer_.IsCursorLayer();
     }
 
+    // Flag owned by the display which is set whenever z-order of this
+    // layer changes, so the display knows its sorted list is stale.
+    void set_z_order_dirty_flag(bool *flag) {
+      z_order_dirty_ = flag;
+    }
+
     // Layer hooks
     HWC2::Error SetCursorPosition(int32_t x, int32_t y);
     HWC2::Error SetLayerBlendMode(int32_t mode);
@@ -116,6 +123,7 @@ class IAHWC2 : public hwc2_device_t {
     hwcomposer::HwcLayer hwc_layer_;
     struct gralloc_handle native_handle_;
     uint32_t x_translation_ = 0;
+    bool *z_order_dirty_ = NULL;
   };
 
   class HwcDisplay {
@@ -171,6 +179,7 @@ class IAHWC2 : public hwc2_device_t {
     HWC2::Error SetActiveConfig(hwc2_config_t config);
     HWC2::Error SetClientTarget(buffer_handle_t target, int32_t acquire_fence,
                                 int32_t dataspace, hwc_region_t damage);
+    HWC2::Error SetCursorPosition(hwc2_layer_t layer, int32_t x, int32_t y);
     HWC2::Error SetColorMode(int32_t mode);
     HWC2::Error SetColorTransform(const float *matrix, int32_t hint);
     HWC2::Error SetOutputBuffer(buffer_handle_t buffer, int32_t release_fence);
@@ -183,10 +192,26 @@ class IAHWC2 : public hwc2_device_t {
     hwcomposer::NativeDisplay *GetDisplay();
 
    private:
+    void SortLayersByZOrder();
+    // Fills present_layers_ with the layers to be shown in z-order, based
+    // on the validated composition type of each layer.
+    void BuildLayerStack();
+    void AddToLayerStack(Hwc2Layer *layer);
+
     hwcomposer::NativeDisplay *display_ = NULL;
     hwc2_display_t handle_;
     HWC2::DisplayType type_;
     std::map<hwc2_layer_t, Hwc2Layer> layers_;
+    // All layers in layers_, kept sorted by z-order. Updated when layers
+    // are created/destroyed or their z-order changes, so that Validate
+    // and Present don't need to build a new ordering every frame.
+    std::vector<Hwc2Layer *> z_sorted_layers_;
+    // Reused across PresentDisplay calls to avoid per frame allocations.
+    std::vector<hwcomposer::HwcLayer *> present_layers_;
+    // Hwc2Layer backing each entry in present_layers_.
+    std::vector<Hwc2Layer *> present_sources_;
+    std::vector<hwcomposer::HWCLayerComposition> layers_composition_;
+    bool z_order_dirty_ = false;
     Hwc2Layer client_layer_;
     int32_t color_mode_;
 
@@ -34,7 +34,8 @@ class BpDiagnostic : public BpInterface<IDiagnostic> {
     TRANSACT_ENABLE_DISPLAY,
     TRANSACT_DISABLE_DISPLAY,
     TRANSACT_MASK_LAYER,
-    TRANSACT_DUMP_FRAMES
+    TRANSACT_DUMP_FRAMES,
+    TRANSACT_GET_FRAME_STATISTICS
   };
 
   virtual ~BpDiagnostic() {
@@ -101,6 +102,19 @@ class BpDiagnostic : public BpInterface<IDiagnostic> {
     }
   }
 
+  status_t GetFrameStatistics(uint32_t d, uint64_t sinceFrame, Parcel* reply) {
+    Parcel data;
+    data.writeInterfaceToken(IDiagnostic::getInterfaceDescriptor());
+    data.writeInt32(d);
+    data.writeUint64(sinceFrame);
+    status_t ret =
+        remote()->transact(TRANSACT_GET_FRAME_STATISTICS, data, reply);
+    if (ret != NO_ERROR) {
+      ALOGW("%s() transact failed: %d", __FUNCTION__, ret);
+    }
+    return ret;
+  }
+
  private:
   Parcel* mReply;
 };
@@ -149,6 +163,13 @@ status_t BnDiagnostic::onTransact(uint32_t code, const Parcel& data,
       return NO_ERROR;
     }
 
+    case BpDiagnostic::TRANSACT_GET_FRAME_STATISTICS: {
+      CHECK_INTERFACE(IDiagnostic, data, reply);
+      uint32_t d = data.readInt32();
+      uint64_t sinceFrame = data.readUint64();
+      return GetFrameStatistics(d, sinceFrame, reply);
+    }
+
     default:
       return BBinder::onTransact(code, data, reply, flags);
   }
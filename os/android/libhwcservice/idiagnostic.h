@@ -43,6 +43,13 @@ class IDiagnostic : public IInterface {
   virtual void DisableDisplay(uint32_t d, bool bBlank) = 0;
   virtual void MaskLayer(uint32_t d, uint32_t layer, bool bHide) = 0;
   virtual void DumpFrames(uint32_t d, int32_t frames, bool bSync) = 0;
+
+  // Writes frame statistics of display d newer than sinceFrame to reply as
+  // version, entry size, count followed by count HwcFrameStatistics
+  // entries in binary form.
+  enum { eFrameStatisticsVersion = 1 };
+  virtual status_t GetFrameStatistics(uint32_t d, uint64_t sinceFrame,
+                                      android::Parcel* reply) = 0;
 };
 
 class BnDiagnostic : public android::BnInterface<IDiagnostic> {
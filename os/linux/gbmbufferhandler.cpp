@@ -27,8 +27,24 @@
 
 #include "commondrmutils.h"
 
+// Mesa exposes gbm_bo_create_with_modifiers together with
+// GBM_BO_IMPORT_FD_MODIFIER, minigbm always has it.
+#if defined(USE_MINIGBM) || defined(GBM_BO_IMPORT_FD_MODIFIER)
+#define HAVE_GBM_MODIFIERS
+#endif
+
 namespace hwcomposer {
 
+#ifdef HAVE_GBM_MODIFIERS
+static uint64_t GetBoModifier(struct gbm_bo *bo) {
+#ifdef USE_MINIGBM
+  return gbm_bo_get_format_modifier(bo);
+#else
+  return gbm_bo_get_modifier(bo);
+#endif
+}
+#endif
+
 // static
 NativeBufferHandler *NativeBufferHandler::CreateInstance(uint32_t fd) {
   GbmBufferHandler *handler = new GbmBufferHandler(fd);
@@ -119,6 +135,46 @@ bool GbmBufferHandler::CreateBuffer(uint32_t w, uint32_t h, int format,
     return false;
   }
 
+  *handle = CreateHandle(bo, flags, 0);
+  return true;
+}
+
+bool GbmBufferHandler::CreateBufferWithModifiers(
+    uint32_t w, uint32_t h, int format, const std::vector<uint64_t> &modifiers,
+    HWCNativeHandle *handle, uint32_t layer_type) const {
+#ifdef HAVE_GBM_MODIFIERS
+  // Cursor buffers have size constraints handled by CreateBuffer and
+  // modifiers don't apply to CPU accessible buffers.
+  if (modifiers.empty() || layer_type == kLayerCursor)
+    return CreateBuffer(w, h, format, handle, layer_type);
+
+  uint32_t gbm_format = format;
+  if (gbm_format == 0)
+    gbm_format = GBM_FORMAT_XRGB8888;
+
+  // The driver picks the best layout out of the list. If it can't
+  // allocate, drop the most preferred modifier and retry, so that we
+  // e.g. end up with Y tiling if compression fails. Last resort is an
+  // allocation without modifiers.
+  size_t count = modifiers.size();
+  for (size_t i = 0; i < count; i++) {
+    struct gbm_bo *bo = gbm_bo_create_with_modifiers(
+        device_, w, h, gbm_format, modifiers.data() + i, count - i);
+    if (bo) {
+      *handle = CreateHandle(bo, GBM_BO_USE_SCANOUT | GBM_BO_USE_RENDERING,
+                             GetBoModifier(bo));
+      return true;
+    }
+  }
+
+  ETRACE("GbmBufferHandler: failed to create gbm_bo with modifiers.");
+#endif
+  return CreateBuffer(w, h, format, handle, layer_type);
+}
+
+HWCNativeHandle GbmBufferHandler::CreateHandle(struct gbm_bo *bo,
+                                               uint32_t flags,
+                                               uint64_t modifier) const {
   struct gbm_handle *temp = new struct gbm_handle();
   temp->import_data.width = gbm_bo_get_width(bo);
   temp->import_data.height = gbm_bo_get_height(bo);
@@ -129,20 +185,25 @@ bool GbmBufferHandler::CreateBuffer(uint32_t w, uint32_t h, int format,
     temp->import_data.fds[i] = gbm_bo_get_plane_fd(bo, i);
     temp->import_data.offsets[i] = gbm_bo_get_plane_offset(bo, i);
     temp->import_data.strides[i] = gbm_bo_get_plane_stride(bo, i);
+    temp->import_data.format_modifiers[i] = modifier;
   }
   temp->total_planes = total_planes;
 #else
   temp->import_data.fd = gbm_bo_get_fd(bo);
   temp->import_data.stride = gbm_bo_get_stride(bo);
   temp->total_planes = drm_bo_get_num_planes(temp->import_data.format);
+#ifdef HAVE_GBM_MODIFIERS
+  // Compressed layouts have an aux plane in the same bo.
+  if (modifier)
+    temp->total_planes = gbm_bo_get_plane_count(bo);
+#endif
 #endif
 
   temp->bo = bo;
   temp->hwc_buffer_ = true;
   temp->gbm_flags = flags;
-  *handle = temp;
-
-  return true;
+  temp->modifier = modifier;
+  return temp;
 }
 
 bool GbmBufferHandler::ReleaseBuffer(HWCNativeHandle handle) const {
@@ -182,6 +243,8 @@ void GbmBufferHandler::CopyHandle(HWCNativeHandle source,
     temp->import_data.fds[i] = dup(source->import_data.fds[i]);
     temp->import_data.offsets[i] = source->import_data.offsets[i];
     temp->import_data.strides[i] = source->import_data.strides[i];
+    temp->import_data.format_modifiers[i] =
+        source->import_data.format_modifiers[i];
   }
 #else
   temp->import_data.fd = dup(source->import_data.fd);
@@ -190,6 +253,7 @@ void GbmBufferHandler::CopyHandle(HWCNativeHandle source,
   temp->bo = source->bo;
   temp->total_planes = source->total_planes;
   temp->gbm_flags  = source->gbm_flags;
+  temp->modifier = source->modifier;
   *target = temp;
 }
 
@@ -240,7 +304,16 @@ bool GbmBufferHandler::ImportBuffer(HWCNativeHandle handle) const {
   handle->meta_data_.gem_handles_[0] = gem_handle;
   handle->meta_data_.offsets_[0] = 0;
   handle->meta_data_.pitches_[0] = gbm_bo_get_stride(handle->bo);
+#ifdef HAVE_GBM_MODIFIERS
+  for (size_t i = 1; i < handle->total_planes && handle->modifier; i++) {
+    handle->meta_data_.gem_handles_[i] = gem_handle;
+    handle->meta_data_.offsets_[i] = gbm_bo_get_offset(handle->bo, i);
+    handle->meta_data_.pitches_[i] =
+        gbm_bo_get_stride_for_plane(handle->bo, i);
+  }
+#endif
 #endif
+  handle->meta_data_.modifier_ = handle->modifier;
 
   return true;
 }
@@ -34,6 +34,10 @@ class GbmBufferHandler : public NativeBufferHandler {
 
   bool CreateBuffer(uint32_t w, uint32_t h, int format, HWCNativeHandle *handle,
                     uint32_t layer_type) const override;
+  bool CreateBufferWithModifiers(uint32_t w, uint32_t h, int format,
+                                 const std::vector<uint64_t> &modifiers,
+                                 HWCNativeHandle *handle,
+                                 uint32_t layer_type) const override;
   bool ReleaseBuffer(HWCNativeHandle handle) const override;
   void DestroyHandle(HWCNativeHandle handle) const override;
   void CopyHandle(HWCNativeHandle source,
@@ -46,6 +50,9 @@ class GbmBufferHandler : public NativeBufferHandler {
   int32_t UnMap(HWCNativeHandle handle, void *map_data) const override;
 
  private:
+  HWCNativeHandle CreateHandle(struct gbm_bo *bo, uint32_t flags,
+                               uint64_t modifier) const;
+
   uint32_t fd_;
   struct gbm_device *device_;
   uint64_t preferred_cursor_width_;
@@ -92,6 +92,8 @@ enum iahwc_function_descriptors {
   IAHWC_FUNC_LAYER_SET_SOURCE_CROP,
   IAHWC_FUNC_LAYER_SET_DISPLAY_FRAME,
   IAHWC_FUNC_LAYER_SET_SURFACE_DAMAGE,
+  IAHWC_FUNC_DISPLAY_GET_FRAME_STATISTICS,
+  IAHWC_FUNC_DISPLAY_GET_SURFACE_POOL_STATISTICS,
 };
 
 enum iahwc_callback_descriptor { IAHWC_CALLBACK_VSYNC };
@@ -124,6 +126,43 @@ typedef struct iahwc_region {
   iahwc_rect_t const* rects;
 } iahwc_region_t;
 
+enum iahwc_frame_composition_flags {
+  IAHWC_FRAME_GPU_COMPOSITION = 1 << 0,
+  IAHWC_FRAME_FULL_VALIDATION = 1 << 1,
+  IAHWC_FRAME_IDLE_UPDATE = 1 << 2,
+  IAHWC_FRAME_OVERLAYS_DISABLED = 1 << 3,
+  IAHWC_FRAME_COMMIT_FAILED = 1 << 4,
+  IAHWC_FRAME_RESUMED = 1 << 5
+};
+
+// Times are CLOCK_MONOTONIC in nanoseconds, flip_time is zero if unknown.
+typedef struct iahwc_frame_statistics {
+  uint64_t frame_number;
+  int64_t present_time;
+  int64_t commit_time;
+  int64_t flip_time;
+  int64_t fence_wait_time;
+  uint32_t missed_vblanks;
+  uint32_t composition_flags;
+  uint32_t total_layers;
+  uint32_t total_planes;
+  uint32_t release_fences;     // Layers given a release fence.
+  uint32_t release_fence_fds;  // Fds created for those release fences.
+  int64_t capture_time;        // Spent submitting the frame capture copy.
+  uint32_t static_layers;      // Layers which haven't changed for a while.
+  uint32_t frozen_planes;      // Planes of static layers reused as is.
+  uint64_t frozen_pixels;      // Pixels those planes cover.
+} iahwc_frame_statistics_t;
+
+// Counters of the pool of off-screen composition surfaces of a display.
+typedef struct iahwc_surface_pool_statistics {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+  uint64_t bytes_resident;
+  uint32_t surfaces;
+} iahwc_surface_pool_statistics_t;
+
 typedef int (*IAHWC_PFN_GET_NUM_DISPLAYS)(iahwc_device_t*, int* num_displays);
 typedef int (*IAHWC_PFN_REGISTER_CALLBACK)(iahwc_device_t*, int descriptor,
                                            iahwc_display_t display_handle,
@@ -190,6 +229,14 @@ typedef int (*IAHWC_PFN_LAYER_SET_DISPLAY_FRAME)(iahwc_device_t*,
 typedef int (*IAHWC_PFN_LAYER_SET_SURFACE_DAMAGE)(
     iahwc_device_t*, iahwc_display_t display_handle, iahwc_layer_t layer_handle,
     iahwc_region_t region);
+// Returns statistics of frames newer than since_frame. If frames is NULL
+// num_frames is set to the number of frames available.
+typedef int (*IAHWC_PFN_DISPLAY_GET_FRAME_STATISTICS)(
+    iahwc_device_t*, iahwc_display_t display_handle, uint64_t since_frame,
+    uint32_t* num_frames, iahwc_frame_statistics_t* frames);
+typedef int (*IAHWC_PFN_DISPLAY_GET_SURFACE_POOL_STATISTICS)(
+    iahwc_device_t*, iahwc_display_t display_handle,
+    iahwc_surface_pool_statistics_t* stats);
 typedef int (*IAHWC_PFN_VSYNC)(iahwc_callback_data_t data,
                                iahwc_display_t display, int64_t timestamp);
 #endif // OS_LINUX_IAHWC_H_
@@ -18,6 +18,9 @@
 #include <commondrmutils.h>
 #include <hwcrect.h>
 
+#include <algorithm>
+#include <vector>
+
 namespace hwcomposer {
 
 class IAHWCVsyncCallback : public hwcomposer::VsyncCallback {
@@ -151,6 +154,16 @@ iahwc_function_ptr_t IAHWC::HookGetFunctionPtr(iahwc_device_t* /* device */,
       return ToHook<IAHWC_PFN_LAYER_SET_SURFACE_DAMAGE>(
           LayerHook<decltype(&IAHWCLayer::SetLayerSurfaceDamage),
                     &IAHWCLayer::SetLayerSurfaceDamage, iahwc_region_t>);
+    case IAHWC_FUNC_DISPLAY_GET_FRAME_STATISTICS:
+      return ToHook<IAHWC_PFN_DISPLAY_GET_FRAME_STATISTICS>(
+          DisplayHook<decltype(&IAHWCDisplay::GetFrameStatistics),
+                      &IAHWCDisplay::GetFrameStatistics, uint64_t, uint32_t*,
+                      iahwc_frame_statistics_t*>);
+    case IAHWC_FUNC_DISPLAY_GET_SURFACE_POOL_STATISTICS:
+      return ToHook<IAHWC_PFN_DISPLAY_GET_SURFACE_POOL_STATISTICS>(
+          DisplayHook<decltype(&IAHWCDisplay::GetSurfacePoolStatistics),
+                      &IAHWCDisplay::GetSurfacePoolStatistics,
+                      iahwc_surface_pool_statistics_t*>);
     case IAHWC_FUNC_INVALID:
     default:
       return NULL;
@@ -229,6 +242,57 @@ int IAHWC::IAHWCDisplay::GetDisplayConfigs(uint32_t* num_configs,
   return IAHWC_ERROR_NONE;
 }
 
+int IAHWC::IAHWCDisplay::GetFrameStatistics(
+    uint64_t since_frame, uint32_t* num_frames,
+    iahwc_frame_statistics_t* frames) {
+  std::vector<hwcomposer::HwcFrameStatistics> stats;
+  if (!native_display_->GetFrameStatistics(since_frame, &stats))
+    return IAHWC_ERROR_UNSUPPORTED;
+
+  if (!frames) {
+    *num_frames = stats.size();
+    return IAHWC_ERROR_NONE;
+  }
+
+  uint32_t total = std::min(*num_frames, static_cast<uint32_t>(stats.size()));
+  for (uint32_t i = 0; i < total; i++) {
+    const hwcomposer::HwcFrameStatistics& stat = stats.at(i);
+    iahwc_frame_statistics_t& frame = frames[i];
+    frame.frame_number = stat.frame_number;
+    frame.present_time = stat.present_time;
+    frame.commit_time = stat.commit_time;
+    frame.flip_time = stat.flip_time;
+    frame.fence_wait_time = stat.fence_wait_time;
+    frame.missed_vblanks = stat.missed_vblanks;
+    frame.composition_flags = stat.composition_flags;
+    frame.total_layers = stat.total_layers;
+    frame.total_planes = stat.total_planes;
+    frame.release_fences = stat.release_fences;
+    frame.release_fence_fds = stat.release_fence_fds;
+    frame.capture_time = stat.capture_time;
+    frame.static_layers = stat.static_layers;
+    frame.frozen_planes = stat.frozen_planes;
+    frame.frozen_pixels = stat.frozen_pixels;
+  }
+
+  *num_frames = total;
+  return IAHWC_ERROR_NONE;
+}
+
+int IAHWC::IAHWCDisplay::GetSurfacePoolStatistics(
+    iahwc_surface_pool_statistics_t* stats) {
+  hwcomposer::HwcSurfacePoolStatistics pool_stats;
+  if (!native_display_->GetSurfacePoolStatistics(&pool_stats))
+    return IAHWC_ERROR_UNSUPPORTED;
+
+  stats->hits = pool_stats.hits;
+  stats->misses = pool_stats.misses;
+  stats->evictions = pool_stats.evictions;
+  stats->bytes_resident = pool_stats.bytes_resident;
+  stats->surfaces = pool_stats.surfaces;
+  return IAHWC_ERROR_NONE;
+}
+
 int IAHWC::IAHWCDisplay::SetDisplayGamma(float r, float b, float g) {
   native_display_->SetGamma(r, g, b);
   return IAHWC_ERROR_NONE;
@@ -67,6 +67,9 @@ class IAHWC : public iahwc_device {
     int GetDisplayConfig(uint32_t* config);
     int ClearAllLayers();
     int PresentDisplay(int32_t* release_fd);
+    int GetFrameStatistics(uint64_t since_frame, uint32_t* num_frames,
+                           iahwc_frame_statistics_t* frames);
+    int GetSurfacePoolStatistics(iahwc_surface_pool_statistics_t* stats);
     int RegisterVsyncCallback(iahwc_callback_data_t data,
                               iahwc_function_ptr_t hook);
     int CreateLayer(uint32_t* layer_handle);
@@ -68,5 +68,10 @@ VkFormat NativeToVkFormat(int native_format) {
 #endif
 
 int ReleaseFrameBuffer(uint32_t gpu_fd, uint32_t fd) {
+#ifdef USE_HEADLESS_WSI
+  // Framebuffer ids are synthetic, see DrmBuffer::CreateFrameBuffer.
+  return 0;
+#else
   return drmModeRmFB(gpu_fd, fd);
+#endif
 }
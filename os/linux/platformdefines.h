@@ -49,6 +49,9 @@ struct gbm_handle {
   bool is_raw_pixel_ = false;
   void* pixel_memory_ = NULL;
   uint32_t gbm_flags = 0;
+  // Modifier the bo was allocated with, see
+  // GbmBufferHandler::CreateBufferWithModifiers.
+  uint64_t modifier = 0;
 };
 
 typedef struct gbm_handle* HWCNativeHandle;
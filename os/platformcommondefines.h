@@ -34,6 +34,11 @@ VkFormat NativeToVkFormat(int native_format);
 // minigbm specific DRM_FORMAT_YVU420_ANDROID enum
 #define DRM_FORMAT_YVU420_ANDROID fourcc_code('9', '9', '9', '7')
 
+// Chroma plane of P010, not known to older libdrm.
+#ifndef DRM_FORMAT_GR1616
+#define DRM_FORMAT_GR1616 fourcc_code('G', 'R', '3', '2')
+#endif
+
 #define HWC_UNUSED(x) ((void)&(x))
 
 inline void hash_combine_hwc(size_t& seed, size_t value) {
@@ -21,6 +21,8 @@
 #include <fstream>
 #include <string>
 #include <sstream>
+#include <thread>
+#include <vector>
 
 #include "displaymanager.h"
 #include "logicaldisplaymanager.h"
@@ -68,6 +70,21 @@ class GpuDevice : public HWCThread {
     kInitialized = 1 << 4  // Everything Initialized
   };
 
+  // Display configuration read from hwc_display.ini.
+  struct HWCSettings {
+    bool use_logical = false;
+    bool use_mosaic = false;
+    bool use_cloned = false;
+    bool rotate_display = false;
+    std::vector<uint32_t> logical_displays;
+    std::vector<uint32_t> physical_displays;
+    std::vector<uint32_t> display_rotation;
+    std::vector<uint32_t> rotation_display_index;
+    std::vector<std::vector<uint32_t>> cloned_displays;
+    std::vector<std::vector<uint32_t>> mosaic_displays;
+  };
+
+  static void ParseHWCSettings(HWCSettings* settings);
   void HandleHWCSettings();
   void InitializeHotPlugEvents(bool take_lock = true);
   void DisableWatch();
@@ -77,12 +94,15 @@ class GpuDevice : public HWCThread {
   std::vector<std::unique_ptr<LogicalDisplayManager>> logical_display_manager_;
   std::vector<std::unique_ptr<NativeDisplay>> mosaic_displays_;
   std::vector<NativeDisplay*> total_displays_;
+  HWCSettings hwc_settings_;
+  std::thread settings_thread_;
   uint32_t initialization_state_ = kUnInitialized;
   SpinLock initialization_state_lock_;
   SpinLock thread_stage_lock_;
   SpinLock thread_sync_lock_;
   int lock_fd_ = -1;
   friend class DrmDisplayManager;
+  friend class HeadlessDisplayManager;
 };
 
 }  // namespace hwcomposer
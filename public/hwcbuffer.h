@@ -35,6 +35,9 @@ struct HwcBuffer {
   uint32_t offsets_[4];
   uint32_t gem_handles_[4];
   uint32_t prime_fd_ = 0;
+  // DRM_FORMAT_MOD_* layout of the buffer. Zero (linear) unless the buffer
+  // was allocated with explicit modifiers.
+  uint64_t modifier_ = 0;
   hwcomposer::HWCLayerType usage_ = hwcomposer::kLayerNormal;
 };
 
@@ -70,6 +70,26 @@ enum HWCLayerType {
   kLayerVideo = 3
 };
 
+// Color space of YUV content, used when it's converted to RGB during
+// composition. kDefault picks BT.601 for SD and BT.709 for HD content.
+enum class HWCColorSpace : int32_t {
+  kDefault = 0,
+  kBT601 = 1,
+  kBT709 = 2,
+  kBT2020 = 3
+};
+
+enum class HWCColorRange : int32_t {
+  kLimited = 0,  // Luma 16-235, chroma 16-240 for 8 bit content.
+  kFull = 1
+};
+
+// Composition chosen for a layer when validating a layer stack.
+enum class HWCLayerComposition : int32_t {
+  kGpu = 0,     // Layer is composited into an off-screen buffer.
+  kDisplay = 1  // Layer is scanned out directly by a display plane.
+};
+
 enum class HWCDisplayAttribute : int32_t {
   kWidth = 1,
   kHeight = 2,
@@ -123,6 +143,23 @@ enum class HWCDeinterlaceControl : int32_t {
   kDeinterlaceMotionCompensated = 4
 };
 
+// Kind of content a display is mostly showing, see
+// NativeDisplay::SetOptimizationMode.
+enum class HWCOptimizationMode : int32_t {
+  kOptimizeNormal = 0,
+  kOptimizeVideo = 1,  // Video is being played.
+  kOptimizeCamera = 2  // Camera preview is being shown.
+};
+
+// How content is laid out on a display of a different size, see
+// NativeDisplay::SetDisplayScaling.
+enum class HWCDisplayScaling : int32_t {
+  kScaleCentre = 0,   // Centred at 1:1, cropped if larger than the display.
+  kScaleStretch = 1,  // Fills the display, aspect ratio isn't preserved.
+  kScaleFit = 2,      // Fits the display, letterboxed or pillarboxed.
+  kScaleFill = 3      // Fills the display keeping aspect ratio, cropped.
+};
+
 enum class HWCScalingRunTimeSetting : int32_t {
   kScalingModeNone = 0,        // use default scaling mode.
   kScalingModeFast = 1,        // use fast scaling mode.
@@ -146,6 +183,95 @@ struct HWCDeinterlaceProp {
   HWCDeinterlaceControl mode_;
 };
 
+// Describes how a presented frame was composed.
+enum HWCFrameCompositionFlags {
+  kFrameGpuComposition = 1 << 0,    // Some layers were composited off-screen.
+  kFrameFullValidation = 1 << 1,    // Layers were re-assigned to planes.
+  kFrameIdleUpdate = 1 << 2,        // Idle frame, composited to one plane.
+  kFrameOverlaysDisabled = 1 << 3,  // Overlay usage was disabled.
+  kFrameCommitFailed = 1 << 4,      // Frame didn't reach the screen.
+  kFrameResumed = 1 << 5            // Last frame shown again on power on.
+};
+
+// Statistics recorded for every frame presented on a display. Times are
+// CLOCK_MONOTONIC in nanoseconds. The layout is fixed, as these are
+// exported as is to clients.
+struct HwcFrameStatistics {
+  uint64_t frame_number = 0;
+  int64_t present_time = 0;     // Present was called.
+  int64_t commit_time = 0;      // Frame was committed to the kernel.
+  int64_t flip_time = 0;        // Frame was shown on screen.
+  int64_t fence_wait_time = 0;  // Time spent blocked on flip fences.
+  uint32_t missed_vblanks = 0;  // Vblanks passed between commit and flip.
+  uint32_t composition_flags = 0;
+  uint32_t total_layers = 0;
+  uint32_t total_planes = 0;
+  // Layers given a release fence, which took an fd each before release
+  // fences were shared.
+  uint32_t release_fences = 0;
+  // Fds created for release fences of the frame until it was shown.
+  uint32_t release_fence_fds = 0;
+  // Time the frame spent submitting its copy for frame capture.
+  int64_t capture_time = 0;
+  // Layers classified static, see HwcLayerStatistics.
+  uint32_t static_layers = 0;
+  // Off-screen planes holding only static layers whose composition was
+  // reused instead of being redrawn, and the pixels they cover.
+  uint32_t frozen_planes = 0;
+  uint64_t frozen_pixels = 0;
+  // Bytes sent to the host compositor by a nested display, file
+  // descriptors not included.
+  uint64_t forwarded_bytes = 0;
+};
+
+// How often the content of a layer changes, buffer or damage wise.
+enum HwcLayerUpdateClass {
+  kLayerUpdateOccasional = 0,
+  kLayerUpdateStatic = 1,   // Unchanged for a while, may be frozen.
+  kLayerUpdateDynamic = 2,  // Changes in most frames.
+};
+
+// Per layer update tracking of the last frame presented on a display.
+struct HwcLayerStatistics {
+  uint32_t z_order = 0;
+  HwcLayerUpdateClass update_class = kLayerUpdateOccasional;
+  uint32_t frames_unchanged = 0;
+  // Fraction of recent frames the layer changed in, in percent.
+  uint32_t update_rate = 0;
+  // Composited with other static layers into a plane which was reused.
+  bool frozen = false;
+};
+
+// Counters of frame capture, see NativeDisplay::StartFrameCapture. Frames
+// are dropped rather than stalling composition, when all staging buffers
+// are still being read back or the queue of captured frames is full.
+struct HwcFrameCaptureStatistics {
+  uint64_t captured = 0;
+  uint64_t dropped = 0;
+  uint64_t bytes = 0;         // Size of the frames captured.
+  int64_t submit_time = 0;    // Spent on the composition path, in total.
+  int64_t readback_time = 0;  // Spent by the capture worker, in total.
+  uint32_t pending = 0;       // Frames still to be captured.
+};
+
+// Frame kept in memory by frame capture, as a PAM image.
+struct HwcCapturedFrame {
+  uint64_t sequence = 0;  // Frames presented since capture started.
+  std::vector<uint8_t> image;
+};
+
+// Counters of the pool of off-screen composition surfaces of a display.
+// Hits and misses count surface requests served from the pool or by a
+// new allocation, evictions count surfaces freed to stay within the
+// pool's memory limits.
+struct HwcSurfacePoolStatistics {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+  uint64_t bytes_resident = 0;  // Estimated memory held by the pool.
+  uint32_t surfaces = 0;        // Surfaces held by the pool.
+};
+
 using HWCColorMap =
     std::unordered_map<HWCColorControl, HWCColorProp, EnumClassHash>;
 
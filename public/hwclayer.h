@@ -21,8 +21,13 @@
 
 #include <platformdefines.h>
 
+#include <memory>
+#include <vector>
+
 namespace hwcomposer {
 
+class SharedFence;
+
 struct HwcLayer {
   ~HwcLayer();
 
@@ -54,6 +59,17 @@ struct HwcLayer {
     return blending_;
   }
 
+  // Color space and range of YUV buffers, ignored for RGB ones.
+  void SetColorSpace(HWCColorSpace color_space, HWCColorRange color_range);
+
+  HWCColorSpace GetColorSpace() const {
+    return color_space_;
+  }
+
+  HWCColorRange GetColorRange() const {
+    return color_range_;
+  }
+
   void SetSourceCrop(const HwcRect<float>& source_crop);
   const HwcRect<float>& GetSourceCrop() const {
     return source_crop_;
@@ -185,7 +201,9 @@ struct HwcLayer {
    * @return "-1" if no valid release fence present
    *         for this layer. Ownership of fd is passed
    *         to caller and caller is responsible for
-   *	     closing the fd.
+   *	     closing the fd. If the layer was released
+   *         by several displays, their fences are merged
+   *         into the returned one.
    */
   int32_t GetReleaseFence();
 
@@ -253,9 +271,16 @@ struct HwcLayer {
                              const HwcRect<int>& newrect, bool same_rect);
 
   void SetTotalDisplays(uint32_t total_displays);
+
+  // Adds a fence shared with other layers to the release fences of this
+  // layer. No fd is created for this layer until GetReleaseFence.
+  void AddReleaseFence(const std::shared_ptr<SharedFence>& fence);
+
+  friend class DisplayQueue;
   friend class VirtualDisplay;
   friend class PhysicalDisplay;
   friend class MosaicDisplay;
+  friend class NestedDisplay;
 
   enum LayerState {
     kSurfaceDamageChanged = 1 << 0,
@@ -284,8 +309,11 @@ struct HwcLayer {
   HwcRect<int> visible_rect_;
   HwcRect<int> current_rendering_damage_;
   HWCBlending blending_ = HWCBlending::kBlendingNone;
+  HWCColorSpace color_space_ = HWCColorSpace::kDefault;
+  HWCColorRange color_range_ = HWCColorRange::kLimited;
   HWCNativeHandle sf_handle_ = 0;
   int32_t release_fd_ = -1;
+  std::vector<std::shared_ptr<SharedFence>> shared_release_fences_;
   int32_t acquire_fence_ = -1;
   std::vector<int32_t> left_constraint_;
   std::vector<int32_t> right_constraint_;
@@ -19,6 +19,8 @@
 
 #include <hwcdefs.h>
 
+#include <vector>
+
 namespace hwcomposer {
 
 // Helper functions.
@@ -28,6 +30,14 @@ namespace hwcomposer {
 //  is not ready.
 int HWCPoll(int fd, int timeout);
 
+// Sets time to when the last fence of sync file fd signalled, in
+// CLOCK_MONOTONIC nanoseconds as reported by the kernel. Returns false if
+// fd hasn't signalled or the kernel doesn't report it.
+bool GetFenceSignalTime(int fd, int64_t* time);
+
+// Returns CLOCK_MONOTONIC in nanoseconds.
+int64_t GetMonotonicTime();
+
 // Reset's rect to include region hwc_region.
 void ResetRectToRegion(const HwcRegion& hwc_region, HwcRect<int>& rect);
 
@@ -46,6 +56,21 @@ bool IsSupportedMediaFormat(uint32_t format);
 // Returns total planes for a given format.
 uint32_t GetTotalPlanesForFormat(uint32_t format);
 
+// Fills modifiers with the entries of renderer_modifiers, which are in
+// order of preference, that are also in plane_modifiers. modifiers is
+// left empty if either list is, allocation should then not request any
+// explicit layout.
+void NegotiateModifiers(const std::vector<uint64_t>& plane_modifiers,
+                        const std::vector<uint64_t>& renderer_modifiers,
+                        std::vector<uint64_t>* modifiers);
+
+// Layers composited by the client end up in a single target, which can't
+// be placed in between layers we scan out. Marks all layers between the
+// bottom most and top most one composited by the client as composited by
+// the client too, client_composition being in z order. Returns the number
+// of layers marked.
+size_t ExtendClientComposition(std::vector<bool>* client_composition);
+
 template <class T>
 inline bool IsOverlapping(T l1, T t1, T r1, T b1, T l2, T t2, T r2, T b2)
 // Do two rectangles overlap?
@@ -19,6 +19,8 @@
 
 #include <stdint.h>
 
+#include <vector>
+
 #include <platformdefines.h>
 #include <hwcdefs.h>
 
@@ -35,6 +37,16 @@ class NativeBufferHandler {
                             HWCNativeHandle *handle = NULL,
                             uint32_t layer_type = kLayerNormal) const = 0;
 
+  // Like CreateBuffer, but the buffer is allocated with one of modifiers,
+  // which are in order of preference. Implementations without modifier
+  // support fall back to CreateBuffer.
+  virtual bool CreateBufferWithModifiers(
+      uint32_t w, uint32_t h, int format,
+      const std::vector<uint64_t> & /*modifiers*/, HWCNativeHandle *handle,
+      uint32_t layer_type = kLayerNormal) const {
+    return CreateBuffer(w, h, format, handle, layer_type);
+  }
+
   virtual bool ReleaseBuffer(HWCNativeHandle handle) const = 0;
 
   virtual void DestroyHandle(HWCNativeHandle handle) const = 0;
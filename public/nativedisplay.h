@@ -38,6 +38,10 @@ class VsyncCallback {
   virtual ~VsyncCallback() {
   }
   virtual void Callback(uint32_t display, int64_t timestamp) = 0;
+  // Called when the vsync period of display changed without the active
+  // config changing, e.g. to match the content rate. period is in ns.
+  virtual void PeriodChanged(uint32_t /*display*/, int64_t /*period*/) {
+  }
 };
 
 class RefreshCallback {
@@ -102,6 +106,40 @@ class NativeDisplay {
                        int32_t *retire_fence,
                        bool handle_constraints = false) = 0;
 
+  /**
+   * API for checking how source_layers would be composited if they were
+   * passed to Present, without committing anything to the display.
+   * @param source_layers, are the layers to be validated. Acquire fences
+   *        and layer state are left untouched.
+   * @param composition will be populated with one entry per layer in
+   *        source_layers telling if the layer would be scanned out
+   *        directly or composited by us.
+   * @return false if validation is not supported by this display. Callers
+   *         should not make any assumptions about composition in this case.
+   */
+  virtual bool ValidateLayers(std::vector<HwcLayer *> & /*source_layers*/,
+                              std::vector<HWCLayerComposition> *
+                              /*composition*/) {
+    return false;
+  }
+
+  /**
+   * API for moving the cursor or changing its buffer without waiting for
+   * the next Present. Only the plane showing the cursor is updated.
+   * @param cursor_layer, the cursor layer passed to the last Present, with
+   *        its new display frame and/or buffer.
+   * @param retire_fence will be populated with a Native Fence object
+   *        signalled when the update is shown, -1 if there is none.
+   * @return false if the update could not be done on its own, in which case
+   *         it needs to go with the next Present. This is the case if the
+   *         cursor isn't on a plane of its own or a frame is being presented
+   *         at the same time.
+   */
+  virtual bool UpdateCursor(HwcLayer * /*cursor_layer*/,
+                            int32_t * /*retire_fence*/) {
+    return false;
+  }
+
   virtual int RegisterVsyncCallback(std::shared_ptr<VsyncCallback> callback,
                                     uint32_t display_id) = 0;
   virtual void VSyncControl(bool enabled) = 0;
@@ -225,6 +263,155 @@ class NativeDisplay {
   virtual void RestoreVideoDefaultDeinterlace() {
   }
 
+  /**
+   * API for informing display about start or end of a video playback
+   * session.
+   * @param session_id identifies the video session.
+   * @param is_prepared true when playback is starting, false when done.
+   */
+  virtual void UpdateVideoState(int64_t /*session_id*/, bool /*is_prepared*/) {
+  }
+
+  /**
+   * API for informing display about frame rate of a video playback
+   * session. Display might change its refresh rate to match content.
+   * @param session_id identifies the video session.
+   * @param fps frame rate of the video content.
+   */
+  virtual void UpdateVideoFPS(int64_t /*session_id*/, int32_t /*fps*/) {
+  }
+
+  /**
+   * API for telling display what kind of content it is showing. With
+   * kOptimizeVideo, planes are set aside for video layers as during a
+   * video session announced through UpdateVideoState.
+   * @param mode kind of content being shown.
+   */
+  virtual void SetOptimizationMode(HWCOptimizationMode /*mode*/) {
+  }
+
+  /**
+   * API for compensating overscan of the display. Layers are scaled by
+   * the display planes and keep their composition.
+   * @param x_overscan, y_overscan in the range -100 to 100. Positive
+   *        values shrink content by up to 15% of the display size,
+   *        negative ones zoom into it.
+   * @return false if overscan is not supported by this display.
+   */
+  virtual bool SetOverscan(int32_t /*x_overscan*/, int32_t /*y_overscan*/) {
+    return false;
+  }
+
+  virtual bool GetOverscan(int32_t * /*x_overscan*/,
+                           int32_t * /*y_overscan*/) {
+    return false;
+  }
+
+  /**
+   * API for choosing how content is laid out when it doesn't have the
+   * size of the display, i.e. when cloned to a display of another size.
+   * @param mode scaling to be used, kScaleStretch by default.
+   * @return false if scaling is not supported by this display.
+   */
+  virtual bool SetDisplayScaling(HWCDisplayScaling /*mode*/) {
+    return false;
+  }
+
+  virtual bool GetDisplayScaling(HWCDisplayScaling * /*mode*/) {
+    return false;
+  }
+
+  /**
+   * API for blanking the display while keeping it powered on and its
+   * mode set. Frames presented meanwhile are dropped, unblank refreshes
+   * the display so that a new frame is presented.
+   * @param blank true to blank, false to unblank.
+   * @return false if blanking is not supported by this display.
+   */
+  virtual bool SetBlank(bool /*blank*/) {
+    return false;
+  }
+
+  /**
+   * API for reading timing statistics of frames recently presented on
+   * this display. Safe to call from any thread.
+   * @param since_frame only frames with frame_number greater than this are
+   *        returned, pass 0 to get all frames still tracked.
+   * @param frames will be populated with the statistics, oldest first.
+   * @return false if statistics are not supported by this display.
+   */
+  virtual bool GetFrameStatistics(
+      uint64_t /*since_frame*/, std::vector<HwcFrameStatistics> * /*frames*/) {
+    return false;
+  }
+
+  /**
+   * API for reading counters of the pool of off-screen surfaces used for
+   * composition on this display. Safe to call from any thread.
+   * @param stats will be populated with the counters.
+   * @return false if the display doesn't composite off-screen.
+   */
+  virtual bool GetSurfacePoolStatistics(HwcSurfacePoolStatistics * /*stats*/) {
+    return false;
+  }
+
+  /**
+   * API for reading how often the layers of the last frame presented on
+   * this display changed and whether they were frozen, i.e. composited
+   * once with other static layers and reused. Safe to call from any
+   * thread.
+   * @param layers will be populated with one entry per layer, bottom
+   *        most first.
+   * @return false if the display doesn't track layer updates.
+   */
+  virtual bool GetLayerStatistics(
+      std::vector<HwcLayerStatistics> * /*layers*/) {
+    return false;
+  }
+
+  /**
+   * API for capturing the next frames shown on this display, for
+   * diagnostics. Frames are copied and read back asynchronously, frames
+   * which can't be captured without stalling composition are dropped.
+   * @param frames number of frames to capture, 0 stops capturing.
+   * @param directory frames are written there as frame-<sequence>.pam if
+   *        not NULL, otherwise the latest ones are kept in memory for
+   *        TakeCapturedFrames.
+   * @return false if frame capture is not supported by this display.
+   */
+  virtual bool StartFrameCapture(uint32_t /*frames*/,
+                                 const char * /*directory*/) {
+    return false;
+  }
+
+  /**
+   * API for reading frame capture counters. Safe to call from any thread.
+   * @return false if frame capture is not supported by this display.
+   */
+  virtual bool GetFrameCaptureStatistics(
+      HwcFrameCaptureStatistics * /*stats*/) {
+    return false;
+  }
+
+  /**
+   * API for taking the frames captured in memory so far, oldest first.
+   * Safe to call from any thread.
+   */
+  virtual void TakeCapturedFrames(std::vector<HwcCapturedFrame> * /*frames*/) {
+  }
+
+  /**
+   * API for keeping imported buffers, plane assignments and off-screen
+   * surfaces of the last frame while the display is off or dozing. The
+   * last frame is then shown again as soon as the display is powered on
+   * and the next frames don't start from cold caches.
+   * @param enable false drops everything on power off, the default.
+   * @param surface_budget bytes off-screen surfaces may keep while
+   *        suspended. Displays whose last frame needs more suspend cold.
+   */
+  virtual void SetWarmSuspend(bool /*enable*/, uint64_t /*surface_budget*/) {
+  }
+
   /**
    * API for setting display Broadcast RGB range property
    * @param range_property supported property string, e.g. "Full", "Automatic"
@@ -70,6 +70,7 @@ LOCAL_SRC_FILES := \
     common/imagelayerrenderer.cpp \
     common/cclayerrenderer.cpp \
     common/esTransform.cpp \
+    common/frametimingrecorder.cpp \
     common/jsonhandlers.cpp \
     apps/jsonlayerstest.cpp
 
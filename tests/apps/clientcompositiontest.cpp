@@ -0,0 +1,86 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Checks which layers end up composited by the client once validation
+// demoted some of them, as ValidateDisplay of HWC2 does. Doesn't need any
+// hardware, exits non-zero on failure.
+
+#include <stdio.h>
+
+#include <vector>
+
+#include "hwcutils.h"
+#include "unittest.h"
+
+using hwcomposer::ExtendClientComposition;
+
+namespace {
+
+void TestNoClientLayers() {
+  std::vector<bool> client;
+  CHECK(ExtendClientComposition(&client) == 0);
+
+  client = {false, false, false};
+  CHECK(ExtendClientComposition(&client) == 0);
+  CHECK(client == std::vector<bool>({false, false, false}));
+}
+
+void TestContiguousClientLayers() {
+  // Device layers below and above the client target stay on planes.
+  std::vector<bool> client = {false, true, true, false};
+  CHECK(ExtendClientComposition(&client) == 0);
+  CHECK(client == std::vector<bool>({false, true, true, false}));
+
+  client = {true, false, false};
+  CHECK(ExtendClientComposition(&client) == 0);
+  CHECK(client == std::vector<bool>({true, false, false}));
+
+  client = {false, false, true};
+  CHECK(ExtendClientComposition(&client) == 0);
+  CHECK(client == std::vector<bool>({false, false, true}));
+}
+
+void TestInterleavedClientLayers() {
+  // Device layer sandwiched between two client layers, e.g. a video plane
+  // under a demoted overlay and above a demoted wallpaper.
+  std::vector<bool> client = {true, false, true};
+  CHECK(ExtendClientComposition(&client) == 1);
+  CHECK(client == std::vector<bool>({true, true, true}));
+
+  // Only layers in between are demoted, not the ones outside the span.
+  client = {false, true, false, false, true, false};
+  CHECK(ExtendClientComposition(&client) == 2);
+  CHECK(client ==
+        std::vector<bool>({false, true, true, true, true, false}));
+
+  // Several gaps.
+  client = {true, false, true, false, false, true, false};
+  CHECK(ExtendClientComposition(&client) == 3);
+  CHECK(client ==
+        std::vector<bool>({true, true, true, true, true, true, false}));
+
+  // Already extended, nothing changes.
+  CHECK(ExtendClientComposition(&client) == 0);
+}
+
+}  // namespace
+
+int main() {
+  TestNoClientLayers();
+  TestContiguousClientLayers();
+  TestInterleavedClientLayers();
+  return ReportChecks();
+}
@@ -0,0 +1,510 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Measures cursor input-to-scanout latency while full frames are presented
+// back to back. Every input event moves the cursor layer. The first run
+// leaves each move to the next Present, the second one tries
+// NativeDisplay::UpdateCursor first and only falls back to the next
+// Present when that fails. The third one does the same from a thread of
+// its own, as the HWC2 cursor position hook does, so updates contend with
+// frames being presented. It also reports the longest UpdateCursor call,
+// which shouldn't wait for a frame in flight.
+//
+// Latency is measured up to the signal of the out fence of the commit
+// showing the move. Commits without one, i.e. legacy cursor moves or
+// headless displays, are assumed to be shown at the following vblank.
+//
+// Usage: cursorlatencybench [frames] [input_interval_us]
+
+#include <drm_fourcc.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gpudevice.h>
+#include <hwclayer.h>
+#include <nativebufferhandler.h>
+#include <nativedisplay.h>
+
+namespace {
+
+const uint32_t kCursorSize = 64;
+const int32_t kFenceTimeoutMs = 1000;
+
+int64_t NowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Collects latencies of cursor updates. Fences are waited on by a thread
+// of its own so that the time they signal is taken as it happens.
+class LatencyRecorder {
+ public:
+  LatencyRecorder() : waiter_(&LatencyRecorder::WaitForFences, this) {
+  }
+
+  ~LatencyRecorder() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      exit_ = true;
+    }
+    fences_changed_.notify_one();
+    waiter_.join();
+  }
+
+  // Update made at input_time was committed at commit_time, fence is
+  // signalled once it's on screen or -1 if there is none. Takes ownership
+  // of fence.
+  void Committed(int64_t input_time, int64_t commit_time, int32_t fence) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fence > 0) {
+      pending_fences_.push_back(Pending{input_time, commit_time, fence});
+      fences_changed_.notify_one();
+    } else {
+      pending_vblanks_.push_back(Pending{input_time, commit_time, -1});
+    }
+  }
+
+  void Vblank(int64_t timestamp) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Pending> pending;
+    for (const Pending& update : pending_vblanks_) {
+      if (update.commit_time < timestamp) {
+        latencies_.emplace_back(timestamp - update.input_time);
+      } else {
+        pending.emplace_back(update);
+      }
+    }
+
+    pending_vblanks_.swap(pending);
+  }
+
+  // Waits for all updates to be shown and returns their latencies.
+  std::vector<int64_t> Finish() {
+    int64_t deadline = NowNs() + kFenceTimeoutMs * 1000000LL;
+    while (NowNs() < deadline) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_fences_.empty() && pending_vblanks_.empty() &&
+            !waiting_)
+          break;
+      }
+
+      usleep(1000);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return latencies_;
+  }
+
+ private:
+  struct Pending {
+    int64_t input_time;
+    int64_t commit_time;
+    int32_t fence;
+  };
+
+  void WaitForFences() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      fences_changed_.wait(
+          lock, [this] { return exit_ || !pending_fences_.empty(); });
+      if (pending_fences_.empty())
+        return;
+
+      Pending update = pending_fences_.front();
+      pending_fences_.pop_front();
+      waiting_ = true;
+      lock.unlock();
+
+      struct pollfd fds;
+      fds.fd = update.fence;
+      fds.events = POLLIN;
+      int ret = poll(&fds, 1, kFenceTimeoutMs);
+      int64_t now = NowNs();
+      close(update.fence);
+
+      lock.lock();
+      waiting_ = false;
+      if (ret > 0)
+        latencies_.emplace_back(now - update.input_time);
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable fences_changed_;
+  std::deque<Pending> pending_fences_;
+  std::vector<Pending> pending_vblanks_;
+  std::vector<int64_t> latencies_;
+  bool waiting_ = false;
+  bool exit_ = false;
+  std::thread waiter_;
+};
+
+class VblankListener : public hwcomposer::VsyncCallback {
+ public:
+  void Callback(uint32_t /*display*/, int64_t timestamp) override {
+    LatencyRecorder* recorder = recorder_;
+    if (recorder)
+      recorder->Vblank(timestamp);
+  }
+
+  std::atomic<LatencyRecorder*> recorder_{NULL};
+};
+
+struct Scenario {
+  hwcomposer::NativeDisplay* display;
+  HWCNativeHandle backgrounds[2];
+  HWCNativeHandle cursor;
+  uint32_t frames;
+  int64_t frame_period;
+  int64_t input_interval;
+  std::shared_ptr<VblankListener> listener;
+};
+
+enum class Mode { kNextFrame, kFastPath, kThreaded };
+
+struct Result {
+  std::vector<int64_t> latencies;
+  uint32_t inputs = 0;
+  uint32_t fast_path = 0;
+  int64_t max_update_call = 0;
+};
+
+// Moves the cursor to the next position of its path.
+void MoveCursor(hwcomposer::HwcLayer* cursor, int32_t width, int32_t height,
+                int32_t* x, int32_t* y) {
+  *x = (*x + 7) % (width - kCursorSize);
+  *y = (*y + 5) % (height - kCursorSize);
+  cursor->SetDisplayFrame(
+      hwcomposer::HwcRect<int>(*x, *y, *x + kCursorSize, *y + kCursorSize),
+      0);
+}
+
+// Input events of the threaded run. Moves that couldn't be shown on their
+// own are left to the next Present.
+class InputThread {
+ public:
+  InputThread(const Scenario& scenario, hwcomposer::HwcLayer* cursor,
+              LatencyRecorder* recorder, Result* result)
+      : scenario_(scenario),
+        cursor_(cursor),
+        recorder_(recorder),
+        result_(result),
+        thread_(&InputThread::Run, this) {
+  }
+
+  ~InputThread() {
+    Stop();
+  }
+
+  void Stop() {
+    exit_ = true;
+    if (thread_.joinable())
+      thread_.join();
+  }
+
+  void TakeUnsentInputs(std::vector<int64_t>* inputs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    inputs->swap(unsent_inputs_);
+  }
+
+ private:
+  void Run() {
+    hwcomposer::NativeDisplay* display = scenario_.display;
+    int32_t width = display->Width();
+    int32_t height = display->Height();
+    int32_t x = 0;
+    int32_t y = 0;
+    while (!exit_) {
+      usleep(scenario_.input_interval / 1000);
+      MoveCursor(cursor_, width, height, &x, &y);
+
+      int64_t input_time = NowNs();
+      int32_t fence = -1;
+      bool updated = display->UpdateCursor(cursor_, &fence);
+      int64_t now = NowNs();
+      std::lock_guard<std::mutex> lock(mutex_);
+      result_->inputs++;
+      result_->max_update_call =
+          std::max(result_->max_update_call, now - input_time);
+      if (updated) {
+        result_->fast_path++;
+        recorder_->Committed(input_time, now, fence);
+      } else {
+        unsent_inputs_.emplace_back(input_time);
+      }
+    }
+  }
+
+  const Scenario& scenario_;
+  hwcomposer::HwcLayer* cursor_;
+  LatencyRecorder* recorder_;
+  Result* result_;
+  std::mutex mutex_;
+  std::vector<int64_t> unsent_inputs_;
+  std::atomic<bool> exit_{false};
+  std::thread thread_;
+};
+
+void CloseReleaseFences(std::vector<hwcomposer::HwcLayer*>& layers) {
+  for (hwcomposer::HwcLayer* layer : layers) {
+    int32_t fence = layer->GetReleaseFence();
+    if (fence > 0)
+      close(fence);
+  }
+}
+
+void Run(const Scenario& scenario, Mode mode, Result* result) {
+  hwcomposer::NativeDisplay* display = scenario.display;
+  int32_t width = display->Width();
+  int32_t height = display->Height();
+
+  hwcomposer::HwcLayer background;
+  background.SetTransform(0);
+  background.SetSourceCrop(hwcomposer::HwcRect<float>(0, 0, width, height));
+  background.SetDisplayFrame(hwcomposer::HwcRect<int>(0, 0, width, height),
+                             0);
+
+  hwcomposer::HwcLayer cursor;
+  cursor.MarkAsCursorLayer();
+  cursor.SetTransform(0);
+  cursor.SetBlending(hwcomposer::HWCBlending::kBlendingPremult);
+  cursor.SetNativeHandle(scenario.cursor);
+  cursor.SetSourceCrop(
+      hwcomposer::HwcRect<float>(0, 0, kCursorSize, kCursorSize));
+  cursor.SetDisplayFrame(
+      hwcomposer::HwcRect<int>(0, 0, kCursorSize, kCursorSize), 0);
+
+  std::vector<hwcomposer::HwcLayer*> layers;
+  layers.emplace_back(&background);
+  layers.emplace_back(&cursor);
+
+  LatencyRecorder recorder;
+  scenario.listener->recorder_ = &recorder;
+
+  hwcomposer::HwcRegion damage;
+  damage.emplace_back(hwcomposer::HwcRect<int>(0, 0, width, height));
+  std::vector<int64_t> unsent_inputs;
+  std::unique_ptr<InputThread> input_thread;
+  if (mode == Mode::kThreaded)
+    input_thread.reset(new InputThread(scenario, &cursor, &recorder, result));
+
+  int32_t x = 0;
+  int32_t y = 0;
+  for (uint32_t frame = 0; frame < scenario.frames; frame++) {
+    background.SetNativeHandle(scenario.backgrounds[frame % 2]);
+    background.SetSurfaceDamage(damage);
+    if (input_thread)
+      input_thread->TakeUnsentInputs(&unsent_inputs);
+
+    int32_t retire_fence = -1;
+    display->Present(layers, &retire_fence);
+    int64_t commit_time = NowNs();
+    for (int64_t input_time : unsent_inputs) {
+      recorder.Committed(input_time, commit_time,
+                         retire_fence > 0 ? dup(retire_fence) : -1);
+    }
+
+    unsent_inputs.clear();
+    if (retire_fence > 0)
+      close(retire_fence);
+
+    CloseReleaseFences(layers);
+
+    // Input events arriving until the next frame is presented. Leave
+    // some time for the next Present to make the following vblank.
+    int64_t next_frame = commit_time + scenario.frame_period * 3 / 4;
+    if (input_thread) {
+      int64_t now = NowNs();
+      if (now < next_frame)
+        usleep((next_frame - now) / 1000);
+
+      continue;
+    }
+
+    while (NowNs() + scenario.input_interval < next_frame) {
+      usleep(scenario.input_interval / 1000);
+      MoveCursor(&cursor, width, height, &x, &y);
+
+      int64_t input_time = NowNs();
+      result->inputs++;
+      int32_t fence = -1;
+      if (mode == Mode::kFastPath) {
+        bool updated = display->UpdateCursor(&cursor, &fence);
+        int64_t now = NowNs();
+        result->max_update_call =
+            std::max(result->max_update_call, now - input_time);
+        if (updated) {
+          result->fast_path++;
+          recorder.Committed(input_time, now, fence);
+          continue;
+        }
+      }
+
+      unsent_inputs.emplace_back(input_time);
+    }
+  }
+
+  if (input_thread) {
+    input_thread->Stop();
+    input_thread->TakeUnsentInputs(&unsent_inputs);
+  }
+
+  // Let the last moves go out.
+  int32_t retire_fence = -1;
+  display->Present(layers, &retire_fence);
+  int64_t commit_time = NowNs();
+  for (int64_t input_time : unsent_inputs) {
+    recorder.Committed(input_time, commit_time,
+                       retire_fence > 0 ? dup(retire_fence) : -1);
+  }
+
+  if (retire_fence > 0)
+    close(retire_fence);
+
+  CloseReleaseFences(layers);
+  result->latencies = recorder.Finish();
+  scenario.listener->recorder_ = NULL;
+}
+
+void Print(const char* name, Result& result) {
+  std::vector<int64_t>& latencies = result.latencies;
+  if (latencies.empty()) {
+    printf("%-12s no updates shown\n", name);
+    return;
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  size_t size = latencies.size();
+  printf(
+      "%-12s inputs: %5u fast path: %5.1f%% latency us p50: %7.1f p90: "
+      "%7.1f p99: %7.1f max: %7.1f update call max: %7.1f\n",
+      name, result.inputs, 100.0 * result.fast_path / result.inputs,
+      latencies[size / 2] / 1000.0, latencies[size * 9 / 10] / 1000.0,
+      latencies[size * 99 / 100] / 1000.0, latencies[size - 1] / 1000.0,
+      result.max_update_call / 1000.0);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  uint32_t frames = argc > 1 ? atoi(argv[1]) : 600;
+  uint32_t input_interval_us = argc > 2 ? atoi(argv[2]) : 2000;
+  if (!frames || !input_interval_us) {
+    fprintf(stderr, "usage: %s [frames] [input_interval_us]\n", argv[0]);
+    return 1;
+  }
+
+  hwcomposer::GpuDevice device;
+  device.Initialize();
+  std::vector<hwcomposer::NativeDisplay*> displays;
+  device.GetConnectedPhysicalDisplays(displays);
+  if (displays.empty()) {
+    fprintf(stderr, "No connected display.\n");
+    return 1;
+  }
+
+  hwcomposer::NativeDisplay* display = displays.at(0);
+  display->SetActiveConfig(0);
+  display->SetPowerMode(hwcomposer::kOn);
+
+  int fd = open("/dev/dri/renderD128", O_RDWR);
+  if (fd == -1) {
+    fprintf(stderr, "Can't open GPU file.\n");
+    return 1;
+  }
+
+  std::unique_ptr<hwcomposer::NativeBufferHandler> buffer_handler(
+      hwcomposer::NativeBufferHandler::CreateInstance(fd));
+  if (!buffer_handler) {
+    fprintf(stderr, "Failed to create buffer handler.\n");
+    return 1;
+  }
+
+  Scenario scenario;
+  scenario.display = display;
+  scenario.frames = frames;
+  scenario.input_interval = input_interval_us * 1000LL;
+  int32_t period = 0;
+  uint32_t config = 0;
+  display->GetActiveConfig(&config);
+  if (!display->GetDisplayAttribute(
+          config, hwcomposer::HWCDisplayAttribute::kRefreshRate, &period) ||
+      period <= 0)
+    period = 16666667;
+
+  scenario.frame_period = period;
+  for (HWCNativeHandle& handle : scenario.backgrounds) {
+    if (!buffer_handler->CreateBuffer(display->Width(), display->Height(),
+                                      DRM_FORMAT_XRGB8888, &handle)) {
+      fprintf(stderr, "Failed to allocate background buffer.\n");
+      return 1;
+    }
+  }
+
+  if (!buffer_handler->CreateBuffer(kCursorSize, kCursorSize,
+                                    DRM_FORMAT_ARGB8888, &scenario.cursor,
+                                    hwcomposer::kLayerCursor)) {
+    fprintf(stderr, "Failed to allocate cursor buffer.\n");
+    return 1;
+  }
+
+  scenario.listener = std::make_shared<VblankListener>();
+  display->RegisterVsyncCallback(scenario.listener, 0);
+  display->VSyncControl(true);
+
+  printf("%ux%u frame period: %.2f ms frames: %u input interval: %u us\n",
+         display->Width(), display->Height(), period / 1000000.0, frames,
+         input_interval_us);
+
+  Result next_frame;
+  Run(scenario, Mode::kNextFrame, &next_frame);
+  Print("next frame", next_frame);
+
+  Result fast_path;
+  Run(scenario, Mode::kFastPath, &fast_path);
+  Print("fast path", fast_path);
+
+  Result threaded;
+  Run(scenario, Mode::kThreaded, &threaded);
+  Print("threaded", threaded);
+
+  display->VSyncControl(false);
+  buffer_handler->ReleaseBuffer(scenario.cursor);
+  buffer_handler->DestroyHandle(scenario.cursor);
+  for (HWCNativeHandle handle : scenario.backgrounds) {
+    buffer_handler->ReleaseBuffer(handle);
+    buffer_handler->DestroyHandle(handle);
+  }
+
+  buffer_handler.reset();
+  close(fd);
+  return 0;
+}
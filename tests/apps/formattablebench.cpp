@@ -0,0 +1,198 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Measures the cost of plane format/modifier lookups done while
+// validating layers against planes. DrmFormatTable is compared with the
+// linear scans DrmPlane used before it.
+//
+// Usage: formattablebench [planes] [layers] [iterations]
+
+#include <drm_fourcc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "drmformattable.h"
+
+using hwcomposer::DrmFormatTable;
+
+namespace {
+
+// Formats and modifiers exposed by a Gen9 universal plane.
+const uint32_t kPlaneFormats[] = {
+    DRM_FORMAT_C8,       DRM_FORMAT_RGB565,   DRM_FORMAT_XRGB8888,
+    DRM_FORMAT_XBGR8888, DRM_FORMAT_ARGB8888, DRM_FORMAT_ABGR8888,
+    DRM_FORMAT_XRGB2101010, DRM_FORMAT_XBGR2101010, DRM_FORMAT_YUYV,
+    DRM_FORMAT_YVYU,     DRM_FORMAT_UYVY,     DRM_FORMAT_VYUY,
+    DRM_FORMAT_NV12};
+
+const uint64_t kPlaneModifiers[] = {
+    DRM_FORMAT_MOD_LINEAR, I915_FORMAT_MOD_X_TILED, I915_FORMAT_MOD_Y_TILED,
+    I915_FORMAT_MOD_Yf_TILED, I915_FORMAT_MOD_Y_TILED_CCS,
+    I915_FORMAT_MOD_Yf_TILED_CCS};
+
+// Layers also use formats and modifiers planes don't support.
+const uint32_t kLayerFormats[] = {
+    DRM_FORMAT_XRGB8888, DRM_FORMAT_ARGB8888, DRM_FORMAT_ABGR8888,
+    DRM_FORMAT_XBGR8888, DRM_FORMAT_RGB565,   DRM_FORMAT_NV12,
+    DRM_FORMAT_YUYV,     DRM_FORMAT_P010,     DRM_FORMAT_BGR888};
+
+const uint64_t kLayerModifiers[] = {
+    DRM_FORMAT_MOD_LINEAR, I915_FORMAT_MOD_X_TILED, I915_FORMAT_MOD_Y_TILED,
+    I915_FORMAT_MOD_Y_TILED_CCS, I915_FORMAT_MOD_Yf_TILED_CCS};
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+// The lookup DrmPlane did before DrmFormatTable.
+struct LinearTable {
+  struct FormatMods {
+    std::vector<uint64_t> mods;
+    uint32_t format;
+  };
+
+  bool IsSupportedFormat(uint32_t format) {
+    if (last_valid_format == format)
+      return true;
+
+    for (auto& element : formats) {
+      if (element == format) {
+        last_valid_format = format;
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  bool IsSupportedModifier(uint32_t format, uint64_t modifier) const {
+    for (const FormatMods& obj : formats_modifiers) {
+      if (obj.format == format) {
+        if (std::find(obj.mods.begin(), obj.mods.end(), modifier) !=
+            obj.mods.end())
+          return true;
+      }
+    }
+
+    return false;
+  }
+
+  std::vector<uint32_t> formats;
+  std::vector<FormatMods> formats_modifiers;
+  uint32_t last_valid_format = 0;
+};
+
+struct Layer {
+  uint32_t format;
+  uint64_t modifier;
+};
+
+int64_t NowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+template <typename Table>
+int64_t Run(std::vector<Table>& planes, const std::vector<Layer>& layers,
+            uint32_t iterations, uint32_t* supported) {
+  uint32_t count = 0;
+  int64_t start = NowNs();
+  for (uint32_t i = 0; i < iterations; i++) {
+    for (Table& plane : planes) {
+      for (const Layer& layer : layers) {
+        if (plane.IsSupportedFormat(layer.format) &&
+            plane.IsSupportedModifier(layer.format, layer.modifier))
+          count++;
+      }
+    }
+  }
+
+  *supported = count;
+  return NowNs() - start;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  uint32_t num_planes = argc > 1 ? atoi(argv[1]) : 24;
+  uint32_t num_layers = argc > 2 ? atoi(argv[2]) : 64;
+  uint32_t iterations = argc > 3 ? atoi(argv[3]) : 10000;
+  if (!num_planes || !num_layers || !iterations) {
+    fprintf(stderr, "usage: %s [planes] [layers] [iterations]\n", argv[0]);
+    return 1;
+  }
+
+  srand(1);
+  std::vector<DrmFormatTable> tables(num_planes);
+  std::vector<LinearTable> linear_tables(num_planes);
+  for (uint32_t p = 0; p < num_planes; p++) {
+    // Vary the format list per plane, cursor-like planes only get the
+    // first few formats.
+    uint32_t num_formats = (p % 4 == 3) ? 6 : ARRAY_SIZE(kPlaneFormats);
+    std::vector<uint32_t> formats(kPlaneFormats, kPlaneFormats + num_formats);
+    tables[p].SetFormats(formats);
+    linear_tables[p].formats = formats;
+
+    for (uint32_t format : formats) {
+      LinearTable::FormatMods mods;
+      mods.format = format;
+      for (uint64_t modifier : kPlaneModifiers) {
+        // CCS is only available for 32bpp RGB.
+        bool ccs = modifier == I915_FORMAT_MOD_Y_TILED_CCS ||
+                   modifier == I915_FORMAT_MOD_Yf_TILED_CCS;
+        if (ccs && format != DRM_FORMAT_XRGB8888 &&
+            format != DRM_FORMAT_ARGB8888 && format != DRM_FORMAT_XBGR8888 &&
+            format != DRM_FORMAT_ABGR8888)
+          continue;
+
+        tables[p].AddModifier(format, modifier);
+        mods.mods.emplace_back(modifier);
+      }
+
+      linear_tables[p].formats_modifiers.emplace_back(mods);
+    }
+  }
+
+  std::vector<Layer> layers(num_layers);
+  for (Layer& layer : layers) {
+    layer.format = kLayerFormats[rand() % ARRAY_SIZE(kLayerFormats)];
+    layer.modifier = kLayerModifiers[rand() % ARRAY_SIZE(kLayerModifiers)];
+  }
+
+  uint32_t linear_supported = 0;
+  uint32_t table_supported = 0;
+  int64_t linear_ns =
+      Run(linear_tables, layers, iterations, &linear_supported);
+  int64_t table_ns = Run(tables, layers, iterations, &table_supported);
+
+  if (linear_supported != table_supported) {
+    fprintf(stderr, "Mismatch: linear %u, table %u supported pairs\n",
+            linear_supported, table_supported);
+    return 1;
+  }
+
+  double lookups = (double)num_planes * num_layers * iterations;
+  printf("planes: %u layers: %u iterations: %u\n", num_planes, num_layers,
+         iterations);
+  printf("linear scan:  %8.2f ns/lookup %10.2f us/frame\n",
+         linear_ns / lookups, linear_ns / 1000.0 / iterations);
+  printf("format table: %8.2f ns/lookup %10.2f us/frame\n",
+         table_ns / lookups, table_ns / 1000.0 / iterations);
+  return 0;
+}
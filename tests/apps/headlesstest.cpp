@@ -0,0 +1,202 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Presents frames on the simulated displays of a build configured with
+// --enable-headless, and checks they all got on screen. Run by make check
+// in such builds.
+//
+// Headless displays don't need display hardware, but buffers are still
+// allocated from a DRM render node and composited with the GPU stack.
+// Without a GPU, load vgem (modprobe vgem) and a software GL driver
+// (e.g. Mesa llvmpipe). Exits with 77, skipped, when there is no render
+// node.
+
+#include <drm_fourcc.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <memory>
+#include <vector>
+
+#include <gpudevice.h>
+#include <hwclayer.h>
+#include <nativebufferhandler.h>
+#include <nativedisplay.h>
+
+namespace {
+
+const uint32_t kFrames = 60;
+const int kSkipped = 77;
+
+// Same lookup as the headless display manager.
+int OpenRenderNode() {
+  const char* device = getenv("HWC_HEADLESS_DEVICE");
+  if (device && *device)
+    return open(device, O_RDWR | O_CLOEXEC);
+
+  char path[64];
+  for (int i = 128; i < 192; i++) {
+    snprintf(path, sizeof(path), "/dev/dri/renderD%d", i);
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd >= 0)
+      return fd;
+  }
+
+  return -1;
+}
+
+void CloseFences(std::vector<hwcomposer::HwcLayer*>& layers,
+                 int32_t retire_fence) {
+  if (retire_fence > 0)
+    close(retire_fence);
+
+  for (hwcomposer::HwcLayer* layer : layers) {
+    int32_t fence = layer->GetReleaseFence();
+    if (fence > 0)
+      close(fence);
+  }
+}
+
+}  // namespace
+
+int main() {
+  int fd = OpenRenderNode();
+  if (fd < 0) {
+    printf("No render node, skipped. Load vgem to run without a GPU.\n");
+    return kSkipped;
+  }
+
+  // Two displays, so that both planes and GPU composition are used.
+  setenv("HWC_HEADLESS_DISPLAYS", "1280x720@60,640x480@60", 0);
+  setenv("HWC_HEADLESS_PLANES", "2", 0);
+
+  hwcomposer::GpuDevice device;
+  if (!device.Initialize()) {
+    fprintf(stderr, "Failed to initialize headless displays.\n");
+    return 1;
+  }
+
+  std::vector<hwcomposer::NativeDisplay*> displays;
+  device.GetConnectedPhysicalDisplays(displays);
+  if (displays.empty()) {
+    fprintf(stderr, "No headless display connected.\n");
+    return 1;
+  }
+
+  std::unique_ptr<hwcomposer::NativeBufferHandler> buffer_handler(
+      hwcomposer::NativeBufferHandler::CreateInstance(fd));
+  if (!buffer_handler) {
+    fprintf(stderr, "Failed to create buffer handler.\n");
+    return 1;
+  }
+
+  int result = 0;
+  for (hwcomposer::NativeDisplay* display : displays) {
+    display->SetActiveConfig(0);
+    display->SetPowerMode(hwcomposer::kOn);
+    int32_t width = display->Width();
+    int32_t height = display->Height();
+
+    HWCNativeHandle backgrounds[2];
+    HWCNativeHandle overlay;
+    bool allocated = true;
+    for (HWCNativeHandle& handle : backgrounds) {
+      allocated &= buffer_handler->CreateBuffer(width, height,
+                                                DRM_FORMAT_XRGB8888, &handle);
+    }
+
+    allocated &= buffer_handler->CreateBuffer(width / 2, height / 2,
+                                              DRM_FORMAT_ARGB8888, &overlay);
+    if (!allocated) {
+      fprintf(stderr, "Failed to allocate buffers.\n");
+      return 1;
+    }
+
+    hwcomposer::HwcLayer background;
+    background.SetTransform(0);
+    background.SetSourceCrop(hwcomposer::HwcRect<float>(0, 0, width, height));
+    background.SetDisplayFrame(hwcomposer::HwcRect<int>(0, 0, width, height),
+                               0);
+
+    // More layers than planes, some need to be composited.
+    std::vector<std::unique_ptr<hwcomposer::HwcLayer>> overlays;
+    std::vector<hwcomposer::HwcLayer*> layers;
+    layers.emplace_back(&background);
+    for (int i = 0; i < 3; i++) {
+      overlays.emplace_back(new hwcomposer::HwcLayer());
+      hwcomposer::HwcLayer* layer = overlays.back().get();
+      int32_t left = i * width / 8;
+      int32_t top = i * height / 8;
+      layer->SetTransform(0);
+      layer->SetBlending(hwcomposer::HWCBlending::kBlendingPremult);
+      layer->SetNativeHandle(overlay);
+      layer->SetSourceCrop(
+          hwcomposer::HwcRect<float>(0, 0, width / 2, height / 2));
+      layer->SetDisplayFrame(
+          hwcomposer::HwcRect<int>(left, top, left + width / 2,
+                                   top + height / 2),
+          0);
+      layers.emplace_back(layer);
+    }
+
+    hwcomposer::HwcRegion damage;
+    damage.emplace_back(hwcomposer::HwcRect<int>(0, 0, width, height));
+    for (uint32_t frame = 0; frame < kFrames; frame++) {
+      background.SetNativeHandle(backgrounds[frame % 2]);
+      background.SetSurfaceDamage(damage);
+      int32_t retire_fence = -1;
+      if (!display->Present(layers, &retire_fence)) {
+        fprintf(stderr, "Present of frame %u failed.\n", frame);
+        result = 1;
+      }
+
+      CloseFences(layers, retire_fence);
+    }
+
+    // Last frame is recorded once the next one is presented.
+    std::vector<hwcomposer::HwcFrameStatistics> frames;
+    if (display->GetFrameStatistics(0, &frames)) {
+      uint32_t failed = 0;
+      for (const hwcomposer::HwcFrameStatistics& stats : frames) {
+        if (stats.composition_flags & hwcomposer::kFrameCommitFailed)
+          failed++;
+      }
+
+      printf("%dx%d: %zu frames recorded, %u failed to commit.\n", width,
+             height, frames.size(), failed);
+      if (frames.size() + 1 < kFrames || failed)
+        result = 1;
+    }
+
+    display->SetPowerMode(hwcomposer::kOff);
+    for (HWCNativeHandle handle : backgrounds) {
+      buffer_handler->ReleaseBuffer(handle);
+      buffer_handler->DestroyHandle(handle);
+    }
+
+    buffer_handler->ReleaseBuffer(overlay);
+    buffer_handler->DestroyHandle(overlay);
+  }
+
+  buffer_handler.reset();
+  close(fd);
+  if (!result)
+    printf("All frames presented.\n");
+
+  return result;
+}
@@ -60,6 +60,7 @@
 #include "videolayerrenderer.h"
 #include "imagelayerrenderer.h"
 #include "cclayerrenderer.h"
+#include "frametimingrecorder.h"
 #include "jsonhandlers.h"
 
 #include <nativebufferhandler.h>
@@ -152,6 +153,11 @@ err_close:
  */
 static uint64_t arg_frames = 0;
 
+/* If set, per frame timings are written to <results>.csv and a summary to
+ * <results>.json once all frames are rendered.
+ */
+static char *arg_results = NULL;
+
 /*flag set to test displaymode*/
 static int display_mode;
 int force_mode = 0, config_index = 0, print_display_config = 0;
@@ -395,6 +401,8 @@ class HotPlugEventCallback : public hwcomposer::DisplayHotPlugEventCallback {
 
 char json_path[1024];
 TEST_PARAMETERS test_parameters;
+/* Parameters of the layers in frames, after clipping to the display. */
+LAYER_PARAMETERS frame_layer_parameters;
 hwcomposer::NativeBufferHandler *buffer_handler;
 
 static uint32_t layerformat2gbmformat(LAYER_FORMAT format,
@@ -688,6 +696,12 @@ static void init_frames(int32_t width, int32_t height) {
 
       hwc_layer = new hwcomposer::HwcLayer();
       fill_hwclayer(hwc_layer, &layer_parameter, renderer);
+      if (layer_parameter.cursor)
+        hwc_layer->MarkAsCursorLayer();
+
+      if (i == 0)
+        frame_layer_parameters.emplace_back(layer_parameter);
+
       frame->layers.push_back(std::unique_ptr<hwcomposer::HwcLayer>(hwc_layer));
       frame->layer_renderers.push_back(
           std::unique_ptr<LayerRenderer>(renderer));
@@ -695,10 +709,61 @@ static void init_frames(int32_t width, int32_t height) {
   }
 }
 
+/* Soak scenarios periodically remove and re-add the topmost non cursor
+ * layer and hide and show video layers.
+ */
+static bool is_layer_hidden(size_t index, uint64_t frame_number) {
+  const LAYER_PARAMETER &parameter = frame_layer_parameters.at(index);
+  uint32_t video_interval = test_parameters.soak_video_toggle_interval;
+  if (video_interval && parameter.type == LAYER_TYPE_VIDEO &&
+      (frame_number / video_interval) % 2)
+    return true;
+
+  uint32_t layer_interval = test_parameters.soak_layer_toggle_interval;
+  if (!layer_interval || !((frame_number / layer_interval) % 2))
+    return false;
+
+  size_t topmost = frame_layer_parameters.size();
+  while (topmost > 0 && frame_layer_parameters.at(topmost - 1).cursor)
+    topmost--;
+
+  return topmost > 0 && index == topmost - 1;
+}
+
+static uint32_t bounce(uint64_t position, uint32_t range) {
+  if (!range)
+    return 0;
+
+  position %= 2 * range;
+  return position <= range ? position : 2 * range - position;
+}
+
+/* Moves cursor layers back and forth across the display. */
+static void move_cursor(hwcomposer::HwcLayer *layer, size_t index,
+                        uint64_t frame_number, uint32_t width,
+                        uint32_t height) {
+  const LAYER_PARAMETER &parameter = frame_layer_parameters.at(index);
+  uint32_t step = test_parameters.soak_cursor_step;
+  if (!step || !parameter.cursor)
+    return;
+
+  uint32_t range_x =
+      width > parameter.frame_width ? width - parameter.frame_width : 0;
+  uint32_t range_y =
+      height > parameter.frame_height ? height - parameter.frame_height : 0;
+  int32_t x = bounce(parameter.frame_x + frame_number * step, range_x);
+  int32_t y = bounce(parameter.frame_y + frame_number * step, range_y);
+  layer->SetDisplayFrame(
+      hwcomposer::HwcRect<int>(x, y, x + parameter.frame_width,
+                               y + parameter.frame_height),
+      0);
+}
+
 static void print_help(void) {
   printf(
       "usage: testjsonlayers [-h|--help] [-f|--frames <frames>] [-j|--json "
-      "<jsonfile>] [-p|--powermode <on/off/doze/dozesuspend>][--displaymode "
+      "<jsonfile>] [-r|--results <basename>] [-p|--powermode "
+      "<on/off/doze/dozesuspend>][--displaymode "
       "<print/forcemode displayconfigindex]\n");
 }
 
@@ -707,6 +772,7 @@ static void parse_args(int argc, char *argv[]) {
       {"help", no_argument, NULL, 'h'},
       {"frames", required_argument, NULL, 'f'},
       {"json", required_argument, NULL, 'j'},
+      {"results", required_argument, NULL, 'r'},
       {"displaymode", required_argument, &display_mode, 1},
       {0},
   };
@@ -718,7 +784,7 @@ static void parse_args(int argc, char *argv[]) {
   /* Suppress getopt's poor error messages */
   opterr = 0;
 
-  while ((opt = getopt_long(argc, argv, "+:hf:j:", longopts,
+  while ((opt = getopt_long(argc, argv, "+:hf:j:r:", longopts,
                             /*longindex*/ &longindex)) != -1) {
     switch (opt) {
       case 0:
@@ -742,6 +808,9 @@ static void parse_args(int argc, char *argv[]) {
         printf("optarg:%s\n", optarg);
         strcpy(json_path, optarg);
         break;
+      case 'r':
+        arg_results = optarg;
+        break;
       case 'f':
         errno = 0;
         arg_frames = strtoul(optarg, &endptr, 0);
@@ -862,6 +931,7 @@ int main(int argc, char *argv[]) {
   int64_t gpu_fence_fd = -1; /* out-fence from gpu, in-fence to kms */
   std::vector<hwcomposer::HwcLayer *> layers;
   uint32_t frame_total = 0;
+  FrameTimingRecorder recorder(primary);
 
   for (uint64_t i = 0; arg_frames == 0 || i < arg_frames; ++i) {
     struct frame *frame = &frames[i % ARRAY_SIZE(frames)];
@@ -885,6 +955,13 @@ int main(int argc, char *argv[]) {
       }
 
       frame->layers_fences[j].clear();
+      if (!display_mode && is_layer_hidden(j, i))
+        continue;
+
+      if (!display_mode)
+        move_cursor(frame->layers[j].get(), j, i, primary_width,
+                    primary_height);
+
       frame->layer_renderers[j]->Draw(&gpu_fence_fd);
       frame->layers[j]->SetAcquireFence(gpu_fence_fd);
       std::vector<hwcomposer::HwcRect<int>> damage_region;
@@ -893,7 +970,14 @@ int main(int argc, char *argv[]) {
       layers.emplace_back(frame->layers[j].get());
     }
 
+    size_t retire_fences = frame->fences.size();
+    int64_t present_start = FrameTimingRecorder::Now();
     callback->PresentLayers(layers, frame->layers_fences, frame->fences);
+    int64_t present_end = FrameTimingRecorder::Now();
+    recorder.FramePresented(
+        present_start, present_end,
+        frame->fences.size() > retire_fences ? frame->fences.back() : -1);
+    recorder.Update(false);
     frame_total++;
 
     if (!strcmp(test_parameters.power_mode.c_str(), "on")) {
@@ -929,6 +1013,21 @@ int main(int argc, char *argv[]) {
         frame_total = 0;
       }
     }
+
+    /* Gaps caused by power mode changes aren't missed frames. */
+    if (frame_total == 0) {
+      recorder.Update(true);
+      recorder.SkipNextInterval();
+    }
+  }
+
+  recorder.Update(true);
+  recorder.PrintSummary(stdout);
+  if (arg_results) {
+    std::string results(arg_results);
+    recorder.WriteJSON((results + ".json").c_str(),
+                       display_mode ? "displaymode" : json_path);
+    recorder.WriteCSV((results + ".csv").c_str());
   }
 
   callback->SetBroadcastRGB("Automatic");
@@ -0,0 +1,121 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Checks the modifiers negotiated for off-screen targets between the
+// renderer and fake planes reporting different IN_FORMATS lists. Doesn't
+// need any hardware, exits non-zero on failure.
+
+#include <stdio.h>
+
+#include <drm_fourcc.h>
+
+#include <vector>
+
+#include "hwcutils.h"
+#include "unittest.h"
+
+using hwcomposer::NegotiateModifiers;
+
+namespace {
+
+// Modifiers a plane reports for a format, as DisplayPlane does from its
+// IN_FORMATS blob.
+struct FakePlane {
+  std::vector<uint64_t> modifiers;
+
+  void GetSupportedModifiers(std::vector<uint64_t>* supported) const {
+    *supported = modifiers;
+  }
+};
+
+// Same order of preference as GetRenderTargetModifiers with GL.
+const std::vector<uint64_t> kRendererModifiers = {
+    I915_FORMAT_MOD_Y_TILED_CCS, I915_FORMAT_MOD_Y_TILED,
+    I915_FORMAT_MOD_X_TILED, DRM_FORMAT_MOD_LINEAR};
+
+std::vector<uint64_t> Negotiate(const FakePlane& plane,
+                                const std::vector<uint64_t>& renderer) {
+  std::vector<uint64_t> plane_modifiers;
+  std::vector<uint64_t> modifiers;
+  plane.GetSupportedModifiers(&plane_modifiers);
+  NegotiateModifiers(plane_modifiers, renderer, &modifiers);
+  return modifiers;
+}
+
+void TestCompressedPreferred() {
+  // Plane order doesn't matter, the renderer's preference does.
+  FakePlane plane;
+  plane.modifiers = {DRM_FORMAT_MOD_LINEAR, I915_FORMAT_MOD_X_TILED,
+                     I915_FORMAT_MOD_Y_TILED, I915_FORMAT_MOD_Y_TILED_CCS};
+  std::vector<uint64_t> modifiers = Negotiate(plane, kRendererModifiers);
+  CHECK(modifiers == kRendererModifiers);
+  CHECK(!modifiers.empty() &&
+        modifiers.front() == I915_FORMAT_MOD_Y_TILED_CCS);
+}
+
+void TestTiledPreferred() {
+  // No CCS on this plane, e.g. an overlay plane before Gen 9.
+  FakePlane plane;
+  plane.modifiers = {DRM_FORMAT_MOD_LINEAR, I915_FORMAT_MOD_X_TILED,
+                     I915_FORMAT_MOD_Y_TILED};
+  std::vector<uint64_t> modifiers = Negotiate(plane, kRendererModifiers);
+  CHECK(modifiers.size() == 3);
+  CHECK(!modifiers.empty() && modifiers.front() == I915_FORMAT_MOD_Y_TILED);
+
+  // Without EGL modifier import the renderer can't use CCS.
+  std::vector<uint64_t> renderer(kRendererModifiers.begin() + 1,
+                                 kRendererModifiers.end());
+  plane.modifiers = kRendererModifiers;
+  modifiers = Negotiate(plane, renderer);
+  CHECK(modifiers == renderer);
+}
+
+void TestLinearFallback() {
+  FakePlane plane;
+  plane.modifiers = {DRM_FORMAT_MOD_LINEAR};
+  std::vector<uint64_t> modifiers = Negotiate(plane, kRendererModifiers);
+  CHECK(modifiers.size() == 1);
+  CHECK(!modifiers.empty() && modifiers.front() == DRM_FORMAT_MOD_LINEAR);
+}
+
+void TestEmptyIntersection() {
+  // Nothing in common, allocation then picks the layout itself.
+  FakePlane plane;
+  plane.modifiers = {I915_FORMAT_MOD_Yf_TILED, I915_FORMAT_MOD_Yf_TILED_CCS};
+  std::vector<uint64_t> modifiers = {DRM_FORMAT_MOD_LINEAR};
+  std::vector<uint64_t> plane_modifiers;
+  plane.GetSupportedModifiers(&plane_modifiers);
+  NegotiateModifiers(plane_modifiers, kRendererModifiers, &modifiers);
+  CHECK(modifiers.empty());
+
+  // Planes without IN_FORMATS report nothing.
+  plane.modifiers.clear();
+  CHECK(Negotiate(plane, kRendererModifiers).empty());
+
+  // Renderers which can't use modifiers, e.g. for media targets.
+  plane.modifiers = kRendererModifiers;
+  CHECK(Negotiate(plane, std::vector<uint64_t>()).empty());
+}
+
+}  // namespace
+
+int main() {
+  TestCompressedPreferred();
+  TestTiledPreferred();
+  TestLinearFallback();
+  TestEmptyIntersection();
+  return ReportChecks();
+}
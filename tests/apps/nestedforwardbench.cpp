@@ -0,0 +1,275 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Compares forwarding layers to a host compositor through NestedDisplay
+// with copying the full composed frame to it. A stack of full screen
+// layers is presented on the nested display, connected to the reference
+// host running in-process, with a band of the top layer damaged every
+// frame. The host reads the damaged rows from the shared dma-bufs. The
+// copy baseline writes a full 32bpp frame through a UNIX socket to a
+// thread which reads it and acknowledges it.
+//
+// Reported per frame are the time until the host completed the frame
+// and the bytes sent to it.
+//
+// Usage: nestedforwardbench [frames] [layers]
+
+#include <drm_fourcc.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gpudevice.h>
+#include <hwclayer.h>
+#include <nativebufferhandler.h>
+#include <nativedisplay.h>
+
+#include "nestedhost.h"
+
+namespace {
+
+// Part of the height of the top layer damaged every frame.
+const uint32_t kDamageFraction = 8;
+
+int64_t NowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct Result {
+  std::vector<int64_t> latency;
+  uint64_t bytes = 0;
+  uint32_t failed = 0;
+};
+
+void Forward(hwcomposer::NativeDisplay* display,
+             const std::vector<HWCNativeHandle>& buffers, uint32_t frames,
+             Result* result) {
+  int32_t width = display->Width();
+  int32_t height = display->Height();
+  std::vector<std::unique_ptr<hwcomposer::HwcLayer>> storage;
+  std::vector<hwcomposer::HwcLayer*> layers;
+  for (size_t i = 0; i < buffers.size(); i++) {
+    storage.emplace_back(new hwcomposer::HwcLayer());
+    hwcomposer::HwcLayer* layer = storage.back().get();
+    layer->SetTransform(0);
+    layer->SetSourceCrop(hwcomposer::HwcRect<float>(0, 0, width, height));
+    layer->SetDisplayFrame(hwcomposer::HwcRect<int>(0, 0, width, height), 0);
+    layer->SetBlending(i ? hwcomposer::HWCBlending::kBlendingPremult
+                         : hwcomposer::HWCBlending::kBlendingNone);
+    layer->SetNativeHandle(buffers.at(i));
+    layers.emplace_back(layer);
+  }
+
+  uint64_t last_frame = 0;
+  int32_t band = height / kDamageFraction;
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    int32_t top = (frame * band) % (height - band + 1);
+    hwcomposer::HwcRegion damage;
+    damage.emplace_back(0, top, width, top + band);
+    layers.back()->SetSurfaceDamage(damage);
+
+    int32_t retire_fence = -1;
+    int64_t start = NowNs();
+    bool presented = display->Present(layers, &retire_fence);
+    int64_t end = NowNs();
+    if (retire_fence > 0)
+      close(retire_fence);
+
+    for (hwcomposer::HwcLayer* layer : layers) {
+      int32_t fence = layer->GetReleaseFence();
+      if (fence > 0)
+        close(fence);
+    }
+
+    if (!presented) {
+      result->failed++;
+      continue;
+    }
+
+    result->latency.emplace_back(end - start);
+
+    std::vector<hwcomposer::HwcFrameStatistics> stats;
+    display->GetFrameStatistics(last_frame, &stats);
+    for (const hwcomposer::HwcFrameStatistics& stat : stats) {
+      result->bytes += stat.forwarded_bytes;
+      last_frame = stat.frame_number;
+    }
+  }
+}
+
+void Copy(uint32_t width, uint32_t height, uint32_t frames, Result* result) {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) {
+    perror("socketpair");
+    return;
+  }
+
+  size_t frame_size = static_cast<size_t>(width) * height * 4;
+  std::vector<uint8_t> source(frame_size, 0x80);
+  std::thread host([fds, frame_size, frames]() {
+    std::vector<uint8_t> target(frame_size);
+    for (uint32_t frame = 0; frame < frames; frame++) {
+      size_t received = 0;
+      while (received < frame_size) {
+        ssize_t ret =
+            read(fds[1], target.data() + received, frame_size - received);
+        if (ret <= 0)
+          return;
+        received += ret;
+      }
+
+      char ack = 0;
+      if (write(fds[1], &ack, 1) != 1)
+        return;
+    }
+  });
+
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    int64_t start = NowNs();
+    size_t sent = 0;
+    while (sent < frame_size) {
+      ssize_t ret = write(fds[0], source.data() + sent, frame_size - sent);
+      if (ret <= 0)
+        break;
+      sent += ret;
+    }
+
+    char ack;
+    if (sent != frame_size || read(fds[0], &ack, 1) != 1) {
+      result->failed++;
+      break;
+    }
+
+    result->latency.emplace_back(NowNs() - start);
+    result->bytes += frame_size;
+  }
+
+  shutdown(fds[0], SHUT_RDWR);
+  host.join();
+  close(fds[0]);
+  close(fds[1]);
+}
+
+void Print(const char* name, Result& result) {
+  std::vector<int64_t>& values = result.latency;
+  if (values.empty()) {
+    printf("%-8s n/a (failed: %u)\n", name, result.failed);
+    return;
+  }
+
+  std::sort(values.begin(), values.end());
+  size_t size = values.size();
+  printf(
+      "%-8s ms p50: %8.3f p90: %8.3f max: %8.3f bytes/frame: %10.0f "
+      "(failed: %u)\n",
+      name, values[size / 2] / 1000000.0, values[size * 9 / 10] / 1000000.0,
+      values[size - 1] / 1000000.0,
+      static_cast<double>(result.bytes) / size, result.failed);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  uint32_t frames = argc > 1 ? atoi(argv[1]) : 300;
+  uint32_t layers = argc > 2 ? atoi(argv[2]) : 4;
+  if (!frames || !layers || layers > NESTED_MAX_LAYERS) {
+    fprintf(stderr, "usage: %s [frames] [layers]\n", argv[0]);
+    return 1;
+  }
+
+  char path[64];
+  snprintf(path, sizeof(path), "/tmp/nestedforwardbench-%d", getpid());
+  NestedHost host(1920, 1080, 60);
+  if (!host.Start(path, true))
+    return 1;
+
+  setenv(NESTED_SOCKET_ENV, path, 1);
+  hwcomposer::GpuDevice device;
+  device.Initialize();
+  hwcomposer::NativeDisplay* display = device.GetNestedDisplay();
+  if (!display) {
+    fprintf(stderr, "No nested display.\n");
+    return 1;
+  }
+
+  display->InitNestedDisplay();
+  display->SetActiveConfig(0);
+  display->SetPowerMode(hwcomposer::kOn);
+
+  int fd = open("/dev/dri/renderD128", O_RDWR);
+  if (fd == -1) {
+    fprintf(stderr, "Can't open GPU file.\n");
+    return 1;
+  }
+
+  std::unique_ptr<hwcomposer::NativeBufferHandler> buffer_handler(
+      hwcomposer::NativeBufferHandler::CreateInstance(fd));
+  if (!buffer_handler) {
+    fprintf(stderr, "Failed to create buffer handler.\n");
+    return 1;
+  }
+
+  std::vector<HWCNativeHandle> buffers;
+  for (uint32_t i = 0; i < layers; i++) {
+    HWCNativeHandle handle = 0;
+    if (!buffer_handler->CreateBuffer(
+            display->Width(), display->Height(),
+            i ? DRM_FORMAT_ARGB8888 : DRM_FORMAT_XRGB8888, &handle)) {
+      fprintf(stderr, "Failed to allocate layer buffer.\n");
+      return 1;
+    }
+
+    buffers.emplace_back(handle);
+  }
+
+  printf("%ux%u layers: %u frames: %u\n", display->Width(), display->Height(),
+         layers, frames);
+
+  Result forward;
+  Forward(display, buffers, frames, &forward);
+  Print("forward", forward);
+
+  Result copy;
+  Copy(display->Width(), display->Height(), frames, &copy);
+  Print("copy", copy);
+
+  NestedHost::Statistics stats = host.GetStatistics();
+  printf("host frames: %llu buffers: %llu read: %.0f bytes/frame errors: %llu\n",
+         static_cast<unsigned long long>(stats.frames),
+         static_cast<unsigned long long>(stats.buffers_added),
+         stats.frames ? static_cast<double>(stats.bytes_read) / stats.frames : 0,
+         static_cast<unsigned long long>(stats.errors));
+
+  for (HWCNativeHandle handle : buffers) {
+    buffer_handler->ReleaseBuffer(handle);
+    buffer_handler->DestroyHandle(handle);
+  }
+
+  buffer_handler.reset();
+  close(fd);
+  host.Stop();
+  return 0;
+}
@@ -0,0 +1,96 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Reference host compositor for NestedDisplay. Listens on the socket
+// nested displays connect to, accepts frames from one guest at a time
+// and prints what it received every second. Frames aren't shown, with
+// -r the damaged part of every layer is read from its dma-buf instead.
+//
+// Usage: nestedhostserver [-r] [socket] [width] [height]
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "nestedhost.h"
+
+namespace {
+
+volatile sig_atomic_t quit = 0;
+
+void HandleSignal(int /*signal*/) {
+  quit = 1;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  bool read_buffers = false;
+  int arg = 1;
+  if (argc > arg && !strcmp(argv[arg], "-r")) {
+    read_buffers = true;
+    arg++;
+  }
+
+  const char* path = getenv(NESTED_SOCKET_ENV);
+  if (argc > arg)
+    path = argv[arg++];
+  if (!path)
+    path = NESTED_DEFAULT_SOCKET;
+
+  uint32_t width = argc > arg ? atoi(argv[arg++]) : 1920;
+  uint32_t height = argc > arg ? atoi(argv[arg++]) : 1080;
+  if (!width || !height) {
+    fprintf(stderr, "usage: %s [-r] [socket] [width] [height]\n", argv[0]);
+    return 1;
+  }
+
+  signal(SIGINT, HandleSignal);
+  signal(SIGTERM, HandleSignal);
+
+  NestedHost host(width, height, 60);
+  if (!host.Start(path, read_buffers))
+    return 1;
+
+  printf("Listening on %s as %ux%u.\n", path, width, height);
+  NestedHost::Statistics last;
+  while (!quit) {
+    sleep(1);
+    NestedHost::Statistics stats = host.GetStatistics();
+    if (stats.frames == last.frames)
+      continue;
+
+    printf(
+        "frames: %llu layers: %llu buffers: +%llu -%llu received: %llu B "
+        "read: %llu B errors: %llu\n",
+        static_cast<unsigned long long>(stats.frames - last.frames),
+        static_cast<unsigned long long>(stats.layers - last.layers),
+        static_cast<unsigned long long>(stats.buffers_added -
+                                        last.buffers_added),
+        static_cast<unsigned long long>(stats.buffers_removed -
+                                        last.buffers_removed),
+        static_cast<unsigned long long>(stats.bytes_received -
+                                        last.bytes_received),
+        static_cast<unsigned long long>(stats.bytes_read - last.bytes_read),
+        static_cast<unsigned long long>(stats.errors - last.errors));
+    last = stats;
+  }
+
+  host.Stop();
+  return 0;
+}
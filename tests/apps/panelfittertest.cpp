@@ -0,0 +1,218 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Checks the layout of content computed by PanelFitter for the scaling
+// modes and overscan, and how layers are mapped and clipped to the
+// display. Doesn't need any hardware, exits non-zero on failure.
+
+#include <math.h>
+#include <stdio.h>
+
+#include "panelfitter.h"
+#include "unittest.h"
+
+using hwcomposer::HWCDisplayScaling;
+using hwcomposer::HwcRect;
+using hwcomposer::PanelFitter;
+
+namespace {
+
+bool Equals(const HwcRect<int>& rect, int left, int top, int right,
+            int bottom) {
+  if (rect == HwcRect<int>(left, top, right, bottom))
+    return true;
+
+  fprintf(stderr, "got %d %d %d %d, expected %d %d %d %d\n", rect.left,
+          rect.top, rect.right, rect.bottom, left, top, right, bottom);
+  return false;
+}
+
+bool Near(const HwcRect<float>& rect, float left, float top, float right,
+          float bottom) {
+  if (fabsf(rect.left - left) < 0.5f && fabsf(rect.top - top) < 0.5f &&
+      fabsf(rect.right - right) < 0.5f && fabsf(rect.bottom - bottom) < 0.5f)
+    return true;
+
+  fprintf(stderr, "got %.1f %.1f %.1f %.1f, expected %.1f %.1f %.1f %.1f\n",
+          rect.left, rect.top, rect.right, rect.bottom, left, top, right,
+          bottom);
+  return false;
+}
+
+void TestIdentity() {
+  PanelFitter fitter;
+  CHECK(fitter.SetDisplaySize(1920, 1080));
+  CHECK(fitter.IsIdentity());
+  CHECK(!fitter.SetScalingMode(HWCDisplayScaling::kScaleStretch));
+
+  // Content as large as the display fits as is in any mode.
+  CHECK(fitter.SetScalingMode(HWCDisplayScaling::kScaleFit));
+  CHECK(fitter.IsIdentity());
+  CHECK(!fitter.SetContentSize(0, 0));
+  CHECK(fitter.SetContentSize(1920, 1080));
+  CHECK(fitter.IsIdentity());
+
+  HwcRect<int> frame(10, 20, 30, 40);
+  HwcRect<float> crop(0, 0, 20, 20);
+  CHECK(fitter.MapLayer(0, &frame, &crop));
+  CHECK(Equals(frame, 10, 20, 30, 40));
+  CHECK(Near(crop, 0, 0, 20, 20));
+}
+
+void TestScalingModes() {
+  PanelFitter fitter;
+  fitter.SetDisplaySize(1280, 1024);
+  fitter.SetContentSize(1920, 1080);
+  CHECK(!fitter.IsIdentity());
+  CHECK(Equals(fitter.GetDestination(), 0, 0, 1280, 1024));
+
+  // Letterboxed.
+  fitter.SetScalingMode(HWCDisplayScaling::kScaleFit);
+  CHECK(Equals(fitter.GetDestination(), 0, 152, 1280, 872));
+
+  // Cropped on both sides.
+  fitter.SetScalingMode(HWCDisplayScaling::kScaleFill);
+  CHECK(Equals(fitter.GetDestination(), -270, 0, 1550, 1024));
+
+  fitter.SetDisplaySize(1920, 1080);
+  fitter.SetContentSize(1280, 720);
+  fitter.SetScalingMode(HWCDisplayScaling::kScaleCentre);
+  CHECK(Equals(fitter.GetDestination(), 320, 180, 1600, 900));
+
+  // Pillarboxed.
+  fitter.SetContentSize(1024, 768);
+  fitter.SetScalingMode(HWCDisplayScaling::kScaleFit);
+  CHECK(Equals(fitter.GetDestination(), 240, 0, 1680, 1080));
+}
+
+void TestOverscan() {
+  PanelFitter fitter;
+  fitter.SetDisplaySize(1920, 1080);
+  CHECK(fitter.SetOverscan(100, 100));
+  CHECK(!fitter.IsIdentity());
+  CHECK(Equals(fitter.GetDestination(), 144, 81, 1776, 999));
+
+  // Out of range values are clamped.
+  CHECK(!fitter.SetOverscan(500, 500));
+  CHECK(fitter.SetOverscan(-100, 0));
+  CHECK(Equals(fitter.GetDestination(), -144, 0, 2064, 1080));
+
+  // Overscan applies on top of the scaling mode.
+  fitter.SetContentSize(1280, 720);
+  fitter.SetScalingMode(HWCDisplayScaling::kScaleCentre);
+  fitter.SetOverscan(0, -100);
+  CHECK(Equals(fitter.GetDestination(), 320, 99, 1600, 981));
+
+  CHECK(fitter.SetContentSize(0, 0));
+  CHECK(fitter.SetOverscan(0, 0));
+  CHECK(fitter.IsIdentity());
+}
+
+void TestMapLayer() {
+  PanelFitter fitter;
+  fitter.SetDisplaySize(1920, 1080);
+  fitter.SetOverscan(100, 100);
+
+  HwcRect<int> frame(0, 0, 1920, 1080);
+  HwcRect<float> crop(0, 0, 1920, 1080);
+  CHECK(fitter.MapLayer(0, &frame, &crop));
+  CHECK(Equals(frame, 144, 81, 1776, 999));
+  CHECK(Near(crop, 0, 0, 1920, 1080));
+
+  // Layers next to each other stay so.
+  HwcRect<int> left(0, 0, 961, 1080);
+  HwcRect<int> right(961, 0, 1920, 1080);
+  crop = HwcRect<float>(0, 0, 100, 100);
+  CHECK(fitter.MapLayer(0, &left, &crop));
+  CHECK(fitter.MapLayer(0, &right, &crop));
+  CHECK(left.right == right.left);
+
+  // Zoomed, the layer is clipped and so is its source.
+  fitter.SetOverscan(-100, 0);
+  frame = HwcRect<int>(0, 0, 1920, 1080);
+  crop = HwcRect<float>(0, 0, 1920, 1080);
+  CHECK(fitter.MapLayer(0, &frame, &crop));
+  CHECK(Equals(frame, 0, 0, 1920, 1080));
+  CHECK(Near(crop, 125.2f, 0, 1794.8f, 1080));
+
+  // Only what is clipped on the left is left out.
+  frame = HwcRect<int>(0, 0, 960, 1080);
+  crop = HwcRect<float>(0, 0, 960, 1080);
+  CHECK(fitter.MapLayer(0, &frame, &crop));
+  CHECK(Equals(frame, 0, 0, 960, 1080));
+  CHECK(Near(crop, 125.2f, 0, 960, 1080));
+
+  // Layers outside of the display are dropped.
+  frame = HwcRect<int>(0, 0, 64, 64);
+  CHECK(!fitter.MapLayer(0, &frame, &crop));
+
+  // Damage is clipped too.
+  CHECK(Equals(fitter.MapRect(HwcRect<int>(0, 0, 960, 540)), 0, 0, 960,
+               540));
+  CHECK(fitter.MapRect(HwcRect<int>(0, 0, 64, 64)).empty());
+}
+
+void TestTransforms() {
+  PanelFitter fitter;
+  fitter.SetDisplaySize(1000, 1000);
+  fitter.SetContentSize(500, 1000);
+  fitter.SetScalingMode(HWCDisplayScaling::kScaleCentre);
+  fitter.SetOverscan(0, -100);
+
+  // Display frame of 500x1150 clipped by 75 at the top and the bottom.
+  // Clipping the top of a buffer rotated by 90 degrees clips the left
+  // of the source.
+  HwcRect<int> frame(0, 0, 500, 1000);
+  HwcRect<float> crop(0, 0, 1000, 500);
+  CHECK(fitter.MapLayer(hwcomposer::kTransform90, &frame, &crop));
+  CHECK(Equals(frame, 250, 0, 750, 1000));
+  CHECK(Near(crop, 65.2f, 0, 934.8f, 500));
+
+  fitter.SetOverscan(0, 0);
+  fitter.SetScalingMode(HWCDisplayScaling::kScaleFill);
+  // Now only the top is clipped, by 500 of 2000.
+  frame = HwcRect<int>(0, 0, 500, 500);
+  crop = HwcRect<float>(0, 0, 500, 500);
+  CHECK(fitter.MapLayer(hwcomposer::kTransform90, &frame, &crop));
+  CHECK(Equals(frame, 0, 0, 1000, 500));
+  CHECK(Near(crop, 250, 0, 500, 500));
+
+  frame = HwcRect<int>(0, 0, 500, 500);
+  crop = HwcRect<float>(0, 0, 500, 500);
+  CHECK(fitter.MapLayer(hwcomposer::kTransform270, &frame, &crop));
+  CHECK(Near(crop, 0, 0, 250, 500));
+
+  frame = HwcRect<int>(0, 0, 500, 500);
+  crop = HwcRect<float>(0, 0, 500, 500);
+  CHECK(fitter.MapLayer(hwcomposer::kTransform180, &frame, &crop));
+  CHECK(Near(crop, 0, 0, 500, 250));
+
+  frame = HwcRect<int>(0, 0, 500, 500);
+  crop = HwcRect<float>(0, 0, 500, 500);
+  CHECK(fitter.MapLayer(hwcomposer::kReflectY, &frame, &crop));
+  CHECK(Near(crop, 0, 0, 500, 250));
+}
+
+}  // namespace
+
+int main() {
+  TestIdentity();
+  TestScalingModes();
+  TestOverscan();
+  TestMapLayer();
+  TestTransforms();
+  return ReportChecks();
+}
@@ -0,0 +1,167 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Checks the blend mode and plane alpha programmed for layers on planes
+// with different "alpha" and "pixel blend mode" properties, and which
+// layers are left to the GPU. Doesn't need any hardware, exits non-zero
+// on failure.
+
+#include <stdio.h>
+
+#include <drm_fourcc.h>
+
+#include "drmplaneblending.h"
+#include "unittest.h"
+
+using hwcomposer::DrmFormatHasAlpha;
+using hwcomposer::DrmPlaneBlendCaps;
+using hwcomposer::DrmPlaneBlendState;
+using hwcomposer::GetDrmPlaneBlendState;
+using hwcomposer::HWCBlending;
+
+namespace {
+
+// Enum values of "pixel blend mode" as exposed by the kernel.
+const uint64_t kNone = 0;
+const uint64_t kPremult = 1;
+const uint64_t kCoverage = 2;
+
+// Plane with the properties of a Gen 9+ universal plane.
+DrmPlaneBlendCaps FullCaps() {
+  DrmPlaneBlendCaps caps;
+  caps.alpha_max = 0xFFFF;
+  caps.has_blend_mode = true;
+  caps.supports_none = true;
+  caps.supports_premult = true;
+  caps.supports_coverage = true;
+  caps.none_value = kNone;
+  caps.premult_value = kPremult;
+  caps.coverage_value = kCoverage;
+  return caps;
+}
+
+void TestNoProperties() {
+  DrmPlaneBlendCaps caps;
+  DrmPlaneBlendState state;
+  // Premultiplied blending is what such planes do.
+  CHECK(GetDrmPlaneBlendState(caps, HWCBlending::kBlendingPremult, 0xFF,
+                              true, &state));
+  CHECK(GetDrmPlaneBlendState(caps, HWCBlending::kBlendingNone, 0x80, true,
+                              &state));
+  // Coverage only looks the same without per pixel alpha.
+  CHECK(GetDrmPlaneBlendState(caps, HWCBlending::kBlendingCoverage, 0xFF,
+                              false, &state));
+  // Plane alpha can't be applied.
+  CHECK(!GetDrmPlaneBlendState(caps, HWCBlending::kBlendingPremult, 0x80,
+                               true, &state));
+  CHECK(!GetDrmPlaneBlendState(caps, HWCBlending::kBlendingPremult, 0x80,
+                               false, &state));
+}
+
+void TestPremultVersusCoverage() {
+  DrmPlaneBlendCaps caps = FullCaps();
+  DrmPlaneBlendState state;
+  CHECK(GetDrmPlaneBlendState(caps, HWCBlending::kBlendingPremult, 0xFF,
+                              true, &state));
+  CHECK(state.blend_mode == kPremult);
+  CHECK(state.alpha == 0xFFFF);
+
+  CHECK(GetDrmPlaneBlendState(caps, HWCBlending::kBlendingCoverage, 0xFF,
+                              true, &state));
+  CHECK(state.blend_mode == kCoverage);
+
+  // Planes missing one of the two modes.
+  caps.supports_coverage = false;
+  CHECK(!GetDrmPlaneBlendState(caps, HWCBlending::kBlendingCoverage, 0xFF,
+                               true, &state));
+  caps = FullCaps();
+  caps.supports_premult = false;
+  CHECK(!GetDrmPlaneBlendState(caps, HWCBlending::kBlendingPremult, 0xFF,
+                               true, &state));
+  CHECK(GetDrmPlaneBlendState(caps, HWCBlending::kBlendingCoverage, 0xFF,
+                              true, &state));
+  CHECK(state.blend_mode == kCoverage);
+}
+
+void TestPlaneAlpha() {
+  DrmPlaneBlendCaps caps = FullCaps();
+  DrmPlaneBlendState state;
+  // 8 bit alpha is scaled to the range of the property.
+  CHECK(GetDrmPlaneBlendState(caps, HWCBlending::kBlendingPremult, 0x80,
+                              true, &state));
+  CHECK(state.alpha == 0x8080);
+  CHECK(state.blend_mode == kPremult);
+
+  CHECK(GetDrmPlaneBlendState(caps, HWCBlending::kBlendingCoverage, 0,
+                              true, &state));
+  CHECK(state.alpha == 0);
+  CHECK(state.blend_mode == kCoverage);
+
+  // Opaque formats keep plane alpha, with any mode which blends.
+  CHECK(GetDrmPlaneBlendState(caps, HWCBlending::kBlendingCoverage, 0x40,
+                              false, &state));
+  CHECK(state.alpha == 0x4040);
+  CHECK(state.blend_mode == kPremult);
+
+  // No blending ignores plane alpha, prefers the "None" mode.
+  CHECK(GetDrmPlaneBlendState(caps, HWCBlending::kBlendingNone, 0x40, true,
+                              &state));
+  CHECK(state.alpha == 0xFFFF);
+  CHECK(state.blend_mode == kNone);
+
+  // Plane alpha without pixel blend mode blends premultiplied.
+  caps = DrmPlaneBlendCaps();
+  caps.alpha_max = 0xFF;
+  CHECK(GetDrmPlaneBlendState(caps, HWCBlending::kBlendingPremult, 0x40,
+                              true, &state));
+  CHECK(state.alpha == 0x40);
+  CHECK(GetDrmPlaneBlendState(caps, HWCBlending::kBlendingCoverage, 0x40,
+                              false, &state));
+  CHECK(state.alpha == 0x40);
+}
+
+void TestCoverageWithoutBlendMode() {
+  DrmPlaneBlendCaps caps = FullCaps();
+  caps.has_blend_mode = false;
+  caps.supports_none = false;
+  caps.supports_premult = false;
+  caps.supports_coverage = false;
+  DrmPlaneBlendState state;
+  CHECK(!GetDrmPlaneBlendState(caps, HWCBlending::kBlendingCoverage, 0xFF,
+                               true, &state));
+  CHECK(!GetDrmPlaneBlendState(caps, HWCBlending::kBlendingCoverage, 0x80,
+                               true, &state));
+  CHECK(GetDrmPlaneBlendState(caps, HWCBlending::kBlendingPremult, 0x80,
+                              true, &state));
+}
+
+void TestFormats() {
+  CHECK(DrmFormatHasAlpha(DRM_FORMAT_ARGB8888));
+  CHECK(DrmFormatHasAlpha(DRM_FORMAT_ABGR2101010));
+  CHECK(!DrmFormatHasAlpha(DRM_FORMAT_XRGB8888));
+  CHECK(!DrmFormatHasAlpha(DRM_FORMAT_NV12));
+}
+
+}  // namespace
+
+int main() {
+  TestNoProperties();
+  TestPremultVersusCoverage();
+  TestPlaneAlpha();
+  TestCoverageWithoutBlendMode();
+  TestFormats();
+  return ReportChecks();
+}
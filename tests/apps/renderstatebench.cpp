@@ -0,0 +1,239 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Measures the CPU cost of building the RenderStates of an offscreen
+// plane, which Compositor::Draw does for every frame. Layers are stacked
+// over a 1920x1080 plane with assorted transforms and regions use a
+// varying subset of them.
+//
+// "region" redoes everything for every region into storage allocated per
+// region and frame, as RenderState::ConstructState did before.
+// "frame" is what Compositor does now: layer state is computed once per
+// frame through LayerStateTable and RenderStates are built in the arena
+// of a DrawState reused across frames.
+//
+// Usage: renderstatebench [iterations]
+
+#include <drm_fourcc.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <hwclayer.h>
+#include <nativebufferhandler.h>
+
+#include "compositionregion.h"
+#include "overlaylayer.h"
+#include "renderstate.h"
+#include "resourcemanager.h"
+
+using hwcomposer::CompositionRegion;
+using hwcomposer::DrawState;
+using hwcomposer::LayerStateTable;
+using hwcomposer::OverlayLayer;
+using hwcomposer::RenderState;
+
+namespace {
+
+const int32_t kWidth = 1920;
+const int32_t kHeight = 1080;
+
+const uint32_t kLayers[] = {8, 16, 32, 64};
+const uint32_t kRegions[] = {100, 200, 400};
+
+const uint32_t kTransforms[] = {
+    hwcomposer::HWCTransform::kIdentity, hwcomposer::HWCTransform::kTransform90,
+    hwcomposer::HWCTransform::kTransform180,
+    hwcomposer::HWCTransform::kTransform270};
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+// Keeps the states from being optimized away.
+volatile float sink;
+
+int64_t NowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void CreateLayers(uint32_t total, HWCNativeHandle handle,
+                  hwcomposer::ResourceManager* resource_manager,
+                  std::vector<std::unique_ptr<hwcomposer::HwcLayer>>& storage,
+                  std::vector<OverlayLayer>& layers) {
+  for (uint32_t i = 0; i < total; i++) {
+    storage.emplace_back(new hwcomposer::HwcLayer());
+    hwcomposer::HwcLayer* layer = storage.back().get();
+    int32_t inset = (i * 7) % 200;
+    layer->SetTransform(kTransforms[i % ARRAY_SIZE(kTransforms)]);
+    layer->SetSourceCrop(
+        hwcomposer::HwcRect<float>(inset, inset, kWidth - inset, kHeight));
+    layer->SetDisplayFrame(
+        hwcomposer::HwcRect<int>(inset, 0, kWidth, kHeight - inset), 0);
+    layer->SetBlending(hwcomposer::HWCBlending::kBlendingPremult);
+    layer->SetAlpha(200);
+    layer->SetNativeHandle(handle);
+    layers.emplace_back();
+    layers.back().InitializeFromHwcLayer(layer, resource_manager, NULL, i, i,
+                                         kHeight, hwcomposer::kRotateNone,
+                                         false);
+  }
+}
+
+// Tiles the plane with total regions, each using about half the layers.
+void CreateRegions(uint32_t total, uint32_t total_layers,
+                   std::vector<CompositionRegion>& regions) {
+  uint32_t columns = 1;
+  while (columns * columns < total)
+    columns++;
+
+  int32_t width = kWidth / columns;
+  int32_t height = kHeight / columns;
+  for (uint32_t i = 0; i < total; i++) {
+    regions.emplace_back();
+    CompositionRegion& region = regions.back();
+    int32_t left = (i % columns) * width;
+    int32_t top = (i / columns) * height;
+    region.frame = hwcomposer::HwcRect<int>(left, top, left + width,
+                                            top + height);
+    for (uint32_t layer = 0; layer < total_layers; layer++) {
+      if ((layer + i) % 2 == 0 || layer % 5 == 0)
+        region.source_layers.emplace_back(layer);
+    }
+  }
+}
+
+void PerRegion(const std::vector<OverlayLayer>& layers,
+               const std::vector<CompositionRegion>& regions) {
+  std::vector<std::vector<RenderState::LayerState>> storage;
+  std::vector<RenderState> states;
+  LayerStateTable table;
+  for (const CompositionRegion& region : regions) {
+    table.Reset(layers.size(), 1, false, false);
+    table.AddLayers(layers, region);
+    storage.emplace(storage.begin());
+    std::vector<RenderState::LayerState>& arena = storage.front();
+    arena.reserve(region.source_layers.size());
+    RenderState state;
+    state.ConstructState(region, table, arena);
+    states.emplace(states.begin(), state);
+  }
+
+  sink = states.back().layer_state_[0].crop_bounds_[0];
+}
+
+void PerFrame(const std::vector<OverlayLayer>& layers,
+              const std::vector<CompositionRegion>& regions,
+              LayerStateTable& table, DrawState& draw_state) {
+  draw_state.Reset();
+  table.Reset(layers.size(), 1, false, false);
+  size_t total_layer_states = 0;
+  for (const CompositionRegion& region : regions) {
+    table.AddLayers(layers, region);
+    total_layer_states += region.source_layers.size();
+  }
+
+  draw_state.layer_states_.reserve(total_layer_states);
+  draw_state.states_.reserve(regions.size());
+  for (size_t i = regions.size(); i-- > 0;) {
+    draw_state.states_.emplace_back();
+    draw_state.states_.back().ConstructState(regions[i], table,
+                                             draw_state.layer_states_);
+  }
+
+  sink = draw_state.states_.back().layer_state_[0].crop_bounds_[0];
+}
+
+double Median(std::vector<int64_t>& values) {
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2] / 1000.0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  uint32_t iterations = argc > 1 ? atoi(argv[1]) : 200;
+  if (!iterations) {
+    fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+    return 1;
+  }
+
+  int fd = open("/dev/dri/renderD128", O_RDWR);
+  if (fd == -1) {
+    fprintf(stderr, "Can't open GPU file.\n");
+    return 1;
+  }
+
+  std::unique_ptr<hwcomposer::NativeBufferHandler> buffer_handler(
+      hwcomposer::NativeBufferHandler::CreateInstance(fd));
+  if (!buffer_handler) {
+    fprintf(stderr, "Failed to create buffer handler.\n");
+    return 1;
+  }
+
+  HWCNativeHandle handle = 0;
+  if (!buffer_handler->CreateBuffer(kWidth, kHeight, DRM_FORMAT_ARGB8888,
+                                    &handle)) {
+    fprintf(stderr, "Failed to allocate layer buffer.\n");
+    return 1;
+  }
+
+  printf("%6s %7s %12s %12s %8s\n", "layers", "regions", "region us",
+         "frame us", "speedup");
+  {
+    hwcomposer::ResourceManager resource_manager(buffer_handler.get());
+    for (uint32_t total_layers : kLayers) {
+      std::vector<std::unique_ptr<hwcomposer::HwcLayer>> storage;
+      std::vector<OverlayLayer> layers;
+      layers.reserve(total_layers);
+      CreateLayers(total_layers, handle, &resource_manager, storage, layers);
+      for (uint32_t total_regions : kRegions) {
+        std::vector<CompositionRegion> regions;
+        CreateRegions(total_regions, total_layers, regions);
+
+        LayerStateTable table;
+        DrawState draw_state;
+        std::vector<int64_t> per_region;
+        std::vector<int64_t> per_frame;
+        for (uint32_t i = 0; i < iterations; i++) {
+          int64_t start = NowNs();
+          PerRegion(layers, regions);
+          int64_t middle = NowNs();
+          PerFrame(layers, regions, table, draw_state);
+          per_region.emplace_back(middle - start);
+          per_frame.emplace_back(NowNs() - middle);
+        }
+
+        double region_us = Median(per_region);
+        double frame_us = Median(per_frame);
+        printf("%6u %7u %12.1f %12.1f %7.2fx\n", total_layers, total_regions,
+               region_us, frame_us, region_us / frame_us);
+      }
+    }
+  }
+
+  buffer_handler->ReleaseBuffer(handle);
+  buffer_handler->DestroyHandle(handle);
+  buffer_handler.reset();
+  close(fd);
+  return 0;
+}
@@ -0,0 +1,266 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Measures time-to-first-frame after powering a display back on. A stack
+// of overlapping layers is presented for a while, the display is turned
+// off and on again and the next frame is presented right away. The first
+// run suspends cold, the second one with NativeDisplay::SetWarmSuspend.
+//
+// Reported per cycle are the time SetPowerMode(kOn) took, the time until
+// the retire fence of the first frame presented after it signalled and,
+// for warm resumes, when the last frame was shown again according to the
+// display's frame statistics.
+//
+// Usage: resumelatencybench [cycles] [layers] [budget_mb]
+
+#include <drm_fourcc.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <gpudevice.h>
+#include <hwclayer.h>
+#include <nativebufferhandler.h>
+#include <nativedisplay.h>
+
+namespace {
+
+const int32_t kFenceTimeoutMs = 1000;
+const uint32_t kWarmupFrames = 30;
+const useconds_t kOffTimeUs = 200000;
+
+int64_t NowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct Scenario {
+  hwcomposer::NativeDisplay* display;
+  std::vector<HWCNativeHandle> buffers;
+  uint32_t cycles;
+  uint32_t layers;
+};
+
+struct Result {
+  std::vector<int64_t> power_on;
+  std::vector<int64_t> first_frame;
+  std::vector<int64_t> resumed_frame;
+  uint32_t unsignalled = 0;
+};
+
+// Presents one frame and returns when its retire fence signalled, or 0
+// if it never did.
+int64_t PresentAndWait(hwcomposer::NativeDisplay* display,
+                       std::vector<hwcomposer::HwcLayer*>& layers) {
+  int32_t retire_fence = -1;
+  display->Present(layers, &retire_fence);
+  int64_t signalled = NowNs();
+  if (retire_fence > 0) {
+    struct pollfd fds;
+    fds.fd = retire_fence;
+    fds.events = POLLIN;
+    int ret = poll(&fds, 1, kFenceTimeoutMs);
+    signalled = ret > 0 ? NowNs() : 0;
+    close(retire_fence);
+  }
+
+  for (hwcomposer::HwcLayer* layer : layers) {
+    int32_t fence = layer->GetReleaseFence();
+    if (fence > 0)
+      close(fence);
+  }
+
+  return signalled;
+}
+
+// Time the last frame was shown again by a warm resume after since, 0 if
+// it wasn't or the display doesn't know.
+int64_t GetResumedFrameLatency(hwcomposer::NativeDisplay* display,
+                               int64_t since) {
+  std::vector<hwcomposer::HwcFrameStatistics> frames;
+  if (!display->GetFrameStatistics(0, &frames))
+    return 0;
+
+  for (const hwcomposer::HwcFrameStatistics& frame : frames) {
+    if ((frame.composition_flags & hwcomposer::kFrameResumed) &&
+        frame.present_time >= since && frame.flip_time > 0)
+      return frame.flip_time - since;
+  }
+
+  return 0;
+}
+
+void Run(const Scenario& scenario, bool warm, uint64_t budget,
+         Result* result) {
+  hwcomposer::NativeDisplay* display = scenario.display;
+  int32_t width = display->Width();
+  int32_t height = display->Height();
+  display->SetWarmSuspend(warm, budget);
+
+  // Overlapping layers, each one smaller than the previous, so that not
+  // all of them fit on planes and some get composited off-screen.
+  std::vector<std::unique_ptr<hwcomposer::HwcLayer>> storage;
+  std::vector<hwcomposer::HwcLayer*> layers;
+  for (uint32_t i = 0; i < scenario.layers; i++) {
+    int32_t inset = i * std::min(width, height) / (4 * scenario.layers);
+    storage.emplace_back(new hwcomposer::HwcLayer());
+    hwcomposer::HwcLayer* layer = storage.back().get();
+    layer->SetTransform(0);
+    layer->SetSourceCrop(hwcomposer::HwcRect<float>(0, 0, width, height));
+    layer->SetDisplayFrame(
+        hwcomposer::HwcRect<int>(inset, inset, width - inset, height - inset),
+        0);
+    layer->SetBlending(i ? hwcomposer::HWCBlending::kBlendingPremult
+                         : hwcomposer::HWCBlending::kBlendingNone);
+    layer->SetNativeHandle(scenario.buffers.at(i));
+    layers.emplace_back(layer);
+  }
+
+  for (uint32_t frame = 0; frame < kWarmupFrames; frame++)
+    PresentAndWait(display, layers);
+
+  for (uint32_t cycle = 0; cycle < scenario.cycles; cycle++) {
+    display->SetPowerMode(hwcomposer::kOff);
+    usleep(kOffTimeUs);
+
+    int64_t start = NowNs();
+    display->SetPowerMode(hwcomposer::kOn);
+    result->power_on.emplace_back(NowNs() - start);
+
+    int64_t signalled = PresentAndWait(display, layers);
+    if (signalled) {
+      result->first_frame.emplace_back(signalled - start);
+    } else {
+      result->unsignalled++;
+    }
+
+    if (warm) {
+      int64_t resumed = GetResumedFrameLatency(display, start);
+      if (resumed)
+        result->resumed_frame.emplace_back(resumed);
+    }
+
+    // Let the display settle before the next cycle.
+    for (uint32_t frame = 0; frame < kWarmupFrames; frame++)
+      PresentAndWait(display, layers);
+  }
+
+  display->SetWarmSuspend(false, 0);
+}
+
+void PrintDistribution(const char* name, std::vector<int64_t>& values) {
+  if (values.empty()) {
+    printf("  %-14s n/a\n", name);
+    return;
+  }
+
+  std::sort(values.begin(), values.end());
+  size_t size = values.size();
+  printf("  %-14s ms p50: %8.2f p90: %8.2f max: %8.2f\n", name,
+         values[size / 2] / 1000000.0, values[size * 9 / 10] / 1000000.0,
+         values[size - 1] / 1000000.0);
+}
+
+void Print(const char* name, Result& result) {
+  printf("%s (unsignalled: %u)\n", name, result.unsignalled);
+  PrintDistribution("power on", result.power_on);
+  PrintDistribution("first frame", result.first_frame);
+  PrintDistribution("resumed frame", result.resumed_frame);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  uint32_t cycles = argc > 1 ? atoi(argv[1]) : 10;
+  uint32_t layers = argc > 2 ? atoi(argv[2]) : 6;
+  uint64_t budget_mb = argc > 3 ? strtoull(argv[3], NULL, 10) : 64;
+  if (!cycles || !layers) {
+    fprintf(stderr, "usage: %s [cycles] [layers] [budget_mb]\n", argv[0]);
+    return 1;
+  }
+
+  hwcomposer::GpuDevice device;
+  device.Initialize();
+  std::vector<hwcomposer::NativeDisplay*> displays;
+  device.GetConnectedPhysicalDisplays(displays);
+  if (displays.empty()) {
+    fprintf(stderr, "No connected display.\n");
+    return 1;
+  }
+
+  hwcomposer::NativeDisplay* display = displays.at(0);
+  display->SetActiveConfig(0);
+  display->SetPowerMode(hwcomposer::kOn);
+
+  int fd = open("/dev/dri/renderD128", O_RDWR);
+  if (fd == -1) {
+    fprintf(stderr, "Can't open GPU file.\n");
+    return 1;
+  }
+
+  std::unique_ptr<hwcomposer::NativeBufferHandler> buffer_handler(
+      hwcomposer::NativeBufferHandler::CreateInstance(fd));
+  if (!buffer_handler) {
+    fprintf(stderr, "Failed to create buffer handler.\n");
+    return 1;
+  }
+
+  Scenario scenario;
+  scenario.display = display;
+  scenario.cycles = cycles;
+  scenario.layers = layers;
+  for (uint32_t i = 0; i < layers; i++) {
+    HWCNativeHandle handle = 0;
+    if (!buffer_handler->CreateBuffer(display->Width(), display->Height(),
+                                      i ? DRM_FORMAT_ARGB8888
+                                        : DRM_FORMAT_XRGB8888,
+                                      &handle)) {
+      fprintf(stderr, "Failed to allocate layer buffer.\n");
+      return 1;
+    }
+
+    scenario.buffers.emplace_back(handle);
+  }
+
+  printf("%ux%u layers: %u cycles: %u warm budget: %llu MB\n",
+         display->Width(), display->Height(), layers, cycles,
+         static_cast<unsigned long long>(budget_mb));
+
+  Result cold;
+  Run(scenario, false, 0, &cold);
+  Print("cold", cold);
+
+  Result warm;
+  Run(scenario, true, budget_mb << 20, &warm);
+  Print("warm", warm);
+
+  for (HWCNativeHandle handle : scenario.buffers) {
+    buffer_handler->ReleaseBuffer(handle);
+    buffer_handler->DestroyHandle(handle);
+  }
+
+  buffer_handler.reset();
+  close(fd);
+  return 0;
+}
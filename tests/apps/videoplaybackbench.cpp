@@ -0,0 +1,365 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Replays a video playback session: 24 fps NV12 video over a background,
+// with subtitles, a status bar and player controls shown now and then
+// above it. The first run presents it as is, the second one announces
+// the playback through UpdateVideoState, UpdateVideoFPS and
+// SetOptimizationMode so that planes are set aside for the video.
+//
+// Reports the time spent in Present and how many frames were composited
+// off-screen or had their layers assigned to planes again.
+//
+// Usage: videoplaybackbench [frames]
+
+#include <drm_fourcc.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <gpudevice.h>
+#include <hwclayer.h>
+#include <nativebufferhandler.h>
+#include <nativedisplay.h>
+
+namespace {
+
+const int64_t kVideoSession = 1;
+const int32_t kVideoFps = 24;
+const uint32_t kVideoBuffers = 3;
+
+// Frames, at the refresh rate of the display, between UI changes.
+const uint32_t kSubtitlePeriod = 150;
+const uint32_t kStatusBarPeriod = 60;
+const uint32_t kControlsPeriod = 600;
+const uint32_t kControlsShown = 180;
+
+int64_t NowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct Scenario {
+  hwcomposer::NativeDisplay* display;
+  HWCNativeHandle background;
+  HWCNativeHandle video[kVideoBuffers];
+  HWCNativeHandle subtitles[2];
+  HWCNativeHandle status_bar[2];
+  HWCNativeHandle controls;
+  uint32_t frames;
+  int32_t refresh_rate;
+  int64_t frame_period;
+};
+
+struct Result {
+  std::vector<int64_t> present_times;
+  uint32_t frames = 0;
+  uint32_t gpu_frames = 0;
+  uint32_t validated_frames = 0;
+};
+
+void InitLayer(hwcomposer::HwcLayer* layer, HWCNativeHandle handle,
+               const hwcomposer::HwcRect<int>& frame, bool blended) {
+  layer->SetTransform(0);
+  layer->SetNativeHandle(handle);
+  layer->SetSourceCrop(hwcomposer::HwcRect<float>(
+      0, 0, frame.right - frame.left, frame.bottom - frame.top));
+  layer->SetDisplayFrame(frame, 0);
+  if (blended)
+    layer->SetBlending(hwcomposer::HWCBlending::kBlendingPremult);
+}
+
+void SetDamage(hwcomposer::HwcLayer* layer, bool changed) {
+  hwcomposer::HwcRegion damage;
+  if (changed)
+    damage.emplace_back(layer->GetDisplayFrame());
+  layer->SetSurfaceDamage(damage);
+}
+
+void CloseReleaseFences(std::vector<hwcomposer::HwcLayer*>& layers) {
+  for (hwcomposer::HwcLayer* layer : layers) {
+    int32_t fence = layer->GetReleaseFence();
+    if (fence > 0)
+      close(fence);
+  }
+}
+
+uint64_t LastFrameNumber(hwcomposer::NativeDisplay* display) {
+  std::vector<hwcomposer::HwcFrameStatistics> frames;
+  if (!display->GetFrameStatistics(0, &frames) || frames.empty())
+    return 0;
+
+  return frames.back().frame_number;
+}
+
+void Run(const Scenario& scenario, bool announce, Result* result) {
+  hwcomposer::NativeDisplay* display = scenario.display;
+  int32_t width = display->Width();
+  int32_t height = display->Height();
+  int32_t bar_height = height / 20;
+
+  hwcomposer::HwcLayer background;
+  InitLayer(&background, scenario.background,
+            hwcomposer::HwcRect<int>(0, 0, width, height), false);
+
+  // 16:9 video letterboxed below the status bar.
+  int32_t video_height = std::min(height - bar_height, width * 9 / 16);
+  int32_t video_top = bar_height + (height - bar_height - video_height) / 2;
+  hwcomposer::HwcLayer video;
+  InitLayer(&video, scenario.video[0],
+            hwcomposer::HwcRect<int>(0, video_top, width,
+                                     video_top + video_height),
+            false);
+  video.SetSourceCrop(hwcomposer::HwcRect<float>(0, 0, 1920, 1080));
+  video.SetColorSpace(hwcomposer::HWCColorSpace::kBT709,
+                      hwcomposer::HWCColorRange::kLimited);
+
+  hwcomposer::HwcLayer subtitles;
+  InitLayer(&subtitles, scenario.subtitles[0],
+            hwcomposer::HwcRect<int>(width / 8, height - 4 * bar_height,
+                                     width * 7 / 8, height - 2 * bar_height),
+            true);
+
+  hwcomposer::HwcLayer status_bar;
+  InitLayer(&status_bar, scenario.status_bar[0],
+            hwcomposer::HwcRect<int>(0, 0, width, bar_height), true);
+
+  hwcomposer::HwcLayer controls;
+  InitLayer(&controls, scenario.controls,
+            hwcomposer::HwcRect<int>(0, height - 2 * bar_height, width,
+                                     height),
+            true);
+
+  if (announce) {
+    display->UpdateVideoState(kVideoSession, true);
+    display->UpdateVideoFPS(kVideoSession, kVideoFps);
+    display->SetOptimizationMode(
+        hwcomposer::HWCOptimizationMode::kOptimizeVideo);
+  }
+
+  uint64_t first_frame = LastFrameNumber(display);
+  std::vector<hwcomposer::HwcLayer*> layers;
+  int64_t next_frame = NowNs();
+  uint32_t last_video_frame = 0;
+  for (uint32_t frame = 0; frame < scenario.frames; frame++) {
+    uint32_t video_frame = frame * kVideoFps / scenario.refresh_rate;
+    bool video_changed = frame == 0 || video_frame != last_video_frame;
+    last_video_frame = video_frame;
+    video.SetNativeHandle(scenario.video[video_frame % kVideoBuffers]);
+    SetDamage(&video, video_changed);
+
+    bool subtitles_changed = frame % kSubtitlePeriod == 0;
+    subtitles.SetNativeHandle(
+        scenario.subtitles[(frame / kSubtitlePeriod) % 2]);
+    SetDamage(&subtitles, subtitles_changed);
+
+    bool status_changed = frame % kStatusBarPeriod == 0;
+    status_bar.SetNativeHandle(
+        scenario.status_bar[(frame / kStatusBarPeriod) % 2]);
+    SetDamage(&status_bar, status_changed);
+
+    SetDamage(&background, frame == 0);
+    uint32_t controls_frame = frame % kControlsPeriod;
+    SetDamage(&controls, controls_frame == 0);
+
+    layers.clear();
+    layers.emplace_back(&background);
+    layers.emplace_back(&video);
+    // Subtitles are shown every other period, each time a new line.
+    if ((frame / kSubtitlePeriod) % 2 == 0)
+      layers.emplace_back(&subtitles);
+
+    if (controls_frame < kControlsShown)
+      layers.emplace_back(&controls);
+
+    layers.emplace_back(&status_bar);
+
+    int32_t retire_fence = -1;
+    int64_t start = NowNs();
+    display->Present(layers, &retire_fence);
+    result->present_times.emplace_back(NowNs() - start);
+    if (retire_fence > 0)
+      close(retire_fence);
+
+    CloseReleaseFences(layers);
+
+    next_frame += scenario.frame_period;
+    int64_t now = NowNs();
+    if (next_frame > now)
+      usleep((next_frame - now) / 1000);
+  }
+
+  std::vector<hwcomposer::HwcFrameStatistics> frames;
+  if (display->GetFrameStatistics(first_frame, &frames)) {
+    for (const hwcomposer::HwcFrameStatistics& stats : frames) {
+      result->frames++;
+      if (stats.composition_flags & hwcomposer::kFrameGpuComposition)
+        result->gpu_frames++;
+
+      if (stats.composition_flags & hwcomposer::kFrameFullValidation)
+        result->validated_frames++;
+    }
+  }
+
+  if (announce) {
+    display->SetOptimizationMode(
+        hwcomposer::HWCOptimizationMode::kOptimizeNormal);
+    display->UpdateVideoState(kVideoSession, false);
+  }
+}
+
+void Print(const char* name, Result& result) {
+  std::vector<int64_t>& times = result.present_times;
+  std::sort(times.begin(), times.end());
+  size_t size = times.size();
+  printf("%-10s present us p50: %7.1f p90: %7.1f max: %7.1f", name,
+         times[size / 2] / 1000.0, times[size * 9 / 10] / 1000.0,
+         times[size - 1] / 1000.0);
+  if (!result.frames) {
+    printf(" no frame statistics\n");
+    return;
+  }
+
+  printf(" gpu frames: %5.1f%% validated frames: %5.1f%%\n",
+         100.0 * result.gpu_frames / result.frames,
+         100.0 * result.validated_frames / result.frames);
+}
+
+bool Allocate(hwcomposer::NativeBufferHandler* handler, uint32_t width,
+              uint32_t height, uint32_t format, uint32_t usage,
+              HWCNativeHandle* handle) {
+  if (handler->CreateBuffer(width, height, format, handle, usage))
+    return true;
+
+  fprintf(stderr, "Failed to allocate %ux%u buffer.\n", width, height);
+  return false;
+}
+
+void Release(hwcomposer::NativeBufferHandler* handler,
+             HWCNativeHandle handle) {
+  handler->ReleaseBuffer(handle);
+  handler->DestroyHandle(handle);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  uint32_t frames = argc > 1 ? atoi(argv[1]) : 1800;
+  if (!frames) {
+    fprintf(stderr, "usage: %s [frames]\n", argv[0]);
+    return 1;
+  }
+
+  hwcomposer::GpuDevice device;
+  device.Initialize();
+  std::vector<hwcomposer::NativeDisplay*> displays;
+  device.GetConnectedPhysicalDisplays(displays);
+  if (displays.empty()) {
+    fprintf(stderr, "No connected display.\n");
+    return 1;
+  }
+
+  hwcomposer::NativeDisplay* display = displays.at(0);
+  display->SetActiveConfig(0);
+  display->SetPowerMode(hwcomposer::kOn);
+
+  int fd = open("/dev/dri/renderD128", O_RDWR);
+  if (fd == -1) {
+    fprintf(stderr, "Can't open GPU file.\n");
+    return 1;
+  }
+
+  std::unique_ptr<hwcomposer::NativeBufferHandler> buffer_handler(
+      hwcomposer::NativeBufferHandler::CreateInstance(fd));
+  if (!buffer_handler) {
+    fprintf(stderr, "Failed to create buffer handler.\n");
+    return 1;
+  }
+
+  Scenario scenario;
+  scenario.display = display;
+  scenario.frames = frames;
+  int32_t refresh_rate = 0;
+  uint32_t config = 0;
+  display->GetActiveConfig(&config);
+  if (!display->GetDisplayAttribute(
+          config, hwcomposer::HWCDisplayAttribute::kRefreshRate,
+          &refresh_rate) ||
+      refresh_rate <= 0)
+    refresh_rate = 60;
+
+  scenario.refresh_rate = refresh_rate;
+  scenario.frame_period = 1000000000LL / refresh_rate;
+
+  hwcomposer::NativeBufferHandler* handler = buffer_handler.get();
+  uint32_t width = display->Width();
+  uint32_t height = display->Height();
+  bool allocated = Allocate(handler, width, height, DRM_FORMAT_XRGB8888, 0,
+                            &scenario.background) &&
+                   Allocate(handler, width, height / 10, DRM_FORMAT_ARGB8888,
+                            0, &scenario.controls);
+  for (HWCNativeHandle& handle : scenario.video) {
+    allocated = allocated &&
+                Allocate(handler, 1920, 1080, DRM_FORMAT_NV12,
+                         hwcomposer::kLayerVideo, &handle);
+  }
+
+  for (HWCNativeHandle& handle : scenario.subtitles) {
+    allocated = allocated && Allocate(handler, width * 3 / 4, height / 10,
+                                      DRM_FORMAT_ARGB8888, 0, &handle);
+  }
+
+  for (HWCNativeHandle& handle : scenario.status_bar) {
+    allocated = allocated && Allocate(handler, width, height / 20,
+                                      DRM_FORMAT_ARGB8888, 0, &handle);
+  }
+
+  if (!allocated)
+    return 1;
+
+  printf("%ux%u@%d video: %d fps frames: %u\n", width, height, refresh_rate,
+         kVideoFps, frames);
+
+  Result plain;
+  Run(scenario, false, &plain);
+  Print("plain", plain);
+
+  Result announced;
+  Run(scenario, true, &announced);
+  Print("announced", announced);
+
+  Release(handler, scenario.background);
+  Release(handler, scenario.controls);
+  for (HWCNativeHandle handle : scenario.video)
+    Release(handler, handle);
+
+  for (HWCNativeHandle handle : scenario.subtitles)
+    Release(handler, handle);
+
+  for (HWCNativeHandle handle : scenario.status_bar)
+    Release(handler, handle);
+
+  buffer_handler.reset();
+  close(fd);
+  return 0;
+}
@@ -0,0 +1,355 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Measures the time to compose a 1920x1080 NV12 video layer with UI
+// layers into an offscreen plane. The UI layers are premultiplied bands
+// across the video, like a status bar, subtitles and playback controls.
+//
+// "va+gl" is the two-stage path: VARenderer converts the video into an
+// XRGB8888 buffer which GLRenderer then blends with the UI.
+// "external" blends the NV12 buffer directly, sampled through
+// samplerExternalOES with the conversion left to the driver.
+// "planar" blends it directly from its R8 and GR88 planes, converting
+// with the BT.709 limited range shader the layer asks for.
+//
+// Frames are timed from the start of the draw until the render fence of
+// the plane signals.
+//
+// Usage: yuvcompositionbench [frames] [ui layers]
+
+#include <drm_fourcc.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <hwclayer.h>
+#include <nativebufferhandler.h>
+
+#include "compositionregion.h"
+#include "factory.h"
+#include "nativegpuresource.h"
+#include "nativesurface.h"
+#include "overlaylayer.h"
+#include "renderer.h"
+#include "renderstate.h"
+#include "resourcemanager.h"
+
+using hwcomposer::CompositionRegion;
+using hwcomposer::DrawState;
+using hwcomposer::LayerStateTable;
+using hwcomposer::NativeGpuResource;
+using hwcomposer::NativeSurface;
+using hwcomposer::OverlayBuffer;
+using hwcomposer::OverlayLayer;
+using hwcomposer::RenderState;
+using hwcomposer::Renderer;
+
+namespace {
+
+const int32_t kWidth = 1920;
+const int32_t kHeight = 1080;
+// Height of a UI band, bands are a band apart.
+const int32_t kBandHeight = 120;
+const uint32_t kMaxUILayers = kHeight / (2 * kBandHeight);
+const int kFenceTimeoutMs = 1000;
+
+int64_t NowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct Result {
+  std::vector<int64_t> frame_time;
+  uint32_t failed = 0;
+};
+
+// Layer 0 is the full screen video or its converted copy, layer i covers
+// the band starting at (i - 1) * 2 * kBandHeight.
+void CreateLayers(HWCNativeHandle video, const std::vector<HWCNativeHandle>& ui,
+                  hwcomposer::ResourceManager* resource_manager,
+                  std::vector<std::unique_ptr<hwcomposer::HwcLayer>>& storage,
+                  std::vector<OverlayLayer>& layers) {
+  for (size_t i = 0; i <= ui.size(); i++) {
+    storage.emplace_back(new hwcomposer::HwcLayer());
+    hwcomposer::HwcLayer* layer = storage.back().get();
+    int32_t top = i ? (i - 1) * 2 * kBandHeight : 0;
+    int32_t bottom = i ? top + kBandHeight : kHeight;
+    layer->SetTransform(hwcomposer::HWCTransform::kIdentity);
+    layer->SetSourceCrop(hwcomposer::HwcRect<float>(0, top, kWidth, bottom));
+    layer->SetDisplayFrame(hwcomposer::HwcRect<int>(0, top, kWidth, bottom),
+                           0);
+    layer->SetBlending(i ? hwcomposer::HWCBlending::kBlendingPremult
+                         : hwcomposer::HWCBlending::kBlendingNone);
+    if (!i)
+      layer->SetColorSpace(hwcomposer::HWCColorSpace::kBT709,
+                           hwcomposer::HWCColorRange::kLimited);
+
+    layer->SetNativeHandle(i ? ui.at(i - 1) : video);
+    layers.emplace_back();
+    layers.back().InitializeFromHwcLayer(layer, resource_manager, NULL, i, i,
+                                         kHeight, hwcomposer::kRotateNone,
+                                         false);
+  }
+}
+
+// Splits the plane into bands with and without UI, as the compositor
+// would.
+void CreateRegions(uint32_t ui_layers, std::vector<CompositionRegion>& regions) {
+  int32_t top = 0;
+  for (uint32_t i = 0; i < ui_layers; i++) {
+    regions.emplace_back();
+    regions.back().frame =
+        hwcomposer::HwcRect<int>(0, top, kWidth, top + kBandHeight);
+    regions.back().source_layers.emplace_back(0);
+    regions.back().source_layers.emplace_back(i + 1);
+    top += kBandHeight;
+    int32_t bottom = i + 1 < ui_layers ? top + kBandHeight : kHeight;
+    regions.emplace_back();
+    regions.back().frame = hwcomposer::HwcRect<int>(0, top, kWidth, bottom);
+    regions.back().source_layers.emplace_back(0);
+    top = bottom;
+  }
+}
+
+bool WaitForFence(int32_t fence) {
+  if (fence <= 0)
+    return true;
+
+  struct pollfd fds;
+  fds.fd = fence;
+  fds.events = POLLIN;
+  bool signaled = poll(&fds, 1, kFenceTimeoutMs) > 0;
+  close(fence);
+  return signaled;
+}
+
+// Composes layers into surface the way CompositorThread does.
+bool Compose(const std::vector<OverlayLayer>& layers,
+             const std::vector<CompositionRegion>& regions,
+             NativeGpuResource* resources, Renderer* renderer,
+             LayerStateTable& table, DrawState& draw_state,
+             NativeSurface* surface) {
+  draw_state.Reset();
+  table.Reset(layers.size(), 1, false, false);
+  size_t total_layer_states = 0;
+  for (const CompositionRegion& region : regions) {
+    table.AddLayers(layers, region);
+    total_layer_states += region.source_layers.size();
+  }
+
+  draw_state.layer_states_.reserve(total_layer_states);
+  for (size_t i = regions.size(); i-- > 0;) {
+    draw_state.states_.emplace_back();
+    draw_state.states_.back().ConstructState(regions[i], table,
+                                             draw_state.layer_states_);
+  }
+
+  std::vector<OverlayBuffer*> buffers;
+  for (const OverlayLayer& layer : layers)
+    buffers.emplace_back(layer.GetBuffer());
+
+  if (!resources->PrepareResources(buffers))
+    return false;
+
+  for (RenderState& render_state : draw_state.states_) {
+    for (RenderState::LayerState& state : render_state.layer_state_) {
+      state.handle_ = resources->GetResourceHandle(state.layer_index_);
+      if (state.sampling_key_ != hwcomposer::kSampleExternal &&
+          !resources->GetPlaneResourceHandles(state.layer_index_,
+                                              &state.plane_handles_[0],
+                                              &state.plane_handles_[1])) {
+        state.sampling_key_ = hwcomposer::kSampleExternal;
+      }
+    }
+  }
+
+  surface->SetClearSurface(NativeSurface::kFullClear);
+  if (!renderer->Draw(draw_state.states_, surface))
+    return false;
+
+  return WaitForFence(surface->GetLayer()->ReleaseAcquireFence());
+}
+
+void Print(const char* name, Result& result) {
+  std::vector<int64_t>& values = result.frame_time;
+  if (values.empty()) {
+    printf("%-8s n/a (failed: %u)\n", name, result.failed);
+    return;
+  }
+
+  std::sort(values.begin(), values.end());
+  size_t size = values.size();
+  printf("%-8s ms p50: %8.3f p90: %8.3f max: %8.3f (failed: %u)\n", name,
+         values[size / 2] / 1000000.0, values[size * 9 / 10] / 1000000.0,
+         values[size - 1] / 1000000.0, result.failed);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  uint32_t frames = argc > 1 ? atoi(argv[1]) : 300;
+  uint32_t ui_layers = argc > 2 ? atoi(argv[2]) : 3;
+  if (!frames || !ui_layers || ui_layers > kMaxUILayers) {
+    fprintf(stderr, "usage: %s [frames] [ui layers, 1-%u]\n", argv[0],
+            kMaxUILayers);
+    return 1;
+  }
+
+  int fd = open("/dev/dri/renderD128", O_RDWR);
+  if (fd == -1) {
+    fprintf(stderr, "Can't open GPU file.\n");
+    return 1;
+  }
+
+  std::unique_ptr<hwcomposer::NativeBufferHandler> buffer_handler(
+      hwcomposer::NativeBufferHandler::CreateInstance(fd));
+  if (!buffer_handler) {
+    fprintf(stderr, "Failed to create buffer handler.\n");
+    return 1;
+  }
+
+  // The video, its XRGB8888 copy for va+gl and the UI layers.
+  std::vector<HWCNativeHandle> handles;
+  for (uint32_t i = 0; i < ui_layers + 2; i++) {
+    int format = DRM_FORMAT_ARGB8888;
+    uint32_t usage = hwcomposer::kLayerNormal;
+    if (i < 2) {
+      format = i ? DRM_FORMAT_XRGB8888 : DRM_FORMAT_NV12;
+      usage = hwcomposer::kLayerVideo;
+    }
+
+    HWCNativeHandle handle = 0;
+    if (!buffer_handler->CreateBuffer(kWidth, kHeight, format, &handle,
+                                      usage)) {
+      fprintf(stderr, "Failed to allocate layer buffers.\n");
+      return 1;
+    }
+
+    handles.emplace_back(handle);
+  }
+
+  std::vector<HWCNativeHandle> ui(handles.begin() + 2, handles.end());
+
+  printf("%dx%d NV12 video, ui layers: %u frames: %u\n", kWidth, kHeight,
+         ui_layers, frames);
+  {
+    hwcomposer::ResourceManager resource_manager(buffer_handler.get());
+    std::unique_ptr<Renderer> renderer(hwcomposer::Create3DRenderer());
+    if (!renderer->Init()) {
+      fprintf(stderr, "Failed to initialize GL renderer.\n");
+      return 1;
+    }
+
+    std::unique_ptr<Renderer> media_renderer(
+        hwcomposer::CreateMediaRenderer());
+    bool has_media = media_renderer->Init(fd);
+
+    // NativeGLResource picks its import path when created.
+    setenv("HWC_GL_PLANAR_YUV", "0", 1);
+    std::unique_ptr<NativeGpuResource> external_resources(
+        hwcomposer::CreateNativeGpuResourceHandler());
+    setenv("HWC_GL_PLANAR_YUV", "1", 1);
+    std::unique_ptr<NativeGpuResource> planar_resources(
+        hwcomposer::CreateNativeGpuResourceHandler());
+
+    std::unique_ptr<NativeSurface> target(
+        hwcomposer::Create3DBuffer(kWidth, kHeight));
+    if (!target->Init(&resource_manager, DRM_FORMAT_XRGB8888,
+                      hwcomposer::kLayerNormal)) {
+      fprintf(stderr, "Failed to allocate the plane.\n");
+      return 1;
+    }
+
+    std::unique_ptr<NativeSurface> converted(
+        hwcomposer::CreateVideoBuffer(kWidth, kHeight));
+    converted->InitializeForOffScreenRendering(handles.at(1),
+                                               &resource_manager);
+
+    std::vector<std::unique_ptr<hwcomposer::HwcLayer>> storage;
+    std::vector<OverlayLayer> video_layers;
+    std::vector<OverlayLayer> converted_layers;
+    video_layers.reserve(ui_layers + 1);
+    converted_layers.reserve(ui_layers + 1);
+    CreateLayers(handles.at(0), ui, &resource_manager, storage, video_layers);
+    CreateLayers(handles.at(1), ui, &resource_manager, storage,
+                 converted_layers);
+
+    std::vector<CompositionRegion> regions;
+    CreateRegions(ui_layers, regions);
+
+    hwcomposer::MediaState media_state = hwcomposer::MediaState();
+    media_state.layer_ = &video_layers.at(0);
+
+    LayerStateTable table;
+    DrawState draw_state;
+    Result two_stage;
+    Result external;
+    Result planar;
+    for (uint32_t frame = 0; frame < frames; frame++) {
+      if (has_media) {
+        int64_t start = NowNs();
+        if (media_renderer->Draw(media_state, converted.get()) &&
+            Compose(converted_layers, regions, external_resources.get(),
+                    renderer.get(), table, draw_state, target.get())) {
+          two_stage.frame_time.emplace_back(NowNs() - start);
+        } else {
+          two_stage.failed++;
+        }
+      }
+
+      int64_t start = NowNs();
+      if (Compose(video_layers, regions, external_resources.get(),
+                  renderer.get(), table, draw_state, target.get())) {
+        external.frame_time.emplace_back(NowNs() - start);
+      } else {
+        external.failed++;
+      }
+
+      start = NowNs();
+      if (Compose(video_layers, regions, planar_resources.get(),
+                  renderer.get(), table, draw_state, target.get())) {
+        planar.frame_time.emplace_back(NowNs() - start);
+      } else {
+        planar.failed++;
+      }
+    }
+
+    if (has_media)
+      Print("va+gl", two_stage);
+    else
+      printf("va+gl    n/a (no media renderer)\n");
+
+    Print("external", external);
+    Print("planar", planar);
+  }
+
+  for (HWCNativeHandle handle : handles) {
+    buffer_handler->ReleaseBuffer(handle);
+    buffer_handler->DestroyHandle(handle);
+  }
+
+  buffer_handler.reset();
+  close(fd);
+  return 0;
+}
@@ -0,0 +1,362 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "frametimingrecorder.h"
+
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+
+#include <hwcutils.h>
+#include <json.h>
+#include <libsync.h>
+#include <nativedisplay.h>
+
+namespace {
+
+double ToMilliseconds(double nanoseconds) {
+  return nanoseconds / 1000000.0;
+}
+
+json_object* DistributionToJSON(double p50, double p95, double p99,
+                                double max, double mean) {
+  json_object* object = json_object_new_object();
+  json_object_object_add(object, "p50", json_object_new_double(p50));
+  json_object_object_add(object, "p95", json_object_new_double(p95));
+  json_object_object_add(object, "p99", json_object_new_double(p99));
+  json_object_object_add(object, "max", json_object_new_double(max));
+  json_object_object_add(object, "mean", json_object_new_double(mean));
+  return object;
+}
+
+}  // namespace
+
+FrameTimingRecorder::FrameTimingRecorder(hwcomposer::NativeDisplay* display)
+    : display_(display) {
+  uint32_t config = 0;
+  int32_t period = 0;
+  if (display_->GetActiveConfig(&config) &&
+      display_->GetDisplayAttribute(
+          config, hwcomposer::HWCDisplayAttribute::kRefreshRate, &period))
+    refresh_period_ = period;
+
+  // Only look at frames presented from now on.
+  std::vector<hwcomposer::HwcFrameStatistics> statistics;
+  display_statistics_ = display_->GetFrameStatistics(0, &statistics);
+  if (!statistics.empty())
+    last_display_frame_ = statistics.back().frame_number;
+}
+
+FrameTimingRecorder::~FrameTimingRecorder() {
+  for (PendingFence& pending : pending_fences_) {
+    close(pending.fd);
+  }
+}
+
+int64_t FrameTimingRecorder::Now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+void FrameTimingRecorder::FramePresented(int64_t present_start,
+                                         int64_t present_end,
+                                         int32_t retire_fence) {
+  FrameTiming timing;
+  timing.frame = frames_.size();
+  timing.present_start = present_start;
+  timing.present_end = present_end;
+  frames_.emplace_back(timing);
+
+  int32_t fd = retire_fence >= 0 ? dup(retire_fence) : -1;
+  if (fd < 0) {
+    // Nothing to wait for, treat the frame as retired right away.
+    FrameRetired(frames_.size() - 1, present_end);
+    return;
+  }
+
+  PendingFence pending;
+  pending.index = frames_.size() - 1;
+  pending.fd = fd;
+  pending_fences_.emplace_back(pending);
+}
+
+void FrameTimingRecorder::Update(bool wait) {
+  // Retire fences signal in order, stop at the first pending one.
+  while (!pending_fences_.empty()) {
+    PendingFence& pending = pending_fences_.front();
+    if (sync_wait(pending.fd, wait ? 1000 : 0) < 0) {
+      if (!wait)
+        break;
+
+      unsignalled_frames_++;
+    } else {
+      int64_t retire_time = 0;
+      if (!hwcomposer::GetFenceSignalTime(pending.fd, &retire_time))
+        retire_time = Now();
+
+      FrameRetired(pending.index, retire_time);
+    }
+
+    close(pending.fd);
+    pending_fences_.pop_front();
+  }
+
+  UpdateDisplayStatistics();
+}
+
+void FrameTimingRecorder::SkipNextInterval() {
+  last_retire_time_ = 0;
+}
+
+void FrameTimingRecorder::FrameRetired(size_t index, int64_t retire_time) {
+  FrameTiming& timing = frames_.at(index);
+  timing.retire_time = retire_time;
+  if (last_retire_time_ > 0 && retire_time > last_retire_time_) {
+    timing.flip_interval = retire_time - last_retire_time_;
+    if (refresh_period_ > 0 &&
+        timing.flip_interval > refresh_period_ + refresh_period_ / 2) {
+      timing.missed_frames =
+          (timing.flip_interval + refresh_period_ / 2) / refresh_period_ - 1;
+      missed_frames_ += timing.missed_frames;
+    }
+  }
+
+  last_retire_time_ = retire_time;
+}
+
+void FrameTimingRecorder::UpdateDisplayStatistics() {
+  if (!display_statistics_)
+    return;
+
+  std::vector<hwcomposer::HwcFrameStatistics> statistics;
+  if (!display_->GetFrameStatistics(last_display_frame_, &statistics))
+    return;
+
+  // Display frames are matched to our frames by the time Present was
+  // called, frames which were dropped before reaching the display won't
+  // have any statistics.
+  for (const hwcomposer::HwcFrameStatistics& stats : statistics) {
+    last_display_frame_ = stats.frame_number;
+    while (next_statistics_match_ < frames_.size()) {
+      FrameTiming& timing = frames_.at(next_statistics_match_);
+      if (stats.present_time < timing.present_start)
+        break;
+
+      next_statistics_match_++;
+      if (stats.present_time <= timing.present_end) {
+        timing.composition_flags = stats.composition_flags;
+        timing.total_planes = stats.total_planes;
+        timing.release_fences = stats.release_fences;
+        timing.release_fence_fds = stats.release_fence_fds;
+        timing.has_statistics = true;
+        break;
+      }
+    }
+  }
+}
+
+FrameTimingRecorder::Distribution FrameTimingRecorder::GetDistribution(
+    std::vector<int64_t> samples) {
+  Distribution distribution;
+  if (samples.empty())
+    return distribution;
+
+  std::sort(samples.begin(), samples.end());
+  double total = 0;
+  for (int64_t sample : samples) {
+    total += sample;
+  }
+
+  // Nearest rank percentiles.
+  size_t size = samples.size();
+  distribution.p50 = ToMilliseconds(samples.at((size - 1) * 50 / 100));
+  distribution.p95 = ToMilliseconds(samples.at((size - 1) * 95 / 100));
+  distribution.p99 = ToMilliseconds(samples.at((size - 1) * 99 / 100));
+  distribution.max = ToMilliseconds(samples.back());
+  distribution.mean = ToMilliseconds(total / size);
+  distribution.samples = size;
+  return distribution;
+}
+
+void FrameTimingRecorder::GetDistributions(Distribution* present,
+                                           Distribution* retire,
+                                           Distribution* flip) const {
+  std::vector<int64_t> present_samples;
+  std::vector<int64_t> retire_samples;
+  std::vector<int64_t> flip_samples;
+  present_samples.reserve(frames_.size());
+  retire_samples.reserve(frames_.size());
+  flip_samples.reserve(frames_.size());
+  for (const FrameTiming& timing : frames_) {
+    present_samples.emplace_back(timing.present_end - timing.present_start);
+    if (timing.retire_time > 0)
+      retire_samples.emplace_back(timing.retire_time - timing.present_start);
+
+    if (timing.flip_interval > 0)
+      flip_samples.emplace_back(timing.flip_interval);
+  }
+
+  *present = GetDistribution(present_samples);
+  *retire = GetDistribution(retire_samples);
+  *flip = GetDistribution(flip_samples);
+}
+
+std::string FrameTimingRecorder::GetCompositionMode(
+    const FrameTiming& timing) {
+  if (!timing.has_statistics)
+    return "unknown";
+
+  if (timing.composition_flags & hwcomposer::kFrameCommitFailed)
+    return "failed";
+
+  if (timing.composition_flags & hwcomposer::kFrameIdleUpdate)
+    return "idle";
+
+  if (timing.composition_flags & hwcomposer::kFrameGpuComposition)
+    return timing.total_planes > 1 ? "mixed" : "gpu";
+
+  return "overlay";
+}
+
+void FrameTimingRecorder::PrintSummary(FILE* file) const {
+  Distribution present, retire, flip;
+  GetDistributions(&present, &retire, &flip);
+
+  std::map<std::string, uint32_t> modes;
+  uint64_t release_fences = 0;
+  uint64_t release_fence_fds = 0;
+  for (const FrameTiming& timing : frames_) {
+    modes[GetCompositionMode(timing)]++;
+    release_fences += timing.release_fences;
+    release_fence_fds += timing.release_fence_fds;
+  }
+
+  fprintf(file, "\nFrames: %zu Missed: %u Unsignalled: %u Refresh: %.3fms\n",
+          frames_.size(), missed_frames_, unsignalled_frames_,
+          ToMilliseconds(refresh_period_));
+  fprintf(file, "%-16s%10s%10s%10s%10s%10s\n", "(ms)", "p50", "p95", "p99",
+          "max", "mean");
+  fprintf(file, "%-16s%10.3f%10.3f%10.3f%10.3f%10.3f\n", "present",
+          present.p50, present.p95, present.p99, present.max, present.mean);
+  fprintf(file, "%-16s%10.3f%10.3f%10.3f%10.3f%10.3f\n", "retire", retire.p50,
+          retire.p95, retire.p99, retire.max, retire.mean);
+  fprintf(file, "%-16s%10.3f%10.3f%10.3f%10.3f%10.3f\n", "flip interval",
+          flip.p50, flip.p95, flip.p99, flip.max, flip.mean);
+  if (flip.mean > 0)
+    fprintf(file, "Average FPS: %.2f\n", 1000.0 / flip.mean);
+
+  fprintf(file, "Composition:");
+  for (const auto& mode : modes) {
+    fprintf(file, " %s=%u", mode.first.c_str(), mode.second);
+  }
+
+  fprintf(file, "\n");
+  if (!frames_.empty()) {
+    // Per layer fds is what release fences took before they were shared.
+    fprintf(file, "Release fence fds per frame: %.2f (per layer: %.2f)\n",
+            static_cast<double>(release_fence_fds) / frames_.size(),
+            static_cast<double>(release_fences) / frames_.size());
+  }
+}
+
+bool FrameTimingRecorder::WriteJSON(const char* path,
+                                    const std::string& scenario) const {
+  Distribution present, retire, flip;
+  GetDistributions(&present, &retire, &flip);
+
+  std::map<std::string, uint32_t> modes;
+  for (const FrameTiming& timing : frames_) {
+    modes[GetCompositionMode(timing)]++;
+  }
+
+  json_object* results = json_object_new_object();
+  json_object_object_add(results, "scenario",
+                         json_object_new_string(scenario.c_str()));
+  json_object_object_add(results, "frames",
+                         json_object_new_int64(frames_.size()));
+  json_object_object_add(results, "missed_frames",
+                         json_object_new_int64(missed_frames_));
+  json_object_object_add(results, "unsignalled_frames",
+                         json_object_new_int64(unsignalled_frames_));
+  json_object_object_add(
+      results, "refresh_period_ms",
+      json_object_new_double(ToMilliseconds(refresh_period_)));
+  json_object_object_add(
+      results, "fps",
+      json_object_new_double(flip.mean > 0 ? 1000.0 / flip.mean : 0));
+  json_object_object_add(results, "present_latency_ms",
+                         DistributionToJSON(present.p50, present.p95,
+                                            present.p99, present.max,
+                                            present.mean));
+  json_object_object_add(results, "retire_latency_ms",
+                         DistributionToJSON(retire.p50, retire.p95,
+                                            retire.p99, retire.max,
+                                            retire.mean));
+  json_object_object_add(
+      results, "flip_interval_ms",
+      DistributionToJSON(flip.p50, flip.p95, flip.p99, flip.max, flip.mean));
+
+  json_object* composition = json_object_new_object();
+  for (const auto& mode : modes) {
+    json_object_object_add(composition, mode.first.c_str(),
+                           json_object_new_int64(mode.second));
+  }
+
+  json_object_object_add(results, "composition", composition);
+
+  int ret = json_object_to_file_ext(const_cast<char*>(path), results,
+                                    JSON_C_TO_STRING_PRETTY);
+  json_object_put(results);
+  if (ret < 0) {
+    fprintf(stderr, "failed to write results to %s\n", path);
+    return false;
+  }
+
+  return true;
+}
+
+bool FrameTimingRecorder::WriteCSV(const char* path) const {
+  FILE* file = fopen(path, "w");
+  if (!file) {
+    fprintf(stderr, "failed to open %s: %m\n", path);
+    return false;
+  }
+
+  fprintf(file,
+          "frame,present_start_ns,present_latency_ns,retire_latency_ns,"
+          "flip_interval_ns,missed_frames,composition,composition_flags,"
+          "planes,release_fences,release_fence_fds\n");
+  for (const FrameTiming& timing : frames_) {
+    int64_t retire_latency =
+        timing.retire_time > 0 ? timing.retire_time - timing.present_start
+                               : -1;
+    fprintf(file, "%llu,%lld,%lld,%lld,%lld,%u,%s,%u,%u,%u,%u\n",
+            static_cast<unsigned long long>(timing.frame),
+            static_cast<long long>(timing.present_start),
+            static_cast<long long>(timing.present_end - timing.present_start),
+            static_cast<long long>(retire_latency),
+            static_cast<long long>(timing.flip_interval),
+            timing.missed_frames, GetCompositionMode(timing).c_str(),
+            timing.composition_flags, timing.total_planes,
+            timing.release_fences, timing.release_fence_fds);
+  }
+
+  fclose(file);
+  return true;
+}
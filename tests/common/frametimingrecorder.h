@@ -0,0 +1,109 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef FRAME_TIMING_RECORDER_H_
+#define FRAME_TIMING_RECORDER_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <hwcdefs.h>
+
+namespace hwcomposer {
+class NativeDisplay;
+}
+
+// Collects per frame timings of a test run: time spent in Present, time
+// until the retire fence signalled and time between flips. Composition
+// details are taken from the display's frame statistics when available.
+// All times are CLOCK_MONOTONIC in nanoseconds.
+class FrameTimingRecorder {
+ public:
+  explicit FrameTimingRecorder(hwcomposer::NativeDisplay* display);
+  ~FrameTimingRecorder();
+
+  static int64_t Now();
+
+  // Call after every Present. retire_fence is duplicated, the caller keeps
+  // ownership of the passed fd.
+  void FramePresented(int64_t present_start, int64_t present_end,
+                      int32_t retire_fence);
+
+  // Collects retire fences which signalled so far and new display
+  // statistics. If wait is true, blocks until all pending fences signal.
+  void Update(bool wait);
+
+  // Don't count the gap before the next retired frame as missed frames,
+  // used when the test intentionally stops presenting (e.g. power modes).
+  void SkipNextInterval();
+
+  void PrintSummary(FILE* file) const;
+  bool WriteJSON(const char* path, const std::string& scenario) const;
+  bool WriteCSV(const char* path) const;
+
+ private:
+  struct FrameTiming {
+    uint64_t frame = 0;
+    int64_t present_start = 0;
+    int64_t present_end = 0;
+    int64_t retire_time = 0;     // 0 if the retire fence never signalled.
+    int64_t flip_interval = 0;   // Time since the previous frame retired.
+    uint32_t missed_frames = 0;  // Refresh periods skipped before retire.
+    uint32_t composition_flags = 0;
+    uint32_t total_planes = 0;
+    uint32_t release_fences = 0;
+    uint32_t release_fence_fds = 0;
+    bool has_statistics = false;
+  };
+
+  struct PendingFence {
+    size_t index;
+    int32_t fd;
+  };
+
+  struct Distribution {
+    double p50 = 0;
+    double p95 = 0;
+    double p99 = 0;
+    double max = 0;
+    double mean = 0;
+    size_t samples = 0;
+  };
+
+  void FrameRetired(size_t index, int64_t retire_time);
+  void UpdateDisplayStatistics();
+  static Distribution GetDistribution(std::vector<int64_t> samples);
+  void GetDistributions(Distribution* present, Distribution* retire,
+                        Distribution* flip) const;
+  static std::string GetCompositionMode(const FrameTiming& timing);
+
+  hwcomposer::NativeDisplay* display_;
+  std::vector<FrameTiming> frames_;
+  std::deque<PendingFence> pending_fences_;
+  int64_t refresh_period_ = 0;
+  int64_t last_retire_time_ = 0;
+  uint64_t last_display_frame_ = 0;
+  size_t next_statistics_match_ = 0;
+  uint32_t missed_frames_ = 0;
+  uint32_t unsignalled_frames_ = 0;
+  bool display_statistics_ = false;
+};
+
+#endif
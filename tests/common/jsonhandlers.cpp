@@ -32,6 +32,18 @@ bool parseParametersJson(const char* json_path, TEST_PARAMETERS* parameters) {
       parameters->contrast_b = json_object_get_int(value);
     } else if (!strcmp(key, "broadcast_rgb")) {
       parameters->broadcast_rgb = std::string(json_object_get_string(value));
+    } else if (!strcmp(key, "soak")) {
+      json_object_object_foreach(value, soak_key, soak_value) {
+        if (!strcmp(soak_key, "layer_toggle_interval")) {
+          parameters->soak_layer_toggle_interval =
+              json_object_get_int(soak_value);
+        } else if (!strcmp(soak_key, "video_toggle_interval")) {
+          parameters->soak_video_toggle_interval =
+              json_object_get_int(soak_value);
+        } else if (!strcmp(soak_key, "cursor_step")) {
+          parameters->soak_cursor_step = json_object_get_int(soak_value);
+        }
+      }
     } else if (!strcmp(key, "layers_parameters")) {
       struct array_list* array = json_object_get_array(value);
       int len = json_object_array_length(value);
@@ -48,6 +60,8 @@ bool parseParametersJson(const char* json_path, TEST_PARAMETERS* parameters) {
           } else if (strcmp(layer_key, "transform") == 0) {
             layer_parameter.transform =
                 (LAYER_TRANSFORM)json_object_get_int(layer_value);
+          } else if (strcmp(layer_key, "cursor") == 0) {
+            layer_parameter.cursor = json_object_get_boolean(layer_value);
           } else if (strcmp(layer_key, "resource_path") == 0) {
             layer_parameter.resource_path =
                 std::string(json_object_get_string(layer_value));
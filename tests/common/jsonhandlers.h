@@ -218,6 +218,7 @@ typedef struct {
   uint32_t frame_y;
   uint32_t frame_width;
   uint32_t frame_height;
+  bool cursor = false;
 } LAYER_PARAMETER;
 
 typedef std::vector<LAYER_PARAMETER> LAYER_PARAMETERS;
@@ -234,6 +235,10 @@ typedef struct {
   uint32_t contrast_b = 0x80;
   std::string broadcast_rgb = "Automatic";
   std::string power_mode = "none";
+  // Soak scenarios, intervals are in frames and 0 disables them.
+  uint32_t soak_layer_toggle_interval = 0;
+  uint32_t soak_video_toggle_interval = 0;
+  uint32_t soak_cursor_step = 0;
   LAYER_PARAMETERS layers_parameters;
 } TEST_PARAMETERS;
 
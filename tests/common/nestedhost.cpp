@@ -0,0 +1,322 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "nestedhost.h"
+
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+const int kFenceTimeoutMs = 1000;
+
+// Keeps reads of layers from being optimized away.
+volatile uint64_t checksum_sink;
+
+void CloseFds(const std::vector<int>& fds) {
+  for (int fd : fds) {
+    if (fd >= 0)
+      close(fd);
+  }
+}
+
+}  // namespace
+
+NestedHost::NestedHost(uint32_t width, uint32_t height, uint32_t refresh_rate)
+    : width_(width), height_(height), refresh_rate_(refresh_rate) {
+}
+
+NestedHost::~NestedHost() {
+  Stop();
+}
+
+bool NestedHost::Start(const char* path, bool read_buffers) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    fprintf(stderr, "Socket path %s is too long.\n", path);
+    return false;
+  }
+
+  strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+  listen_fd_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (listen_fd_ < 0) {
+    perror("socket");
+    return false;
+  }
+
+  unlink(path);
+  if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&address),
+           sizeof(address)) < 0 ||
+      listen(listen_fd_, 1) < 0 || pipe(stop_fd_) < 0) {
+    perror("Failed to listen");
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return false;
+  }
+
+  path_ = path;
+  read_buffers_ = read_buffers;
+  thread_ = std::thread(&NestedHost::Run, this);
+  return true;
+}
+
+void NestedHost::Stop() {
+  if (listen_fd_ < 0)
+    return;
+
+  char stop = 0;
+  if (write(stop_fd_[1], &stop, 1) < 0)
+    perror("write");
+
+  thread_.join();
+  close(stop_fd_[0]);
+  close(stop_fd_[1]);
+  close(listen_fd_);
+  unlink(path_.c_str());
+  listen_fd_ = -1;
+}
+
+NestedHost::Statistics NestedHost::GetStatistics() const {
+  Statistics stats;
+  stats.frames = frames_;
+  stats.layers = layers_;
+  stats.buffers_added = buffers_added_;
+  stats.buffers_removed = buffers_removed_;
+  stats.bytes_received = bytes_received_;
+  stats.bytes_read = bytes_read_;
+  stats.errors = errors_;
+  return stats;
+}
+
+void NestedHost::Run() {
+  while (true) {
+    struct pollfd fds[2];
+    fds[0].fd = listen_fd_;
+    fds[0].events = POLLIN;
+    fds[1].fd = stop_fd_[0];
+    fds[1].events = POLLIN;
+    if (poll(fds, 2, -1) < 0)
+      continue;
+
+    if (fds[1].revents)
+      return;
+
+    int client = accept4(listen_fd_, NULL, NULL, SOCK_CLOEXEC);
+    if (client < 0)
+      continue;
+
+    Serve(client);
+    DropBuffers();
+    close(client);
+  }
+}
+
+void NestedHost::Serve(int client) {
+  while (true) {
+    struct pollfd fds[2];
+    fds[0].fd = client;
+    fds[0].events = POLLIN;
+    fds[1].fd = stop_fd_[0];
+    fds[1].events = POLLIN;
+    if (poll(fds, 2, -1) < 0)
+      continue;
+
+    if (fds[1].revents)
+      return;
+
+    hwcomposer::NestedMessageHeader header;
+    std::vector<uint8_t> payload;
+    std::vector<int> received_fds;
+    if (!hwcomposer::ReceiveNestedMessage(client, 0, &header, &payload,
+                                          &received_fds)) {
+      // Guest hung up.
+      CloseFds(received_fds);
+      return;
+    }
+
+    bytes_received_ += sizeof(header) + payload.size();
+    switch (header.type) {
+      case hwcomposer::kNestedHello: {
+        hwcomposer::NestedConfig config;
+        config.version = NESTED_PROTOCOL_VERSION;
+        config.width = width_;
+        config.height = height_;
+        config.refresh_rate = refresh_rate_;
+        hwcomposer::SendNestedMessage(client, hwcomposer::kNestedConfig,
+                                      &config, sizeof(config), NULL, 0);
+        break;
+      }
+      case hwcomposer::kNestedAddBuffer: {
+        if (payload.size() < sizeof(hwcomposer::NestedBuffer) ||
+            received_fds.size() != 1) {
+          errors_++;
+          break;
+        }
+
+        Buffer buffer;
+        memcpy(&buffer.info, payload.data(), sizeof(buffer.info));
+        buffer.fd = received_fds[0];
+        received_fds.clear();
+        if (read_buffers_) {
+          size_t size = static_cast<size_t>(buffer.info.offsets[0]) +
+                        static_cast<size_t>(buffer.info.pitches[0]) *
+                            buffer.info.height;
+          void* map = mmap(NULL, size, PROT_READ, MAP_SHARED, buffer.fd, 0);
+          if (map != MAP_FAILED) {
+            buffer.map = static_cast<const uint8_t*>(map);
+            buffer.map_size = size;
+          }
+        }
+
+        RemoveBuffer(buffer.info.id);
+        buffers_[buffer.info.id] = buffer;
+        buffers_added_++;
+        break;
+      }
+      case hwcomposer::kNestedRemoveBuffer: {
+        if (payload.size() < sizeof(hwcomposer::NestedBufferId)) {
+          errors_++;
+          break;
+        }
+
+        hwcomposer::NestedBufferId id;
+        memcpy(&id, payload.data(), sizeof(id));
+        RemoveBuffer(id.id);
+        buffers_removed_++;
+        break;
+      }
+      case hwcomposer::kNestedFrame:
+        if (!HandleFrame(client, payload, received_fds))
+          errors_++;
+        break;
+      default:
+        errors_++;
+        break;
+    }
+
+    CloseFds(received_fds);
+  }
+}
+
+bool NestedHost::HandleFrame(int client, const std::vector<uint8_t>& payload,
+                             std::vector<int>& fds) {
+  hwcomposer::NestedFrame frame;
+  if (payload.size() < sizeof(frame))
+    return false;
+
+  memcpy(&frame, payload.data(), sizeof(frame));
+  bool valid = frame.total_layers <= NESTED_MAX_LAYERS &&
+               payload.size() >= sizeof(frame) + frame.total_layers *
+                                     sizeof(hwcomposer::NestedLayer);
+  size_t fence_index = 0;
+  for (uint32_t i = 0; valid && i < frame.total_layers; i++) {
+    hwcomposer::NestedLayer layer;
+    memcpy(&layer,
+           payload.data() + sizeof(frame) + i * sizeof(hwcomposer::NestedLayer),
+           sizeof(layer));
+    auto it = buffers_.find(layer.buffer_id);
+    if (it == buffers_.end()) {
+      valid = false;
+      break;
+    }
+
+    // Wait for the guest to be done rendering before reading.
+    if (layer.has_acquire_fence && fence_index < fds.size()) {
+      struct pollfd fence;
+      fence.fd = fds[fence_index++];
+      fence.events = POLLIN;
+      poll(&fence, 1, kFenceTimeoutMs);
+    }
+
+    bytes_read_ += ReadLayer(it->second, layer);
+    layers_++;
+  }
+
+  frames_++;
+  hwcomposer::NestedFrameDone done;
+  memset(&done, 0, sizeof(done));
+  done.frame = frame.frame;
+  hwcomposer::SendNestedMessage(client, hwcomposer::kNestedFrameDone, &done,
+                                sizeof(done), NULL, 0);
+  return valid;
+}
+
+uint64_t NestedHost::ReadLayer(const Buffer& buffer,
+                               const hwcomposer::NestedLayer& layer) {
+  if (!buffer.map)
+    return 0;
+
+  // Map the damaged part of the display frame back to the source crop.
+  const int32_t* frame = layer.display_frame;
+  const int32_t* damage = layer.damage;
+  int32_t frame_width = frame[2] - frame[0];
+  int32_t frame_height = frame[3] - frame[1];
+  if (damage[2] <= damage[0] || damage[3] <= damage[1] || frame_width <= 0 ||
+      frame_height <= 0)
+    return 0;
+
+  const float* crop = layer.source_crop;
+  float scale_y = (crop[3] - crop[1]) / frame_height;
+  int32_t top = crop[1] + (std::max(damage[1], frame[1]) - frame[1]) * scale_y;
+  int32_t bottom =
+      crop[1] + (std::min(damage[3], frame[3]) - frame[1]) * scale_y;
+  top = std::max<int32_t>(top, 0);
+  bottom = std::min<int32_t>(bottom, buffer.info.height);
+
+  // Whole rows are read, it's what the memory traffic is made of.
+  uint32_t pitch = buffer.info.pitches[0];
+  const uint8_t* data = buffer.map + buffer.info.offsets[0];
+  uint64_t checksum = 0;
+  uint64_t bytes = 0;
+  for (int32_t y = top; y < bottom; y++) {
+    const uint64_t* row =
+        reinterpret_cast<const uint64_t*>(data + static_cast<size_t>(y) * pitch);
+    for (uint32_t x = 0; x < pitch / sizeof(uint64_t); x++)
+      checksum += row[x];
+
+    bytes += pitch;
+  }
+
+  checksum_sink = checksum;
+  return bytes;
+}
+
+void NestedHost::RemoveBuffer(uint32_t id) {
+  auto it = buffers_.find(id);
+  if (it == buffers_.end())
+    return;
+
+  if (it->second.map)
+    munmap(const_cast<uint8_t*>(it->second.map), it->second.map_size);
+
+  close(it->second.fd);
+  buffers_.erase(it);
+}
+
+void NestedHost::DropBuffers() {
+  while (!buffers_.empty())
+    RemoveBuffer(buffers_.begin()->first);
+}
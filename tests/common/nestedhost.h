@@ -0,0 +1,95 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef NESTED_HOST_H_
+#define NESTED_HOST_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+
+#include "nestedprotocol.h"
+
+// Reference host for NestedDisplay, see nestedprotocol.h. Serves one
+// guest at a time on a UNIX socket from a thread of its own. Frames are
+// checked against the buffers the guest sent, acquire fences are waited
+// for and, if enabled, the damaged part of every layer is read through
+// a mapping of its dma-buf, as a compositor sampling it would. Frames
+// are completed before kNestedFrameDone is sent, so no fences are
+// returned.
+class NestedHost {
+ public:
+  struct Statistics {
+    uint64_t frames = 0;
+    uint64_t layers = 0;
+    uint64_t buffers_added = 0;
+    uint64_t buffers_removed = 0;
+    uint64_t bytes_received = 0;
+    uint64_t bytes_read = 0;  // From dma-bufs, if reading is enabled.
+    uint64_t errors = 0;      // Bad messages or unknown buffers.
+  };
+
+  NestedHost(uint32_t width, uint32_t height, uint32_t refresh_rate);
+  ~NestedHost();
+
+  // Starts listening on path, replacing any socket file there.
+  bool Start(const char* path, bool read_buffers);
+  void Stop();
+
+  Statistics GetStatistics() const;
+
+ private:
+  struct Buffer {
+    hwcomposer::NestedBuffer info;
+    int fd = -1;
+    // Mapping of the first plane, NULL if reading is disabled or the
+    // dma-buf can't be mapped.
+    const uint8_t* map = NULL;
+    size_t map_size = 0;
+  };
+
+  void Run();
+  void Serve(int client);
+  bool HandleFrame(int client, const std::vector<uint8_t>& payload,
+                   std::vector<int>& fds);
+  uint64_t ReadLayer(const Buffer& buffer,
+                     const hwcomposer::NestedLayer& layer);
+  void RemoveBuffer(uint32_t id);
+  void DropBuffers();
+
+  uint32_t width_;
+  uint32_t height_;
+  uint32_t refresh_rate_;
+  bool read_buffers_ = false;
+  int listen_fd_ = -1;
+  int stop_fd_[2] = {-1, -1};
+  std::string path_;
+  std::thread thread_;
+  std::map<uint32_t, Buffer> buffers_;
+
+  std::atomic<uint64_t> frames_{0};
+  std::atomic<uint64_t> layers_{0};
+  std::atomic<uint64_t> buffers_added_{0};
+  std::atomic<uint64_t> buffers_removed_{0};
+  std::atomic<uint64_t> bytes_received_{0};
+  std::atomic<uint64_t> bytes_read_{0};
+  std::atomic<uint64_t> errors_{0};
+};
+
+#endif  // NESTED_HOST_H_
@@ -0,0 +1,51 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef UNIT_TEST_H_
+#define UNIT_TEST_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Checks for unit tests which run without any hardware under make check.
+// A failing CHECK is reported and counted, the test carries on.
+
+inline uint32_t& CheckFailures() {
+  static uint32_t failures = 0;
+  return failures;
+}
+
+// Reports the outcome of all checks, returns the exit code of the test.
+inline int ReportChecks() {
+  if (CheckFailures()) {
+    fprintf(stderr, "%u checks failed.\n", CheckFailures());
+    return 1;
+  }
+
+  printf("All checks passed.\n");
+  return 0;
+}
+
+#define CHECK(condition)                                        \
+  do {                                                          \
+    if (!(condition)) {                                         \
+      fprintf(stderr, "%s:%d: %s failed\n", __FILE__, __LINE__, \
+              #condition);                                      \
+      CheckFailures()++;                                        \
+    }                                                           \
+  } while (0)
+
+#endif  // UNIT_TEST_H_
@@ -25,8 +25,10 @@
 #include <unistd.h>
 #include <getopt.h>
 
+#include "colorkernels.h"
+
 #define INPUT_FORMAT_NUM 20
-#define OUTPUT_FORMAT_NUM 20
+#define OUTPUT_FORMAT_NUM 24
 
 FILE *input_fd = NULL;
 FILE *output_fd = NULL;
@@ -54,7 +56,13 @@ struct output_input_formats output_input_mapping[OUTPUT_FORMAT_NUM] = {
     {"raw16", {"*"}},
     {"rawopaque", {"*"}},
     {"rawblob", {"*"}},
-    {"y16", {"yuv420p16le"}}};
+    {"y16", {"yuv420p16le"}},
+    {"argb8888", {"rgba"}},
+    {"abgr8888", {"bgra"}},
+    {"argb8888_premult", {"bgra"}},
+    {"xrgb8888", {"rgb565le", "nv12"}},
+    {"rgb565", {"bgra", "bgr0"}},
+    {"nv12", {"bgra", "bgr0"}}};
 
 char input_raw[1024];
 char output_raw[1024];
@@ -451,6 +459,129 @@ bool generate_y16_output_buf() {
   return true;
 }
 
+// Reads size bytes of the input file into a new buffer.
+static char *read_input_buf(unsigned long size) {
+  char *input_buf = (char *)malloc(size);
+  fseek(input_fd, 0, SEEK_SET);
+  if (fread(input_buf, 1, size, input_fd) != size) {
+    printf("Failed to read resource file\n");
+    free(input_buf);
+    return NULL;
+  }
+
+  return input_buf;
+}
+
+// Swaps R and B, rgba input gives argb8888 and bgra input abgr8888.
+bool generate_swizzled_output_buf() {
+  output_buf_size = width * 4 * height;
+  char *input_buf = read_input_buf(output_buf_size);
+  if (!input_buf)
+    return false;
+
+  output_buf = (char *)malloc(output_buf_size);
+  const struct color_kernels *kernels = get_color_kernels();
+  for (unsigned int row = 0; row < height; row++) {
+    kernels->swizzle_rgba((const uint8_t *)input_buf + row * width * 4,
+                          (uint8_t *)output_buf + row * width * 4, width);
+  }
+
+  free(input_buf);
+  return true;
+}
+
+bool generate_premult_output_buf() {
+  output_buf_size = width * 4 * height;
+  char *input_buf = read_input_buf(output_buf_size);
+  if (!input_buf)
+    return false;
+
+  output_buf = (char *)malloc(output_buf_size);
+  const struct color_kernels *kernels = get_color_kernels();
+  for (unsigned int row = 0; row < height; row++) {
+    kernels->premultiply_argb8888((const uint32_t *)input_buf + row * width,
+                                  (uint32_t *)output_buf + row * width, width);
+  }
+
+  free(input_buf);
+  return true;
+}
+
+bool generate_xrgb8888_output_buf() {
+  bool from_nv12 = !strcmp(input_format, "nv12");
+  unsigned int uv_pitch = (width + 1) & ~1;
+  unsigned long input_size = from_nv12
+                                 ? width * height + uv_pitch * ((height + 1) / 2)
+                                 : width * 2 * height;
+  char *input_buf = read_input_buf(input_size);
+  if (!input_buf)
+    return false;
+
+  output_buf_size = width * 4 * height;
+  output_buf = (char *)malloc(output_buf_size);
+  const struct color_kernels *kernels = get_color_kernels();
+  for (unsigned int row = 0; row < height; row++) {
+    uint32_t *dst = (uint32_t *)output_buf + row * width;
+    if (from_nv12) {
+      const uint8_t *y = (const uint8_t *)input_buf + row * width;
+      const uint8_t *uv = (const uint8_t *)input_buf + width * height +
+                          (row / 2) * uv_pitch;
+      kernels->nv12_to_xrgb8888(y, uv, dst, width);
+    } else {
+      kernels->rgb565_to_xrgb8888((const uint16_t *)input_buf + row * width,
+                                  dst, width);
+    }
+  }
+
+  free(input_buf);
+  return true;
+}
+
+bool generate_rgb565_output_buf() {
+  char *input_buf = read_input_buf(width * 4 * height);
+  if (!input_buf)
+    return false;
+
+  output_buf_size = width * 2 * height;
+  output_buf = (char *)malloc(output_buf_size);
+  const struct color_kernels *kernels = get_color_kernels();
+  for (unsigned int row = 0; row < height; row++) {
+    kernels->xrgb8888_to_rgb565((const uint32_t *)input_buf + row * width,
+                                (uint16_t *)output_buf + row * width, width);
+  }
+
+  free(input_buf);
+  return true;
+}
+
+bool generate_nv12_output_buf() {
+  char *input_buf = read_input_buf(width * 4 * height);
+  if (!input_buf)
+    return false;
+
+  unsigned int uv_pitch = (width + 1) & ~1;
+  unsigned int uv_height = (height + 1) / 2;
+  printf("%-16s%-32d\n%-16s%-32d\n%-16s%-32d\n%-16s%-32d\n", "Pitch-y:",
+         width, "Height-y:", height, "Pitch-c:", uv_pitch, "Height-c:",
+         uv_height);
+  output_buf_size = width * height + uv_pitch * uv_height;
+  output_buf = (char *)malloc(output_buf_size);
+  const struct color_kernels *kernels = get_color_kernels();
+  const uint32_t *src = (const uint32_t *)input_buf;
+  uint8_t *y = (uint8_t *)output_buf;
+  uint8_t *uv = y + width * height;
+  for (unsigned int row = 0; row < height; row += 2) {
+    // The last row of an odd height is paired with itself.
+    unsigned int next = row + 1 < height ? row + 1 : row;
+    kernels->xrgb8888_to_nv12(src + row * width, src + next * width,
+                              y + row * width, y + next * width,
+                              uv + (row / 2) * uv_pitch, width);
+  }
+
+  free(input_buf);
+  return true;
+}
+
 int main(int argc, char *argv[]) {
   printf("\n\n");
   parse_args(argc, argv);
@@ -480,8 +611,8 @@ int main(int argc, char *argv[]) {
 
   printf(
       "Image Width: \t%d\nImage Height: \t%d\nInput Format:\t%s\nOutput "
-      "Format:\t%s\n",
-      width, height, input_format, output_format);
+      "Format:\t%s\nKernels:\t%s\n",
+      width, height, input_format, output_format, get_color_kernels()->name);
 
   if (valid_input_output_format == 1) {
     input_fd = fopen(input_raw, "r");
@@ -524,6 +655,17 @@ int main(int argc, char *argv[]) {
     ret = generate_rawblob_output_buf();
   } else if (!strcmp(output_format, "rawopaque")) {
     ret = generate_rawopaque_output_buf();
+  } else if (!strcmp(output_format, "argb8888") ||
+             !strcmp(output_format, "abgr8888")) {
+    ret = generate_swizzled_output_buf();
+  } else if (!strcmp(output_format, "argb8888_premult")) {
+    ret = generate_premult_output_buf();
+  } else if (!strcmp(output_format, "xrgb8888")) {
+    ret = generate_xrgb8888_output_buf();
+  } else if (!strcmp(output_format, "rgb565")) {
+    ret = generate_rgb565_output_buf();
+  } else if (!strcmp(output_format, "nv12")) {
+    ret = generate_nv12_output_buf();
   }
 
   if (!ret) {
@@ -0,0 +1,186 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+// Reports the throughput of each color conversion kernel, for every
+// kernel level the CPU supports and a few image sizes. Throughput counts
+// the bytes read plus the bytes written.
+//
+// Usage: colorkernelbench [milliseconds per measurement]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+
+#include "colorkernels.h"
+
+struct image_size {
+  const char *name;
+  size_t width;
+  size_t height;
+};
+
+static const struct image_size image_sizes[] = {
+    {"256x256", 256, 256},
+    {"1280x720", 1280, 720},
+    {"1920x1080", 1920, 1080},
+    {"3840x2160", 3840, 2160}};
+
+// Source and destination images of the largest size, reused by every
+// measurement.
+struct buffers {
+  std::vector<uint32_t> rgb;
+  std::vector<uint32_t> rgb_out;
+  std::vector<uint16_t> rgb565;
+  std::vector<uint8_t> nv12;
+  std::vector<uint8_t> nv12_out;
+};
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+enum kernel_id {
+  KERNEL_SWIZZLE,
+  KERNEL_RGB565_TO_XRGB,
+  KERNEL_XRGB_TO_RGB565,
+  KERNEL_NV12_TO_XRGB,
+  KERNEL_XRGB_TO_NV12,
+  KERNEL_PREMULTIPLY,
+  KERNEL_COUNT
+};
+
+static const char *kernel_names[KERNEL_COUNT] = {
+    "swizzle_rgba",     "rgb565_to_xrgb8888", "xrgb8888_to_rgb565",
+    "nv12_to_xrgb8888", "xrgb8888_to_nv12",   "premultiply_argb8888"};
+
+// Converts one image, returns the bytes read and written.
+static size_t run_kernel(const struct color_kernels *kernels, int id,
+                         const struct image_size &size, struct buffers &b) {
+  size_t w = size.width;
+  size_t h = size.height;
+  size_t uv_offset = w * h;
+  switch (id) {
+    case KERNEL_SWIZZLE:
+      for (size_t row = 0; row < h; row++)
+        kernels->swizzle_rgba((const uint8_t *)&b.rgb[row * w],
+                              (uint8_t *)&b.rgb_out[row * w], w);
+      return w * h * 8;
+    case KERNEL_RGB565_TO_XRGB:
+      for (size_t row = 0; row < h; row++)
+        kernels->rgb565_to_xrgb8888(&b.rgb565[row * w], &b.rgb_out[row * w],
+                                    w);
+      return w * h * 6;
+    case KERNEL_XRGB_TO_RGB565:
+      for (size_t row = 0; row < h; row++)
+        kernels->xrgb8888_to_rgb565(&b.rgb[row * w], &b.rgb565[row * w], w);
+      return w * h * 6;
+    case KERNEL_NV12_TO_XRGB:
+      for (size_t row = 0; row < h; row++)
+        kernels->nv12_to_xrgb8888(&b.nv12[row * w],
+                                  &b.nv12[uv_offset + (row / 2) * w],
+                                  &b.rgb_out[row * w], w);
+      return w * h * 4 + w * h * 3 / 2;
+    case KERNEL_XRGB_TO_NV12:
+      for (size_t row = 0; row < h; row += 2)
+        kernels->xrgb8888_to_nv12(&b.rgb[row * w], &b.rgb[(row + 1) * w],
+                                  &b.nv12_out[row * w],
+                                  &b.nv12_out[(row + 1) * w],
+                                  &b.nv12_out[uv_offset + (row / 2) * w], w);
+      return w * h * 4 + w * h * 3 / 2;
+    case KERNEL_PREMULTIPLY:
+      for (size_t row = 0; row < h; row++)
+        kernels->premultiply_argb8888(&b.rgb[row * w], &b.rgb_out[row * w],
+                                      w);
+      return w * h * 8;
+  }
+
+  return 0;
+}
+
+// Best throughput in GB/s over repeated conversions for budget seconds.
+static double measure(const struct color_kernels *kernels, int id,
+                      const struct image_size &size, struct buffers &b,
+                      double budget) {
+  // Warm up caches and page tables.
+  run_kernel(kernels, id, size, b);
+  double best = 0;
+  double start = now_seconds();
+  while (now_seconds() - start < budget) {
+    double begin = now_seconds();
+    size_t bytes = run_kernel(kernels, id, size, b);
+    double elapsed = now_seconds() - begin;
+    if (elapsed > 0 && bytes / elapsed > best)
+      best = bytes / elapsed;
+  }
+
+  return best / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+  double budget = (argc > 1 ? atoi(argv[1]) : 200) / 1000.0;
+  if (budget <= 0) {
+    fprintf(stderr, "usage: %s [milliseconds per measurement]\n", argv[0]);
+    return 1;
+  }
+
+  const struct image_size &largest =
+      image_sizes[sizeof(image_sizes) / sizeof(image_sizes[0]) - 1];
+  size_t pixels = largest.width * largest.height;
+  struct buffers b;
+  b.rgb.resize(pixels);
+  b.rgb_out.resize(pixels);
+  b.rgb565.resize(pixels);
+  b.nv12.resize(pixels * 3 / 2);
+  b.nv12_out.resize(pixels * 3 / 2);
+  srand(1);
+  for (uint32_t &p : b.rgb)
+    p = ((uint32_t)rand() << 16) ^ rand();
+  for (uint16_t &p : b.rgb565)
+    p = rand();
+  for (uint8_t &p : b.nv12)
+    p = rand();
+
+  printf("Selected kernels: %s\n\n", get_color_kernels()->name);
+  printf("%-22s%-12s", "GB/s", "size");
+  for (int level = 0; level < COLOR_KERNEL_LEVELS; level++) {
+    const struct color_kernels *kernels =
+        get_color_kernels_for_level((enum color_kernel_level)level);
+    if (kernels)
+      printf("%10s", kernels->name);
+  }
+  printf("\n");
+
+  for (int id = 0; id < KERNEL_COUNT; id++) {
+    for (const struct image_size &size : image_sizes) {
+      printf("%-22s%-12s", kernel_names[id], size.name);
+      for (int level = 0; level < COLOR_KERNEL_LEVELS; level++) {
+        const struct color_kernels *kernels =
+            get_color_kernels_for_level((enum color_kernel_level)level);
+        if (kernels)
+          printf("%10.2f", measure(kernels, id, size, b, budget));
+      }
+      printf("\n");
+      fflush(stdout);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,605 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "colorkernels.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define COLOR_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+// BT.601 limited range, 8 bit fixed point.
+#define Y_FROM_RGB(r, g, b) ((((66 * (r) + 129 * (g) + 25 * (b) + 128) >> 8)) + 16)
+#define U_FROM_RGB(r, g, b) ((((-38 * (r) - 74 * (g) + 112 * (b) + 128) >> 8)) + 128)
+#define V_FROM_RGB(r, g, b) ((((112 * (r) - 94 * (g) - 18 * (b) + 128) >> 8)) + 128)
+
+static inline uint32_t clamp_u8(int32_t value) {
+  return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+// Rounded value * alpha / 255, exact for all 8 bit inputs.
+static inline uint32_t multiply_alpha(uint32_t value, uint32_t alpha) {
+  uint32_t t = value * alpha + 128;
+  return (t + (t >> 8)) >> 8;
+}
+
+static void swizzle_rgba_scalar(const uint8_t *src, uint8_t *dst,
+                                size_t width) {
+  for (size_t i = 0; i < width; i++) {
+    uint8_t first = src[i * 4];
+    uint8_t third = src[i * 4 + 2];
+    dst[i * 4] = third;
+    dst[i * 4 + 1] = src[i * 4 + 1];
+    dst[i * 4 + 2] = first;
+    dst[i * 4 + 3] = src[i * 4 + 3];
+  }
+}
+
+static void rgb565_to_xrgb8888_scalar(const uint16_t *src, uint32_t *dst,
+                                      size_t width) {
+  for (size_t i = 0; i < width; i++) {
+    uint32_t r = src[i] >> 11;
+    uint32_t g = (src[i] >> 5) & 0x3f;
+    uint32_t b = src[i] & 0x1f;
+    r = (r << 3) | (r >> 2);
+    g = (g << 2) | (g >> 4);
+    b = (b << 3) | (b >> 2);
+    dst[i] = 0xff000000 | (r << 16) | (g << 8) | b;
+  }
+}
+
+static void xrgb8888_to_rgb565_scalar(const uint32_t *src, uint16_t *dst,
+                                      size_t width) {
+  for (size_t i = 0; i < width; i++) {
+    uint32_t p = src[i];
+    dst[i] = ((p >> 8) & 0xf800) | ((p >> 5) & 0x07e0) | ((p >> 3) & 0x001f);
+  }
+}
+
+static void nv12_to_xrgb8888_scalar(const uint8_t *y, const uint8_t *uv,
+                                    uint32_t *dst, size_t width) {
+  for (size_t i = 0; i < width; i++) {
+    int32_t c = 298 * (y[i] - 16);
+    int32_t d = uv[i & ~1] - 128;
+    int32_t e = uv[(i & ~1) + 1] - 128;
+    uint32_t r = clamp_u8((c + 409 * e + 128) >> 8);
+    uint32_t g = clamp_u8((c - 100 * d - 208 * e + 128) >> 8);
+    uint32_t b = clamp_u8((c + 516 * d + 128) >> 8);
+    dst[i] = 0xff000000 | (r << 16) | (g << 8) | b;
+  }
+}
+
+static void xrgb8888_to_nv12_scalar(const uint32_t *src0, const uint32_t *src1,
+                                    uint8_t *y0, uint8_t *y1, uint8_t *uv,
+                                    size_t width) {
+  for (size_t i = 0; i < width; i++) {
+    uint32_t p0 = src0[i];
+    uint32_t p1 = src1[i];
+    y0[i] = Y_FROM_RGB((int32_t)((p0 >> 16) & 0xff),
+                       (int32_t)((p0 >> 8) & 0xff), (int32_t)(p0 & 0xff));
+    y1[i] = Y_FROM_RGB((int32_t)((p1 >> 16) & 0xff),
+                       (int32_t)((p1 >> 8) & 0xff), (int32_t)(p1 & 0xff));
+  }
+
+  for (size_t i = 0; i < width; i += 2) {
+    // The last column of an odd width is averaged with itself.
+    size_t j = i + 1 < width ? i + 1 : i;
+    const uint32_t block[4] = {src0[i], src0[j], src1[i], src1[j]};
+    int32_t r = 2;
+    int32_t g = 2;
+    int32_t b = 2;
+    for (uint32_t p : block) {
+      r += (p >> 16) & 0xff;
+      g += (p >> 8) & 0xff;
+      b += p & 0xff;
+    }
+
+    r >>= 2;
+    g >>= 2;
+    b >>= 2;
+    uv[i] = U_FROM_RGB(r, g, b);
+    uv[i + 1] = V_FROM_RGB(r, g, b);
+  }
+}
+
+static void premultiply_argb8888_scalar(const uint32_t *src, uint32_t *dst,
+                                        size_t width) {
+  for (size_t i = 0; i < width; i++) {
+    uint32_t p = src[i];
+    uint32_t a = p >> 24;
+    dst[i] = (a << 24) | (multiply_alpha((p >> 16) & 0xff, a) << 16) |
+             (multiply_alpha((p >> 8) & 0xff, a) << 8) |
+             multiply_alpha(p & 0xff, a);
+  }
+}
+
+static const struct color_kernels scalar_kernels = {
+    "scalar",
+    swizzle_rgba_scalar,
+    rgb565_to_xrgb8888_scalar,
+    xrgb8888_to_rgb565_scalar,
+    nv12_to_xrgb8888_scalar,
+    xrgb8888_to_nv12_scalar,
+    premultiply_argb8888_scalar};
+
+#ifdef COLOR_KERNELS_X86
+
+// The SIMD kernels below convert as many pixels as fit in a vector and
+// leave the remaining ones to the scalar kernels.
+
+static inline __m128i load_u32(const void *src) {
+  int32_t value;
+  memcpy(&value, src, sizeof(value));
+  return _mm_cvtsi32_si128(value);
+}
+
+static inline void store_u32(void *dst, __m128i value) {
+  int32_t low = _mm_cvtsi128_si32(value);
+  memcpy(dst, &low, sizeof(low));
+}
+
+__attribute__((target("sse4.1"))) static void swizzle_rgba_sse41(
+    const uint8_t *src, uint8_t *dst, size_t width) {
+  const __m128i mask =
+      _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+  size_t i = 0;
+  for (; i + 4 <= width; i += 4) {
+    __m128i p = _mm_loadu_si128((const __m128i *)(src + i * 4));
+    _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_shuffle_epi8(p, mask));
+  }
+
+  swizzle_rgba_scalar(src + i * 4, dst + i * 4, width - i);
+}
+
+__attribute__((target("sse4.1"))) static void rgb565_to_xrgb8888_sse41(
+    const uint16_t *src, uint32_t *dst, size_t width) {
+  const __m128i mask_5 = _mm_set1_epi16(0x1f);
+  const __m128i mask_6 = _mm_set1_epi16(0x3f);
+  const __m128i alpha = _mm_set1_epi16((int16_t)0xff00);
+  size_t i = 0;
+  for (; i + 8 <= width; i += 8) {
+    __m128i p = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i r = _mm_srli_epi16(p, 11);
+    __m128i g = _mm_and_si128(_mm_srli_epi16(p, 5), mask_6);
+    __m128i b = _mm_and_si128(p, mask_5);
+    r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+    g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+    b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+    __m128i gb = _mm_or_si128(_mm_slli_epi16(g, 8), b);
+    __m128i ar = _mm_or_si128(r, alpha);
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_unpacklo_epi16(gb, ar));
+    _mm_storeu_si128((__m128i *)(dst + i + 4), _mm_unpackhi_epi16(gb, ar));
+  }
+
+  rgb565_to_xrgb8888_scalar(src + i, dst + i, width - i);
+}
+
+__attribute__((target("sse4.1"))) static inline __m128i pack_rgb565_sse41(
+    __m128i p) {
+  __m128i r = _mm_and_si128(_mm_srli_epi32(p, 8), _mm_set1_epi32(0xf800));
+  __m128i g = _mm_and_si128(_mm_srli_epi32(p, 5), _mm_set1_epi32(0x07e0));
+  __m128i b = _mm_and_si128(_mm_srli_epi32(p, 3), _mm_set1_epi32(0x001f));
+  return _mm_or_si128(_mm_or_si128(r, g), b);
+}
+
+__attribute__((target("sse4.1"))) static void xrgb8888_to_rgb565_sse41(
+    const uint32_t *src, uint16_t *dst, size_t width) {
+  size_t i = 0;
+  for (; i + 8 <= width; i += 8) {
+    __m128i lo = pack_rgb565_sse41(
+        _mm_loadu_si128((const __m128i *)(src + i)));
+    __m128i hi = pack_rgb565_sse41(
+        _mm_loadu_si128((const __m128i *)(src + i + 4)));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi32(lo, hi));
+  }
+
+  xrgb8888_to_rgb565_scalar(src + i, dst + i, width - i);
+}
+
+__attribute__((target("sse4.1"))) static void nv12_to_xrgb8888_sse41(
+    const uint8_t *y, const uint8_t *uv, uint32_t *dst, size_t width) {
+  const __m128i u_mask = _mm_setr_epi8(0, 0, 2, 2, -1, -1, -1, -1, -1, -1, -1,
+                                       -1, -1, -1, -1, -1);
+  const __m128i v_mask = _mm_setr_epi8(1, 1, 3, 3, -1, -1, -1, -1, -1, -1, -1,
+                                       -1, -1, -1, -1, -1);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i max = _mm_set1_epi32(255);
+  const __m128i round = _mm_set1_epi32(128);
+  const __m128i alpha = _mm_set1_epi32((int32_t)0xff000000);
+  size_t i = 0;
+  for (; i + 4 <= width; i += 4) {
+    __m128i luma = _mm_cvtepu8_epi32(load_u32(y + i));
+    __m128i chroma = load_u32(uv + i);
+    __m128i d = _mm_sub_epi32(
+        _mm_cvtepu8_epi32(_mm_shuffle_epi8(chroma, u_mask)), round);
+    __m128i e = _mm_sub_epi32(
+        _mm_cvtepu8_epi32(_mm_shuffle_epi8(chroma, v_mask)), round);
+    __m128i c = _mm_add_epi32(
+        _mm_mullo_epi32(_mm_sub_epi32(luma, _mm_set1_epi32(16)),
+                        _mm_set1_epi32(298)),
+        round);
+    __m128i r = _mm_add_epi32(c, _mm_mullo_epi32(e, _mm_set1_epi32(409)));
+    __m128i g = _mm_sub_epi32(
+        c, _mm_add_epi32(_mm_mullo_epi32(d, _mm_set1_epi32(100)),
+                         _mm_mullo_epi32(e, _mm_set1_epi32(208))));
+    __m128i b = _mm_add_epi32(c, _mm_mullo_epi32(d, _mm_set1_epi32(516)));
+    r = _mm_min_epi32(_mm_max_epi32(_mm_srai_epi32(r, 8), zero), max);
+    g = _mm_min_epi32(_mm_max_epi32(_mm_srai_epi32(g, 8), zero), max);
+    b = _mm_min_epi32(_mm_max_epi32(_mm_srai_epi32(b, 8), zero), max);
+    __m128i p = _mm_or_si128(
+        _mm_or_si128(alpha, _mm_slli_epi32(r, 16)),
+        _mm_or_si128(_mm_slli_epi32(g, 8), b));
+    _mm_storeu_si128((__m128i *)(dst + i), p);
+  }
+
+  nv12_to_xrgb8888_scalar(y + i, uv + i, dst + i, width - i);
+}
+
+// Y, U or V of 32 bit r, g, b lanes.
+__attribute__((target("sse4.1"))) static inline __m128i weigh_rgb_sse41(
+    __m128i r, __m128i g, __m128i b, int32_t wr, int32_t wg, int32_t wb,
+    int32_t offset) {
+  __m128i sum = _mm_add_epi32(
+      _mm_add_epi32(_mm_mullo_epi32(r, _mm_set1_epi32(wr)),
+                    _mm_mullo_epi32(g, _mm_set1_epi32(wg))),
+      _mm_add_epi32(_mm_mullo_epi32(b, _mm_set1_epi32(wb)),
+                    _mm_set1_epi32(128)));
+  return _mm_add_epi32(_mm_srai_epi32(sum, 8), _mm_set1_epi32(offset));
+}
+
+__attribute__((target("sse4.1"))) static inline __m128i pack_u8_sse41(
+    __m128i value) {
+  __m128i words = _mm_packus_epi32(value, value);
+  return _mm_packus_epi16(words, words);
+}
+
+__attribute__((target("sse4.1"))) static void xrgb8888_to_nv12_sse41(
+    const uint32_t *src0, const uint32_t *src1, uint8_t *y0, uint8_t *y1,
+    uint8_t *uv, size_t width) {
+  const __m128i mask = _mm_set1_epi32(0xff);
+  const __m128i two = _mm_set1_epi32(2);
+  size_t i = 0;
+  for (; i + 4 <= width; i += 4) {
+    __m128i p0 = _mm_loadu_si128((const __m128i *)(src0 + i));
+    __m128i p1 = _mm_loadu_si128((const __m128i *)(src1 + i));
+    __m128i r0 = _mm_and_si128(_mm_srli_epi32(p0, 16), mask);
+    __m128i g0 = _mm_and_si128(_mm_srli_epi32(p0, 8), mask);
+    __m128i b0 = _mm_and_si128(p0, mask);
+    __m128i r1 = _mm_and_si128(_mm_srli_epi32(p1, 16), mask);
+    __m128i g1 = _mm_and_si128(_mm_srli_epi32(p1, 8), mask);
+    __m128i b1 = _mm_and_si128(p1, mask);
+    store_u32(y0 + i,
+              pack_u8_sse41(weigh_rgb_sse41(r0, g0, b0, 66, 129, 25, 16)));
+    store_u32(y1 + i,
+              pack_u8_sse41(weigh_rgb_sse41(r1, g1, b1, 66, 129, 25, 16)));
+
+    // Sums of 2x2 blocks, in the first two lanes.
+    __m128i r = _mm_add_epi32(r0, r1);
+    __m128i g = _mm_add_epi32(g0, g1);
+    __m128i b = _mm_add_epi32(b0, b1);
+    r = _mm_srai_epi32(_mm_add_epi32(_mm_hadd_epi32(r, r), two), 2);
+    g = _mm_srai_epi32(_mm_add_epi32(_mm_hadd_epi32(g, g), two), 2);
+    b = _mm_srai_epi32(_mm_add_epi32(_mm_hadd_epi32(b, b), two), 2);
+    __m128i u = weigh_rgb_sse41(r, g, b, -38, -74, 112, 128);
+    __m128i v = weigh_rgb_sse41(r, g, b, 112, -94, -18, 128);
+    store_u32(uv + i, pack_u8_sse41(_mm_unpacklo_epi32(u, v)));
+  }
+
+  xrgb8888_to_nv12_scalar(src0 + i, src1 + i, y0 + i, y1 + i, uv + i,
+                          width - i);
+}
+
+// Multiplies 16 bit lanes of color by alpha, alpha itself by 255.
+__attribute__((target("sse4.1"))) static inline __m128i multiply_alpha_sse41(
+    __m128i color, __m128i alpha) {
+  __m128i t = _mm_add_epi16(_mm_mullo_epi16(color, alpha), _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+__attribute__((target("sse4.1"))) static void premultiply_argb8888_sse41(
+    const uint32_t *src, uint32_t *dst, size_t width) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i alpha_lo = _mm_setr_epi8(3, -1, 3, -1, 3, -1, -1, -1, 7, -1, 7,
+                                         -1, 7, -1, -1, -1);
+  const __m128i alpha_hi = _mm_setr_epi8(11, -1, 11, -1, 11, -1, -1, -1, 15,
+                                         -1, 15, -1, 15, -1, -1, -1);
+  const __m128i keep_alpha = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+  size_t i = 0;
+  for (; i + 4 <= width; i += 4) {
+    __m128i p = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i lo = multiply_alpha_sse41(
+        _mm_unpacklo_epi8(p, zero),
+        _mm_or_si128(_mm_shuffle_epi8(p, alpha_lo), keep_alpha));
+    __m128i hi = multiply_alpha_sse41(
+        _mm_unpackhi_epi8(p, zero),
+        _mm_or_si128(_mm_shuffle_epi8(p, alpha_hi), keep_alpha));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+  }
+
+  premultiply_argb8888_scalar(src + i, dst + i, width - i);
+}
+
+static const struct color_kernels sse41_kernels = {
+    "sse4.1",
+    swizzle_rgba_sse41,
+    rgb565_to_xrgb8888_sse41,
+    xrgb8888_to_rgb565_sse41,
+    nv12_to_xrgb8888_sse41,
+    xrgb8888_to_nv12_sse41,
+    premultiply_argb8888_sse41};
+
+// AVX2 shuffles and packs work on each 128 bit half separately, which the
+// kernels below account for.
+
+__attribute__((target("avx2"))) static void swizzle_rgba_avx2(
+    const uint8_t *src, uint8_t *dst, size_t width) {
+  const __m256i mask =
+      _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, 2,
+                       1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+  size_t i = 0;
+  for (; i + 8 <= width; i += 8) {
+    __m256i p = _mm256_loadu_si256((const __m256i *)(src + i * 4));
+    _mm256_storeu_si256((__m256i *)(dst + i * 4),
+                        _mm256_shuffle_epi8(p, mask));
+  }
+
+  swizzle_rgba_sse41(src + i * 4, dst + i * 4, width - i);
+}
+
+__attribute__((target("avx2"))) static void rgb565_to_xrgb8888_avx2(
+    const uint16_t *src, uint32_t *dst, size_t width) {
+  const __m256i mask_5 = _mm256_set1_epi16(0x1f);
+  const __m256i mask_6 = _mm256_set1_epi16(0x3f);
+  const __m256i alpha = _mm256_set1_epi16((int16_t)0xff00);
+  size_t i = 0;
+  for (; i + 16 <= width; i += 16) {
+    __m256i p = _mm256_loadu_si256((const __m256i *)(src + i));
+    __m256i r = _mm256_srli_epi16(p, 11);
+    __m256i g = _mm256_and_si256(_mm256_srli_epi16(p, 5), mask_6);
+    __m256i b = _mm256_and_si256(p, mask_5);
+    r = _mm256_or_si256(_mm256_slli_epi16(r, 3), _mm256_srli_epi16(r, 2));
+    g = _mm256_or_si256(_mm256_slli_epi16(g, 2), _mm256_srli_epi16(g, 4));
+    b = _mm256_or_si256(_mm256_slli_epi16(b, 3), _mm256_srli_epi16(b, 2));
+    __m256i gb = _mm256_or_si256(_mm256_slli_epi16(g, 8), b);
+    __m256i ar = _mm256_or_si256(r, alpha);
+    // Pixels 0-3 and 8-11, 4-7 and 12-15.
+    __m256i lo = _mm256_unpacklo_epi16(gb, ar);
+    __m256i hi = _mm256_unpackhi_epi16(gb, ar);
+    _mm256_storeu_si256((__m256i *)(dst + i),
+                        _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i *)(dst + i + 8),
+                        _mm256_permute2x128_si256(lo, hi, 0x31));
+  }
+
+  rgb565_to_xrgb8888_sse41(src + i, dst + i, width - i);
+}
+
+__attribute__((target("avx2"))) static inline __m256i pack_rgb565_avx2(
+    __m256i p) {
+  __m256i r =
+      _mm256_and_si256(_mm256_srli_epi32(p, 8), _mm256_set1_epi32(0xf800));
+  __m256i g =
+      _mm256_and_si256(_mm256_srli_epi32(p, 5), _mm256_set1_epi32(0x07e0));
+  __m256i b =
+      _mm256_and_si256(_mm256_srli_epi32(p, 3), _mm256_set1_epi32(0x001f));
+  return _mm256_or_si256(_mm256_or_si256(r, g), b);
+}
+
+__attribute__((target("avx2"))) static void xrgb8888_to_rgb565_avx2(
+    const uint32_t *src, uint16_t *dst, size_t width) {
+  size_t i = 0;
+  for (; i + 16 <= width; i += 16) {
+    __m256i lo = pack_rgb565_avx2(
+        _mm256_loadu_si256((const __m256i *)(src + i)));
+    __m256i hi = pack_rgb565_avx2(
+        _mm256_loadu_si256((const __m256i *)(src + i + 8)));
+    // Pixels 0-3, 8-11, 4-7, 12-15.
+    __m256i packed = _mm256_packus_epi32(lo, hi);
+    _mm256_storeu_si256((__m256i *)(dst + i),
+                        _mm256_permute4x64_epi64(packed, 0xd8));
+  }
+
+  xrgb8888_to_rgb565_sse41(src + i, dst + i, width - i);
+}
+
+__attribute__((target("avx2"))) static void nv12_to_xrgb8888_avx2(
+    const uint8_t *y, const uint8_t *uv, uint32_t *dst, size_t width) {
+  const __m128i u_mask = _mm_setr_epi8(0, 0, 2, 2, 4, 4, 6, 6, -1, -1, -1, -1,
+                                       -1, -1, -1, -1);
+  const __m128i v_mask = _mm_setr_epi8(1, 1, 3, 3, 5, 5, 7, 7, -1, -1, -1, -1,
+                                       -1, -1, -1, -1);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i max = _mm256_set1_epi32(255);
+  const __m256i round = _mm256_set1_epi32(128);
+  const __m256i alpha = _mm256_set1_epi32((int32_t)0xff000000);
+  size_t i = 0;
+  for (; i + 8 <= width; i += 8) {
+    __m256i luma =
+        _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(y + i)));
+    __m128i chroma = _mm_loadl_epi64((const __m128i *)(uv + i));
+    __m256i d = _mm256_sub_epi32(
+        _mm256_cvtepu8_epi32(_mm_shuffle_epi8(chroma, u_mask)), round);
+    __m256i e = _mm256_sub_epi32(
+        _mm256_cvtepu8_epi32(_mm_shuffle_epi8(chroma, v_mask)), round);
+    __m256i c = _mm256_add_epi32(
+        _mm256_mullo_epi32(_mm256_sub_epi32(luma, _mm256_set1_epi32(16)),
+                           _mm256_set1_epi32(298)),
+        round);
+    __m256i r =
+        _mm256_add_epi32(c, _mm256_mullo_epi32(e, _mm256_set1_epi32(409)));
+    __m256i g = _mm256_sub_epi32(
+        c, _mm256_add_epi32(_mm256_mullo_epi32(d, _mm256_set1_epi32(100)),
+                            _mm256_mullo_epi32(e, _mm256_set1_epi32(208))));
+    __m256i b =
+        _mm256_add_epi32(c, _mm256_mullo_epi32(d, _mm256_set1_epi32(516)));
+    r = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(r, 8), zero), max);
+    g = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(g, 8), zero), max);
+    b = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(b, 8), zero), max);
+    __m256i p = _mm256_or_si256(
+        _mm256_or_si256(alpha, _mm256_slli_epi32(r, 16)),
+        _mm256_or_si256(_mm256_slli_epi32(g, 8), b));
+    _mm256_storeu_si256((__m256i *)(dst + i), p);
+  }
+
+  nv12_to_xrgb8888_sse41(y + i, uv + i, dst + i, width - i);
+}
+
+__attribute__((target("avx2"))) static inline __m256i weigh_rgb_avx2(
+    __m256i r, __m256i g, __m256i b, int32_t wr, int32_t wg, int32_t wb,
+    int32_t offset) {
+  __m256i sum = _mm256_add_epi32(
+      _mm256_add_epi32(_mm256_mullo_epi32(r, _mm256_set1_epi32(wr)),
+                       _mm256_mullo_epi32(g, _mm256_set1_epi32(wg))),
+      _mm256_add_epi32(_mm256_mullo_epi32(b, _mm256_set1_epi32(wb)),
+                       _mm256_set1_epi32(128)));
+  return _mm256_add_epi32(_mm256_srai_epi32(sum, 8),
+                          _mm256_set1_epi32(offset));
+}
+
+// Stores the first four bytes of each half of value to lo and hi.
+__attribute__((target("avx2"))) static inline void store_u8_avx2(
+    __m256i value, uint8_t *lo, uint8_t *hi) {
+  __m256i words = _mm256_packus_epi32(value, value);
+  __m256i bytes = _mm256_packus_epi16(words, words);
+  store_u32(lo, _mm256_castsi256_si128(bytes));
+  store_u32(hi, _mm256_extracti128_si256(bytes, 1));
+}
+
+__attribute__((target("avx2"))) static void xrgb8888_to_nv12_avx2(
+    const uint32_t *src0, const uint32_t *src1, uint8_t *y0, uint8_t *y1,
+    uint8_t *uv, size_t width) {
+  const __m256i mask = _mm256_set1_epi32(0xff);
+  const __m256i two = _mm256_set1_epi32(2);
+  size_t i = 0;
+  for (; i + 8 <= width; i += 8) {
+    __m256i p0 = _mm256_loadu_si256((const __m256i *)(src0 + i));
+    __m256i p1 = _mm256_loadu_si256((const __m256i *)(src1 + i));
+    __m256i r0 = _mm256_and_si256(_mm256_srli_epi32(p0, 16), mask);
+    __m256i g0 = _mm256_and_si256(_mm256_srli_epi32(p0, 8), mask);
+    __m256i b0 = _mm256_and_si256(p0, mask);
+    __m256i r1 = _mm256_and_si256(_mm256_srli_epi32(p1, 16), mask);
+    __m256i g1 = _mm256_and_si256(_mm256_srli_epi32(p1, 8), mask);
+    __m256i b1 = _mm256_and_si256(p1, mask);
+    store_u8_avx2(weigh_rgb_avx2(r0, g0, b0, 66, 129, 25, 16), y0 + i,
+                  y0 + i + 4);
+    store_u8_avx2(weigh_rgb_avx2(r1, g1, b1, 66, 129, 25, 16), y1 + i,
+                  y1 + i + 4);
+
+    // Sums of 2x2 blocks, in the first two lanes of each half.
+    __m256i r = _mm256_add_epi32(r0, r1);
+    __m256i g = _mm256_add_epi32(g0, g1);
+    __m256i b = _mm256_add_epi32(b0, b1);
+    r = _mm256_srai_epi32(_mm256_add_epi32(_mm256_hadd_epi32(r, r), two), 2);
+    g = _mm256_srai_epi32(_mm256_add_epi32(_mm256_hadd_epi32(g, g), two), 2);
+    b = _mm256_srai_epi32(_mm256_add_epi32(_mm256_hadd_epi32(b, b), two), 2);
+    __m256i u = weigh_rgb_avx2(r, g, b, -38, -74, 112, 128);
+    __m256i v = weigh_rgb_avx2(r, g, b, 112, -94, -18, 128);
+    store_u8_avx2(_mm256_unpacklo_epi32(u, v), uv + i, uv + i + 4);
+  }
+
+  xrgb8888_to_nv12_sse41(src0 + i, src1 + i, y0 + i, y1 + i, uv + i,
+                         width - i);
+}
+
+__attribute__((target("avx2"))) static inline __m256i multiply_alpha_avx2(
+    __m256i color, __m256i alpha) {
+  __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(color, alpha),
+                               _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+__attribute__((target("avx2"))) static void premultiply_argb8888_avx2(
+    const uint32_t *src, uint32_t *dst, size_t width) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i alpha_lo = _mm256_setr_epi8(
+      3, -1, 3, -1, 3, -1, -1, -1, 7, -1, 7, -1, 7, -1, -1, -1, 3, -1, 3, -1,
+      3, -1, -1, -1, 7, -1, 7, -1, 7, -1, -1, -1);
+  const __m256i alpha_hi = _mm256_setr_epi8(
+      11, -1, 11, -1, 11, -1, -1, -1, 15, -1, 15, -1, 15, -1, -1, -1, 11, -1,
+      11, -1, 11, -1, -1, -1, 15, -1, 15, -1, 15, -1, -1, -1);
+  const __m256i keep_alpha = _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0,
+                                               0, 0, 255, 0, 0, 0, 255);
+  size_t i = 0;
+  for (; i + 8 <= width; i += 8) {
+    __m256i p = _mm256_loadu_si256((const __m256i *)(src + i));
+    __m256i lo = multiply_alpha_avx2(
+        _mm256_unpacklo_epi8(p, zero),
+        _mm256_or_si256(_mm256_shuffle_epi8(p, alpha_lo), keep_alpha));
+    __m256i hi = multiply_alpha_avx2(
+        _mm256_unpackhi_epi8(p, zero),
+        _mm256_or_si256(_mm256_shuffle_epi8(p, alpha_hi), keep_alpha));
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_packus_epi16(lo, hi));
+  }
+
+  premultiply_argb8888_sse41(src + i, dst + i, width - i);
+}
+
+static const struct color_kernels avx2_kernels = {
+    "avx2",
+    swizzle_rgba_avx2,
+    rgb565_to_xrgb8888_avx2,
+    xrgb8888_to_rgb565_avx2,
+    nv12_to_xrgb8888_avx2,
+    xrgb8888_to_nv12_avx2,
+    premultiply_argb8888_avx2};
+
+#endif  // COLOR_KERNELS_X86
+
+const struct color_kernels *get_color_kernels_for_level(
+    enum color_kernel_level level) {
+  switch (level) {
+    case COLOR_KERNEL_SCALAR:
+      return &scalar_kernels;
+#ifdef COLOR_KERNELS_X86
+    case COLOR_KERNEL_SSE41:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("sse4.1") ? &sse41_kernels : NULL;
+    case COLOR_KERNEL_AVX2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2") ? &avx2_kernels : NULL;
+#endif
+    default:
+      return NULL;
+  }
+}
+
+static const struct color_kernels *select_color_kernels(void) {
+  int max_level = COLOR_KERNEL_LEVELS - 1;
+  const char *cap = getenv("COLOR_KERNEL_LEVEL");
+  if (cap) {
+    if (!strcmp(cap, "scalar"))
+      max_level = COLOR_KERNEL_SCALAR;
+    else if (!strcmp(cap, "sse41"))
+      max_level = COLOR_KERNEL_SSE41;
+  }
+
+  for (int level = max_level; level > COLOR_KERNEL_SCALAR; level--) {
+    const struct color_kernels *kernels =
+        get_color_kernels_for_level((enum color_kernel_level)level);
+    if (kernels)
+      return kernels;
+  }
+
+  return &scalar_kernels;
+}
+
+const struct color_kernels *get_color_kernels(void) {
+  static const struct color_kernels *kernels = select_color_kernels();
+  return kernels;
+}
@@ -0,0 +1,73 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef COLORFORMATTER_COLORKERNELS_H_
+#define COLORFORMATTER_COLORKERNELS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Row conversion kernels. All of them convert width pixels of one row and
+// accept unaligned pointers. 32 bit pixels are named after their DRM
+// fourcc, i.e. xrgb8888 is B, G, R, X in memory. YUV is BT.601 limited
+// range, the same for every implementation, so their output is bit exact.
+struct color_kernels {
+  const char *name;
+
+  // Swaps the first and third byte of each pixel, which turns RGBA into
+  // BGRA and back.
+  void (*swizzle_rgba)(const uint8_t *src, uint8_t *dst, size_t width);
+
+  void (*rgb565_to_xrgb8888)(const uint16_t *src, uint32_t *dst,
+                             size_t width);
+  void (*xrgb8888_to_rgb565)(const uint32_t *src, uint16_t *dst,
+                             size_t width);
+
+  // Converts one row of an NV12 image, uv is the chroma row shared with
+  // the row above or below. Alpha is set to 0xff. Chroma rows of odd
+  // widths have a trailing sample, i.e. are (width + 1) & ~1 bytes.
+  void (*nv12_to_xrgb8888)(const uint8_t *y, const uint8_t *uv,
+                           uint32_t *dst, size_t width);
+
+  // Converts two rows of an image into two luma rows and the chroma row
+  // they share. Each chroma sample is taken from the average of a 2x2
+  // block. For an odd height, pass the last row as both rows.
+  void (*xrgb8888_to_nv12)(const uint32_t *src0, const uint32_t *src1,
+                           uint8_t *y0, uint8_t *y1, uint8_t *uv,
+                           size_t width);
+
+  // Multiplies color by alpha of argb8888 (or abgr8888) pixels, rounding
+  // to nearest.
+  void (*premultiply_argb8888)(const uint32_t *src, uint32_t *dst,
+                               size_t width);
+};
+
+enum color_kernel_level {
+  COLOR_KERNEL_SCALAR,
+  COLOR_KERNEL_SSE41,
+  COLOR_KERNEL_AVX2,
+  COLOR_KERNEL_LEVELS
+};
+
+// Kernels of the given level, NULL if the CPU doesn't support it.
+const struct color_kernels *get_color_kernels_for_level(
+    enum color_kernel_level level);
+
+// Fastest kernels the CPU supports, selected once with CPUID. Setting
+// COLOR_KERNEL_LEVEL to scalar, sse41 or avx2 caps the level used.
+const struct color_kernels *get_color_kernels(void);
+
+#endif  // COLORFORMATTER_COLORKERNELS_H_
@@ -52,6 +52,8 @@ LOCAL_SRC_FILES := \
         drm/drmdisplay.cpp \
         drm/drmbuffer.cpp \
         drm/drmplane.cpp \
+        drm/drmformattable.cpp \
+        drm/drmplaneblending.cpp \
 	drm/drmpixelbuffer.cpp \
         drm/drmdisplaymanager.cpp \
 	drm/drmscopedtypes.cpp
@@ -105,6 +107,19 @@ LOCAL_CPPFLAGS += \
 	-DDISABLE_HOTPLUG_NOTIFICATION
 endif
 
+ifeq ($(strip $(BOARD_USES_HEADLESS_WSI)), true)
+LOCAL_SRC_FILES += \
+	headless/headlessdisplay.cpp \
+	headless/headlessdisplaymanager.cpp \
+	headless/headlessplane.cpp
+
+LOCAL_C_INCLUDES += \
+	$(LOCAL_PATH)/../wsi/headless
+
+LOCAL_CPPFLAGS += \
+	-DUSE_HEADLESS_WSI
+endif
+
 LOCAL_CPPFLAGS += -DENABLE_ANDROID_WA
 
 LOCAL_MODULE := libhwcomposer_wsi
@@ -20,6 +20,8 @@
 #include <stdlib.h>
 #include <stdint.h>
 
+#include <vector>
+
 namespace hwcomposer {
 
 struct OverlayLayer;
@@ -53,6 +55,14 @@ class DisplayPlane {
    */
   virtual uint32_t GetPreferredFormat() const = 0;
 
+  /**
+   * API for querying the modifiers this plane can scan out
+   * format with. Leaves modifiers empty if the plane doesn't
+   * report any, in which case only implicit layouts can be used.
+   */
+  virtual void GetSupportedModifiers(
+      uint32_t format, std::vector<uint64_t>* modifiers) const = 0;
+
   virtual void SetInUse(bool in_use) = 0;
 
   virtual bool InUse() const = 0;
@@ -21,6 +21,8 @@
 #include <xf86drm.h>
 #include <xf86drmMode.h>
 
+#include <atomic>
+
 #include <hwcdefs.h>
 #include <nativebufferhandler.h>
 
@@ -34,10 +36,11 @@
 namespace hwcomposer {
 
 DrmBuffer::~DrmBuffer() {
+  bool has_textures = image_.texture_ > 0 || image_.plane_textures_[0] > 0;
   if (media_image_.surface_ == VA_INVALID_ID) {
-    resource_manager_->MarkResourceForDeletion(image_, image_.texture_ > 0);
+    resource_manager_->MarkResourceForDeletion(image_, has_textures);
   } else {
-    if (image_.texture_ > 0) {
+    if (has_textures) {
       image_.handle_ = 0;
       image_.drm_fd_ = 0;
       resource_manager_->MarkResourceForDeletion(image_, true);
@@ -63,6 +66,7 @@ void DrmBuffer::Initialize(const HwcBuffer& bo) {
     format_ = DRM_FORMAT_YUV420;
 
   prime_fd_ = bo.prime_fd_;
+  modifier_ = bo.modifier_;
   usage_ = bo.usage_;
 
   if (usage_ == hwcomposer::kLayerCursor) {
@@ -165,6 +169,38 @@ const ResourceHandle& DrmBuffer::GetGpuResource(GpuDisplay egl_display,
             egl_display, EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT,
             static_cast<EGLClientBuffer>(nullptr), attr_list_yv12);
       }
+#ifdef EGL_DMA_BUF_PLANE0_MODIFIER_LO_EXT
+    } else if (modifier_) {
+      // Tiled or compressed render target, see
+      // GbmBufferHandler::CreateBufferWithModifiers. Compressed buffers
+      // have their aux surface in plane 1.
+      const EGLint modifier_lo = static_cast<EGLint>(modifier_ & 0xFFFFFFFF);
+      const EGLint modifier_hi = static_cast<EGLint>(modifier_ >> 32);
+      EGLint attr_list_modifier[] = {
+          EGL_WIDTH,                          static_cast<EGLint>(width_),
+          EGL_HEIGHT,                         static_cast<EGLint>(height_),
+          EGL_LINUX_DRM_FOURCC_EXT,           static_cast<EGLint>(format_),
+          EGL_DMA_BUF_PLANE0_FD_EXT,          static_cast<EGLint>(prime_fd_),
+          EGL_DMA_BUF_PLANE0_PITCH_EXT,       static_cast<EGLint>(pitches_[0]),
+          EGL_DMA_BUF_PLANE0_OFFSET_EXT,      static_cast<EGLint>(offsets_[0]),
+          EGL_DMA_BUF_PLANE0_MODIFIER_LO_EXT, modifier_lo,
+          EGL_DMA_BUF_PLANE0_MODIFIER_HI_EXT, modifier_hi,
+          EGL_DMA_BUF_PLANE1_FD_EXT,          static_cast<EGLint>(prime_fd_),
+          EGL_DMA_BUF_PLANE1_PITCH_EXT,       static_cast<EGLint>(pitches_[1]),
+          EGL_DMA_BUF_PLANE1_OFFSET_EXT,      static_cast<EGLint>(offsets_[1]),
+          EGL_DMA_BUF_PLANE1_MODIFIER_LO_EXT, modifier_lo,
+          EGL_DMA_BUF_PLANE1_MODIFIER_HI_EXT, modifier_hi,
+          EGL_NONE,                           0};
+      // Terminate the list before the aux plane, at PLANE1_FD, if there
+      // is none.
+      if (!gem_handles_[1])
+        attr_list_modifier[16] = EGL_NONE;
+
+      image = eglCreateImageKHR(egl_display, EGL_NO_CONTEXT,
+                                EGL_LINUX_DMA_BUF_EXT,
+                                static_cast<EGLClientBuffer>(nullptr),
+                                attr_list_modifier);
+#endif
     } else {
       const EGLint attr_list[] = {
           EGL_WIDTH,                     static_cast<EGLint>(width_),
@@ -320,6 +356,78 @@ const ResourceHandle& DrmBuffer::GetGpuResource() {
   return image_;
 }
 
+const ResourceHandle& DrmBuffer::GetPlanarGpuResource(GpuDisplay egl_display) {
+#ifdef USE_GL
+  if (image_.plane_images_[0] || planar_import_failed_)
+    return image_;
+
+  uint32_t plane_formats[2];
+  if (format_ == DRM_FORMAT_NV12) {
+    plane_formats[0] = DRM_FORMAT_R8;
+    plane_formats[1] = DRM_FORMAT_GR88;
+  } else if (format_ == DRM_FORMAT_P010) {
+    plane_formats[0] = DRM_FORMAT_R16;
+    plane_formats[1] = DRM_FORMAT_GR1616;
+  } else {
+    return image_;
+  }
+
+  for (uint32_t i = 0; i < 2; i++) {
+    // Chroma is subsampled 2x2.
+    uint32_t width = i ? (width_ + 1) / 2 : width_;
+    uint32_t height = i ? (height_ + 1) / 2 : height_;
+    EGLint attr_list[] = {
+        EGL_WIDTH,                     static_cast<EGLint>(width),
+        EGL_HEIGHT,                    static_cast<EGLint>(height),
+        EGL_LINUX_DRM_FOURCC_EXT,      static_cast<EGLint>(plane_formats[i]),
+        EGL_DMA_BUF_PLANE0_FD_EXT,     static_cast<EGLint>(prime_fd_),
+        EGL_DMA_BUF_PLANE0_PITCH_EXT,  static_cast<EGLint>(pitches_[i]),
+        EGL_DMA_BUF_PLANE0_OFFSET_EXT, static_cast<EGLint>(offsets_[i]),
+#ifdef EGL_DMA_BUF_PLANE0_MODIFIER_LO_EXT
+        EGL_DMA_BUF_PLANE0_MODIFIER_LO_EXT,
+        static_cast<EGLint>(modifier_ & 0xFFFFFFFF),
+        EGL_DMA_BUF_PLANE0_MODIFIER_HI_EXT,
+        static_cast<EGLint>(modifier_ >> 32),
+#endif
+        EGL_NONE,                      0};
+    if (!modifier_)
+      attr_list[12] = EGL_NONE;
+
+    EGLImageKHR image =
+        eglCreateImageKHR(egl_display, EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT,
+                          static_cast<EGLClientBuffer>(nullptr), attr_list);
+    if (image == EGL_NO_IMAGE_KHR) {
+      ETRACE("Failed to import plane %u of buffer.", i);
+      if (i) {
+        glDeleteTextures(1, &image_.plane_textures_[0]);
+        eglDestroyImageKHR(egl_display, image_.plane_images_[0]);
+        image_.plane_textures_[0] = 0;
+        image_.plane_images_[0] = 0;
+      }
+
+      planar_import_failed_ = true;
+      return image_;
+    }
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, (GLeglImageOES)image);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    image_.plane_images_[i] = image;
+    image_.plane_textures_[i] = texture;
+  }
+#else
+  HWC_UNUSED(egl_display);
+#endif
+
+  return image_;
+}
+
 bool DrmBuffer::CreateFrameBuffer(uint32_t gpu_fd) {
   if (image_.drm_fd_) {
     return true;
@@ -328,8 +436,31 @@ bool DrmBuffer::CreateFrameBuffer(uint32_t gpu_fd) {
   image_.drm_fd_ = 0;
   media_image_.drm_fd_ = 0;
 
-  int ret = drmModeAddFB2(gpu_fd, width_, height_, frame_buffer_format_,
-                          gem_handles_, pitches_, offsets_, &image_.drm_fd_, 0);
+#ifdef USE_HEADLESS_WSI
+  // Nothing scans out the buffer, ids only need to be unique and non zero.
+  static std::atomic<uint32_t> next_fb_id(1);
+  image_.drm_fd_ = next_fb_id++;
+  media_image_.drm_fd_ = image_.drm_fd_;
+  return true;
+#endif
+
+  int ret = 0;
+  if (modifier_) {
+    // Every plane of the buffer, including the aux plane of compressed
+    // layouts, uses the same modifier.
+    uint64_t modifiers[4] = {0, 0, 0, 0};
+    for (uint32_t i = 0; i < 4; i++) {
+      if (gem_handles_[i])
+        modifiers[i] = modifier_;
+    }
+
+    ret = drmModeAddFB2WithModifiers(
+        gpu_fd, width_, height_, frame_buffer_format_, gem_handles_, pitches_,
+        offsets_, modifiers, &image_.drm_fd_, DRM_MODE_FB_MODIFIERS);
+  } else {
+    ret = drmModeAddFB2(gpu_fd, width_, height_, frame_buffer_format_,
+                        gem_handles_, pitches_, offsets_, &image_.drm_fd_, 0);
+  }
 
   if (ret) {
     ETRACE("drmModeAddFB2 error (%dx%d, %c%c%c%c, handle %d pitch %d) (%s)",
@@ -360,6 +491,7 @@ void DrmBuffer::Dump() {
   DUMPTRACE("Fb: %d", image_.drm_fd_);
   DUMPTRACE("Prime Handle: %d", prime_fd_);
   DUMPTRACE("Format: %4.4s", (char*)&format_);
+  DUMPTRACE("Modifier: %llx", (unsigned long long)modifier_);
   for (uint32_t i = 0; i < 4; i++) {
     DUMPTRACE("Pitch:%d value:%d", i, pitches_[i]);
     DUMPTRACE("Offset:%d value:%d", i, offsets_[i]);
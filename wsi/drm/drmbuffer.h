@@ -79,11 +79,17 @@ class DrmBuffer : public OverlayBuffer {
     return offsets_;
   }
 
+  uint64_t GetModifier() const override {
+    return modifier_;
+  }
+
   const ResourceHandle& GetGpuResource(GpuDisplay egl_display,
                                        bool external_import) override;
 
   const ResourceHandle& GetGpuResource() override;
 
+  const ResourceHandle& GetPlanarGpuResource(GpuDisplay egl_display) override;
+
   const MediaResourceHandle& GetMediaResource(MediaDisplay display,
                                               uint32_t width,
                                               uint32_t height) override;
@@ -102,8 +108,10 @@ class DrmBuffer : public OverlayBuffer {
   uint32_t offsets_[4];
   uint32_t gem_handles_[4];
   uint32_t prime_fd_ = 0;
+  uint64_t modifier_ = 0;
   HWCLayerType usage_ = kLayerNormal;
   uint32_t total_planes_ = 0;
+  bool planar_import_failed_ = false;
   uint32_t previous_width_ = 0;   // For Media usage.
   uint32_t previous_height_ = 0;  // For Media usage.
   ResourceManager* resource_manager_ = 0;
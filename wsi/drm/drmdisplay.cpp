@@ -36,6 +36,37 @@ namespace hwcomposer {
 
 static const int32_t kUmPerInch = 25400;
 
+// Maximum difference allowed between refresh rate and a multiple of
+// content rate for the mode to be considered a match.
+static const float kRefreshRateTolerance = 0.01f;
+
+static float GetRefreshRate(const drmModeModeInfo &mode) {
+  if (!mode.htotal || !mode.vtotal)
+    return 0;
+
+  float refresh = (mode.clock * 1000.0f) / (mode.htotal * mode.vtotal);
+
+  if (mode.flags & DRM_MODE_FLAG_INTERLACE)
+    refresh *= 2;
+
+  if (mode.flags & DRM_MODE_FLAG_DBLSCAN)
+    refresh /= 2;
+
+  if (mode.vscan > 1)
+    refresh /= mode.vscan;
+
+  return refresh;
+}
+
+static bool IsSameMode(const drmModeModeInfo &lhs, const drmModeModeInfo &rhs) {
+  return lhs.clock == rhs.clock && lhs.hdisplay == rhs.hdisplay &&
+         lhs.hsync_start == rhs.hsync_start && lhs.hsync_end == rhs.hsync_end &&
+         lhs.htotal == rhs.htotal && lhs.hskew == rhs.hskew &&
+         lhs.vdisplay == rhs.vdisplay && lhs.vsync_start == rhs.vsync_start &&
+         lhs.vsync_end == rhs.vsync_end && lhs.vtotal == rhs.vtotal &&
+         lhs.vscan == rhs.vscan && lhs.flags == rhs.flags;
+}
+
 DrmDisplay::DrmDisplay(uint32_t gpu_fd, uint32_t pipe_id, uint32_t crtc_id,
                        DrmDisplayManager *manager)
     : PhysicalDisplay(gpu_fd, pipe_id),
@@ -65,6 +96,7 @@ bool DrmDisplay::InitializeDisplay() {
   GetDrmObjectProperty("GAMMA_LUT", crtc_props, &lut_id_prop_);
   GetDrmObjectPropertyValue("GAMMA_LUT_SIZE", crtc_props, &lut_size_);
   GetDrmObjectProperty("OUT_FENCE_PTR", crtc_props, &out_fence_ptr_prop_);
+  GetDrmObjectProperty("VRR_ENABLED", crtc_props, &vrr_enabled_prop_);
 
   return true;
 }
@@ -90,6 +122,7 @@ bool DrmDisplay::ConnectDisplay(const drmModeModeInfo &mode_info,
   mmHeight_ = connector->mmHeight;
   SetDisplayAttribute(mode_info);
   config_ = config;
+  CheckSeamlessTakeover(mode_info, connector);
 
   ScopedDrmObjectPropertyPtr connector_props(drmModeObjectGetProperties(
       gpu_fd_, connector_, DRM_MODE_OBJECT_CONNECTOR));
@@ -123,6 +156,17 @@ bool DrmDisplay::ConnectDisplay(const drmModeModeInfo &mode_info,
   GetDrmObjectProperty("Broadcast RGB", connector_props, &broadcastrgb_id_);
   GetDrmObjectProperty("DPMS", connector_props, &dpms_prop_);
 
+  vrr_capable_ = false;
+  uint32_t count_props = connector_props->count_props;
+  for (uint32_t i = 0; i < count_props; i++) {
+    ScopedDrmPropertyPtr property(
+        drmModeGetProperty(gpu_fd_, connector_props->props[i]));
+    if (property && !strcmp(property->name, "vrr_capable")) {
+      vrr_capable_ = connector_props->prop_values[i] != 0;
+      break;
+    }
+  }
+
   PhysicalDisplay::Connect();
   SetHDCPState(desired_protection_support_);
 
@@ -151,6 +195,36 @@ bool DrmDisplay::ConnectDisplay(const drmModeModeInfo &mode_info,
   return true;
 }
 
+void DrmDisplay::CheckSeamlessTakeover(const drmModeModeInfo &mode_info,
+                                       const drmModeConnector *connector) {
+  seamless_takeover_ = false;
+  // Firmware or splash screen might have already lit up this pipe. If it's
+  // driving our connector with the mode we want, we can keep it running and
+  // avoid a full modeset.
+  ScopedDrmCrtcPtr crtc(drmModeGetCrtc(gpu_fd_, crtc_id_));
+  if (!crtc || !crtc->mode_valid || !crtc->buffer_id)
+    return;
+
+  if (!connector->encoder_id)
+    return;
+
+  ScopedDrmEncoderPtr encoder(drmModeGetEncoder(gpu_fd_, connector->encoder_id));
+  if (!encoder || encoder->crtc_id != crtc_id_)
+    return;
+
+  if (!IsSameMode(crtc->mode, mode_info)) {
+    IHOTPLUGEVENTTRACE(
+        "Current mode of crtc: %d doesn't match the preferred mode, needs "
+        "modeset.",
+        crtc_id_);
+    return;
+  }
+
+  IHOTPLUGEVENTTRACE("Taking over active pipe: %d crtc: %d fb: %d", pipe_,
+                     crtc_id_, crtc->buffer_id);
+  seamless_takeover_ = true;
+}
+
 bool DrmDisplay::GetDisplayAttribute(uint32_t config /*config*/,
                                      HWCDisplayAttribute attribute,
                                      int32_t *value) {
@@ -160,7 +234,6 @@ bool DrmDisplay::GetDisplayAttribute(uint32_t config /*config*/,
     return PhysicalDisplay::GetDisplayAttribute(config, attribute, value);
   }
 
-  float refresh;
   bool status = true;
   switch (attribute) {
     case HWCDisplayAttribute::kWidth:
@@ -170,19 +243,12 @@ bool DrmDisplay::GetDisplayAttribute(uint32_t config /*config*/,
       *value = modes_[config].vdisplay;
       break;
     case HWCDisplayAttribute::kRefreshRate:
-      refresh = (modes_[config].clock * 1000.0f) /
-                (modes_[config].htotal * modes_[config].vtotal);
-
-      if (modes_[config].flags & DRM_MODE_FLAG_INTERLACE)
-        refresh *= 2;
-
-      if (modes_[config].flags & DRM_MODE_FLAG_DBLSCAN)
-        refresh /= 2;
-
-      if (modes_[config].vscan > 1)
-        refresh /= modes_[config].vscan;
-      // in nanoseconds
-      *value = 1e9 / refresh;
+      // in nanoseconds, of the mode matching content rate if that's in use
+      if (config == config_ && applied_mode_ >= 0) {
+        *value = 1e9 / GetRefreshRate(modes_[applied_mode_]);
+      } else {
+        *value = 1e9 / GetRefreshRate(modes_[config]);
+      }
       break;
     case HWCDisplayAttribute::kDpiX:
       // Dots per 1000 inches
@@ -256,6 +322,8 @@ void DrmDisplay::UpdateDisplayConfig() {
   // update the activeConfig
   SPIN_LOCK(display_lock_);
   flags_ |= DRM_MODE_ATOMIC_ALLOW_MODESET;
+  seamless_takeover_ = false;
+  ResetContentRate();
   SetDisplayAttribute(modes_[config_]);
   SPIN_UNLOCK(display_lock_);
 }
@@ -263,6 +331,9 @@ void DrmDisplay::UpdateDisplayConfig() {
 void DrmDisplay::PowerOn() {
   flags_ = 0;
   flags_ |= DRM_MODE_ATOMIC_ALLOW_MODESET;
+  SPIN_LOCK(display_lock_);
+  ResetContentRate();
+  SPIN_UNLOCK(display_lock_);
   drmModeConnectorSetProperty(gpu_fd_, connector_, dpms_prop_,
                               DRM_MODE_DPMS_ON);
   IHOTPLUGEVENTTRACE("PowerOn: Powered on Pipe: %d display: %p", pipe_, this);
@@ -325,21 +396,54 @@ bool DrmDisplay::Commit(
     return false;
   }
 
+  uint32_t flags = flags_;
+  bool seamless = false;
+  int64_t vsync_period = 0;
   if (display_state_ & kNeedsModeset) {
-    if (!ApplyPendingModeset(pset.get())) {
+    if (seamless_takeover_) {
+      // Pipe is already running the mode we need, just replace the
+      // scanout buffer left behind by firmware.
+      seamless = true;
+      flags &= ~DRM_MODE_ATOMIC_ALLOW_MODESET;
+    } else if (!ApplyPendingModeset(pset.get())) {
       ETRACE("Failed to Modeset.");
       return false;
     }
-  } else if (!disable_explicit_fence && out_fence_ptr_prop_) {
-    GetFence(pset.get(), commit_fence);
+  } else {
+    if (!disable_explicit_fence && out_fence_ptr_prop_)
+      GetFence(pset.get(), commit_fence);
+
+    vsync_period = ApplyPendingContentRate(pset.get());
   }
 
   if (!CommitFrame(composition_planes, previous_composition_planes, pset.get(),
-                   flags_)) {
-    ETRACE("Failed to Commit layers.");
-    return false;
+                   flags)) {
+    if (!seamless) {
+      ETRACE("Failed to Commit layers.");
+      return false;
+    }
+
+    // Kernel refused to inherit the current pipe state. Fall back to a
+    // full modeset.
+    ETRACE("Seamless takeover failed for crtc %d, doing a full modeset.",
+           crtc_id_);
+    seamless_takeover_ = false;
+    pset.reset(drmModeAtomicAlloc());
+    if (!pset || !ApplyPendingModeset(pset.get())) {
+      ETRACE("Failed to Modeset.");
+      return false;
+    }
+
+    if (!CommitFrame(composition_planes, previous_composition_planes,
+                     pset.get(), flags_)) {
+      ETRACE("Failed to Commit layers.");
+      return false;
+    }
   }
 
+  seamless_takeover_ = false;
+  inherited_planes_.clear();
+
   if (display_state_ & kNeedsModeset) {
     display_state_ &= ~kNeedsModeset;
     if (!disable_explicit_fence) {
@@ -348,6 +452,70 @@ bool DrmDisplay::Commit(
     }
   }
 
+  if (vsync_period > 0)
+    display_queue_->VsyncPeriodChanged(vsync_period);
+
+  return true;
+}
+
+bool DrmDisplay::CommitCursor(DisplayPlane *display_plane,
+                              const OverlayLayer *layer, uint32_t zorder,
+                              bool position_only, int32_t *commit_fence) {
+  CTRACE();
+  *commit_fence = -1;
+  if (display_state_ & kNeedsModeset)
+    return false;
+
+  DrmPlane *plane = static_cast<DrmPlane *>(display_plane);
+  const HwcRect<int> &display_frame = layer->GetDisplayFrame();
+  // Legacy cursor planes can be moved without an atomic commit, this
+  // doesn't wait for commits still pending on the pipe.
+  if (position_only && !plane->IsUniversal()) {
+    if (!drmModeMoveCursor(gpu_fd_, crtc_id_, display_frame.left,
+                           display_frame.top))
+      return true;
+
+    IDISPLAYMANAGERTRACE("Failed to move cursor on crtc %d: %s", crtc_id_,
+                         PRINTERROR());
+  }
+
+  // Without explicit fencing every commit blocks, leave the update to the
+  // next frame rather than stalling the caller.
+  if (!(flags_ & DRM_MODE_ATOMIC_NONBLOCK))
+    return false;
+
+  ScopedDrmAtomicReqPtr pset(drmModeAtomicAlloc());
+  if (!pset) {
+    ETRACE("Failed to allocate property set %d", -ENOMEM);
+    return false;
+  }
+
+  if (out_fence_ptr_prop_)
+    GetFence(pset.get(), commit_fence);
+
+  int32_t fence = layer->GetAcquireFence();
+  if (fence > 0) {
+    plane->SetNativeFence(dup(fence));
+  } else {
+    plane->SetNativeFence(-1);
+  }
+
+  if (!plane->UpdateProperties(pset.get(), crtc_id_, layer, zorder))
+    return false;
+
+  int ret = drmModeAtomicCommit(gpu_fd_, pset.get(), DRM_MODE_ATOMIC_NONBLOCK,
+                                NULL);
+  if (ret) {
+    // EBUSY while the last frame is still waiting for its flip.
+    IDISPLAYMANAGERTRACE("Failed to commit cursor on crtc %d: %s", crtc_id_,
+                         PRINTERROR());
+    if (*commit_fence > 0)
+      close(*commit_fence);
+
+    *commit_fence = -1;
+    return false;
+  }
+
   return true;
 }
 
@@ -361,6 +529,7 @@ bool DrmDisplay::CommitFrame(
     return false;
   }
 
+  uint32_t zorder = 0;
   for (const DisplayPlaneState &comp_plane : comp_planes) {
     DrmPlane *plane = static_cast<DrmPlane *>(comp_plane.GetDisplayPlane());
     const OverlayLayer *layer = comp_plane.GetOverlayLayer();
@@ -370,7 +539,7 @@ bool DrmDisplay::CommitFrame(
     } else {
       plane->SetNativeFence(-1);
     }
-    if (!plane->UpdateProperties(pset, crtc_id_, layer))
+    if (!plane->UpdateProperties(pset, crtc_id_, layer, zorder++))
       return false;
   }
 
@@ -382,6 +551,14 @@ bool DrmDisplay::CommitFrame(
     plane->Disable(pset);
   }
 
+  // Turn off any planes left enabled by firmware which we are not using.
+  for (DrmPlane *plane : inherited_planes_) {
+    if (plane->InUse())
+      continue;
+
+    plane->Disable(pset);
+  }
+
   int ret = drmModeAtomicCommit(gpu_fd_, pset, flags, NULL);
   if (ret) {
     ETRACE("Failed to commit pset ret=%s\n", PRINTERROR());
@@ -395,6 +572,7 @@ void DrmDisplay::SetDrmModeInfo(const std::vector<drmModeModeInfo> &mode_info) {
   SPIN_LOCK(display_lock_);
   uint32_t size = mode_info.size();
   std::vector<drmModeModeInfo>().swap(modes_);
+  std::vector<uint32_t>().swap(rejected_modes_);
   for (uint32_t i = 0; i < size; ++i) {
     modes_.emplace_back(mode_info[i]);
   }
@@ -402,6 +580,20 @@ void DrmDisplay::SetDrmModeInfo(const std::vector<drmModeModeInfo> &mode_info) {
   SPIN_UNLOCK(display_lock_);
 }
 
+bool DrmDisplay::HasSameModes(const std::vector<drmModeModeInfo> &mode_info) {
+  SPIN_LOCK(display_lock_);
+  size_t size = mode_info.size();
+  bool same = modes_.size() == size;
+  for (size_t i = 0; same && i < size; ++i) {
+    same = IsSameMode(modes_[i], mode_info[i]) &&
+           ((modes_[i].type & DRM_MODE_TYPE_PREFERRED) ==
+            (mode_info[i].type & DRM_MODE_TYPE_PREFERRED));
+  }
+
+  SPIN_UNLOCK(display_lock_);
+  return same;
+}
+
 void DrmDisplay::SetDisplayAttribute(const drmModeModeInfo &mode_info) {
   width_ = mode_info.hdisplay;
   height_ = mode_info.vdisplay;
@@ -688,6 +880,13 @@ bool DrmDisplay::ApplyPendingModeset(drmModeAtomicReqPtr property_set) {
     return false;
   }
 
+  if (vrr_enabled_prop_ &&
+      drmModeAtomicAddProperty(property_set, crtc_id_, vrr_enabled_prop_, 0) <
+          0) {
+    ETRACE("Failed to add VRR_ENABLED property to pset");
+    return false;
+  }
+
   old_blob_id_ = blob_id_;
   blob_id_ = 0;
 
@@ -706,8 +905,134 @@ bool DrmDisplay::GetFence(drmModeAtomicReqPtr property_set,
   return true;
 }
 
+void DrmDisplay::UpdateContentRate(float rate) {
+  SPIN_LOCK(display_lock_);
+  if (vrr_capable_ && vrr_enabled_prop_) {
+    // Let presentation drive the refresh rate while video is playing.
+    requested_vrr_ = rate > 0;
+    SPIN_UNLOCK(display_lock_);
+    return;
+  }
+
+  requested_mode_ = -1;
+  if (rate > 0 && config_ < modes_.size()) {
+    const drmModeModeInfo &active = modes_[config_];
+    float best_refresh = 0;
+    size_t size = modes_.size();
+    for (size_t i = 0; i < size; i++) {
+      const drmModeModeInfo &mode = modes_[i];
+      if (mode.hdisplay != active.hdisplay ||
+          mode.vdisplay != active.vdisplay ||
+          (mode.flags & DRM_MODE_FLAG_INTERLACE) !=
+              (active.flags & DRM_MODE_FLAG_INTERLACE))
+        continue;
+
+      if (std::find(rejected_modes_.begin(), rejected_modes_.end(), i) !=
+          rejected_modes_.end())
+        continue;
+
+      // Refresh rate needs to be a multiple of content rate to avoid
+      // judder. Lowest one matching saves most power.
+      float refresh = GetRefreshRate(mode);
+      float multiple = std::round(refresh / rate);
+      if (multiple < 1 ||
+          std::fabs(refresh / rate - multiple) > multiple * kRefreshRateTolerance)
+        continue;
+
+      if (best_refresh == 0 || refresh < best_refresh) {
+        best_refresh = refresh;
+        requested_mode_ = i;
+      }
+    }
+
+    if (requested_mode_ == static_cast<int32_t>(config_))
+      requested_mode_ = -1;
+  }
+
+  IDISPLAYMANAGERTRACE("Content rate %f requested mode %d for pipe %d", rate,
+                       requested_mode_, pipe_);
+  SPIN_UNLOCK(display_lock_);
+}
+
+void DrmDisplay::ResetContentRate() {
+  requested_mode_ = -1;
+  applied_mode_ = -1;
+  requested_vrr_ = false;
+  vrr_enabled_ = false;
+}
+
+bool DrmDisplay::TestSeamlessUpdate(uint32_t object_id, uint32_t property_id,
+                                    uint64_t value) const {
+  ScopedDrmAtomicReqPtr pset(drmModeAtomicAlloc());
+  if (!pset)
+    return false;
+
+  if (drmModeAtomicAddProperty(pset.get(), object_id, property_id, value) < 0)
+    return false;
+
+  // No ALLOW_MODESET, kernel will refuse if this would need a full modeset.
+  return drmModeAtomicCommit(gpu_fd_, pset.get(), DRM_MODE_ATOMIC_TEST_ONLY,
+                             NULL) == 0;
+}
+
+int64_t DrmDisplay::ApplyPendingContentRate(
+    drmModeAtomicReqPtr property_set) {
+  SPIN_LOCK(display_lock_);
+  if (requested_vrr_ != vrr_enabled_) {
+    if (TestSeamlessUpdate(crtc_id_, vrr_enabled_prop_, requested_vrr_) &&
+        drmModeAtomicAddProperty(property_set, crtc_id_, vrr_enabled_prop_,
+                                 requested_vrr_) >= 0) {
+      vrr_enabled_ = requested_vrr_;
+    } else {
+      ETRACE("Unable to toggle VRR without modeset on pipe %d", pipe_);
+      vrr_capable_ = false;
+      requested_vrr_ = vrr_enabled_;
+    }
+  }
+
+  if (requested_mode_ == applied_mode_ || config_ >= modes_.size()) {
+    SPIN_UNLOCK(display_lock_);
+    return 0;
+  }
+
+  const drmModeModeInfo &mode =
+      requested_mode_ < 0 ? modes_[config_] : modes_[requested_mode_];
+  uint32_t blob_id = 0;
+  drmModeCreatePropertyBlob(gpu_fd_, &mode, sizeof(drmModeModeInfo), &blob_id);
+  if (blob_id == 0) {
+    SPIN_UNLOCK(display_lock_);
+    return 0;
+  }
+
+  if (!TestSeamlessUpdate(crtc_id_, mode_id_prop_, blob_id) ||
+      drmModeAtomicAddProperty(property_set, crtc_id_, mode_id_prop_,
+                               blob_id) < 0) {
+    IDISPLAYMANAGERTRACE("Mode %d needs a full modeset, not using it.",
+                         requested_mode_);
+    drmModeDestroyPropertyBlob(gpu_fd_, blob_id);
+    if (requested_mode_ >= 0)
+      rejected_modes_.emplace_back(requested_mode_);
+
+    requested_mode_ = applied_mode_;
+    SPIN_UNLOCK(display_lock_);
+    return 0;
+  }
+
+  // Kernel keeps a reference to the blob in use.
+  if (old_blob_id_)
+    drmModeDestroyPropertyBlob(gpu_fd_, old_blob_id_);
+
+  old_blob_id_ = blob_id;
+  applied_mode_ = requested_mode_;
+  int64_t vsync_period = 1e9 / GetRefreshRate(mode);
+  SPIN_UNLOCK(display_lock_);
+  return vsync_period;
+}
+
 void DrmDisplay::Disable(const DisplayPlaneStateList &composition_planes) {
   IHOTPLUGEVENTTRACE("Disable: Disabling Display: %p", this);
+  seamless_takeover_ = false;
+  inherited_planes_.clear();
 
   for (const DisplayPlaneState &comp_plane : composition_planes) {
     DrmPlane *plane = static_cast<DrmPlane *>(comp_plane.GetDisplayPlane());
@@ -731,6 +1056,7 @@ bool DrmDisplay::PopulatePlanes(
   uint32_t pipe_bit = 1 << pipe_;
   std::set<uint32_t> plane_ids;
   std::unique_ptr<DisplayPlane> cursor_plane;
+  inherited_planes_.clear();
   for (uint32_t i = 0; i < num_planes; ++i) {
     ScopedDrmPlanePtr drm_plane(
         drmModeGetPlane(gpu_fd_, plane_resources->planes[i]));
@@ -751,6 +1077,9 @@ bool DrmDisplay::PopulatePlanes(
       supported_formats[j] = drm_plane->formats[j];
 
     if (plane->Initialize(gpu_fd_, supported_formats)) {
+      if (drm_plane->crtc_id == crtc_id_ && drm_plane->fb_id)
+        inherited_planes_.emplace_back(plane.get());
+
       if (plane->type() == DRM_PLANE_TYPE_CURSOR) {
         cursor_plane.reset(plane.release());
       } else {
@@ -798,7 +1127,9 @@ bool DrmDisplay::TestCommit(
   ScopedDrmAtomicReqPtr pset(drmModeAtomicAlloc());
   for (auto i = commit_planes.begin(); i != commit_planes.end(); i++) {
     DrmPlane *plane = static_cast<DrmPlane *>(i->plane);
-    if (!(plane->UpdateProperties(pset.get(), crtc_id_, i->layer, true))) {
+    uint32_t zorder = i - commit_planes.begin();
+    if (!(plane->UpdateProperties(pset.get(), crtc_id_, i->layer, zorder,
+                                  true))) {
       return false;
     }
   }
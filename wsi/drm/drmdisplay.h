@@ -53,6 +53,7 @@ class DrmDisplay : public PhysicalDisplay {
   bool InitializeDisplay() override;
   void PowerOn() override;
   void UpdateDisplayConfig() override;
+  void UpdateContentRate(float rate) override;
   void SetColorCorrection(struct gamma_colors gamma, uint32_t contrast,
                           uint32_t brightness) const override;
   void SetColorTransformMatrix(const float *color_transform_matrix,
@@ -61,15 +62,25 @@ class DrmDisplay : public PhysicalDisplay {
   bool Commit(const DisplayPlaneStateList &composition_planes,
               const DisplayPlaneStateList &previous_composition_planes,
               bool disable_explicit_fence, int32_t *commit_fence) override;
+  bool CommitCursor(DisplayPlane *plane, const OverlayLayer *layer,
+                    uint32_t zorder, bool position_only,
+                    int32_t *commit_fence) override;
 
   uint32_t CrtcId() const {
     return crtc_id_;
   }
 
+  uint32_t ConnectorId() const {
+    return connector_;
+  }
+
   bool ConnectDisplay(const drmModeModeInfo &mode_info,
                       const drmModeConnector *connector, uint32_t config);
 
   void SetDrmModeInfo(const std::vector<drmModeModeInfo> &mode_info);
+  // Returns true if mode_info matches the modes currently supported
+  // by this display.
+  bool HasSameModes(const std::vector<drmModeModeInfo> &mode_info);
   void SetDisplayAttribute(const drmModeModeInfo &mode_info);
 
   bool TestCommit(
@@ -88,6 +99,8 @@ class DrmDisplay : public PhysicalDisplay {
 
  private:
   void ShutDownPipe();
+  void CheckSeamlessTakeover(const drmModeModeInfo &mode_info,
+                             const drmModeConnector *connector);
   void GetDrmObjectPropertyValue(const char *name,
                                  const ScopedDrmObjectPropertyPtr &props,
                                  uint64_t *value) const;
@@ -106,6 +119,13 @@ class DrmDisplay : public PhysicalDisplay {
                        struct drm_color_ctm_post_offset *ctm_post_offset) const;
   void ApplyPendingLUT(struct drm_color_lut *lut) const;
   bool ApplyPendingModeset(drmModeAtomicReqPtr property_set);
+  // Returns the vsync period in ns of the mode switched to, 0 if the
+  // mode didn't change.
+  int64_t ApplyPendingContentRate(drmModeAtomicReqPtr property_set);
+  void ResetContentRate();
+  // Returns true if property can be changed without a full modeset.
+  bool TestSeamlessUpdate(uint32_t object_id, uint32_t property_id,
+                          uint64_t value) const;
   bool GetFence(drmModeAtomicReqPtr property_set, int32_t *out_fence);
   bool CommitFrame(const DisplayPlaneStateList &comp_planes,
                    const DisplayPlaneStateList &previous_composition_planes,
@@ -128,17 +148,31 @@ class DrmDisplay : public PhysicalDisplay {
   uint32_t active_prop_ = 0;
   uint32_t mode_id_prop_ = 0;
   uint32_t hdcp_id_prop_ = 0;
+  uint32_t vrr_enabled_prop_ = 0;
   uint32_t connector_ = 0;
   uint64_t lut_size_ = 0;
   int64_t broadcastrgb_full_ = -1;
   int64_t broadcastrgb_automatic_ = -1;
   uint32_t flags_ = DRM_MODE_ATOMIC_ALLOW_MODESET;
+  // Pipe was left running by firmware with the mode we need, first
+  // commit can skip the modeset.
+  bool seamless_takeover_ = false;
   HWCContentProtection current_protection_support_ =
       HWCContentProtection::kUnSupported;
   HWCContentProtection desired_protection_support_ =
       HWCContentProtection::kUnSupported;
   drmModeModeInfo current_mode_;
   std::vector<drmModeModeInfo> modes_;
+  // Mode matching content rate, -1 if mode of active config is used.
+  int32_t requested_mode_ = -1;
+  int32_t applied_mode_ = -1;
+  // Modes which can't be switched to without a full modeset.
+  std::vector<uint32_t> rejected_modes_;
+  bool vrr_capable_ = false;
+  bool requested_vrr_ = false;
+  bool vrr_enabled_ = false;
+  // Planes which were scanning out on this pipe before we took over.
+  std::vector<DrmPlane *> inherited_planes_;
   SpinLock display_lock_;
   DrmDisplayManager *manager_;
 };
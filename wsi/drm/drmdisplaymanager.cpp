@@ -19,6 +19,7 @@
 #include <stdlib.h>
 #include <time.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/socket.h>
@@ -31,6 +32,10 @@
 #include <linux/types.h>
 #include <linux/netlink.h>
 
+#include <algorithm>
+#include <chrono>
+#include <map>
+
 #include <hwctrace.h>
 #include <gpudevice.h>
 
@@ -45,6 +50,9 @@ DrmDisplayManager::DrmDisplayManager(GpuDevice *device)
 
 DrmDisplayManager::~DrmDisplayManager() {
   CTRACE();
+  if (probe_thread_.joinable())
+    probe_thread_.join();
+
   std::vector<std::unique_ptr<DrmDisplay>>().swap(displays_);
 #ifndef DISABLE_HOTPLUG_NOTIFICATION
   close(hotplug_fd_);
@@ -75,6 +83,17 @@ bool DrmDisplayManager::Initialize() {
   }
 
   ScopedDrmResourcesPtr res(drmModeGetResources(fd_));
+  if (!res) {
+    ETRACE("Failed to get DrmResources resources");
+    return false;
+  }
+
+  // Start probing connectors right away. Probing may need to read EDID
+  // which is slow, let it overlap with rest of the initialization.
+  std::vector<uint32_t> connector_ids(res->connectors,
+                                      res->connectors + res->count_connectors);
+  probe_thread_ = std::thread(&DrmDisplayManager::ProbeInitialConnectors,
+                              this, connector_ids);
 
   for (int32_t i = 0; i < res->count_crtcs; ++i) {
     ScopedDrmCrtcPtr c(drmModeGetCrtc(fd_, res->crtcs[i]));
@@ -119,18 +138,47 @@ void DrmDisplayManager::HotPlugEventHandler() {
   CTRACE();
   int fd = hotplug_fd_;
   char buffer[DRM_HOTPLUG_EVENT_SIZE];
-  int ret;
+  ssize_t ret;
+  bool hotplug_received = false;
+  bool full_update = false;
+  // Connectors to update and whether they need to be re-probed.
+  std::map<uint32_t, bool> connectors;
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
 
   memset(&buffer, 0, sizeof(buffer));
   while (true) {
-    bool drm_event = false, hotplug_event = false;
+    bool drm_event = false, hotplug_event = false, property_event = false;
+    uint32_t connector_id = 0;
     size_t srclen = DRM_HOTPLUG_EVENT_SIZE - 1;
-    ret = read(fd, &buffer, srclen);
+    ret = recv(fd, &buffer, srclen, MSG_DONTWAIT);
     if (ret <= 0) {
-      if (ret < 0)
+      if (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
         ETRACE("Failed to read uevent. %s", PRINTERROR());
+        break;
+      }
 
-      return;
+      if (!hotplug_received)
+        return;
+
+      // Plugging or unplugging a cable usually results in a burst of
+      // events. Wait for things to settle before probing anything.
+      int elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+      if (elapsed >= DRM_HOTPLUG_MAX_DEBOUNCE_MS)
+        break;
+
+      struct pollfd pfd;
+      pfd.fd = fd;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      int timeout = std::min(DRM_HOTPLUG_DEBOUNCE_MS,
+                             DRM_HOTPLUG_MAX_DEBOUNCE_MS - elapsed);
+      if (poll(&pfd, 1, timeout) <= 0)
+        break;
+
+      continue;
     }
 
     buffer[ret] = '\0';
@@ -143,20 +191,48 @@ void DrmDisplayManager::HotPlugEventHandler() {
                !strcmp(event,
                        "HDMI-Change")) {  // Hotplug happened during suspend
         hotplug_event = true;
+      } else if (!strncmp(event, "CONNECTOR=", strlen("CONNECTOR="))) {
+        connector_id = atoi(event + strlen("CONNECTOR="));
+      } else if (!strncmp(event, "PROPERTY=", strlen("PROPERTY="))) {
+        property_event = true;
       }
 
-      if (hotplug_event && drm_event)
-        break;
-
       i += strlen(event) + 1;
     }
 
-    if (drm_event && hotplug_event) {
-      IHOTPLUGEVENTTRACE(
-          "Recieved Hot Plug event related to display calling "
-          "UpdateDisplayState.");
-      UpdateDisplayState();
+    if (!(drm_event && hotplug_event))
+      continue;
+
+    hotplug_received = true;
+    if (!connector_id) {
+      // Kernel didn't tell us which connector changed.
+      full_update = true;
+      continue;
     }
+
+    // Property change on a connector doesn't change connection
+    // status, no need to probe it again.
+    bool &needs_probe = connectors[connector_id];
+    needs_probe |= !property_event;
+  }
+
+  if (!hotplug_received)
+    return;
+
+  if (full_update) {
+    IHOTPLUGEVENTTRACE(
+        "Recieved Hot Plug event related to display calling "
+        "UpdateDisplayState.");
+    UpdateDisplayState();
+    return;
+  }
+
+  for (const std::pair<const uint32_t, bool> &connector : connectors) {
+    IHOTPLUGEVENTTRACE(
+        "Recieved Hot Plug event for connector %d calling "
+        "UpdateConnectorState.",
+        connector.first);
+    UpdateConnectorState(connector.first, !connector.second);
   }
 }
 
@@ -182,6 +258,7 @@ void DrmDisplayManager::InitializeDisplayResources() {
 
   virtual_display_.reset(new VirtualDisplay(fd_, buffer_handler_.get(), 0, 0));
   nested_display_.reset(new NestedDisplay());
+  nested_display_->Initialize(buffer_handler_.get());
 }
 
 void DrmDisplayManager::StartHotPlugMonitor() {
@@ -204,30 +281,266 @@ void DrmDisplayManager::HandleRoutine() {
   }
 }
 
+drmModeConnectorPtr DrmDisplayManager::GetCachedConnector(int fd,
+                                                          uint32_t id) {
+  // Connection status is kept up to date by the kernel on hotplug, only
+  // connectors it hasn't probed yet or without modes need a new probe.
+  drmModeConnectorPtr connector = drmModeGetConnectorCurrent(fd, id);
+  if (connector &&
+      (connector->connection == DRM_MODE_UNKNOWNCONNECTION ||
+       (connector->connection == DRM_MODE_CONNECTED &&
+        connector->count_modes == 0))) {
+    drmModeFreeConnector(connector);
+    connector = NULL;
+  }
+
+  return connector;
+}
+
+drmModeConnectorPtr DrmDisplayManager::ProbeConnector(int fd, uint32_t id,
+                                                  bool use_cached_state) {
+  drmModeConnectorPtr connector = NULL;
+  if (use_cached_state)
+    connector = GetCachedConnector(fd, id);
+
+  if (!connector)
+    connector = drmModeGetConnector(fd, id);
+
+  return connector;
+}
+
+void DrmDisplayManager::ProbeConnectors(
+    int fd, const std::vector<uint32_t> &connector_ids, bool use_cached_state,
+    std::vector<ScopedDrmConnectorPtr> *connectors) {
+  connectors->clear();
+  for (uint32_t id : connector_ids) {
+    drmModeConnectorPtr connector = ProbeConnector(fd, id, use_cached_state);
+    if (!connector) {
+      ETRACE("Failed to get connector %d", id);
+      continue;
+    }
+
+    connectors->emplace_back(connector);
+  }
+}
+
+void DrmDisplayManager::ProbeInitialConnectors(
+    std::vector<uint32_t> connector_ids) {
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  // State already known to kernel goes first, displays lit by firmware
+  // don't need to wait for EDID reads of other connectors.
+  std::vector<ScopedDrmConnectorPtr> connectors;
+  std::vector<uint32_t> needs_probe;
+  for (uint32_t id : connector_ids) {
+    drmModeConnectorPtr connector = GetCachedConnector(fd_, id);
+    if (connector) {
+      connectors.emplace_back(connector);
+    } else {
+      needs_probe.emplace_back(id);
+    }
+  }
+
+  ISTARTUPTRACE(
+      "Read cached state of %zu connectors in(usec): %lld",
+      connectors.size(),
+      static_cast<long long>(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count()));
+  PublishProbedConnectors(connectors, needs_probe.empty());
+
+  // Probes are serialized by the kernel, one at a time is as fast as
+  // several threads. Each display is connected as soon as it's probed,
+  // once the primary one is like on hotplug.
+  size_t total_probes = needs_probe.size();
+  for (size_t i = 0; i < total_probes; ++i) {
+    ProbeConnectors(fd_, std::vector<uint32_t>(1, needs_probe.at(i)), false,
+                    &connectors);
+    if (PublishProbedConnectors(connectors, i + 1 == total_probes))
+      continue;
+
+    for (ScopedDrmConnectorPtr &connector : connectors) {
+      UpdateConnector(connector.get());
+    }
+
+    connectors.clear();
+  }
+
+  ISTARTUPTRACE(
+      "Probed %zu connectors in(usec): %lld", total_probes,
+      static_cast<long long>(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count()));
+}
+
+bool DrmDisplayManager::PublishProbedConnectors(
+    std::vector<ScopedDrmConnectorPtr> &connectors, bool complete) {
+  std::lock_guard<std::mutex> lock(probe_lock_);
+  if (primary_connected_)
+    return false;
+
+  for (ScopedDrmConnectorPtr &connector : connectors) {
+    probed_connectors_.emplace_back(std::move(connector));
+  }
+
+  connectors.clear();
+  probe_batches_++;
+  probe_complete_ = complete;
+  probe_changed_.notify_one();
+  return true;
+}
+
+void DrmDisplayManager::GetConnectorModes(const drmModeConnector *connector,
+                                          std::vector<drmModeModeInfo> *modes,
+                                          uint32_t *preferred_mode) {
+  uint32_t size = connector->count_modes;
+  modes->resize(size);
+  *preferred_mode = 0;
+  for (uint32_t i = 0; i < size; ++i) {
+    modes->at(i) = connector->modes[i];
+    // There is only one preferred mode per connector.
+    if (connector->modes[i].type & DRM_MODE_TYPE_PREFERRED) {
+      *preferred_mode = i;
+    }
+  }
+}
+
+bool DrmDisplayManager::ConnectToCurrentCrtc(
+    const drmModeConnector *connector) {
+  std::vector<drmModeModeInfo> mode;
+  uint32_t preferred_mode = 0;
+  GetConnectorModes(connector, &mode, &preferred_mode);
+
+  // Lets try to find crts for any connected encoder.
+  ScopedDrmEncoderPtr encoder(drmModeGetEncoder(fd_, connector->encoder_id));
+  if (!encoder || !encoder->crtc_id)
+    return false;
+
+  for (auto &display : displays_) {
+    IHOTPLUGEVENTTRACE(
+        "Trying to connect %d with crtc: %d is display connected: %d \n",
+        encoder->crtc_id, display->CrtcId(), display->IsConnected());
+    // At initilaization  preferred mode is set!
+    if (!display->IsConnected() && encoder->crtc_id == display->CrtcId() &&
+        display->ConnectDisplay(mode.at(preferred_mode), connector,
+                                preferred_mode)) {
+      IHOTPLUGEVENTTRACE("Connected %d with crtc: %d pipe:%d \n",
+                         encoder->crtc_id, display->CrtcId(),
+                         display->GetDisplayPipe());
+      // Set the modes supported for each display
+      display->SetDrmModeInfo(mode);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool DrmDisplayManager::ConnectToFreeCrtc(const drmModeConnector *connector) {
+  std::vector<drmModeModeInfo> mode;
+  uint32_t preferred_mode = 0;
+  GetConnectorModes(connector, &mode, &preferred_mode);
+
+  // Try to find an encoder for the connector.
+  uint32_t size = connector->count_encoders;
+  for (uint32_t j = 0; j < size; ++j) {
+    ScopedDrmEncoderPtr encoder(drmModeGetEncoder(fd_, connector->encoders[j]));
+    if (!encoder)
+      continue;
+
+    for (auto &display : displays_) {
+      if (!display->IsConnected() &&
+          (encoder->possible_crtcs & (1 << display->GetDisplayPipe())) &&
+          display->ConnectDisplay(mode.at(preferred_mode), connector,
+                                  preferred_mode)) {
+        IHOTPLUGEVENTTRACE("Connected with crtc: %d pipe:%d \n",
+                           display->CrtcId(), display->GetDisplayPipe());
+        // Set the modes supported for each display
+        display->SetDrmModeInfo(mode);
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
 bool DrmDisplayManager::UpdateDisplayState() {
   CTRACE();
+  probe_lock_.lock();
+  bool initial_probe = probe_thread_.joinable() && !primary_connected_;
+  probe_lock_.unlock();
+  if (initial_probe) {
+    // Initial probe was started during Initialize.
+    ConnectProbedDisplays();
+    return true;
+  }
+
   ScopedDrmResourcesPtr res(drmModeGetResources(fd_));
   if (!res) {
     ETRACE("Failed to get DrmResources resources");
     return false;
   }
 
-  spin_lock_.lock();
-  // Start of assuming no displays are connected
-  for (auto &display : displays_) {
-    display->MarkForDisconnect();
+  std::vector<uint32_t> connector_ids(res->connectors,
+                                      res->connectors + res->count_connectors);
+  std::vector<ScopedDrmConnectorPtr> connectors;
+  ProbeConnectors(fd_, connector_ids, false, &connectors);
+  ConnectDisplays(connectors, true);
+  return true;
+}
+
+void DrmDisplayManager::ConnectProbedDisplays() {
+  uint32_t batches = 0;
+  bool connected = false;
+  bool complete = false;
+  while (!connected && !complete) {
+    std::vector<ScopedDrmConnectorPtr> connectors;
+    bool first_batch = batches == 0;
+    {
+      std::unique_lock<std::mutex> lock(probe_lock_);
+      probe_changed_.wait(
+          lock, [this, batches] { return probe_batches_ > batches; });
+      batches = probe_batches_;
+      complete = probe_complete_;
+      connectors.swap(probed_connectors_);
+    }
+
+    // Later batches only add displays to those connected by the first.
+    for (ScopedDrmConnectorPtr &connector : connectors) {
+      connected |= connector->connection == DRM_MODE_CONNECTED;
+    }
+
+    if (first_batch || connected)
+      ConnectDisplays(connectors, first_batch);
   }
 
-  std::vector<NativeDisplay *> connected_displays;
-  std::vector<uint32_t> no_encoder;
-  uint32_t total_connectors = res->count_connectors;
-  for (uint32_t i = 0; i < total_connectors; ++i) {
-    ScopedDrmConnectorPtr connector(
-        drmModeGetConnector(fd_, res->connectors[i]));
-    if (!connector) {
-      ETRACE("Failed to get connector %d", res->connectors[i]);
-      break;
+  // Primary display is up, probe thread connects the rest like hotplug
+  // does. Anything it published meanwhile is left to us.
+  std::vector<ScopedDrmConnectorPtr> connectors;
+  probe_lock_.lock();
+  primary_connected_ = true;
+  connectors.swap(probed_connectors_);
+  probe_lock_.unlock();
+  for (ScopedDrmConnectorPtr &connector : connectors) {
+    UpdateConnector(connector.get());
+  }
+}
+
+void DrmDisplayManager::ConnectDisplays(
+    std::vector<ScopedDrmConnectorPtr> &connectors, bool disconnect_others) {
+  spin_lock_.lock();
+  if (disconnect_others) {
+    // Start of assuming no displays are connected
+    for (auto &display : displays_) {
+      display->MarkForDisconnect();
     }
+  }
+
+  std::vector<drmModeConnector *> no_current_crtc;
+  for (ScopedDrmConnectorPtr &connector : connectors) {
     // check if a monitor is connected.
     if (connector->connection != DRM_MODE_CONNECTED)
       continue;
@@ -236,90 +549,78 @@ bool DrmDisplayManager::UpdateDisplayState() {
     if (connector->count_modes == 0)
       continue;
 
-    if (connector->encoder_id == 0) {
-      no_encoder.emplace_back(i);
-      continue;
-    }
+    if (!connector->encoder_id || !ConnectToCurrentCrtc(connector.get()))
+      no_current_crtc.emplace_back(connector.get());
+  }
 
-    std::vector<drmModeModeInfo> mode;
-    uint32_t preferred_mode = 0;
-    uint32_t size = connector->count_modes;
-    mode.resize(size);
-    for (uint32_t i = 0; i < size; ++i) {
-      mode[i] = connector->modes[i];
-      // There is only one preferred mode per connector.
-      if (mode[i].type & DRM_MODE_TYPE_PREFERRED) {
-        preferred_mode = i;
-      }
-    }
+  // Deal with connectors whose crtc, if any, is taken only once all
+  // others kept theirs.
+  for (drmModeConnector *connector : no_current_crtc) {
+    ConnectToFreeCrtc(connector);
+  }
 
-    // Lets try to find crts for any connected encoder.
-    ScopedDrmEncoderPtr encoder(drmModeGetEncoder(fd_, connector->encoder_id));
-    if (encoder && encoder->crtc_id) {
-      for (auto &display : displays_) {
-        IHOTPLUGEVENTTRACE(
-            "Trying to connect %d with crtc: %d is display connected: %d \n",
-            encoder->crtc_id, display->CrtcId(), display->IsConnected());
-        // At initilaization  preferred mode is set!
-        if (!display->IsConnected() && encoder->crtc_id == display->CrtcId() &&
-            display->ConnectDisplay(mode.at(preferred_mode), connector.get(),
-                                    preferred_mode)) {
-          IHOTPLUGEVENTTRACE("Connected %d with crtc: %d pipe:%d \n",
-                             encoder->crtc_id, display->CrtcId(),
-                             display->GetDisplayPipe());
-          // Set the modes supported for each display
-          display->SetDrmModeInfo(mode);
-          break;
-        }
-      }
-    }
+  CompleteDisplayStateUpdate();
+}
+
+bool DrmDisplayManager::UpdateConnectorState(uint32_t connector_id,
+                                             bool use_cached_state) {
+  CTRACE();
+  // Probe without holding the lock, this can be slow and other
+  // displays should be able to continue presenting meanwhile.
+  ScopedDrmConnectorPtr connector(
+      ProbeConnector(fd_, connector_id, use_cached_state));
+  if (!connector) {
+    ETRACE("Failed to get connector %d", connector_id);
+    return false;
   }
 
-  // Deal with connectors with encoder_id == 0.
-  uint32_t size = no_encoder.size();
-  for (uint32_t i = 0; i < size; ++i) {
-    ScopedDrmConnectorPtr connector(
-        drmModeGetConnector(fd_, res->connectors[no_encoder.at(i)]));
-    if (!connector) {
-      ETRACE("Failed to get connector %d", res->connectors[i]);
+  UpdateConnector(connector.get());
+  return true;
+}
+
+void DrmDisplayManager::UpdateConnector(drmModeConnector *connector) {
+  uint32_t connector_id = connector->connector_id;
+  bool connected = connector->connection == DRM_MODE_CONNECTED &&
+                   connector->count_modes > 0;
+
+  spin_lock_.lock();
+  DrmDisplay *current = NULL;
+  for (auto &display : displays_) {
+    if (display->IsConnected() && display->ConnectorId() == connector_id) {
+      current = display.get();
       break;
     }
+  }
 
+  if (!current && !connected) {
+    spin_lock_.unlock();
+    return;
+  }
+
+  if (current && connected) {
     std::vector<drmModeModeInfo> mode;
     uint32_t preferred_mode = 0;
-    uint32_t size = connector->count_modes;
-    mode.resize(size);
-    for (uint32_t i = 0; i < size; ++i) {
-      mode[i] = connector->modes[i];
-      // There is only one preferred mode per connector.
-      if (mode[i].type & DRM_MODE_TYPE_PREFERRED) {
-        preferred_mode = i;
-      }
+    GetConnectorModes(connector, &mode, &preferred_mode);
+    if (current->HasSameModes(mode)) {
+      IHOTPLUGEVENTTRACE("No changes for connector %d \n", connector_id);
+      spin_lock_.unlock();
+      return;
     }
+  }
 
-    // Try to find an encoder for the connector.
-    size = connector->count_encoders;
-    for (uint32_t j = 0; j < size; ++j) {
-      ScopedDrmEncoderPtr encoder(
-          drmModeGetEncoder(fd_, connector->encoders[j]));
-      if (!encoder)
-        continue;
-
-      for (auto &display : displays_) {
-        if (!display->IsConnected() &&
-            (encoder->possible_crtcs & (1 << display->GetDisplayPipe())) &&
-            display->ConnectDisplay(mode.at(preferred_mode), connector.get(),
-                                    preferred_mode)) {
-          IHOTPLUGEVENTTRACE("Connected with crtc: %d pipe:%d \n",
-                             display->CrtcId(), display->GetDisplayPipe());
-          // Set the modes supported for each display
-          display->SetDrmModeInfo(mode);
-          break;
-        }
-      }
-    }
+  if (current)
+    current->MarkForDisconnect();
+
+  if (connected) {
+    if (!connector->encoder_id || !ConnectToCurrentCrtc(connector))
+      ConnectToFreeCrtc(connector);
   }
 
+  CompleteDisplayStateUpdate();
+}
+
+void DrmDisplayManager::CompleteDisplayStateUpdate() {
+  std::vector<NativeDisplay *> connected_displays;
   for (auto &display : displays_) {
     if (!display->IsConnected()) {
       display->DisConnect();
@@ -348,8 +649,6 @@ bool DrmDisplayManager::UpdateDisplayState() {
     nested_display_->HotPlugUpdate(true);
     nested_display_registered = true;
   }
-
-  return true;
 }
 
 void DrmDisplayManager::NotifyClientsOfDisplayChangeStatus() {
@@ -427,8 +726,10 @@ void DrmDisplayManager::HandleLazyInitialization() {
   spin_lock_.unlock();
 }
 
+#ifndef USE_HEADLESS_WSI
 DisplayManager *DisplayManager::CreateDisplayManager(GpuDevice *device) {
   return new DrmDisplayManager(device);
 }
+#endif
 
 }  // namespace hwcomposer
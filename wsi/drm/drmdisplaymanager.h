@@ -19,7 +19,10 @@
 
 #include <stdint.h>
 
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -37,6 +40,10 @@
 namespace hwcomposer {
 
 #define DRM_HOTPLUG_EVENT_SIZE 256
+// Time to wait for more uevents before handling a hotplug.
+#define DRM_HOTPLUG_DEBOUNCE_MS 100
+// Upper limit on how long a burst of uevents can delay handling.
+#define DRM_HOTPLUG_MAX_DEBOUNCE_MS 500
 
 class NativeDisplay;
 
@@ -74,11 +81,60 @@ class DrmDisplayManager : public HWCThread, public DisplayManager {
  private:
   void HotPlugEventHandler();
   bool UpdateDisplayState();
+  // Re-probes only the given connector and updates the display
+  // using it. Other displays are left untouched.
+  bool UpdateConnectorState(uint32_t connector_id, bool use_cached_state);
+  // Updates the display using connector, which was just probed.
+  void UpdateConnector(drmModeConnector *connector);
+  // Disconnects displays which lost their connector and notifies
+  // clients. Expects spin_lock_ to be held and releases it.
+  void CompleteDisplayStateUpdate();
+  bool ConnectToCurrentCrtc(const drmModeConnector *connector);
+  bool ConnectToFreeCrtc(const drmModeConnector *connector);
+  static void GetConnectorModes(const drmModeConnector *connector,
+                                std::vector<drmModeModeInfo> *modes,
+                                uint32_t *preferred_mode);
+  // Connects displays of connectors which are connected. If
+  // disconnect_others is true, displays of other connectors are
+  // disconnected, otherwise they are left as they are.
+  void ConnectDisplays(std::vector<ScopedDrmConnectorPtr> &connectors,
+                       bool disconnect_others);
+  // Connects displays of the initial probe until the primary one is,
+  // the probe thread then connects the rest through UpdateConnector.
+  void ConnectProbedDisplays();
+  // Returns connector state already known to kernel, NULL if it needs to
+  // be probed to be of any use.
+  static drmModeConnectorPtr GetCachedConnector(int fd, uint32_t id);
+  // If use_cached_state is true, connector state already known to
+  // kernel is used instead of forcing a new probe where possible.
+  static drmModeConnectorPtr ProbeConnector(int fd, uint32_t id,
+                                            bool use_cached_state);
+  // Reads state of all connectors in |connector_ids|, one at a time.
+  static void ProbeConnectors(int fd,
+                              const std::vector<uint32_t> &connector_ids,
+                              bool use_cached_state,
+                              std::vector<ScopedDrmConnectorPtr> *connectors);
+  // Runs on probe_thread_. Hands cached state of connectors at once and
+  // then those it had to probe one by one to ConnectProbedDisplays.
+  void ProbeInitialConnectors(std::vector<uint32_t> connector_ids);
+  // Returns false, leaving connectors alone, if the primary display is
+  // connected already.
+  bool PublishProbedConnectors(std::vector<ScopedDrmConnectorPtr> &connectors,
+                               bool complete);
   std::unique_ptr<NativeDisplay> virtual_display_;
   std::unique_ptr<NativeDisplay> nested_display_;
   std::vector<std::unique_ptr<DrmDisplay>> displays_;
   std::shared_ptr<DisplayHotPlugEventCallback> callback_ = NULL;
   std::unique_ptr<NativeBufferHandler> buffer_handler_;
+  // Initial probe, see ProbeInitialConnectors.
+  std::thread probe_thread_;
+  std::mutex probe_lock_;
+  std::condition_variable probe_changed_;
+  std::vector<ScopedDrmConnectorPtr> probed_connectors_;
+  uint32_t probe_batches_ = 0;
+  bool probe_complete_ = false;
+  // Set once ConnectProbedDisplays is done.
+  bool primary_connected_ = false;
   GpuDevice *device_ = NULL;
   int fd_ = -1;
   int hotplug_fd_ = -1;
@@ -0,0 +1,152 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "drmformattable.h"
+
+#include <algorithm>
+
+#include "hwctrace.h"
+
+namespace hwcomposer {
+
+// Smallest table is 4 slots, tables are grown up to 16 times the minimum
+// size while looking for a collision free multiplier.
+#define HASH_MIN_SIZE_LOG2 2
+#define HASH_MAX_GROWTH_LOG2 4
+#define HASH_ATTEMPTS_PER_SIZE 64
+#define HASH_DEFAULT_MULTIPLIER 0x9E3779B1u
+
+template <typename Key>
+void DrmFormatTable::HashIndex<Key>::Build(const std::vector<Key>& keys) {
+  keys_ = keys;
+  slots_.clear();
+  used_.clear();
+  if (keys_.empty())
+    return;
+
+  // Keep the load factor at or below one half.
+  uint32_t min_log2 = HASH_MIN_SIZE_LOG2;
+  while ((1u << min_log2) < keys_.size() * 2)
+    min_log2++;
+
+  uint32_t seed = HASH_DEFAULT_MULTIPLIER;
+  for (uint32_t log2 = min_log2; log2 <= min_log2 + HASH_MAX_GROWTH_LOG2;
+       log2++) {
+    uint32_t size = 1u << log2;
+    shift_ = 32 - log2;
+    for (uint32_t attempt = 0; attempt < HASH_ATTEMPTS_PER_SIZE; attempt++) {
+      multiplier_ = seed | 1;
+      // xorshift32, only needs to be a deterministic sequence.
+      seed ^= seed << 13;
+      seed ^= seed >> 17;
+      seed ^= seed << 5;
+
+      slots_.assign(size, Key());
+      used_.assign(size, 0);
+      bool collision = false;
+      for (Key key : keys_) {
+        uint32_t slot = Hash(key);
+        if (used_[slot]) {
+          collision = true;
+          break;
+        }
+
+        slots_[slot] = key;
+        used_[slot] = 1;
+      }
+
+      if (!collision)
+        return;
+    }
+  }
+
+  // Extremely unlikely, fall back to linear probing.
+  uint32_t size = 1u << min_log2;
+  shift_ = 32 - min_log2;
+  multiplier_ = HASH_DEFAULT_MULTIPLIER;
+  slots_.assign(size, Key());
+  used_.assign(size, 0);
+  for (Key key : keys_) {
+    uint32_t slot = Hash(key);
+    while (used_[slot])
+      slot = (slot + 1) & (size - 1);
+
+    slots_[slot] = key;
+    used_[slot] = 1;
+  }
+}
+
+void DrmFormatTable::SetFormats(const std::vector<uint32_t>& formats) {
+  std::vector<uint32_t> unique_formats = formats;
+  std::sort(unique_formats.begin(), unique_formats.end());
+  unique_formats.erase(
+      std::unique(unique_formats.begin(), unique_formats.end()),
+      unique_formats.end());
+  formats_.Build(unique_formats);
+  modifiers_.Build(std::vector<uint64_t>());
+  modifier_masks_.assign(formats_.size(), 0);
+  modifier_bits_.clear();
+}
+
+void DrmFormatTable::AddModifier(uint32_t format, uint64_t modifier) {
+  int format_slot = formats_.Find(format);
+  if (format_slot < 0)
+    return;
+
+  const std::vector<uint64_t>& modifiers = modifiers_.keys();
+  auto it = std::find(modifiers.begin(), modifiers.end(), modifier);
+  uint32_t bit = it - modifiers.begin();
+  if (it == modifiers.end()) {
+    if (modifiers.size() >= kMaxModifiers) {
+      ETRACE("Too many modifiers for plane, ignoring modifier %llx",
+             (unsigned long long)modifier);
+      return;
+    }
+
+    std::vector<uint64_t> new_modifiers = modifiers;
+    new_modifiers.emplace_back(modifier);
+    modifiers_.Build(new_modifiers);
+    RebuildModifierBits();
+  }
+
+  modifier_masks_[format_slot] |= 1ULL << bit;
+}
+
+void DrmFormatTable::GetModifiers(uint32_t format,
+                                  std::vector<uint64_t>* modifiers) const {
+  int format_slot = formats_.Find(format);
+  if (format_slot < 0)
+    return;
+
+  uint64_t mask = modifier_masks_[format_slot];
+  const std::vector<uint64_t>& keys = modifiers_.keys();
+  for (uint32_t bit = 0; bit < keys.size(); bit++) {
+    if (mask & (1ULL << bit))
+      modifiers->emplace_back(keys[bit]);
+  }
+}
+
+void DrmFormatTable::RebuildModifierBits() {
+  // Bits follow the order in which modifiers were added, only the slots
+  // move when the hash table is rebuilt.
+  modifier_bits_.assign(modifiers_.size(), 0);
+  const std::vector<uint64_t>& modifiers = modifiers_.keys();
+  for (uint32_t bit = 0; bit < modifiers.size(); bit++) {
+    modifier_bits_[modifiers_.Find(modifiers[bit])] = 1ULL << bit;
+  }
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,135 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef WSI_DRMFORMATTABLE_H_
+#define WSI_DRMFORMATTABLE_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace hwcomposer {
+
+// Formats and modifiers supported by a plane. Built once when the plane
+// is initialized and read only afterwards, so lookups need no locking.
+//
+// Formats and modifiers are each stored in an open addressed hash table
+// whose multiplier is chosen at build time so that no two keys collide,
+// which makes a lookup one multiply and one compare. Every distinct
+// modifier gets a bit and each format slot stores the mask of modifiers
+// it can be scanned out with.
+class DrmFormatTable {
+ public:
+  // Maximum number of distinct modifiers tracked per plane. IN_FORMATS
+  // blobs in practice only list a handful.
+  static const uint32_t kMaxModifiers = 64;
+
+  DrmFormatTable() = default;
+
+  // formats is the list from drmModeGetPlane.
+  void SetFormats(const std::vector<uint32_t>& formats);
+
+  // Marks modifier as supported for format. Must be called after
+  // SetFormats, formats not passed to SetFormats are ignored.
+  void AddModifier(uint32_t format, uint64_t modifier);
+
+  bool IsSupportedFormat(uint32_t format) const {
+    return formats_.Find(format) >= 0;
+  }
+
+  bool IsSupportedModifier(uint32_t format, uint64_t modifier) const {
+    int format_slot = formats_.Find(format);
+    if (format_slot < 0)
+      return false;
+
+    int modifier_slot = modifiers_.Find(modifier);
+    if (modifier_slot < 0)
+      return false;
+
+    return modifier_masks_[format_slot] & modifier_bits_[modifier_slot];
+  }
+
+  // Appends the modifiers supported for format, in the order they were
+  // added.
+  void GetModifiers(uint32_t format, std::vector<uint64_t>* modifiers) const;
+
+  // True if any modifier information was added, i.e. the plane exposes
+  // IN_FORMATS.
+  bool HasModifiers() const {
+    return !modifiers_.keys().empty();
+  }
+
+ private:
+  template <typename Key>
+  class HashIndex {
+   public:
+    // Rebuilds the table for keys, which must be unique.
+    void Build(const std::vector<Key>& keys);
+
+    // Returns slot of key, or -1 if it's not in the table.
+    int Find(Key key) const {
+      if (slots_.empty())
+        return -1;
+
+      uint32_t mask = slots_.size() - 1;
+      uint32_t slot = Hash(key);
+      // Build picks a multiplier without collisions whenever it can, so
+      // this normally stops at the first slot.
+      for (uint32_t probe = 0; probe <= mask; probe++) {
+        uint32_t index = (slot + probe) & mask;
+        if (!used_[index])
+          return -1;
+
+        if (slots_[index] == key)
+          return index;
+      }
+
+      return -1;
+    }
+
+    uint32_t size() const {
+      return slots_.size();
+    }
+
+    const std::vector<Key>& keys() const {
+      return keys_;
+    }
+
+   private:
+    uint32_t Hash(Key key) const {
+      uint64_t value = static_cast<uint64_t>(key);
+      uint32_t folded = static_cast<uint32_t>(value ^ (value >> 32));
+      return (folded * multiplier_) >> shift_;
+    }
+
+    std::vector<Key> keys_;
+    std::vector<Key> slots_;
+    std::vector<uint8_t> used_;
+    uint32_t multiplier_ = 0;
+    uint32_t shift_ = 0;
+  };
+
+  void RebuildModifierBits();
+
+  HashIndex<uint32_t> formats_;
+  HashIndex<uint64_t> modifiers_;
+  // Indexed by slot of formats_ and modifiers_ respectively.
+  std::vector<uint64_t> modifier_masks_;
+  std::vector<uint64_t> modifier_bits_;
+};
+
+}  // namespace hwcomposer
+#endif  // WSI_DRMFORMATTABLE_H_
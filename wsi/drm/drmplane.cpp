@@ -16,6 +16,9 @@
 
 #include "drmplane.h"
 
+#include <string.h>
+
+#include <algorithm>
 #include <cmath>
 #include <drm_fourcc.h>
 
@@ -77,7 +80,6 @@ DrmPlane::DrmPlane(uint32_t plane_id, uint32_t possible_crtcs)
     : id_(plane_id),
       possible_crtc_mask_(possible_crtcs),
       type_(0),
-      last_valid_format_(0),
       in_use_(false) {
 }
 
@@ -88,6 +90,7 @@ DrmPlane::~DrmPlane() {
 bool DrmPlane::Initialize(uint32_t gpu_fd,
                           const std::vector<uint32_t>& formats) {
   supported_formats_ = formats;
+  format_table_.SetFormats(formats);
   uint32_t total_size = supported_formats_.size();
   for (uint32_t j = 0; j < total_size; j++) {
     uint32_t format = supported_formats_.at(j);
@@ -188,6 +191,16 @@ bool DrmPlane::Initialize(uint32_t gpu_fd,
   if (!ret)
     ETRACE("Could not get alpha property");
 
+  ret = blend_mode_prop_.Initialize(gpu_fd, "pixel blend mode", plane_props);
+  if (!ret)
+    ETRACE("Could not get pixel blend mode property");
+
+  ret = zpos_prop_.Initialize(gpu_fd, "zpos", plane_props);
+  if (!ret)
+    ETRACE("Could not get zpos property");
+
+  InitializeBlendingCaps(gpu_fd);
+
   ret = in_fence_fd_prop_.Initialize(gpu_fd, "IN_FENCE_FD", plane_props);
   if (!ret) {
     ETRACE("Could not get IN_FENCE_FD property");
@@ -212,32 +225,79 @@ bool DrmPlane::Initialize(uint32_t gpu_fd,
     struct drm_format_modifier* mod_o =
         (struct drm_format_modifier*)(void*)(((char*)m) + m->modifiers_offset);
 
+    // Bit j of drm_format_modifier::formats refers to the format at
+    // offset + j of the blob's format list, which matches the plane's
+    // format list.
     for (uint32_t j = 0; j < total_size; j++) {
       uint32_t format = supported_formats_.at(j);
-      format_mods modifiers_obj;
-      modifiers_obj.format = format;
-      uint32_t format_index = j;
-
+      bool has_modifier = false;
       struct drm_format_modifier* mod = mod_o;
-      for (int i = 0; i < (int)m->count_modifiers; i++, mod++) {
-        if (mod->formats & (1ULL << format_index)) {
-          modifiers_obj.mods.emplace_back(mod->modifier);
+      for (uint32_t i = 0; i < m->count_modifiers; i++, mod++) {
+        if (j < mod->offset || j >= mod->offset + 64)
+          continue;
+
+        if (mod->formats & (1ULL << (j - mod->offset))) {
+          format_table_.AddModifier(format, mod->modifier);
+          has_modifier = true;
         }
       }
-      if (modifiers_obj.mods.size() == 0) {
-        modifiers_obj.mods.emplace_back(DRM_FORMAT_MOD_NONE);
-      }
 
-      formats_modifiers_.emplace_back(modifiers_obj);
+      if (!has_modifier)
+        format_table_.AddModifier(format, DRM_FORMAT_MOD_NONE);
     }
+
+    drmModeFreePropertyBlob(blob);
   }
   return true;
 }
 
+void DrmPlane::InitializeBlendingCaps(uint32_t gpu_fd) {
+  if (alpha_prop_.id) {
+    ScopedDrmPropertyPtr property(drmModeGetProperty(gpu_fd, alpha_prop_.id));
+    // Older kernels used an 8 bit range, upstream uses 16 bit.
+    blend_caps_.alpha_max = 0xFF;
+    if (property && (property->flags & DRM_MODE_PROP_RANGE) &&
+        property->count_values >= 2 && property->values[1] > 0)
+      blend_caps_.alpha_max = property->values[1];
+  }
+
+  if (blend_mode_prop_.id) {
+    ScopedDrmPropertyPtr property(
+        drmModeGetProperty(gpu_fd, blend_mode_prop_.id));
+    for (int i = 0; property && i < property->count_enums; i++) {
+      const struct drm_mode_property_enum& penum = property->enums[i];
+      if (!strcmp(penum.name, "None")) {
+        blend_caps_.supports_none = true;
+        blend_caps_.none_value = penum.value;
+      } else if (!strcmp(penum.name, "Pre-multiplied")) {
+        blend_caps_.supports_premult = true;
+        blend_caps_.premult_value = penum.value;
+      } else if (!strcmp(penum.name, "Coverage")) {
+        blend_caps_.supports_coverage = true;
+        blend_caps_.coverage_value = penum.value;
+      }
+    }
+
+    blend_caps_.has_blend_mode = blend_caps_.supports_none ||
+                                 blend_caps_.supports_premult ||
+                                 blend_caps_.supports_coverage;
+  }
+
+  if (zpos_prop_.id) {
+    ScopedDrmPropertyPtr property(drmModeGetProperty(gpu_fd, zpos_prop_.id));
+    if (property && !(property->flags & DRM_MODE_PROP_IMMUTABLE) &&
+        property->count_values >= 2 &&
+        property->values[1] > property->values[0]) {
+      zpos_min_ = property->values[0];
+      zpos_max_ = property->values[1];
+      zpos_mutable_ = true;
+    }
+  }
+}
+
 bool DrmPlane::UpdateProperties(drmModeAtomicReqPtr property_set,
                                 uint32_t crtc_id, const OverlayLayer* layer,
-                                bool test_commit) const {
-  uint64_t alpha = 0xFF;
+                                uint32_t zorder, bool test_commit) const {
   OverlayBuffer* buffer = layer->GetBuffer();
   const HwcRect<int>& display_frame = layer->GetDisplayFrame();
   const HwcRect<float>& source_crop = layer->GetSourceCrop();
@@ -245,8 +305,11 @@ bool DrmPlane::UpdateProperties(drmModeAtomicReqPtr property_set,
   if (test_commit)
     fence = layer->GetAcquireFence();
 
-  if (layer->GetBlending() == HWCBlending::kBlendingPremult)
-    alpha = layer->GetAlpha();
+  // ValidateLayer already rejected layers we can't blend, the state is
+  // still filled in for them.
+  DrmPlaneBlendState blend_state;
+  GetDrmPlaneBlendState(blend_caps_, layer->GetBlending(), layer->GetAlpha(),
+                        DrmFormatHasAlpha(buffer->GetFormat()), &blend_state);
 
   IDISPLAYMANAGERTRACE("buffer->GetFb() ---------------------- STARTS %d",
                        buffer->GetFb());
@@ -306,18 +369,30 @@ bool DrmPlane::UpdateProperties(drmModeAtomicReqPtr property_set,
     else
       rotation |= DRM_MODE_ROTATE_0;
 
-    success = drmModeAtomicAddProperty(property_set, id_, rotation_prop_.id,
-                                       rotation) < 0;
+    success |= drmModeAtomicAddProperty(property_set, id_, rotation_prop_.id,
+                                        rotation) < 0;
   }
 
   if (alpha_prop_.id) {
-    success =
-        drmModeAtomicAddProperty(property_set, id_, alpha_prop_.id, alpha) < 0;
+    success |= drmModeAtomicAddProperty(property_set, id_, alpha_prop_.id,
+                                        blend_state.alpha) < 0;
+  }
+
+  if (blend_caps_.has_blend_mode) {
+    success |= drmModeAtomicAddProperty(property_set, id_,
+                                        blend_mode_prop_.id,
+                                        blend_state.blend_mode) < 0;
+  }
+
+  if (zpos_mutable_) {
+    uint64_t zpos = std::min(zpos_min_ + zorder, zpos_max_);
+    success |=
+        drmModeAtomicAddProperty(property_set, id_, zpos_prop_.id, zpos) < 0;
   }
 
   if (fence > 0 && in_fence_fd_prop_.id) {
-    success = drmModeAtomicAddProperty(property_set, id_, in_fence_fd_prop_.id,
-                                       fence) < 0;
+    success |= drmModeAtomicAddProperty(property_set, id_,
+                                        in_fence_fd_prop_.id, fence) < 0;
   }
 
   if (success) {
@@ -379,15 +454,14 @@ uint32_t DrmPlane::type() const {
 }
 
 bool DrmPlane::ValidateLayer(const OverlayLayer* layer) {
-  uint64_t alpha = 0xFF;
-
-  if (layer->GetBlending() == HWCBlending::kBlendingPremult)
-    alpha = layer->GetAlpha();
-
-  if (type_ == DRM_PLANE_TYPE_OVERLAY && (alpha != 0 && alpha != 0xFF) &&
-      alpha_prop_.id == 0) {
+  DrmPlaneBlendState blend_state;
+  if (!GetDrmPlaneBlendState(blend_caps_, layer->GetBlending(),
+                             layer->GetAlpha(),
+                             DrmFormatHasAlpha(layer->GetBuffer()->GetFormat()),
+                             &blend_state)) {
     IDISPLAYMANAGERTRACE(
-        "Alpha property not supported, Cannot composite layer using Overlay.");
+        "Plane alpha or blend mode not supported, Cannot composite layer "
+        "using Overlay.");
     return false;
   }
 
@@ -404,27 +478,26 @@ bool DrmPlane::ValidateLayer(const OverlayLayer* layer) {
     return false;
   }
 
-  if (!IsSupportedFormat(layer->GetBuffer()->GetFormat())) {
+  OverlayBuffer* buffer = layer->GetBuffer();
+  if (!IsSupportedFormat(buffer->GetFormat())) {
     IDISPLAYMANAGERTRACE(
         "Layer cannot be supported as format is not supported.");
     return false;
   }
 
+  uint64_t modifier = buffer->GetModifier();
+  if (modifier && format_table_.HasModifiers() &&
+      !format_table_.IsSupportedModifier(buffer->GetFormat(), modifier)) {
+    IDISPLAYMANAGERTRACE(
+        "Layer cannot be supported as modifier is not supported.");
+    return false;
+  }
+
   return IsSupportedTransform(transform);
 }
 
 bool DrmPlane::IsSupportedFormat(uint32_t format) {
-  if (last_valid_format_ == format)
-    return true;
-
-  for (auto& element : supported_formats_) {
-    if (element == format) {
-      last_valid_format_ = format;
-      return true;
-    }
-  }
-
-  return false;
+  return format_table_.IsSupportedFormat(format);
 }
 
 bool DrmPlane::IsSupportedTransform(uint32_t transform) const {
@@ -461,19 +534,13 @@ void DrmPlane::SetInUse(bool in_use) {
   in_use_ = in_use;
 }
 
+void DrmPlane::GetSupportedModifiers(uint32_t format,
+                                     std::vector<uint64_t>* modifiers) const {
+  format_table_.GetModifiers(format, modifiers);
+}
+
 bool DrmPlane::IsSupportedModifier(uint64_t modifier, uint32_t format) {
-  uint32_t count = formats_modifiers_.size();
-  for (uint32_t i = 0; i < count; i++) {
-    const format_mods& obj = formats_modifiers_.at(i);
-    if (obj.format == format) {
-      std::vector<uint64_t>::const_iterator it;
-      it = std::find(obj.mods.begin(), obj.mods.end(), modifier);
-      if (it != obj.mods.end()) {
-        return true;
-      }
-    }
-  }
-  return false;
+  return format_table_.IsSupportedModifier(format, modifier);
 }
 
 void DrmPlane::Dump() const {
@@ -499,7 +566,18 @@ void DrmPlane::Dump() const {
   DUMPTRACE("Enabled: %d", in_use_);
 
   if (alpha_prop_.id != 0)
-    DUMPTRACE("Alpha property is supported.");
+    DUMPTRACE("Alpha property is supported, max %llu.",
+              (unsigned long long)blend_caps_.alpha_max);
+
+  if (blend_caps_.has_blend_mode)
+    DUMPTRACE("Pixel blend mode property is supported: %s%s%s.",
+              blend_caps_.supports_none ? "None " : "",
+              blend_caps_.supports_premult ? "Pre-multiplied " : "",
+              blend_caps_.supports_coverage ? "Coverage" : "");
+
+  if (zpos_mutable_)
+    DUMPTRACE("zpos property is supported, range %llu-%llu.",
+              (unsigned long long)zpos_min_, (unsigned long long)zpos_max_);
 
   if (rotation_prop_.id != 0)
     DUMPTRACE("Rotation property is supported.");
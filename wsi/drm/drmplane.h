@@ -27,6 +27,8 @@
 #include <vector>
 
 #include "displayplane.h"
+#include "drmformattable.h"
+#include "drmplaneblending.h"
 
 namespace hwcomposer {
 
@@ -41,8 +43,10 @@ class DrmPlane : public DisplayPlane {
 
   bool Initialize(uint32_t gpu_fd, const std::vector<uint32_t>& formats);
 
+  // zorder is the position of the plane in the commit, starting from the
+  // bottom most plane. It's only used if the plane has a mutable zpos.
   bool UpdateProperties(drmModeAtomicReqPtr property_set, uint32_t crtc_id,
-                        const OverlayLayer* layer,
+                        const OverlayLayer* layer, uint32_t zorder,
                         bool test_commit = false) const;
 
   void SetNativeFence(int32_t fd);
@@ -64,6 +68,9 @@ class DrmPlane : public DisplayPlane {
   uint32_t GetPreferredVideoFormat() const override;
   uint32_t GetPreferredFormat() const override;
 
+  void GetSupportedModifiers(uint32_t format,
+                             std::vector<uint64_t>* modifiers) const override;
+
   void Dump() const override;
 
   void SetInUse(bool in_use) override;
@@ -80,6 +87,8 @@ class DrmPlane : public DisplayPlane {
   bool IsSupportedModifier(uint64_t modifier, uint32_t format);
 
  private:
+  void InitializeBlendingCaps(uint32_t gpu_fd);
+
   struct Property {
     Property();
     bool Initialize(uint32_t fd, const char* name,
@@ -101,6 +110,8 @@ class DrmPlane : public DisplayPlane {
   Property src_h_prop_;
   Property rotation_prop_;
   Property alpha_prop_;
+  Property blend_mode_prop_;
+  Property zpos_prop_;
   Property in_fence_fd_prop_;
   Property in_formats_prop_;
 
@@ -110,7 +121,6 @@ class DrmPlane : public DisplayPlane {
 
   uint32_t type_;
 
-  uint32_t last_valid_format_;
   bool in_use_;
 
   std::vector<uint32_t> supported_formats_;
@@ -119,12 +129,15 @@ class DrmPlane : public DisplayPlane {
   uint32_t prefered_format_ = 0;
   uint32_t rotation_ = 0;
 
-  // keep supported modifiers for each supported format
-  typedef struct format_mods {
-    std::vector<uint64_t> mods;
-    uint32_t format;
-  } format_mods;
-  std::vector<format_mods> formats_modifiers_;
+  // Supported formats and, from IN_FORMATS, modifiers for each of them.
+  DrmFormatTable format_table_;
+
+  // From the alpha and pixel blend mode properties.
+  DrmPlaneBlendCaps blend_caps_;
+  // Range of zpos, only programmed if it can be changed.
+  uint64_t zpos_min_ = 0;
+  uint64_t zpos_max_ = 0;
+  bool zpos_mutable_ = false;
 };
 
 }  // namespace hwcomposer
@@ -0,0 +1,111 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "drmplaneblending.h"
+
+#include <drm_fourcc.h>
+
+namespace hwcomposer {
+
+// Returns the value of the first supported mode in order, the plane's
+// default (premultiplied) otherwise.
+static uint64_t PickBlendMode(const DrmPlaneBlendCaps& caps, bool none_first) {
+  if (none_first && caps.supports_none)
+    return caps.none_value;
+
+  if (caps.supports_premult)
+    return caps.premult_value;
+
+  if (caps.supports_none)
+    return caps.none_value;
+
+  return caps.coverage_value;
+}
+
+bool GetDrmPlaneBlendState(const DrmPlaneBlendCaps& caps,
+                           HWCBlending blending, uint8_t alpha,
+                           bool format_has_alpha, DrmPlaneBlendState* state) {
+  state->alpha = caps.alpha_max;
+  state->blend_mode = 0;
+
+  if (blending == HWCBlending::kBlendingNone) {
+    // Plane alpha is ignored and the layer is treated as opaque.
+    if (caps.has_blend_mode)
+      state->blend_mode = PickBlendMode(caps, true);
+
+    return true;
+  }
+
+  if (alpha != 0xFF) {
+    if (!caps.alpha_max)
+      return false;
+
+    state->alpha = (static_cast<uint64_t>(alpha) * caps.alpha_max + 127) / 255;
+  }
+
+  // Planes without the property blend premultiplied, which also works
+  // for coverage if there is no per pixel alpha.
+  if (!caps.has_blend_mode)
+    return blending == HWCBlending::kBlendingPremult || !format_has_alpha;
+
+  if (!format_has_alpha) {
+    state->blend_mode = PickBlendMode(caps, false);
+    return true;
+  }
+
+  if (blending == HWCBlending::kBlendingPremult) {
+    if (!caps.supports_premult)
+      return false;
+
+    state->blend_mode = caps.premult_value;
+    return true;
+  }
+
+  if (!caps.supports_coverage)
+    return false;
+
+  state->blend_mode = caps.coverage_value;
+  return true;
+}
+
+bool DrmFormatHasAlpha(uint32_t format) {
+  switch (format) {
+    case DRM_FORMAT_ARGB4444:
+    case DRM_FORMAT_ABGR4444:
+    case DRM_FORMAT_RGBA4444:
+    case DRM_FORMAT_BGRA4444:
+    case DRM_FORMAT_ARGB1555:
+    case DRM_FORMAT_ABGR1555:
+    case DRM_FORMAT_RGBA5551:
+    case DRM_FORMAT_BGRA5551:
+    case DRM_FORMAT_ARGB8888:
+    case DRM_FORMAT_ABGR8888:
+    case DRM_FORMAT_RGBA8888:
+    case DRM_FORMAT_BGRA8888:
+    case DRM_FORMAT_ARGB2101010:
+    case DRM_FORMAT_ABGR2101010:
+    case DRM_FORMAT_RGBA1010102:
+    case DRM_FORMAT_BGRA1010102:
+    case DRM_FORMAT_AYUV:
+      return true;
+    default:
+      break;
+  }
+
+  return false;
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,65 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef WSI_DRMPLANEBLENDING_H_
+#define WSI_DRMPLANEBLENDING_H_
+
+#include <stdint.h>
+
+#include <hwcdefs.h>
+
+namespace hwcomposer {
+
+// Blending capabilities of a plane, from its "alpha" and
+// "pixel blend mode" properties. Kept free of libdrm types so the
+// decision logic can be exercised with a hand filled description.
+struct DrmPlaneBlendCaps {
+  // Maximum value of the alpha property, 0 if the plane has none.
+  uint64_t alpha_max = 0;
+
+  // Set if the plane has a pixel blend mode property. Each supports_*
+  // flag tells if the matching enum entry exists, *_value is its value.
+  bool has_blend_mode = false;
+  bool supports_none = false;
+  bool supports_premult = false;
+  bool supports_coverage = false;
+  uint64_t none_value = 0;
+  uint64_t premult_value = 0;
+  uint64_t coverage_value = 0;
+};
+
+// Property values to program for a layer.
+struct DrmPlaneBlendState {
+  // Valid if DrmPlaneBlendCaps::alpha_max is non zero.
+  uint64_t alpha = 0;
+  // Valid if DrmPlaneBlendCaps::has_blend_mode is set.
+  uint64_t blend_mode = 0;
+};
+
+// Fills state with what the plane needs to be programmed with to show a
+// layer with blending and plane alpha the way the GPU compositor would.
+// format_has_alpha tells if the buffer has per pixel alpha. Returns false
+// if the plane can't reproduce the result, in which case the layer needs
+// to be composited.
+bool GetDrmPlaneBlendState(const DrmPlaneBlendCaps& caps,
+                           HWCBlending blending, uint8_t alpha,
+                           bool format_has_alpha, DrmPlaneBlendState* state);
+
+// Returns true if format has per pixel alpha.
+bool DrmFormatHasAlpha(uint32_t format);
+
+}  // namespace hwcomposer
+#endif  // WSI_DRMPLANEBLENDING_H_
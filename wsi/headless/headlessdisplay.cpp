@@ -0,0 +1,301 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "headlessdisplay.h"
+
+#include <errno.h>
+#include <time.h>
+
+#include <hwcdefs.h>
+#include <hwclayer.h>
+#include <hwctrace.h>
+#include <hwcutils.h>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+#include "displayqueue.h"
+#include "headlessdisplaymanager.h"
+#include "overlaylayer.h"
+#include "wsi_utils.h"
+
+namespace hwcomposer {
+
+// Acquire fences are expected to signal well within this time, we don't
+// want a stuck GPU job to hang the display thread forever.
+static const int kAcquireFenceTimeoutMs = 3000;
+
+// Blocks until the next multiple of period on CLOCK_MONOTONIC. This is the
+// same phase used by the simulated vblank events of DisplayQueue.
+static void WaitForNextVblank(int64_t period) {
+  if (period <= 0)
+    return;
+
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  int64_t now = static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+  int64_t next = (now / period + 1) * period;
+  ts.tv_sec = next / 1000000000LL;
+  ts.tv_nsec = next % 1000000000LL;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    ;
+}
+
+HeadlessDisplay::HeadlessDisplay(uint32_t gpu_fd, uint32_t pipe_id,
+                                 const std::vector<HeadlessMode> &modes,
+                                 const std::vector<HeadlessPlaneCaps> &planes,
+                                 HeadlessDisplayManager *manager)
+    : PhysicalDisplay(gpu_fd, pipe_id),
+      modes_(modes),
+      planes_(planes),
+      manager_(manager) {
+  // Configs are indices into modes_.
+  config_ = 0;
+}
+
+HeadlessDisplay::~HeadlessDisplay() {
+  display_queue_->SetPowerMode(kOff);
+}
+
+bool HeadlessDisplay::InitializeDisplay() {
+  vsync_period_ = GetVsyncPeriod();
+  display_queue_->SetSimulatedVblankPeriod(vsync_period_);
+  return true;
+}
+
+void HeadlessDisplay::ConnectDisplay() {
+  IHOTPLUGEVENTTRACE("HeadlessDisplay::Connect recieved.");
+  SPIN_LOCK(display_lock_);
+  width_ = modes_[config_].width;
+  height_ = modes_[config_].height;
+  SPIN_UNLOCK(display_lock_);
+
+  PhysicalDisplay::Connect();
+  SetPowerMode(power_mode_);
+}
+
+int64_t HeadlessDisplay::GetVsyncPeriod() const {
+  uint32_t refresh = modes_[config_].refresh;
+  if (!refresh)
+    refresh = 60;
+
+  return 1000000000LL / refresh;
+}
+
+bool HeadlessDisplay::GetDisplayAttribute(uint32_t config,
+                                          HWCDisplayAttribute attribute,
+                                          int32_t *value) {
+  SPIN_LOCK(display_lock_);
+  if (config >= modes_.size()) {
+    SPIN_UNLOCK(display_lock_);
+    *value = -1;
+    return false;
+  }
+
+  const HeadlessMode &mode = modes_[config];
+  bool status = true;
+  switch (attribute) {
+    case HWCDisplayAttribute::kWidth:
+      *value = mode.width;
+      break;
+    case HWCDisplayAttribute::kHeight:
+      *value = mode.height;
+      break;
+    case HWCDisplayAttribute::kRefreshRate:
+      // in nanoseconds
+      *value = 1e9 / (mode.refresh ? mode.refresh : 60);
+      break;
+    case HWCDisplayAttribute::kDpiX:
+    case HWCDisplayAttribute::kDpiY:
+      // No physical size to report.
+      *value = -1;
+      break;
+    default:
+      *value = -1;
+      status = false;
+  }
+
+  SPIN_UNLOCK(display_lock_);
+  return status;
+}
+
+bool HeadlessDisplay::GetDisplayConfigs(uint32_t *num_configs,
+                                        uint32_t *configs) {
+  SPIN_LOCK(display_lock_);
+  uint32_t modes_size = modes_.size();
+  SPIN_UNLOCK(display_lock_);
+
+  if (!configs) {
+    *num_configs = modes_size;
+    return true;
+  }
+
+  uint32_t size = std::min(*num_configs, modes_size);
+  for (uint32_t i = 0; i < size; i++)
+    configs[i] = i;
+
+  *num_configs = size;
+  return true;
+}
+
+bool HeadlessDisplay::GetDisplayName(uint32_t *size, char *name) {
+  std::ostringstream stream;
+  stream << "Headless-" << pipe_;
+  std::string string = stream.str();
+  size_t length = string.length();
+  if (!name) {
+    *size = length;
+    return true;
+  }
+
+  *size = std::min<uint32_t>(static_cast<uint32_t>(length + 1), *size);
+  strncpy(name, string.c_str(), *size);
+  return true;
+}
+
+void HeadlessDisplay::UpdateDisplayConfig() {
+  SPIN_LOCK(display_lock_);
+  if (config_ >= modes_.size())
+    config_ = 0;
+
+  width_ = modes_[config_].width;
+  height_ = modes_[config_].height;
+  vsync_period_ = GetVsyncPeriod();
+  SPIN_UNLOCK(display_lock_);
+  display_queue_->SetSimulatedVblankPeriod(vsync_period_);
+}
+
+void HeadlessDisplay::PowerOn() {
+  IHOTPLUGEVENTTRACE("PowerOn: Powered on Pipe: %d display: %p", pipe_, this);
+}
+
+void HeadlessDisplay::SetColorCorrection(struct gamma_colors /*gamma*/,
+                                         uint32_t /*contrast*/,
+                                         uint32_t /*brightness*/) const {
+}
+
+void HeadlessDisplay::SetColorTransformMatrix(
+    const float * /*color_transform_matrix*/,
+    HWCColorTransform /*color_transform_hint*/) const {
+}
+
+void HeadlessDisplay::Disable(
+    const DisplayPlaneStateList &composition_planes) {
+  IHOTPLUGEVENTTRACE("Disable: Disabling Display: %p", this);
+  for (const DisplayPlaneState &comp_plane : composition_planes) {
+    comp_plane.GetDisplayPlane()->SetInUse(false);
+  }
+}
+
+bool HeadlessDisplay::Commit(
+    const DisplayPlaneStateList &composition_planes,
+    const DisplayPlaneStateList & /*previous_composition_planes*/,
+    bool /*disable_explicit_fence*/, int32_t * /*commit_fence*/) {
+  CTRACE();
+  // Nothing scans out the buffers, but they must not be released before
+  // the content would have been on screen.
+  for (const DisplayPlaneState &comp_plane : composition_planes) {
+    const OverlayLayer *layer = comp_plane.GetOverlayLayer();
+    int32_t fence = layer->GetAcquireFence();
+    if (fence > 0 && HWCPoll(fence, kAcquireFenceTimeoutMs) < 0) {
+      ETRACE("Timed out waiting for acquire fence of plane %d.",
+             comp_plane.GetDisplayPlane()->id());
+    }
+  }
+
+  display_state_ &= ~kNeedsModeset;
+
+  // There is no out fence, commit completes once the simulated flip has
+  // happened.
+  WaitForNextVblank(vsync_period_);
+  return true;
+}
+
+bool HeadlessDisplay::CommitCursor(DisplayPlane *plane,
+                                   const OverlayLayer *layer,
+                                   uint32_t /*zorder*/,
+                                   bool /*position_only*/,
+                                   int32_t *commit_fence) {
+  CTRACE();
+  *commit_fence = -1;
+  if (display_state_ & kNeedsModeset)
+    return false;
+
+  // Like a hardware cursor update, this doesn't wait for the flip.
+  int32_t fence = layer->GetAcquireFence();
+  if (fence > 0 && HWCPoll(fence, kAcquireFenceTimeoutMs) < 0) {
+    ETRACE("Timed out waiting for acquire fence of plane %d.", plane->id());
+  }
+
+  return true;
+}
+
+bool HeadlessDisplay::TestCommit(
+    const std::vector<OverlayPlane> &commit_planes) const {
+  for (const OverlayPlane &commit_plane : commit_planes) {
+    if (!commit_plane.plane->ValidateLayer(commit_plane.layer)) {
+      IDISPLAYMANAGERTRACE("Test Commit Failed for plane %d.",
+                           commit_plane.plane->id());
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool HeadlessDisplay::PopulatePlanes(
+    std::vector<std::unique_ptr<DisplayPlane>> &overlay_planes) {
+  std::unique_ptr<DisplayPlane> cursor_plane;
+  uint32_t plane_id = 1;
+  for (const HeadlessPlaneCaps &caps : planes_) {
+    std::unique_ptr<DisplayPlane> plane(new HeadlessPlane(plane_id++, caps));
+    if (caps.cursor) {
+      cursor_plane.reset(plane.release());
+    } else {
+      overlay_planes.emplace_back(plane.release());
+    }
+  }
+
+  if (overlay_planes.empty()) {
+    ETRACE("No primary plane configured for headless display %d", pipe_);
+    return false;
+  }
+
+  if (cursor_plane) {
+    overlay_planes.emplace_back(cursor_plane.release());
+  }
+
+  return true;
+}
+
+void HeadlessDisplay::ForceRefresh() {
+  display_queue_->ForceRefresh();
+}
+
+void HeadlessDisplay::IgnoreUpdates() {
+  display_queue_->IgnoreUpdates();
+}
+
+void HeadlessDisplay::HandleLazyInitialization() {
+  manager_->HandleLazyInitialization();
+}
+
+void HeadlessDisplay::NotifyClientsOfDisplayChangeStatus() {
+  manager_->NotifyClientsOfDisplayChangeStatus();
+}
+
+}  // namespace hwcomposer
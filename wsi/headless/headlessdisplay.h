@@ -0,0 +1,97 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef WSI_HEADLESS_HEADLESSDISPLAY_H_
+#define WSI_HEADLESS_HEADLESSDISPLAY_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "headlessplane.h"
+#include "physicaldisplay.h"
+
+namespace hwcomposer {
+class HeadlessDisplayManager;
+
+struct HeadlessMode {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t refresh = 60;
+};
+
+// Display without any output hardware behind it. Commits only wait for
+// the acquire fences of the layers and for the next simulated vblank,
+// so that frame pacing matches a panel of the configured refresh rate.
+class HeadlessDisplay : public PhysicalDisplay {
+ public:
+  HeadlessDisplay(uint32_t gpu_fd, uint32_t pipe_id,
+                  const std::vector<HeadlessMode> &modes,
+                  const std::vector<HeadlessPlaneCaps> &planes,
+                  HeadlessDisplayManager *manager);
+  ~HeadlessDisplay() override;
+
+  bool GetDisplayAttribute(uint32_t config, HWCDisplayAttribute attribute,
+                           int32_t *value) override;
+
+  bool GetDisplayConfigs(uint32_t *num_configs, uint32_t *configs) override;
+  bool GetDisplayName(uint32_t *size, char *name) override;
+
+  bool InitializeDisplay() override;
+  void PowerOn() override;
+  void UpdateDisplayConfig() override;
+  void SetColorCorrection(struct gamma_colors gamma, uint32_t contrast,
+                          uint32_t brightness) const override;
+  void SetColorTransformMatrix(
+      const float *color_transform_matrix,
+      HWCColorTransform color_transform_hint) const override;
+  void Disable(const DisplayPlaneStateList &composition_planes) override;
+  bool Commit(const DisplayPlaneStateList &composition_planes,
+              const DisplayPlaneStateList &previous_composition_planes,
+              bool disable_explicit_fence, int32_t *commit_fence) override;
+  bool CommitCursor(DisplayPlane *plane, const OverlayLayer *layer,
+                    uint32_t zorder, bool position_only,
+                    int32_t *commit_fence) override;
+
+  bool TestCommit(
+      const std::vector<OverlayPlane> &commit_planes) const override;
+
+  bool PopulatePlanes(
+      std::vector<std::unique_ptr<DisplayPlane>> &overlay_planes) override;
+
+  void NotifyClientsOfDisplayChangeStatus() override;
+
+  void HandleLazyInitialization() override;
+
+  void ForceRefresh();
+
+  void IgnoreUpdates();
+
+  void ConnectDisplay();
+
+ private:
+  int64_t GetVsyncPeriod() const;
+
+  std::vector<HeadlessMode> modes_;
+  std::vector<HeadlessPlaneCaps> planes_;
+  int64_t vsync_period_ = 0;
+  SpinLock display_lock_;
+  HeadlessDisplayManager *manager_;
+};
+
+}  // namespace hwcomposer
+#endif  // WSI_HEADLESS_HEADLESSDISPLAY_H_
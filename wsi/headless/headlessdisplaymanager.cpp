@@ -0,0 +1,317 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "headlessdisplaymanager.h"
+
+#include <drm_fourcc.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <hwctrace.h>
+#include <gpudevice.h>
+
+#include <nativebufferhandler.h>
+
+namespace hwcomposer {
+
+// Render nodes are numbered from 128, see drm(7).
+#define HEADLESS_RENDER_NODE_MIN 128
+#define HEADLESS_RENDER_NODE_MAX 192
+#define HEADLESS_DEFAULT_PLANES 3
+
+static bool GetEnvFlag(const char *name, bool default_value) {
+  const char *value = getenv(name);
+  if (!value || !*value)
+    return default_value;
+
+  return atoi(value) != 0;
+}
+
+HeadlessDisplayManager::HeadlessDisplayManager(GpuDevice *device)
+    : device_(device) {
+  CTRACE();
+}
+
+HeadlessDisplayManager::~HeadlessDisplayManager() {
+  CTRACE();
+  std::vector<std::unique_ptr<HeadlessDisplay>>().swap(displays_);
+  if (fd_ >= 0)
+    close(fd_);
+}
+
+int HeadlessDisplayManager::OpenDevice() {
+  const char *device = getenv("HWC_HEADLESS_DEVICE");
+  if (device && *device) {
+    int fd = open(device, O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+      ETRACE("Failed to open %s %s", device, PRINTERROR());
+
+    return fd;
+  }
+
+  char path[64];
+  for (int i = HEADLESS_RENDER_NODE_MIN; i < HEADLESS_RENDER_NODE_MAX; i++) {
+    snprintf(path, sizeof(path), "/dev/dri/renderD%d", i);
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd >= 0) {
+      IHOTPLUGEVENTTRACE("Headless display manager using %s", path);
+      return fd;
+    }
+  }
+
+  ETRACE("Failed to find a render node for headless display manager.");
+  return -1;
+}
+
+bool HeadlessDisplayManager::ParseModes(
+    const char *config, std::vector<std::vector<HeadlessMode>> *displays) {
+  std::vector<HeadlessMode> modes;
+  const char *current = config;
+  while (*current) {
+    HeadlessMode mode;
+    int consumed = 0;
+    if (sscanf(current, "%ux%u%n", &mode.width, &mode.height, &consumed) !=
+            2 ||
+        !mode.width || !mode.height) {
+      ETRACE("Invalid headless mode: %s", current);
+      return false;
+    }
+
+    current += consumed;
+    if (*current == '@') {
+      if (sscanf(current, "@%u%n", &mode.refresh, &consumed) != 1 ||
+          !mode.refresh) {
+        ETRACE("Invalid headless refresh rate: %s", current);
+        return false;
+      }
+
+      current += consumed;
+    }
+
+    modes.emplace_back(mode);
+    if (*current == '|') {
+      current++;
+      continue;
+    }
+
+    displays->emplace_back(modes);
+    modes.clear();
+    if (*current == ',') {
+      current++;
+    } else if (*current) {
+      ETRACE("Unexpected character in headless display config: %s", current);
+      return false;
+    }
+  }
+
+  if (!modes.empty())
+    displays->emplace_back(modes);
+
+  return !displays->empty();
+}
+
+void HeadlessDisplayManager::GetPlaneCaps(
+    std::vector<HeadlessPlaneCaps> *planes) {
+  int num_planes = HEADLESS_DEFAULT_PLANES;
+  const char *value = getenv("HWC_HEADLESS_PLANES");
+  if (value && atoi(value) > 0)
+    num_planes = atoi(value);
+
+  bool yuv = GetEnvFlag("HWC_HEADLESS_YUV", true);
+  uint32_t transforms = 0;
+  if (GetEnvFlag("HWC_HEADLESS_ROTATION", false))
+    transforms |= kTransform180;
+
+  std::vector<uint64_t> modifiers;
+  const char *modifier_list = getenv("HWC_HEADLESS_MODIFIERS");
+  while (modifier_list && *modifier_list) {
+    char *end = NULL;
+    uint64_t modifier = strtoull(modifier_list, &end, 16);
+    if (end == modifier_list) {
+      ETRACE("Invalid headless modifier list: %s", modifier_list);
+      break;
+    }
+
+    modifiers.emplace_back(modifier);
+    modifier_list = *end == ',' ? end + 1 : end;
+  }
+
+  for (int i = 0; i < num_planes; i++) {
+    HeadlessPlaneCaps caps;
+    caps.formats = {DRM_FORMAT_XRGB8888, DRM_FORMAT_ARGB8888,
+                    DRM_FORMAT_XBGR8888, DRM_FORMAT_ABGR8888,
+                    DRM_FORMAT_RGB565};
+    // Like most hardware, only overlays can scan out YUV.
+    if (yuv && i > 0) {
+      caps.formats.emplace_back(DRM_FORMAT_NV12);
+      caps.formats.emplace_back(DRM_FORMAT_YUYV);
+    }
+
+    caps.modifiers = modifiers;
+    caps.transforms = transforms;
+    planes->emplace_back(caps);
+  }
+
+  if (GetEnvFlag("HWC_HEADLESS_CURSOR", true)) {
+    HeadlessPlaneCaps caps;
+    caps.formats = {DRM_FORMAT_ARGB8888};
+    caps.cursor = true;
+    planes->emplace_back(caps);
+  }
+}
+
+bool HeadlessDisplayManager::Initialize() {
+  CTRACE();
+  fd_ = OpenDevice();
+  if (fd_ < 0)
+    return false;
+
+  const char *config = getenv("HWC_HEADLESS_DISPLAYS");
+  if (!config || !*config)
+    config = "1920x1080@60";
+
+  std::vector<std::vector<HeadlessMode>> display_modes;
+  if (!ParseModes(config, &display_modes)) {
+    ETRACE("Failed to parse HWC_HEADLESS_DISPLAYS.");
+    return false;
+  }
+
+  std::vector<HeadlessPlaneCaps> planes;
+  GetPlaneCaps(&planes);
+
+  uint32_t pipe = 0;
+  for (const std::vector<HeadlessMode> &modes : display_modes) {
+    std::unique_ptr<HeadlessDisplay> display(
+        new HeadlessDisplay(fd_, pipe++, modes, planes, this));
+    displays_.emplace_back(std::move(display));
+  }
+
+  IHOTPLUGEVENTTRACE("Headless DisplayManager Initialization succeeded.");
+  return true;
+}
+
+void HeadlessDisplayManager::InitializeDisplayResources() {
+  buffer_handler_.reset(NativeBufferHandler::CreateInstance(fd_));
+  if (!buffer_handler_) {
+    ETRACE("Failed to create native buffer handler instance");
+    return;
+  }
+
+  int size = displays_.size();
+  for (int i = 0; i < size; ++i) {
+    if (!displays_.at(i)->Initialize(buffer_handler_.get())) {
+      ETRACE("Failed to Initialize Display %d", i);
+    }
+  }
+
+  virtual_display_.reset(new VirtualDisplay(fd_, buffer_handler_.get(), 0, 0));
+  nested_display_.reset(new NestedDisplay());
+  nested_display_->Initialize(buffer_handler_.get());
+}
+
+void HeadlessDisplayManager::StartHotPlugMonitor() {
+  // Displays never change, connect all of them once.
+  spin_lock_.lock();
+  std::vector<NativeDisplay *> connected_displays;
+  for (auto &display : displays_) {
+    display->ConnectDisplay();
+    connected_displays.emplace_back(display.get());
+  }
+
+  if (callback_) {
+    callback_->Callback(connected_displays);
+  }
+
+  spin_lock_.unlock();
+  NotifyClientsOfDisplayChangeStatus();
+  nested_display_->HotPlugUpdate(true);
+}
+
+void HeadlessDisplayManager::NotifyClientsOfDisplayChangeStatus() {
+  spin_lock_.lock();
+  for (auto &display : displays_) {
+    display->NotifyClientOfConnectedState();
+  }
+  spin_lock_.unlock();
+}
+
+NativeDisplay *HeadlessDisplayManager::GetVirtualDisplay() {
+  spin_lock_.lock();
+  NativeDisplay *display = virtual_display_.get();
+  spin_lock_.unlock();
+  return display;
+}
+
+NativeDisplay *HeadlessDisplayManager::GetNestedDisplay() {
+  spin_lock_.lock();
+  NativeDisplay *display = nested_display_.get();
+  spin_lock_.unlock();
+  return display;
+}
+
+std::vector<NativeDisplay *> HeadlessDisplayManager::GetAllDisplays() {
+  spin_lock_.lock();
+  std::vector<NativeDisplay *> all_displays;
+  size_t size = displays_.size();
+  for (size_t i = 0; i < size; ++i) {
+    all_displays.emplace_back(displays_.at(i).get());
+  }
+  spin_lock_.unlock();
+  return all_displays;
+}
+
+void HeadlessDisplayManager::RegisterHotPlugEventCallback(
+    std::shared_ptr<DisplayHotPlugEventCallback> callback) {
+  spin_lock_.lock();
+  callback_ = callback;
+  spin_lock_.unlock();
+}
+
+void HeadlessDisplayManager::ForceRefresh() {
+  spin_lock_.lock();
+  size_t size = displays_.size();
+  for (size_t i = 0; i < size; ++i) {
+    displays_.at(i)->ForceRefresh();
+  }
+
+  release_lock_ = true;
+  spin_lock_.unlock();
+}
+
+void HeadlessDisplayManager::IgnoreUpdates() {
+  size_t size = displays_.size();
+  for (size_t i = 0; i < size; ++i) {
+    displays_.at(i)->IgnoreUpdates();
+  }
+}
+
+void HeadlessDisplayManager::HandleLazyInitialization() {
+  spin_lock_.lock();
+  if (release_lock_) {
+    device_->DisableWatch();
+    release_lock_ = false;
+  }
+  spin_lock_.unlock();
+}
+
+DisplayManager *DisplayManager::CreateDisplayManager(GpuDevice *device) {
+  return new HeadlessDisplayManager(device);
+}
+
+}  // namespace hwcomposer
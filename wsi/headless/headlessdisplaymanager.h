@@ -0,0 +1,98 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef WSI_HEADLESS_DISPLAY_MANAGER_H_
+#define WSI_HEADLESS_DISPLAY_MANAGER_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "spinlock.h"
+
+#include "displaymanager.h"
+#include "headlessdisplay.h"
+#include "nesteddisplay.h"
+#include "virtualdisplay.h"
+
+namespace hwcomposer {
+
+class NativeBufferHandler;
+
+// Display manager used when HWC is built with --enable-headless. Displays
+// are described by environment variables instead of being probed. Buffers
+// are still allocated from a DRM render node and composited by the GPU
+// stack, machines without a GPU need vgem and a software GL driver, see
+// tests/apps/headlesstest.cpp.
+//
+// HWC_HEADLESS_DEVICE:   DRM node used for buffer allocation. Defaults to
+//                        the first render node found (e.g. vgem).
+// HWC_HEADLESS_DISPLAYS: Comma separated list of displays, each a '|'
+//                        separated list of modes WxH[@refresh], first mode
+//                        is the preferred one. Defaults to 1920x1080@60.
+// HWC_HEADLESS_PLANES:   Number of universal planes per display. Default 3.
+// HWC_HEADLESS_CURSOR:   1 to add a cursor plane. Default 1.
+// HWC_HEADLESS_YUV:      1 if overlay planes accept NV12/YUYV. Default 1.
+// HWC_HEADLESS_ROTATION: 1 if planes can rotate by 180 degrees. Default 0.
+// HWC_HEADLESS_MODIFIERS: Comma separated list of DRM format modifiers, in
+//                        hex, universal planes accept. Default none.
+class HeadlessDisplayManager : public DisplayManager {
+ public:
+  HeadlessDisplayManager(GpuDevice *device);
+  ~HeadlessDisplayManager() override;
+
+  bool Initialize() override;
+
+  void InitializeDisplayResources() override;
+
+  void StartHotPlugMonitor() override;
+
+  NativeDisplay *GetVirtualDisplay() override;
+  NativeDisplay *GetNestedDisplay() override;
+
+  std::vector<NativeDisplay *> GetAllDisplays() override;
+
+  void RegisterHotPlugEventCallback(
+      std::shared_ptr<DisplayHotPlugEventCallback> callback) override;
+
+  void ForceRefresh() override;
+
+  void IgnoreUpdates() override;
+
+  void NotifyClientsOfDisplayChangeStatus();
+
+  void HandleLazyInitialization();
+
+ private:
+  static int OpenDevice();
+  static bool ParseModes(const char *config,
+                         std::vector<std::vector<HeadlessMode>> *displays);
+  static void GetPlaneCaps(std::vector<HeadlessPlaneCaps> *planes);
+
+  std::unique_ptr<NativeDisplay> virtual_display_;
+  std::unique_ptr<NativeDisplay> nested_display_;
+  std::vector<std::unique_ptr<HeadlessDisplay>> displays_;
+  std::shared_ptr<DisplayHotPlugEventCallback> callback_ = NULL;
+  std::unique_ptr<NativeBufferHandler> buffer_handler_;
+  GpuDevice *device_ = NULL;
+  int fd_ = -1;
+  bool release_lock_ = false;
+  SpinLock spin_lock_;
+};
+
+}  // namespace hwcomposer
+#endif  // WSI_HEADLESS_DISPLAY_MANAGER_H_
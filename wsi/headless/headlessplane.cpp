@@ -0,0 +1,132 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "headlessplane.h"
+
+#include <drm_fourcc.h>
+
+#include <algorithm>
+
+#include "hwctrace.h"
+#include "hwcutils.h"
+#include "overlaylayer.h"
+
+namespace hwcomposer {
+
+HeadlessPlane::HeadlessPlane(uint32_t plane_id, const HeadlessPlaneCaps& caps)
+    : id_(plane_id), caps_(caps) {
+  for (uint32_t format : caps_.formats) {
+    if (!preferred_video_format_ && IsSupportedMediaFormat(format))
+      preferred_video_format_ = format;
+
+    switch (format) {
+      case DRM_FORMAT_ARGB8888:
+      case DRM_FORMAT_XRGB8888:
+      case DRM_FORMAT_ABGR8888:
+      case DRM_FORMAT_XBGR8888:
+        if (!preferred_format_)
+          preferred_format_ = format;
+        break;
+    }
+  }
+
+  if (!preferred_video_format_)
+    preferred_video_format_ = preferred_format_;
+}
+
+HeadlessPlane::~HeadlessPlane() {
+}
+
+bool HeadlessPlane::ValidateLayer(const OverlayLayer* layer) {
+  OverlayBuffer* buffer = layer->GetBuffer();
+  if (!IsSupportedFormat(buffer->GetFormat())) {
+    IDISPLAYMANAGERTRACE(
+        "Layer cannot be supported as format is not supported.");
+    return false;
+  }
+
+  uint64_t modifier = buffer->GetModifier();
+  if (modifier && !caps_.modifiers.empty() &&
+      std::find(caps_.modifiers.begin(), caps_.modifiers.end(), modifier) ==
+          caps_.modifiers.end()) {
+    IDISPLAYMANAGERTRACE(
+        "Layer cannot be supported as modifier is not supported.");
+    return false;
+  }
+
+  return IsSupportedTransform(layer->GetPlaneTransform());
+}
+
+bool HeadlessPlane::IsSupportedFormat(uint32_t format) {
+  for (uint32_t supported : caps_.formats) {
+    if (supported == format)
+      return true;
+  }
+
+  return false;
+}
+
+bool HeadlessPlane::IsSupportedTransform(uint32_t transform) const {
+  if (transform & kTransform90)
+    return caps_.transforms & kTransform90;
+
+  if (transform & kTransform180)
+    return caps_.transforms & kTransform180;
+
+  if (transform & kTransform270)
+    return caps_.transforms & kTransform270;
+
+  return true;
+}
+
+uint32_t HeadlessPlane::GetPreferredVideoFormat() const {
+  return preferred_video_format_;
+}
+
+uint32_t HeadlessPlane::GetPreferredFormat() const {
+  return preferred_format_;
+}
+
+void HeadlessPlane::GetSupportedModifiers(
+    uint32_t format, std::vector<uint64_t>* modifiers) const {
+  if (std::find(caps_.formats.begin(), caps_.formats.end(), format) ==
+      caps_.formats.end())
+    return;
+
+  modifiers->insert(modifiers->end(), caps_.modifiers.begin(),
+                    caps_.modifiers.end());
+}
+
+void HeadlessPlane::SetInUse(bool in_use) {
+  in_use_ = in_use;
+}
+
+void HeadlessPlane::Dump() const {
+  DUMPTRACE("Plane Information Starts. -------------");
+  DUMPTRACE("Plane ID: %d", id_);
+  DUMPTRACE("Type: %s.", caps_.cursor ? "Cursor" : "Headless");
+  for (uint32_t j = 0; j < caps_.formats.size(); j++)
+    DUMPTRACE("Format: %4.4s", (char*)&caps_.formats[j]);
+
+  for (uint32_t j = 0; j < caps_.modifiers.size(); j++)
+    DUMPTRACE("Modifier: %llx", (unsigned long long)caps_.modifiers[j]);
+
+  DUMPTRACE("Transforms: %x", caps_.transforms);
+  DUMPTRACE("Enabled: %d", in_use_);
+  DUMPTRACE("Plane Information Ends. -------------");
+}
+
+}  // namespace hwcomposer
@@ -0,0 +1,87 @@
+/*
+// Copyright (c) 2018 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#ifndef WSI_HEADLESS_HEADLESSPLANE_H_
+#define WSI_HEADLESS_HEADLESSPLANE_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "displayplane.h"
+
+namespace hwcomposer {
+
+struct OverlayLayer;
+
+// Capabilities of a simulated plane.
+struct HeadlessPlaneCaps {
+  std::vector<uint32_t> formats;
+  // Modifiers every format can be scanned out with. Empty if the plane
+  // only supports implicit layouts.
+  std::vector<uint64_t> modifiers;
+  // Mask of HWCTransform values which can be handled by the plane.
+  uint32_t transforms = 0;
+  bool cursor = false;
+};
+
+// Plane of a HeadlessDisplay. There is no hardware behind it, it only
+// checks layers against the configured capabilities so that plane
+// allocation behaves like it would on real hardware.
+class HeadlessPlane : public DisplayPlane {
+ public:
+  HeadlessPlane(uint32_t plane_id, const HeadlessPlaneCaps& caps);
+  ~HeadlessPlane() override;
+
+  uint32_t id() const override {
+    return id_;
+  }
+
+  bool ValidateLayer(const OverlayLayer* layer) override;
+
+  bool IsSupportedFormat(uint32_t format) override;
+
+  bool IsSupportedTransform(uint32_t transform) const override;
+
+  uint32_t GetPreferredVideoFormat() const override;
+  uint32_t GetPreferredFormat() const override;
+
+  void GetSupportedModifiers(uint32_t format,
+                             std::vector<uint64_t>* modifiers) const override;
+
+  void SetInUse(bool in_use) override;
+
+  bool InUse() const override {
+    return in_use_;
+  }
+
+  bool IsUniversal() override {
+    return !caps_.cursor;
+  }
+
+  void Dump() const override;
+
+ private:
+  uint32_t id_;
+  HeadlessPlaneCaps caps_;
+  uint32_t preferred_video_format_ = 0;
+  uint32_t preferred_format_ = 0;
+  bool in_use_ = false;
+};
+
+}  // namespace hwcomposer
+#endif  // WSI_HEADLESS_HEADLESSPLANE_H_
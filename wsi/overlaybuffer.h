@@ -76,6 +76,9 @@ class OverlayBuffer {
 
   virtual const uint32_t* GetOffsets() const = 0;
 
+  // DRM_FORMAT_MOD_* layout of the buffer, zero if linear or not known.
+  virtual uint64_t GetModifier() const = 0;
+
   // external_import should be true if this resource is not owned by HWC.
   // If resource is owned by HWC, than the implementation needs to create
   // frame buffer for this buffer.
@@ -84,6 +87,12 @@ class OverlayBuffer {
 
   virtual const ResourceHandle& GetGpuResource() = 0;
 
+  // Imports the luma and chroma planes of NV12 and P010 buffers as images
+  // of their own, for shaders doing the YUV to RGB conversion. Other
+  // buffers are left as they are.
+  virtual const ResourceHandle& GetPlanarGpuResource(
+      GpuDisplay egl_display) = 0;
+
   // Returns Media resource for this buffer which can be used by compositor.
   // Surface will be clipped to width, height even if buffer size is
   // greater than these values.
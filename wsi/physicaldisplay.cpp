@@ -118,6 +118,9 @@ void PhysicalDisplay::DisConnect() {
     display_queue_->SetPowerMode(kOff);
   }
 
+  // Whatever was kept is of no use for the next connection.
+  display_queue_->DropSuspendedState();
+
   connection_state_ &= ~kConnected;
   display_state_ &= ~kUpdateDisplay;
   SPIN_UNLOCK(modeset_lock_);
@@ -310,6 +313,42 @@ bool PhysicalDisplay::Present(std::vector<HwcLayer *> &source_layers,
   return success;
 }
 
+bool PhysicalDisplay::ValidateLayers(
+    std::vector<HwcLayer *> &source_layers,
+    std::vector<HWCLayerComposition> *composition) {
+  CTRACE();
+  SPIN_LOCK(modeset_lock_);
+  // Cloned displays share the layers of the source display, we can't
+  // predict composition for all of them here.
+  bool supported = (display_state_ & kUpdateDisplay) && clones_.empty() &&
+                   !source_display_;
+  SPIN_UNLOCK(modeset_lock_);
+  if (!supported)
+    return false;
+
+  return display_queue_->ValidateLayers(source_layers, composition);
+}
+
+bool PhysicalDisplay::UpdateCursor(HwcLayer *cursor_layer,
+                                   int32_t *retire_fence) {
+  CTRACE();
+  *retire_fence = -1;
+  SPIN_LOCK(modeset_lock_);
+  // Clones show the layers of their source display, let them all be
+  // updated by the next Present.
+  bool supported = (display_state_ & kUpdateDisplay) && clones_.empty() &&
+                   !source_display_;
+  SPIN_UNLOCK(modeset_lock_);
+  if (!supported)
+    return false;
+
+  if (!display_queue_->UpdateCursor(cursor_layer, retire_fence))
+    return false;
+
+  cursor_layer->Validate();
+  return true;
+}
+
 bool PhysicalDisplay::PresentClone(std::vector<HwcLayer *> &source_layers,
                                    int32_t *retire_fence, bool idle_frame) {
   CTRACE();
@@ -431,6 +470,81 @@ void PhysicalDisplay::RestoreVideoDefaultDeinterlace() {
   display_queue_->RestoreVideoDefaultDeinterlace();
 }
 
+void PhysicalDisplay::UpdateVideoState(int64_t session_id, bool is_prepared) {
+  display_queue_->UpdateVideoState(session_id, is_prepared);
+}
+
+void PhysicalDisplay::UpdateVideoFPS(int64_t session_id, int32_t fps) {
+  display_queue_->UpdateVideoFPS(session_id, fps);
+}
+
+void PhysicalDisplay::SetOptimizationMode(HWCOptimizationMode mode) {
+  display_queue_->SetOptimizationMode(mode);
+}
+
+bool PhysicalDisplay::SetOverscan(int32_t x_overscan, int32_t y_overscan) {
+  display_queue_->SetOverscan(x_overscan, y_overscan);
+  return true;
+}
+
+bool PhysicalDisplay::GetOverscan(int32_t *x_overscan, int32_t *y_overscan) {
+  display_queue_->GetOverscan(x_overscan, y_overscan);
+  return true;
+}
+
+bool PhysicalDisplay::SetDisplayScaling(HWCDisplayScaling mode) {
+  display_queue_->SetDisplayScaling(mode);
+  return true;
+}
+
+bool PhysicalDisplay::GetDisplayScaling(HWCDisplayScaling *mode) {
+  *mode = display_queue_->GetDisplayScaling();
+  return true;
+}
+
+bool PhysicalDisplay::SetBlank(bool blank) {
+  return display_queue_->SetBlank(blank);
+}
+
+bool PhysicalDisplay::GetFrameStatistics(
+    uint64_t since_frame, std::vector<HwcFrameStatistics> *frames) {
+  display_queue_->GetFrameStatistics(since_frame, frames);
+  return true;
+}
+
+bool PhysicalDisplay::GetSurfacePoolStatistics(
+    HwcSurfacePoolStatistics *stats) {
+  display_queue_->GetSurfacePoolStatistics(stats);
+  return true;
+}
+
+bool PhysicalDisplay::GetLayerStatistics(
+    std::vector<HwcLayerStatistics> *layers) {
+  display_queue_->GetLayerStatistics(layers);
+  return true;
+}
+
+bool PhysicalDisplay::StartFrameCapture(uint32_t frames,
+                                        const char *directory) {
+  return display_queue_->StartFrameCapture(width_, height_, frames,
+                                           directory);
+}
+
+bool PhysicalDisplay::GetFrameCaptureStatistics(
+    HwcFrameCaptureStatistics *stats) {
+  display_queue_->GetFrameCaptureStatistics(stats);
+  return true;
+}
+
+void PhysicalDisplay::TakeCapturedFrames(
+    std::vector<HwcCapturedFrame> *frames) {
+  display_queue_->TakeCapturedFrames(frames);
+}
+
+void PhysicalDisplay::SetWarmSuspend(bool enable, uint64_t surface_budget) {
+  display_queue_->SetWarmSuspend(enable, surface_budget);
+}
+
 bool PhysicalDisplay::PopulatePlanes(
     std::vector<std::unique_ptr<DisplayPlane>> & /*overlay_planes*/) {
   ETRACE("PopulatePlanes unimplemented in PhysicalDisplay.");
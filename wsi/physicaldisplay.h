@@ -68,6 +68,11 @@ class PhysicalDisplay : public NativeDisplay, public DisplayPlaneHandler {
   bool Present(std::vector<HwcLayer *> &source_layers, int32_t *retire_fence,
                bool handle_constraints = false) override;
 
+  bool ValidateLayers(std::vector<HwcLayer *> &source_layers,
+                      std::vector<HWCLayerComposition> *composition) override;
+
+  bool UpdateCursor(HwcLayer *cursor_layer, int32_t *retire_fence) override;
+
   int RegisterVsyncCallback(std::shared_ptr<VsyncCallback> callback,
                             uint32_t display_id) override;
 
@@ -92,6 +97,30 @@ class PhysicalDisplay : public NativeDisplay, public DisplayPlaneHandler {
   void SetVideoDeinterlace(HWCDeinterlaceFlag flag,
                            HWCDeinterlaceControl mode) override;
   void RestoreVideoDefaultDeinterlace() override;
+  void UpdateVideoState(int64_t session_id, bool is_prepared) override;
+  void UpdateVideoFPS(int64_t session_id, int32_t fps) override;
+  void SetOptimizationMode(HWCOptimizationMode mode) override;
+
+  bool SetOverscan(int32_t x_overscan, int32_t y_overscan) override;
+  bool GetOverscan(int32_t *x_overscan, int32_t *y_overscan) override;
+  bool SetDisplayScaling(HWCDisplayScaling mode) override;
+  bool GetDisplayScaling(HWCDisplayScaling *mode) override;
+  bool SetBlank(bool blank) override;
+
+  bool GetFrameStatistics(uint64_t since_frame,
+                          std::vector<HwcFrameStatistics> *frames) override;
+
+  bool GetSurfacePoolStatistics(HwcSurfacePoolStatistics *stats) override;
+
+  bool GetLayerStatistics(std::vector<HwcLayerStatistics> *layers) override;
+
+  bool StartFrameCapture(uint32_t frames, const char *directory) override;
+
+  bool GetFrameCaptureStatistics(HwcFrameCaptureStatistics *stats) override;
+
+  void TakeCapturedFrames(std::vector<HwcCapturedFrame> *frames) override;
+
+  void SetWarmSuspend(bool enable, uint64_t surface_budget) override;
 
   void Connect() override;
 
@@ -157,6 +186,26 @@ class PhysicalDisplay : public NativeDisplay, public DisplayPlaneHandler {
                       const DisplayPlaneStateList &previous_composition_planes,
                       bool disable_explicit_fence, int32_t *commit_fence) = 0;
 
+  /**
+  * API for updating only the plane showing the cursor, on top of the last
+  * committed frame.
+  * @param plane showing the cursor.
+  * @param layer cursor layer with its new position and/or buffer.
+  * @param zorder position of plane in the last committed frame.
+  * @param position_only is set to true if only the position of the cursor
+  *        changed.
+  * @param commit_fence hardware fence associated with this update, -1 if
+  *        there is none.
+  * @return false if the display can't take the update right now, it will
+  *         then go with the next Commit.
+  */
+  virtual bool CommitCursor(DisplayPlane * /*plane*/,
+                            const OverlayLayer * /*layer*/,
+                            uint32_t /*zorder*/, bool /*position_only*/,
+                            int32_t * /*commit_fence*/) {
+    return false;
+  }
+
   /**
   * API is called if current active display configuration has changed.
   * Implementations need to reset any state in this case.
@@ -168,6 +217,16 @@ class PhysicalDisplay : public NativeDisplay, public DisplayPlaneHandler {
   */
   virtual void PowerOn() = 0;
 
+  /**
+  * API is called when rate at which content is updated changes, i.e.
+  * during video playback. Implementations can switch refresh rate to
+  * match it, as long as this doesn't need a full modeset.
+  * @param rate content frame rate, 0 if content rate is unknown and
+  *        refresh rate of active configuration should be used.
+  */
+  virtual void UpdateContentRate(float /*rate*/) {
+  }
+
   /**
   * API for initializing display. Implementation needs to handle all things
   * needed to set up the physical display.